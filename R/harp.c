@@ -787,8 +787,8 @@ SEXP rharp_import_product(SEXP sname, SEXP soperations, SEXP soptions)
         options = CHAR(STRING_ELT(soptions, 0));
     }
 
-    /* harp import */
-    if (harp_import(filename, operations, options, &hp) != 0)
+    /* harp import (variable data is read on demand while converting the product) */
+    if (harp_import_lazy(filename, operations, options, &hp) != 0)
     {
         rharp_error();
     }
@@ -824,7 +824,13 @@ SEXP rharp_import_product(SEXP sname, SEXP soperations, SEXP soptions)
     for (i = 0; i < hp->num_variables; i++)
     {
         harp_variable *hv = hp->variable[i];
-        SEXP var = rharp_import_variable(hv);
+        SEXP var;
+
+        if (harp_variable_ensure_loaded(hv) != 0)
+        {
+            rharp_error();
+        }
+        var = rharp_import_variable(hv);
 
         SET_VECTOR_ELT(product, i + 2, var);
     }
@@ -32,11 +32,129 @@
 #include "harp-area-mask.h"
 #include "harp-csv.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <ctype.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
+/* maximum number of polygons in a leaf node of the spatial index */
+#define AREA_MASK_INDEX_LEAF_SIZE 4
+
+typedef struct area_mask_cache_entry_struct
+{
+    char *filename;
+    time_t modification_time;
+    off_t size;
+    harp_area_mask *area_mask;
+} area_mask_cache_entry;
+
+/* area masks read from file are cached by filename such that they only need to be read (and indexed) once when the
+ * same operation is applied to many products */
+static long num_cache_entries = 0;
+static area_mask_cache_entry *cache_entry = NULL;
+
+typedef struct intersects_area_query_struct
+{
+    const harp_spherical_polygon *area;
+    double min_fraction;
+} intersects_area_query;
+
+static double vector3d_angle(const harp_vector3d *vectora, const harp_vector3d *vectorb)
+{
+    double dotproduct = harp_vector3d_dotproduct(vectora, vectorb);
+
+    if (dotproduct >= 1.0)
+    {
+        return 0.0;
+    }
+    if (dotproduct <= -1.0)
+    {
+        return M_PI;
+    }
+    return acos(dotproduct);
+}
+
+static void spherical_cap_from_point(harp_spherical_cap *cap, const harp_spherical_point *point)
+{
+    harp_vector3d_from_spherical_point(&cap->centre, point);
+    cap->radius = 0;
+}
+
+/* Determine a cap that encloses the polygon.
+ * Since a valid polygon never covers more than half the globe, a cap around the polygon centre that contains all
+ * polygon points will also contain all polygon segments and the polygon interior (as long as the cap radius is less
+ * than 90 degrees). If this is not the case we return a cap that covers the whole sphere.
+ */
+static void spherical_cap_from_polygon(harp_spherical_cap *cap, const harp_spherical_polygon *polygon)
+{
+    double norm;
+    double min_dotproduct = 1.0;
+    int32_t i;
+
+    harp_spherical_polygon_centre(&cap->centre, polygon);
+    norm = harp_vector3d_norm(&cap->centre);
+    if (HARP_GEOMETRY_FPzero(norm))
+    {
+        cap->centre.x = 0;
+        cap->centre.y = 0;
+        cap->centre.z = 1;
+        cap->radius = M_PI;
+        return;
+    }
+    cap->centre.x /= norm;
+    cap->centre.y /= norm;
+    cap->centre.z /= norm;
+
+    for (i = 0; i < polygon->numberofpoints; i++)
+    {
+        harp_vector3d vector;
+        double dotproduct;
+
+        harp_vector3d_from_spherical_point(&vector, &polygon->point[i]);
+        dotproduct = harp_vector3d_dotproduct(&cap->centre, &vector);
+        if (dotproduct < min_dotproduct)
+        {
+            min_dotproduct = dotproduct;
+        }
+    }
+
+    if (min_dotproduct <= 0)
+    {
+        cap->radius = M_PI;
+        return;
+    }
+    cap->radius = acos(min_dotproduct) + HARP_GEOMETRY_EPSILON;
+}
+
+static int spherical_caps_overlap(const harp_spherical_cap *capa, const harp_spherical_cap *capb)
+{
+    double max_angle = capa->radius + capb->radius + HARP_GEOMETRY_EPSILON;
+
+    if (max_angle >= M_PI)
+    {
+        return 1;
+    }
+    return vector3d_angle(&capa->centre, &capb->centre) <= max_angle;
+}
+
+static void clear_index(harp_area_mask *area_mask)
+{
+    if (area_mask->node != NULL)
+    {
+        free(area_mask->node);
+        area_mask->node = NULL;
+    }
+    if (area_mask->polygon_index != NULL)
+    {
+        free(area_mask->polygon_index);
+        area_mask->polygon_index = NULL;
+    }
+    area_mask->num_nodes = 0;
+}
+
 int harp_area_mask_new(harp_area_mask **new_area_mask)
 {
     harp_area_mask *area_mask;
@@ -51,15 +169,47 @@ int harp_area_mask_new(harp_area_mask **new_area_mask)
 
     area_mask->num_polygons = 0;
     area_mask->polygon = NULL;
+    area_mask->cap = NULL;
+    area_mask->num_nodes = 0;
+    area_mask->node = NULL;
+    area_mask->polygon_index = NULL;
+    area_mask->reference_count = 1;
 
     *new_area_mask = area_mask;
     return 0;
 }
 
+/* area masks from the cache can be shared by operations that are created or deleted from different threads, so
+ * changes to the reference count are serialized */
+static void add_reference(harp_area_mask *area_mask)
+{
+#ifdef _OPENMP
+#pragma omp critical (harp_area_mask_reference_count)
+#endif
+    {
+        area_mask->reference_count++;
+    }
+}
+
+/* releases a reference to the area mask; the area mask is only deleted once the last reference is released */
 void harp_area_mask_delete(harp_area_mask *area_mask)
 {
     if (area_mask != NULL)
     {
+        int reference_count;
+
+#ifdef _OPENMP
+#pragma omp critical (harp_area_mask_reference_count)
+#endif
+        {
+            area_mask->reference_count--;
+            reference_count = area_mask->reference_count;
+        }
+        if (reference_count > 0)
+        {
+            return;
+        }
+
         if (area_mask->polygon != NULL)
         {
             long i;
@@ -71,6 +221,11 @@ void harp_area_mask_delete(harp_area_mask *area_mask)
 
             free(area_mask->polygon);
         }
+        if (area_mask->cap != NULL)
+        {
+            free(area_mask->cap);
+        }
+        clear_index(area_mask);
 
         free(area_mask);
     }
@@ -86,6 +241,7 @@ int harp_area_mask_add_polygon(harp_area_mask *area_mask, harp_spherical_polygon
     if (area_mask->num_polygons % BLOCK_SIZE == 0)
     {
         harp_spherical_polygon **new_polygon = NULL;
+        harp_spherical_cap *new_cap = NULL;
 
         new_polygon = realloc(area_mask->polygon, (area_mask->num_polygons + BLOCK_SIZE)
                               * sizeof(harp_spherical_polygon *));
@@ -96,79 +252,258 @@ int harp_area_mask_add_polygon(harp_area_mask *area_mask, harp_spherical_polygon
                            __FILE__, __LINE__);
             return -1;
         }
-
         area_mask->polygon = new_polygon;
+
+        new_cap = realloc(area_mask->cap, (area_mask->num_polygons + BLOCK_SIZE) * sizeof(harp_spherical_cap));
+        if (new_cap == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (area_mask->num_polygons + BLOCK_SIZE) * sizeof(harp_spherical_cap), __FILE__, __LINE__);
+            return -1;
+        }
+        area_mask->cap = new_cap;
     }
 
+    /* any existing index is no longer valid */
+    clear_index(area_mask);
+
     area_mask->polygon[area_mask->num_polygons] = polygon;
+    spherical_cap_from_polygon(&area_mask->cap[area_mask->num_polygons], polygon);
     area_mask->num_polygons++;
     return 0;
 }
 
-/* returns true (1) if at least one polygon of the mask covers the given point */
-int harp_area_mask_covers_point(const harp_area_mask *area_mask, const harp_spherical_point *point)
+static double cap_coordinate(const harp_spherical_cap *cap, int axis)
 {
-    long i;
+    switch (axis)
+    {
+        case 0:
+            return cap->centre.x;
+        case 1:
+            return cap->centre.y;
+        default:
+            break;
+    }
+    return cap->centre.z;
+}
 
-    for (i = 0; i < area_mask->num_polygons; i++)
+/* reorder polygon_index[first .. first + count - 1] such that the element at position first + count / 2 is the median
+ * (with regard to the cap centre coordinate along the given axis) and all elements before/after it are
+ * smaller/larger
+ */
+static void partition_polygons(harp_area_mask *area_mask, long first, long count, int axis)
+{
+    long *index = area_mask->polygon_index;
+    long left = first;
+    long right = first + count - 1;
+    long median = first + count / 2;
+
+    while (left < right)
     {
-        if (harp_spherical_polygon_contains_point(area_mask->polygon[i], point))
+        double pivot = cap_coordinate(&area_mask->cap[index[(left + right) / 2]], axis);
+        long i = left;
+        long j = right;
+
+        while (i <= j)
         {
-            return 1;
+            while (cap_coordinate(&area_mask->cap[index[i]], axis) < pivot)
+            {
+                i++;
+            }
+            while (cap_coordinate(&area_mask->cap[index[j]], axis) > pivot)
+            {
+                j--;
+            }
+            if (i <= j)
+            {
+                long tmp = index[i];
+
+                index[i] = index[j];
+                index[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (median <= j)
+        {
+            right = j;
+        }
+        else if (median >= i)
+        {
+            left = i;
+        }
+        else
+        {
+            break;
         }
     }
-
-    return 0;
 }
 
-/* returns true (1) if at least one polygon of the mask covers the given polygon */
-int harp_area_mask_covers_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+static long build_index_node(harp_area_mask *area_mask, long first, long count)
 {
+    harp_area_mask_node *node;
+    harp_vector3d minimum = { 2, 2, 2 };
+    harp_vector3d maximum = { -2, -2, -2 };
+    harp_vector3d sum = { 0, 0, 0 };
+    double norm;
+    long node_index;
     long i;
 
-    for (i = 0; i < area_mask->num_polygons; i++)
+    node_index = area_mask->num_nodes;
+    area_mask->num_nodes++;
+    node = &area_mask->node[node_index];
+
+    for (i = first; i < first + count; i++)
     {
-        if (harp_spherical_polygon_spherical_polygon_relationship(area_mask->polygon[i], area, 0)
-            == HARP_GEOMETRY_POLY_CONTAINS)
+        const harp_vector3d *centre = &area_mask->cap[area_mask->polygon_index[i]].centre;
+
+        sum.x += centre->x;
+        sum.y += centre->y;
+        sum.z += centre->z;
+        minimum.x = centre->x < minimum.x ? centre->x : minimum.x;
+        minimum.y = centre->y < minimum.y ? centre->y : minimum.y;
+        minimum.z = centre->z < minimum.z ? centre->z : minimum.z;
+        maximum.x = centre->x > maximum.x ? centre->x : maximum.x;
+        maximum.y = centre->y > maximum.y ? centre->y : maximum.y;
+        maximum.z = centre->z > maximum.z ? centre->z : maximum.z;
+    }
+
+    /* the cap of the node encloses the caps of all its polygons */
+    norm = harp_vector3d_norm(&sum);
+    if (HARP_GEOMETRY_FPzero(norm))
+    {
+        node->cap.centre.x = 0;
+        node->cap.centre.y = 0;
+        node->cap.centre.z = 1;
+        node->cap.radius = M_PI;
+    }
+    else
+    {
+        node->cap.centre.x = sum.x / norm;
+        node->cap.centre.y = sum.y / norm;
+        node->cap.centre.z = sum.z / norm;
+        node->cap.radius = 0;
+        for (i = first; i < first + count; i++)
         {
-            return 1;
+            const harp_spherical_cap *cap = &area_mask->cap[area_mask->polygon_index[i]];
+            double radius = vector3d_angle(&node->cap.centre, &cap->centre) + cap->radius;
+
+            if (radius > node->cap.radius)
+            {
+                node->cap.radius = radius;
+            }
+        }
+        if (node->cap.radius > M_PI)
+        {
+            node->cap.radius = M_PI;
         }
     }
 
-    return 0;
+    if (count <= AREA_MASK_INDEX_LEAF_SIZE)
+    {
+        node->first_polygon = first;
+        node->num_polygons = count;
+        node->child[0] = -1;
+        node->child[1] = -1;
+    }
+    else
+    {
+        long child[2];
+        int axis = 0;
+
+        /* split along the axis with the largest spread of cap centres */
+        if (maximum.y - minimum.y > maximum.x - minimum.x)
+        {
+            axis = 1;
+        }
+        if (maximum.z - minimum.z > (axis == 0 ? maximum.x - minimum.x : maximum.y - minimum.y))
+        {
+            axis = 2;
+        }
+        partition_polygons(area_mask, first, count, axis);
+
+        child[0] = build_index_node(area_mask, first, count / 2);
+        child[1] = build_index_node(area_mask, first + count / 2, count - count / 2);
+
+        /* the node array is allocated up front, so 'node' is still valid */
+        node->first_polygon = first;
+        node->num_polygons = 0;
+        node->child[0] = child[0];
+        node->child[1] = child[1];
+    }
+
+    return node_index;
 }
 
-/* returns true (1) if at least one polygon of the mask falls inside the given polygon */
-int harp_area_mask_inside_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+/* Build a hierarchy of bounding caps for the polygons of the area mask.
+ * This speeds up the harp_area_mask_covers_point(), harp_area_mask_covers_area(), harp_area_mask_inside_area(),
+ * harp_area_mask_intersects_area(), and harp_area_mask_intersects_area_with_fraction() functions for area masks with
+ * many polygons, since only polygons whose bounding cap overlaps with the query point/area will need to be tested.
+ * The index is discarded when a polygon is added to the area mask.
+ */
+int harp_area_mask_build_index(harp_area_mask *area_mask)
 {
     long i;
 
+    clear_index(area_mask);
+
+    if (area_mask->num_polygons == 0)
+    {
+        return 0;
+    }
+
+    area_mask->polygon_index = (long *)malloc(area_mask->num_polygons * sizeof(long));
+    if (area_mask->polygon_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       area_mask->num_polygons * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
     for (i = 0; i < area_mask->num_polygons; i++)
     {
-        if (harp_spherical_polygon_spherical_polygon_relationship(area_mask->polygon[i], area, 0)
-            == HARP_GEOMETRY_POLY_CONTAINED)
-        {
-            return 1;
-        }
+        area_mask->polygon_index[i] = i;
     }
 
+    /* a binary tree with at least one polygon per leaf never has more than 2 * num_polygons - 1 nodes */
+    area_mask->node = (harp_area_mask_node *)malloc(2 * area_mask->num_polygons * sizeof(harp_area_mask_node));
+    if (area_mask->node == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       2 * area_mask->num_polygons * sizeof(harp_area_mask_node), __FILE__, __LINE__);
+        clear_index(area_mask);
+        return -1;
+    }
+
+    build_index_node(area_mask, 0, area_mask->num_polygons);
+
     return 0;
 }
 
-/* returns true (1) if at least one polygon of the mask intersects the given polygon */
-int harp_area_mask_intersects_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+static int find_matching_polygon_in_node(const harp_area_mask *area_mask, long node_index,
+                                         const harp_spherical_cap *query_cap,
+                                         int (*matches)(const harp_spherical_polygon *polygon, const void *query),
+                                         const void *query)
 {
+    const harp_area_mask_node *node = &area_mask->node[node_index];
     long i;
 
-    for (i = 0; i < area_mask->num_polygons; i++)
+    if (!spherical_caps_overlap(&node->cap, query_cap))
     {
-        int has_overlap;
+        return 0;
+    }
 
-        if (harp_spherical_polygon_overlapping(area_mask->polygon[i], area, &has_overlap) != 0)
-        {
-            continue;
-        }
-        if (has_overlap)
+    if (node->num_polygons == 0)
+    {
+        return find_matching_polygon_in_node(area_mask, node->child[0], query_cap, matches, query) ||
+            find_matching_polygon_in_node(area_mask, node->child[1], query_cap, matches, query);
+    }
+
+    for (i = node->first_polygon; i < node->first_polygon + node->num_polygons; i++)
+    {
+        long polygon_id = area_mask->polygon_index[i];
+
+        if (spherical_caps_overlap(&area_mask->cap[polygon_id], query_cap) &&
+            matches(area_mask->polygon[polygon_id], query))
         {
             return 1;
         }
@@ -177,23 +512,23 @@ int harp_area_mask_intersects_area(const harp_area_mask *area_mask, const harp_s
     return 0;
 }
 
-/* returns true (1) if at least one polygon of the mask intersects the given polygon for at least the given fraction */
-int harp_area_mask_intersects_area_with_fraction(const harp_area_mask *area_mask, const harp_spherical_polygon *area,
-                                                 double min_fraction)
+/* returns true (1) if 'matches' returns true for at least one polygon of the mask.
+ * Only polygons whose bounding cap overlaps with the bounding cap of the query are tested.
+ */
+static int find_matching_polygon(const harp_area_mask *area_mask, const harp_spherical_cap *query_cap,
+                                 int (*matches)(const harp_spherical_polygon *polygon, const void *query),
+                                 const void *query)
 {
     long i;
 
-    for (i = 0; i < area_mask->num_polygons; i++)
+    if (area_mask->node != NULL)
     {
-        int has_overlap;
-        double fraction;
-
-        if (harp_spherical_polygon_overlapping_fraction(area_mask->polygon[i], area, &has_overlap, &fraction) != 0)
-        {
-            continue;
-        }
+        return find_matching_polygon_in_node(area_mask, 0, query_cap, matches, query);
+    }
 
-        if (has_overlap && fraction >= min_fraction)
+    for (i = 0; i < area_mask->num_polygons; i++)
+    {
+        if (spherical_caps_overlap(&area_mask->cap[i], query_cap) && matches(area_mask->polygon[i], query))
         {
             return 1;
         }
@@ -202,6 +537,103 @@ int harp_area_mask_intersects_area_with_fraction(const harp_area_mask *area_mask
     return 0;
 }
 
+static int polygon_contains_point(const harp_spherical_polygon *polygon, const void *query)
+{
+    return harp_spherical_polygon_contains_point(polygon, (const harp_spherical_point *)query);
+}
+
+static int polygon_contains_area(const harp_spherical_polygon *polygon, const void *query)
+{
+    return harp_spherical_polygon_spherical_polygon_relationship(polygon, (const harp_spherical_polygon *)query, 0) ==
+        HARP_GEOMETRY_POLY_CONTAINS;
+}
+
+static int polygon_inside_area(const harp_spherical_polygon *polygon, const void *query)
+{
+    return harp_spherical_polygon_spherical_polygon_relationship(polygon, (const harp_spherical_polygon *)query, 0) ==
+        HARP_GEOMETRY_POLY_CONTAINED;
+}
+
+static int polygon_intersects_area(const harp_spherical_polygon *polygon, const void *query)
+{
+    int has_overlap;
+
+    if (harp_spherical_polygon_overlapping(polygon, (const harp_spherical_polygon *)query, &has_overlap) != 0)
+    {
+        return 0;
+    }
+
+    return has_overlap;
+}
+
+static int polygon_intersects_area_with_fraction(const harp_spherical_polygon *polygon, const void *query)
+{
+    const intersects_area_query *area_query = (const intersects_area_query *)query;
+    int has_overlap;
+    double fraction;
+
+    if (harp_spherical_polygon_overlapping_fraction(polygon, area_query->area, &has_overlap, &fraction) != 0)
+    {
+        return 0;
+    }
+
+    return has_overlap && fraction >= area_query->min_fraction;
+}
+
+/* returns true (1) if at least one polygon of the mask covers the given point */
+int harp_area_mask_covers_point(const harp_area_mask *area_mask, const harp_spherical_point *point)
+{
+    harp_spherical_cap query_cap;
+
+    spherical_cap_from_point(&query_cap, point);
+
+    return find_matching_polygon(area_mask, &query_cap, polygon_contains_point, point);
+}
+
+/* returns true (1) if at least one polygon of the mask covers the given polygon */
+int harp_area_mask_covers_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+{
+    harp_spherical_cap query_cap;
+
+    spherical_cap_from_polygon(&query_cap, area);
+
+    return find_matching_polygon(area_mask, &query_cap, polygon_contains_area, area);
+}
+
+/* returns true (1) if at least one polygon of the mask falls inside the given polygon */
+int harp_area_mask_inside_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+{
+    harp_spherical_cap query_cap;
+
+    spherical_cap_from_polygon(&query_cap, area);
+
+    return find_matching_polygon(area_mask, &query_cap, polygon_inside_area, area);
+}
+
+/* returns true (1) if at least one polygon of the mask intersects the given polygon */
+int harp_area_mask_intersects_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area)
+{
+    harp_spherical_cap query_cap;
+
+    spherical_cap_from_polygon(&query_cap, area);
+
+    return find_matching_polygon(area_mask, &query_cap, polygon_intersects_area, area);
+}
+
+/* returns true (1) if at least one polygon of the mask intersects the given polygon for at least the given fraction */
+int harp_area_mask_intersects_area_with_fraction(const harp_area_mask *area_mask, const harp_spherical_polygon *area,
+                                                 double min_fraction)
+{
+    harp_spherical_cap query_cap;
+    intersects_area_query query;
+
+    spherical_cap_from_polygon(&query_cap, area);
+    query.area = area;
+    query.min_fraction = min_fraction;
+
+    return find_matching_polygon(area_mask, &query_cap, polygon_intersects_area_with_fraction, &query);
+}
+
 static int parse_polygon(const char *str, harp_spherical_polygon **polygon)
 {
     harp_spherical_point *point_array = NULL;
@@ -404,10 +836,112 @@ static int read_area_mask(FILE *stream, harp_area_mask **new_area_mask)
     return 0;
 }
 
+/* returns the cached area mask for the file (with an additional reference), or NULL if it is not in the cache */
+static harp_area_mask *get_cached_area_mask(const char *filename, const struct stat *statbuf)
+{
+    harp_area_mask *area_mask = NULL;
+    long i;
+
+    /* the cache is global, so only one thread at a time may access it */
+#ifdef _OPENMP
+#pragma omp critical (harp_area_mask_cache)
+#endif
+    {
+        for (i = 0; i < num_cache_entries; i++)
+        {
+            if (strcmp(cache_entry[i].filename, filename) == 0)
+            {
+                if (cache_entry[i].modification_time == statbuf->st_mtime && cache_entry[i].size == statbuf->st_size)
+                {
+                    area_mask = cache_entry[i].area_mask;
+                    add_reference(area_mask);
+                }
+                break;
+            }
+        }
+    }
+
+    return area_mask;
+}
+
+static int add_cached_area_mask(const char *filename, const struct stat *statbuf, harp_area_mask *area_mask)
+{
+    int result = 0;
+    long i;
+
+#ifdef _OPENMP
+#pragma omp critical (harp_area_mask_cache)
+#endif
+    {
+        for (i = 0; i < num_cache_entries; i++)
+        {
+            if (strcmp(cache_entry[i].filename, filename) == 0)
+            {
+                /* replace outdated entry */
+                harp_area_mask_delete(cache_entry[i].area_mask);
+                break;
+            }
+        }
+
+        if (i == num_cache_entries)
+        {
+            if (num_cache_entries % BLOCK_SIZE == 0)
+            {
+                area_mask_cache_entry *new_cache_entry;
+
+                new_cache_entry = realloc(cache_entry,
+                                          (num_cache_entries + BLOCK_SIZE) * sizeof(area_mask_cache_entry));
+                if (new_cache_entry == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   (num_cache_entries + BLOCK_SIZE) * sizeof(area_mask_cache_entry), __FILE__,
+                                   __LINE__);
+                    result = -1;
+                }
+                else
+                {
+                    cache_entry = new_cache_entry;
+                }
+            }
+            if (result == 0)
+            {
+                cache_entry[i].filename = strdup(filename);
+                if (cache_entry[i].filename == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)",
+                                   __FILE__, __LINE__);
+                    result = -1;
+                }
+                else
+                {
+                    num_cache_entries++;
+                }
+            }
+        }
+
+        if (result == 0)
+        {
+            cache_entry[i].modification_time = statbuf->st_mtime;
+            cache_entry[i].size = statbuf->st_size;
+            cache_entry[i].area_mask = area_mask;
+            add_reference(area_mask);
+        }
+    }
+
+    return result;
+}
+
+/* Read an area mask from file.
+ * Area masks are cached by filename (as long as the modification time and size of the file do not change), so the
+ * returned area mask may be shared. It should therefore not be modified and should be released using
+ * harp_area_mask_delete().
+ */
 int harp_area_mask_read(const char *filename, harp_area_mask **new_area_mask)
 {
     FILE *stream;
     harp_area_mask *area_mask;
+    struct stat statbuf;
+    int use_cache;
 
     if (filename == NULL)
     {
@@ -415,6 +949,17 @@ int harp_area_mask_read(const char *filename, harp_area_mask **new_area_mask)
         return -1;
     }
 
+    use_cache = (stat(filename, &statbuf) == 0);
+    if (use_cache)
+    {
+        area_mask = get_cached_area_mask(filename, &statbuf);
+        if (area_mask != NULL)
+        {
+            *new_area_mask = area_mask;
+            return 0;
+        }
+    }
+
     stream = fopen(filename, "r");
     if (stream == NULL)
     {
@@ -431,6 +976,44 @@ int harp_area_mask_read(const char *filename, harp_area_mask **new_area_mask)
 
     fclose(stream);
 
+    if (harp_area_mask_build_index(area_mask) != 0)
+    {
+        harp_area_mask_delete(area_mask);
+        return -1;
+    }
+
+    if (use_cache)
+    {
+        if (add_cached_area_mask(filename, &statbuf, area_mask) != 0)
+        {
+            harp_area_mask_delete(area_mask);
+            return -1;
+        }
+    }
+
     *new_area_mask = area_mask;
     return 0;
 }
+
+/* remove all area masks from the cache */
+void harp_area_mask_done(void)
+{
+    long i;
+
+#ifdef _OPENMP
+#pragma omp critical (harp_area_mask_cache)
+#endif
+    {
+        for (i = 0; i < num_cache_entries; i++)
+        {
+            free(cache_entry[i].filename);
+            harp_area_mask_delete(cache_entry[i].area_mask);
+        }
+        if (cache_entry != NULL)
+        {
+            free(cache_entry);
+            cache_entry = NULL;
+        }
+        num_cache_entries = 0;
+    }
+}
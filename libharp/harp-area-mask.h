@@ -34,15 +34,43 @@
 
 #include "harp-geometry.h"
 
+/* Spherical cap (all points within an angular distance 'radius' [rad] of the unit vector 'centre') */
+typedef struct harp_spherical_cap_struct
+{
+    harp_vector3d centre;
+    double radius;
+} harp_spherical_cap;
+
+/* Node of the bounding cap hierarchy of an area mask.
+ * A leaf node references the polygons polygon_index[first_polygon] .. polygon_index[first_polygon + num_polygons - 1].
+ * For non-leaf nodes num_polygons is 0 and 'child' contains the indices of the two child nodes.
+ */
+typedef struct harp_area_mask_node_struct
+{
+    harp_spherical_cap cap;
+    long first_polygon;
+    long num_polygons;
+    long child[2];
+} harp_area_mask_node;
+
 typedef struct harp_area_mask_struct
 {
     long num_polygons;
     harp_spherical_polygon **polygon;
+    harp_spherical_cap *cap;    /* bounding cap for each polygon */
+
+    /* spatial index (only available after harp_area_mask_build_index() has been called) */
+    long num_nodes;
+    harp_area_mask_node *node;
+    long *polygon_index;
+
+    int reference_count;
 } harp_area_mask;
 
 int harp_area_mask_new(harp_area_mask **new_area_mask);
 void harp_area_mask_delete(harp_area_mask *area_mask);
 int harp_area_mask_add_polygon(harp_area_mask *area_mask, harp_spherical_polygon *polygon);
+int harp_area_mask_build_index(harp_area_mask *area_mask);
 
 int harp_area_mask_covers_point(const harp_area_mask *area_mask, const harp_spherical_point *point);
 int harp_area_mask_covers_area(const harp_area_mask *area_mask, const harp_spherical_polygon *area);
@@ -52,4 +80,5 @@ int harp_area_mask_intersects_area_with_fraction(const harp_area_mask *area_mask
                                                  double min_fraction);
 
 int harp_area_mask_read(const char *path, harp_area_mask **new_area_mask);
+void harp_area_mask_done(void);
 #endif
@@ -31,15 +31,31 @@
 
 #include "harp-internal.h"
 #include "harp-geometry.h"
+#include "hashtable.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define MAX_NAME_LENGTH 128
 #define LATLON_BLOCK_SIZE 1024
+#define POLYGON_CHUNKS_PER_THREAD 16
+#define BIN_GROUPS_PER_TASK 16
+#define BIN_KEY_BLOCK_SIZE 1024
+#define BIN_STREAM_BUFFER_SIZE (64 * 1024 * 1024)
+
+/* spill files can be larger than 2GB, so we need a seek with a 64-bit offset (long is only 32-bit on Windows) */
+#ifdef WIN32
+#define spill_file_seek(file, offset) _fseeki64(file, offset, SEEK_SET)
+#else
+#define spill_file_seek(file, offset) fseeko(file, (off_t)(offset), SEEK_SET)
+#endif
 
 typedef enum binning_type_enum
 {
@@ -866,406 +882,487 @@ static double find_weight_for_polygon_and_cell(long num_points, double *poly_lat
     return poly_area / cell_area;
 }
 
-static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bounds, harp_variable *longitude_bounds,
-                                                      long num_latitude_edges, double *latitude_edges,
-                                                      long num_longitude_edges, double *longitude_edges,
-                                                      long *num_latlon_index, long **latlon_cell_index,
-                                                      double **latlon_weight)
+/* scratch buffers that are needed for determining the matching cells and weights of a single polygon */
+typedef struct polygon_workspace_struct
 {
-    double *temp_poly_latitude = NULL;
-    double *temp_poly_longitude = NULL;
-    double *poly_latitude = NULL;
-    double *poly_longitude = NULL;
-    long num_latitude_cells = num_latitude_edges - 1;
-    long num_longitude_cells = num_longitude_edges - 1;
-    long *min_lat_id = NULL, *max_lat_id = NULL;        /* min/max grid latitude index for each longitude grid row */
-    long *min_lon_id = NULL, *max_lon_id = NULL;        /* min/max grid longitude index for each latitude grid row */
-    long cumsum_index = 0;
-    long num_elements;
-    long max_num_vertices;
-    long i, j, k;
+    double *poly_latitude;
+    double *poly_longitude;
+    double *temp_poly_latitude;
+    double *temp_poly_longitude;
+    long *min_lat_id;   /* min grid latitude index for each longitude grid row */
+    long *max_lat_id;   /* max grid latitude index for each longitude grid row */
+    long *min_lon_id;   /* min grid longitude index for each latitude grid row */
+    long *max_lon_id;   /* max grid longitude index for each latitude grid row */
+} polygon_workspace;
+
+/* matching cells and weights for a consecutive range of samples */
+typedef struct cell_weight_list_struct
+{
+    long num_cells;
+    long *cell_index;
+    double *weight;
+    int status;
+    harp_thread_error error;    /* error that was set by the thread that processed the samples (if status != 0) */
+} cell_weight_list;
+
+static void polygon_workspace_delete(polygon_workspace *workspace)
+{
+    if (workspace->poly_latitude != NULL)
+    {
+        free(workspace->poly_latitude);
+    }
+    if (workspace->poly_longitude != NULL)
+    {
+        free(workspace->poly_longitude);
+    }
+    if (workspace->temp_poly_latitude != NULL)
+    {
+        free(workspace->temp_poly_latitude);
+    }
+    if (workspace->temp_poly_longitude != NULL)
+    {
+        free(workspace->temp_poly_longitude);
+    }
+    if (workspace->min_lat_id != NULL)
+    {
+        free(workspace->min_lat_id);
+    }
+    if (workspace->max_lat_id != NULL)
+    {
+        free(workspace->max_lat_id);
+    }
+    if (workspace->min_lon_id != NULL)
+    {
+        free(workspace->min_lon_id);
+    }
+    if (workspace->max_lon_id != NULL)
+    {
+        free(workspace->max_lon_id);
+    }
+    free(workspace);
+}
 
-    num_elements = latitude_bounds->dimension[0];
-    max_num_vertices = latitude_bounds->dimension[latitude_bounds->num_dimensions - 1];
+static int polygon_workspace_new(long max_num_vertices, long num_latitude_cells, long num_longitude_cells,
+                                 polygon_workspace **new_workspace)
+{
+    polygon_workspace *workspace;
 
-    if (longitude_bounds->dimension[latitude_bounds->num_dimensions - 1] != max_num_vertices)
+    workspace = malloc(sizeof(polygon_workspace));
+    if (workspace == NULL)
     {
-        harp_set_error(HARP_ERROR_INVALID_VARIABLE, "latitude_bounds and longitude_bounds variables should have the "
-                       "same length for the inpendent dimension");
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(polygon_workspace), __FILE__, __LINE__);
         return -1;
     }
+    workspace->poly_latitude = NULL;
+    workspace->poly_longitude = NULL;
+    workspace->temp_poly_latitude = NULL;
+    workspace->temp_poly_longitude = NULL;
+    workspace->min_lat_id = NULL;
+    workspace->max_lat_id = NULL;
+    workspace->min_lon_id = NULL;
+    workspace->max_lon_id = NULL;
 
     /* add 1 point to allow closing the polygon (i.e. repeat first point at the end) */
     /* and allow room for 2 more points to close polygons that cover a pole */
-    poly_latitude = malloc((max_num_vertices + 3) * sizeof(double));
-    if (poly_latitude == NULL)
+    workspace->poly_latitude = malloc((max_num_vertices + 3) * sizeof(double));
+    if (workspace->poly_latitude == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (max_num_vertices + 3) * sizeof(double), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
-    poly_longitude = malloc((max_num_vertices + 3) * sizeof(double));
-    if (poly_longitude == NULL)
+    workspace->poly_longitude = malloc((max_num_vertices + 3) * sizeof(double));
+    if (workspace->poly_longitude == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (max_num_vertices + 3) * sizeof(double), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
     /* the temporary polygon is used for calculating the overlap fraction with a cell */
     /* it needs to be able to hold three times the amount of points as the input polygon */
-    temp_poly_latitude = malloc(3 * (max_num_vertices + 3) * sizeof(double));
-    if (temp_poly_latitude == NULL)
+    workspace->temp_poly_latitude = malloc(3 * (max_num_vertices + 3) * sizeof(double));
+    if (workspace->temp_poly_latitude == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        3 * (max_num_vertices + 3) * sizeof(double), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
-    temp_poly_longitude = malloc(3 * (max_num_vertices + 3) * sizeof(double));
-    if (temp_poly_longitude == NULL)
+    workspace->temp_poly_longitude = malloc(3 * (max_num_vertices + 3) * sizeof(double));
+    if (workspace->temp_poly_longitude == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        3 * (max_num_vertices + 3) * sizeof(double), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
 
     /* add two to the length to allow indexing just before and after the range */
-    min_lat_id = malloc((num_longitude_cells + 2) * sizeof(long));
-    if (min_lat_id == NULL)
+    workspace->min_lat_id = malloc((num_longitude_cells + 2) * sizeof(long));
+    if (workspace->min_lat_id == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (num_longitude_cells + 2) * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
-    max_lat_id = malloc((num_longitude_cells + 2) * sizeof(long));
-    if (max_lat_id == NULL)
+    workspace->max_lat_id = malloc((num_longitude_cells + 2) * sizeof(long));
+    if (workspace->max_lat_id == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (num_longitude_cells + 2) * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
-    min_lon_id = malloc((num_latitude_cells + 2) * sizeof(long));
-    if (min_lon_id == NULL)
+    workspace->min_lon_id = malloc((num_latitude_cells + 2) * sizeof(long));
+    if (workspace->min_lon_id == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (num_latitude_cells + 2) * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
-    max_lon_id = malloc((num_latitude_cells + 2) * sizeof(long));
-    if (max_lon_id == NULL)
+    workspace->max_lon_id = malloc((num_latitude_cells + 2) * sizeof(long));
+    if (workspace->max_lon_id == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
                        (num_latitude_cells + 2) * sizeof(long), __FILE__, __LINE__);
-        goto error;
+        polygon_workspace_delete(workspace);
+        return -1;
     }
 
-    for (i = 0; i < num_elements; i++)
+    *new_workspace = workspace;
+    return 0;
+}
+
+/* determine the matching cells and weights for a single polygon with 'max_num_vertices' vertices (trailing NaN
+ * vertices are ignored) and append them to latlon_cell_index/latlon_weight
+ */
+static int find_matching_cells_and_weights_for_polygon(polygon_workspace *workspace, long max_num_vertices,
+                                                       const double *latitude_bounds, const double *longitude_bounds,
+                                                       long num_latitude_edges, double *latitude_edges,
+                                                       long num_longitude_edges, double *longitude_edges,
+                                                       long *num_latlon_index, long *cumsum_index,
+                                                       long **latlon_cell_index, double **latlon_weight)
+{
+    double *temp_poly_latitude = workspace->temp_poly_latitude;
+    double *temp_poly_longitude = workspace->temp_poly_longitude;
+    double *poly_latitude = workspace->poly_latitude;
+    double *poly_longitude = workspace->poly_longitude;
+    long num_latitude_cells = num_latitude_edges - 1;
+    long num_longitude_cells = num_longitude_edges - 1;
+    long *min_lat_id = workspace->min_lat_id;
+    long *max_lat_id = workspace->max_lat_id;
+    long *min_lon_id = workspace->min_lon_id;
+    long *max_lon_id = workspace->max_lon_id;
+    long j, k;
+
+    double lat_min, lat_max, lon_min, lon_max;
+    long num_vertices = max_num_vertices;
+    int loop;
+
+    *num_latlon_index = 0;
+
+    memcpy(poly_latitude, latitude_bounds, max_num_vertices * sizeof(double));
+    memcpy(poly_longitude, longitude_bounds, max_num_vertices * sizeof(double));
+    while (num_vertices > 0 && harp_isnan(poly_latitude[num_vertices - 1]))
     {
-        double lat_min, lat_max, lon_min, lon_max;
-        long num_vertices = max_num_vertices;
-        int loop;
+        num_vertices--;
+    }
+    if (num_vertices > 2 && poly_latitude[0] == poly_latitude[num_vertices - 1] &&
+        poly_longitude[0] == poly_longitude[num_vertices - 1])
+    {
+        /* remove duplicate point (make_2d_polygon will introduce it again) */
+        num_vertices--;
+    }
+    if (num_vertices == 2)
+    {
+        /* treat this as a bounding rect -> create a polygon with four points from the edge coordinates */
+        poly_latitude[2] = poly_latitude[1];
+        poly_longitude[2] = poly_longitude[1];
+        poly_latitude[1] = poly_latitude[0];
+        poly_latitude[3] = poly_latitude[2];
+        poly_longitude[3] = poly_longitude[0];
+        num_vertices = 4;
+    }
+    else if (num_vertices < 2)
+    {
+        /* skip polygon */
+        return 0;
+    }
+
+    /* TODO:
+     * - reorder polygon such that it is turning counter-clockwise
+     * - check that the polygon is convex
+     *   this can be done by looking at the outer products of vec(0,k) X vec(0,k+1)
+     *   this should be positive (>=0) for all 0<k<n-1
+     */
+
+    make_2d_polygon(&num_vertices, poly_latitude, poly_longitude, longitude_edges[0], &lat_min, &lat_max, &lon_min,
+                    &lon_max);
+    if (num_vertices == 0)
+    {
+        return 0;
+    }
+
+    if (lat_max <= latitude_edges[0] || lat_min >= latitude_edges[num_latitude_edges - 1])
+    {
+        return 0;
+    }
 
-        num_latlon_index[i] = 0;
+    /* We loop twice to handle wrap-around situations. The second time we use longitudes + 360 */
+    for (loop = 0; loop < 2; loop++)
+    {
+        long lat_id = -1, lon_id = -1;
+        long next_lat_id, next_lon_id;
+        long cumsum_offset = *cumsum_index;
 
-        memcpy(poly_latitude, &latitude_bounds->data.double_data[i * max_num_vertices],
-               max_num_vertices * sizeof(double));
-        memcpy(poly_longitude, &longitude_bounds->data.double_data[i * max_num_vertices],
-               max_num_vertices * sizeof(double));
-        while (num_vertices > 0 && harp_isnan(poly_latitude[num_vertices - 1]))
+        if (loop == 1)
         {
-            num_vertices--;
+            lon_min += 360;
+            lon_max += 360;
+            for (k = 0; k < num_vertices; k++)
+            {
+                poly_longitude[k] += 360;
+            }
         }
-        if (num_vertices > 2 && poly_latitude[0] == poly_latitude[num_vertices - 1] &&
-            poly_longitude[0] == poly_longitude[num_vertices - 1])
+
+        if (lon_max <= longitude_edges[0] || lon_min >= longitude_edges[num_longitude_edges - 1])
         {
-            /* remove duplicate point (make_2d_polygon will introduce it again) */
-            num_vertices--;
+            continue;
         }
-        if (num_vertices == 2)
+
+        for (j = 0; j < num_longitude_cells + 2; j++)
         {
-            /* treat this as a bounding rect -> create a polygon with four points from the edge coordinates */
-            poly_latitude[2] = poly_latitude[1];
-            poly_longitude[2] = poly_longitude[1];
-            poly_latitude[1] = poly_latitude[0];
-            poly_latitude[3] = poly_latitude[2];
-            poly_longitude[3] = poly_longitude[0];
-            num_vertices = 4;
+            min_lat_id[j] = num_latitude_cells;
+            max_lat_id[j] = -1;
         }
-        else if (num_vertices < 2)
+        for (j = 0; j < num_latitude_cells + 2; j++)
         {
-            /* skip polygon */
-            continue;
+            min_lon_id[j] = num_longitude_cells;
+            max_lon_id[j] = -1;
         }
 
-        /* TODO:
-         * - reorder polygon such that it is turning counter-clockwise
-         * - check that the polygon is convex
-         *   this can be done by looking at the outer products of vec(0,k) X vec(0,k+1)
-         *   this should be positive (>=0) for all 0<k<n-1
-         */
-
-        make_2d_polygon(&num_vertices, poly_latitude, poly_longitude, longitude_edges[0], &lat_min, &lat_max, &lon_min,
-                        &lon_max);
-        if (num_vertices == 0)
+        /* iterate over all line segments and determine which grid cells are crossed */
+        /* we initially add each crossing cell with weight 1 */
+        harp_interpolate_find_index(num_latitude_edges, latitude_edges, poly_latitude[0], &lat_id);
+        if (lat_id == num_latitude_edges)
         {
-            continue;
+            lat_id = num_latitude_cells;
         }
-
-        if (lat_max <= latitude_edges[0] || lat_min >= latitude_edges[num_latitude_edges - 1])
+        harp_interpolate_find_index(num_longitude_edges, longitude_edges, poly_longitude[0], &lon_id);
+        if (lon_id == num_longitude_edges)
         {
-            continue;
+            lon_id = num_longitude_cells;
         }
-
-        /* We loop twice to handle wrap-around situations. The second time we use longitudes + 360 */
-        for (loop = 0; loop < 2; loop++)
+        next_lat_id = lat_id;
+        next_lon_id = lon_id;
+        /* add cell of starting point (if it falls within the grid) */
+        if (lon_id >= 0 && lon_id < num_longitude_cells && lat_id >= 0 && lat_id < num_latitude_cells)
         {
-            long lat_id = -1, lon_id = -1;
-            long next_lat_id, next_lon_id;
-            long cumsum_offset = cumsum_index;
-
-            if (loop == 1)
+            if (lon_id < min_lon_id[lat_id + 1] || lon_id > max_lon_id[lat_id + 1] ||
+                lat_id < min_lat_id[lon_id + 1] || lat_id > max_lat_id[lon_id + 1])
             {
-                lon_min += 360;
-                lon_max += 360;
-                for (k = 0; k < num_vertices; k++)
+                (*num_latlon_index)++;
+                if (add_cell_index(lat_id * num_longitude_cells + lon_id, cumsum_index, latlon_cell_index,
+                                   latlon_weight) != 0)
                 {
-                    poly_longitude[k] += 360;
+                    return -1;
                 }
             }
-
-            if (lon_max <= longitude_edges[0] || lon_min >= longitude_edges[num_longitude_edges - 1])
-            {
-                continue;
-            }
-
-            for (j = 0; j < num_longitude_cells + 2; j++)
-            {
-                min_lat_id[j] = num_latitude_cells;
-                max_lat_id[j] = -1;
-            }
-            for (j = 0; j < num_latitude_cells + 2; j++)
-            {
-                min_lon_id[j] = num_longitude_cells;
-                max_lon_id[j] = -1;
-            }
-
-            /* iterate over all line segments and determine which grid cells are crossed */
-            /* we initially add each crossing cell with weight 1 */
-            harp_interpolate_find_index(num_latitude_edges, latitude_edges, poly_latitude[0], &lat_id);
-            if (lat_id == num_latitude_edges)
+        }
+        if (lat_id < min_lat_id[lon_id + 1])
+        {
+            min_lat_id[lon_id + 1] = lat_id;
+        }
+        if (lat_id > max_lat_id[lon_id + 1])
+        {
+            max_lat_id[lon_id + 1] = lat_id;
+        }
+        if (lon_id < min_lon_id[lat_id + 1])
+        {
+            min_lon_id[lat_id + 1] = lon_id;
+        }
+        if (lon_id > max_lon_id[lat_id + 1])
+        {
+            max_lon_id[lat_id + 1] = lon_id;
+        }
+        for (j = 0; j < num_vertices - 1; j++)
+        {
+            double latitude = poly_latitude[j];
+            double longitude = poly_longitude[j];
+            double next_latitude = poly_latitude[j + 1];
+            double next_longitude = poly_longitude[j + 1];
+
+            /* determine grid location of end of line segment */
+            harp_interpolate_find_index(num_latitude_edges, latitude_edges, poly_latitude[j + 1], &next_lat_id);
+            if (next_lat_id == num_latitude_edges)
             {
-                lat_id = num_latitude_cells;
+                next_lat_id = num_latitude_cells;
             }
-            harp_interpolate_find_index(num_longitude_edges, longitude_edges, poly_longitude[0], &lon_id);
-            if (lon_id == num_longitude_edges)
+            harp_interpolate_find_index(num_longitude_edges, longitude_edges, poly_longitude[j + 1], &next_lon_id);
+            if (next_lon_id == num_longitude_edges)
             {
-                lon_id = num_longitude_cells;
+                next_lon_id = num_longitude_cells;
             }
-            next_lat_id = lat_id;
-            next_lon_id = lon_id;
-            /* add cell of starting point (if it falls within the grid) */
-            if (lon_id >= 0 && lon_id < num_longitude_cells && lat_id >= 0 && lat_id < num_latitude_cells)
+            while (lat_id != next_lat_id || lon_id != next_lon_id)
             {
-                if (lon_id < min_lon_id[lat_id + 1] || lon_id > max_lon_id[lat_id + 1] ||
-                    lat_id < min_lat_id[lon_id + 1] || lat_id > max_lat_id[lon_id + 1])
+                /* determine intermediate cells that the line segment crosses */
+                if (next_lat_id > lat_id)
                 {
-                    num_latlon_index[i]++;
-                    if (add_cell_index(lat_id * num_longitude_cells + lon_id, &cumsum_index, latlon_cell_index,
-                                       latlon_weight) != 0)
-                    {
-                        goto error;
-                    }
-                }
-            }
-            if (lat_id < min_lat_id[lon_id + 1])
-            {
-                min_lat_id[lon_id + 1] = lat_id;
-            }
-            if (lat_id > max_lat_id[lon_id + 1])
-            {
-                max_lat_id[lon_id + 1] = lat_id;
-            }
-            if (lon_id < min_lon_id[lat_id + 1])
-            {
-                min_lon_id[lat_id + 1] = lon_id;
-            }
-            if (lon_id > max_lon_id[lat_id + 1])
-            {
-                max_lon_id[lat_id + 1] = lon_id;
-            }
-            for (j = 0; j < num_vertices - 1; j++)
-            {
-                double latitude = poly_latitude[j];
-                double longitude = poly_longitude[j];
-                double next_latitude = poly_latitude[j + 1];
-                double next_longitude = poly_longitude[j + 1];
+                    double slope = (next_longitude - longitude) / (next_latitude - latitude);
 
-                /* determine grid location of end of line segment */
-                harp_interpolate_find_index(num_latitude_edges, latitude_edges, poly_latitude[j + 1], &next_lat_id);
-                if (next_lat_id == num_latitude_edges)
-                {
-                    next_lat_id = num_latitude_cells;
-                }
-                harp_interpolate_find_index(num_longitude_edges, longitude_edges, poly_longitude[j + 1], &next_lon_id);
-                if (next_lon_id == num_longitude_edges)
-                {
-                    next_lon_id = num_longitude_cells;
-                }
-                while (lat_id != next_lat_id || lon_id != next_lon_id)
-                {
-                    /* determine intermediate cells that the line segment crosses */
-                    if (next_lat_id > lat_id)
+                    if (next_lon_id > lon_id &&
+                        longitude + (latitude_edges[lat_id + 1] - latitude) * slope > longitude_edges[lon_id + 1])
                     {
-                        double slope = (next_longitude - longitude) / (next_latitude - latitude);
-
-                        if (next_lon_id > lon_id &&
-                            longitude + (latitude_edges[lat_id + 1] - latitude) * slope > longitude_edges[lon_id + 1])
-                        {
-                            /* move right */
-                            latitude += (longitude_edges[lon_id + 1] - longitude) / slope;
-                            longitude = longitude_edges[lon_id + 1];
-                            lon_id++;
-                        }
-                        else if (next_lon_id < lon_id &&
-                                 longitude + (latitude_edges[lat_id + 1] - latitude) * slope < longitude_edges[lon_id])
-                        {
-                            /* move left */
-                            latitude += (longitude_edges[lon_id] - longitude) / slope;
-                            longitude = longitude_edges[lon_id];
-                            lon_id--;
-                        }
-                        else
-                        {
-                            /* move up */
-                            longitude += (latitude_edges[lat_id + 1] - latitude) * slope;
-                            latitude = latitude_edges[lat_id + 1];
-                            lat_id++;
-                        }
+                        /* move right */
+                        latitude += (longitude_edges[lon_id + 1] - longitude) / slope;
+                        longitude = longitude_edges[lon_id + 1];
+                        lon_id++;
                     }
-                    else if (next_lat_id < lat_id)
+                    else if (next_lon_id < lon_id &&
+                             longitude + (latitude_edges[lat_id + 1] - latitude) * slope < longitude_edges[lon_id])
                     {
-                        double slope = (next_longitude - longitude) / (next_latitude - latitude);
-
-                        if (next_lon_id > lon_id &&
-                            longitude + (latitude_edges[lat_id] - latitude) * slope > longitude_edges[lon_id + 1])
-                        {
-                            /* move right */
-                            latitude += (longitude_edges[lon_id + 1] - longitude) / slope;
-                            longitude = longitude_edges[lon_id + 1];
-                            lon_id++;
-                        }
-                        else if (next_lon_id < lon_id &&
-                                 longitude + (latitude_edges[lat_id] - latitude) * slope < longitude_edges[lon_id])
-                        {
-                            /* move left */
-                            latitude += (longitude_edges[lon_id] - longitude) / slope;
-                            longitude = longitude_edges[lon_id];
-                            lon_id--;
-                        }
-                        else
-                        {
-                            /* move down */
-                            longitude += (latitude_edges[lat_id] - latitude) * slope;
-                            latitude = latitude_edges[lat_id];
-                            lat_id--;
-                        }
+                        /* move left */
+                        latitude += (longitude_edges[lon_id] - longitude) / slope;
+                        longitude = longitude_edges[lon_id];
+                        lon_id--;
                     }
                     else
                     {
-                        double slope = (next_latitude - latitude) / (next_longitude - longitude);
+                        /* move up */
+                        longitude += (latitude_edges[lat_id + 1] - latitude) * slope;
+                        latitude = latitude_edges[lat_id + 1];
+                        lat_id++;
+                    }
+                }
+                else if (next_lat_id < lat_id)
+                {
+                    double slope = (next_longitude - longitude) / (next_latitude - latitude);
 
-                        if (next_lon_id > lon_id)
-                        {
-                            /* move right */
-                            latitude += (longitude_edges[lon_id + 1] - longitude) * slope;
-                            longitude = longitude_edges[lon_id + 1];
-                            lon_id++;
-                        }
-                        else
-                        {
-                            /* move left */
-                            latitude += (longitude_edges[lon_id] - longitude) * slope;
-                            longitude = longitude_edges[lon_id];
-                            lon_id--;
-                        }
+                    if (next_lon_id > lon_id &&
+                        longitude + (latitude_edges[lat_id] - latitude) * slope > longitude_edges[lon_id + 1])
+                    {
+                        /* move right */
+                        latitude += (longitude_edges[lon_id + 1] - longitude) / slope;
+                        longitude = longitude_edges[lon_id + 1];
+                        lon_id++;
                     }
-                    /* add next cell (if it falls within the grid) */
-                    if (lon_id >= 0 && lon_id < num_longitude_cells && lat_id >= 0 && lat_id < num_latitude_cells)
+                    else if (next_lon_id < lon_id &&
+                             longitude + (latitude_edges[lat_id] - latitude) * slope < longitude_edges[lon_id])
                     {
-                        if (lon_id < min_lon_id[lat_id + 1] || lon_id > max_lon_id[lat_id + 1] ||
-                            lat_id < min_lat_id[lon_id + 1] || lat_id > max_lat_id[lon_id + 1])
-                        {
-                            num_latlon_index[i]++;
-                            if (add_cell_index(lat_id * num_longitude_cells + lon_id, &cumsum_index, latlon_cell_index,
-                                               latlon_weight) != 0)
-                            {
-                                goto error;
-                            }
-                        }
+                        /* move left */
+                        latitude += (longitude_edges[lon_id] - longitude) / slope;
+                        longitude = longitude_edges[lon_id];
+                        lon_id--;
                     }
-                    if (lat_id < min_lat_id[lon_id + 1])
+                    else
                     {
-                        min_lat_id[lon_id + 1] = lat_id;
+                        /* move down */
+                        longitude += (latitude_edges[lat_id] - latitude) * slope;
+                        latitude = latitude_edges[lat_id];
+                        lat_id--;
                     }
-                    if (lat_id > max_lat_id[lon_id + 1])
+                }
+                else
+                {
+                    double slope = (next_latitude - latitude) / (next_longitude - longitude);
+
+                    if (next_lon_id > lon_id)
                     {
-                        max_lat_id[lon_id + 1] = lat_id;
+                        /* move right */
+                        latitude += (longitude_edges[lon_id + 1] - longitude) * slope;
+                        longitude = longitude_edges[lon_id + 1];
+                        lon_id++;
                     }
-                    if (lon_id < min_lon_id[lat_id + 1])
+                    else
                     {
-                        min_lon_id[lat_id + 1] = lon_id;
+                        /* move left */
+                        latitude += (longitude_edges[lon_id] - longitude) * slope;
+                        longitude = longitude_edges[lon_id];
+                        lon_id--;
                     }
-                    if (lon_id > max_lon_id[lat_id + 1])
+                }
+                /* add next cell (if it falls within the grid) */
+                if (lon_id >= 0 && lon_id < num_longitude_cells && lat_id >= 0 && lat_id < num_latitude_cells)
+                {
+                    if (lon_id < min_lon_id[lat_id + 1] || lon_id > max_lon_id[lat_id + 1] ||
+                        lat_id < min_lat_id[lon_id + 1] || lat_id > max_lat_id[lon_id + 1])
                     {
-                        max_lon_id[lat_id + 1] = lon_id;
+                        (*num_latlon_index)++;
+                        if (add_cell_index(lat_id * num_longitude_cells + lon_id, cumsum_index, latlon_cell_index,
+                                           latlon_weight) != 0)
+                        {
+                            return -1;
+                        }
                     }
                 }
+                if (lat_id < min_lat_id[lon_id + 1])
+                {
+                    min_lat_id[lon_id + 1] = lat_id;
+                }
+                if (lat_id > max_lat_id[lon_id + 1])
+                {
+                    max_lat_id[lon_id + 1] = lat_id;
+                }
+                if (lon_id < min_lon_id[lat_id + 1])
+                {
+                    min_lon_id[lat_id + 1] = lon_id;
+                }
+                if (lon_id > max_lon_id[lat_id + 1])
+                {
+                    max_lon_id[lat_id + 1] = lon_id;
+                }
             }
+        }
 
-            /* calculate actual weight (based on overlap fraction) for each cell we have added up to now */
-            for (j = cumsum_offset; j < cumsum_index; j++)
-            {
-                lat_id = (*latlon_cell_index)[j] / num_longitude_cells;
-                lon_id = (*latlon_cell_index)[j] - lat_id * num_longitude_cells;
-                (*latlon_weight)[j] = find_weight_for_polygon_and_cell(num_vertices, poly_latitude, poly_longitude,
-                                                                       temp_poly_latitude, temp_poly_longitude,
-                                                                       &latitude_edges[lat_id],
-                                                                       &longitude_edges[lon_id]);
-            }
+        /* calculate actual weight (based on overlap fraction) for each cell we have added up to now */
+        for (j = cumsum_offset; j < *cumsum_index; j++)
+        {
+            lat_id = (*latlon_cell_index)[j] / num_longitude_cells;
+            lon_id = (*latlon_cell_index)[j] - lat_id * num_longitude_cells;
+            (*latlon_weight)[j] = find_weight_for_polygon_and_cell(num_vertices, poly_latitude, poly_longitude,
+                                                                   temp_poly_latitude, temp_poly_longitude,
+                                                                   &latitude_edges[lat_id],
+                                                                   &longitude_edges[lon_id]);
+        }
 
-            /* add all grid cells that lie fully within the polygon */
-            for (j = 0; j < num_latitude_cells; j++)
+        /* add all grid cells that lie fully within the polygon */
+        for (j = 0; j < num_latitude_cells; j++)
+        {
+            if (min_lon_id[j + 1] < max_lon_id[j + 1])
             {
-                if (min_lon_id[j + 1] < max_lon_id[j + 1])
+                for (k = min_lon_id[j + 1] + 1; k < max_lon_id[j + 1]; k++)
                 {
-                    for (k = min_lon_id[j + 1] + 1; k < max_lon_id[j + 1]; k++)
+                    long cell_index = j * num_longitude_cells + k;
+
+                    if (j > min_lat_id[k + 1] && j < max_lat_id[k + 1])
                     {
-                        long cell_index = j * num_longitude_cells + k;
+                        long l;
 
-                        if (j > min_lat_id[k + 1] && j < max_lat_id[k + 1])
+                        /* check if this cell wasn't already added due to a partial overlap */
+                        for (l = cumsum_offset; l < *cumsum_index; l++)
                         {
-                            long l;
-
-                            /* check if this cell wasn't already added due to a partial overlap */
-                            for (l = cumsum_offset; l < cumsum_index; l++)
+                            if (cell_index == (*latlon_cell_index)[l])
                             {
-                                if (cell_index == (*latlon_cell_index)[l])
-                                {
-                                    break;
-                                }
+                                break;
                             }
-                            if (l == cumsum_index)
+                        }
+                        if (l == *cumsum_index)
+                        {
+                            /* add cell with full weight */
+                            (*num_latlon_index)++;
+                            if (add_cell_index(cell_index, cumsum_index, latlon_cell_index, latlon_weight) != 0)
                             {
-                                /* add cell with full weight */
-                                num_latlon_index[i]++;
-                                if (add_cell_index(cell_index, &cumsum_index, latlon_cell_index, latlon_weight) != 0)
-                                {
-                                    goto error;
-                                }
-                                (*latlon_weight)[cumsum_index - 1] =
-                                    find_weight_for_polygon_and_cell(num_vertices, poly_latitude, poly_longitude,
-                                                                     temp_poly_latitude, temp_poly_longitude,
-                                                                     &latitude_edges[j], &longitude_edges[k]);
+                                return -1;
                             }
+                            (*latlon_weight)[*cumsum_index - 1] =
+                                find_weight_for_polygon_and_cell(num_vertices, poly_latitude, poly_longitude,
+                                                                 temp_poly_latitude, temp_poly_longitude,
+                                                                 &latitude_edges[j], &longitude_edges[k]);
                         }
                     }
                 }
@@ -1273,81 +1370,244 @@ static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bo
         }
     }
 
-    free(poly_latitude);
-    free(poly_longitude);
-    free(temp_poly_latitude);
-    free(temp_poly_longitude);
-    free(min_lat_id);
-    free(max_lat_id);
-    free(min_lon_id);
-    free(max_lon_id);
-
     return 0;
+}
 
-  error:
-    if (poly_latitude != NULL)
+static int find_matching_cells_and_weights_for_bounds(harp_variable *latitude_bounds, harp_variable *longitude_bounds,
+                                                      long num_latitude_edges, double *latitude_edges,
+                                                      long num_longitude_edges, double *longitude_edges,
+                                                      long *num_latlon_index, long **latlon_cell_index,
+                                                      double **latlon_weight)
+{
+    polygon_workspace **workspace = NULL;
+    cell_weight_list *chunk = NULL;
+    long num_elements;
+    long max_num_vertices;
+    long total_num_cells;
+    long num_chunks = 1;
+    int num_threads = 1;
+    long i;
+
+    num_elements = latitude_bounds->dimension[0];
+    max_num_vertices = latitude_bounds->dimension[latitude_bounds->num_dimensions - 1];
+
+    if (longitude_bounds->dimension[latitude_bounds->num_dimensions - 1] != max_num_vertices)
     {
-        free(poly_latitude);
+        harp_set_error(HARP_ERROR_INVALID_VARIABLE, "latitude_bounds and longitude_bounds variables should have the "
+                       "same length for the inpendent dimension");
+        return -1;
     }
-    if (poly_longitude != NULL)
+
+#ifdef _OPENMP
+    /* split the samples into consecutive chunks that are processed in parallel; each chunk gets its own result list
+     * and the lists are concatenated afterwards, so the result is identical to that of a serial run
+     */
+    num_threads = omp_get_max_threads();
+    if (num_threads > 1)
     {
-        free(poly_longitude);
+        num_chunks = num_threads * POLYGON_CHUNKS_PER_THREAD;
     }
-    if (temp_poly_latitude != NULL)
+#endif
+    if (num_chunks > num_elements)
     {
-        free(temp_poly_latitude);
+        num_chunks = num_elements > 0 ? num_elements : 1;
     }
-    if (temp_poly_longitude != NULL)
+    if (num_threads > num_chunks)
     {
-        free(temp_poly_longitude);
+        num_threads = (int)num_chunks;
     }
-    if (min_lat_id != NULL)
+
+    workspace = malloc(num_threads * sizeof(polygon_workspace *));
+    if (workspace == NULL)
     {
-        free(min_lat_id);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_threads * sizeof(polygon_workspace *), __FILE__, __LINE__);
+        goto error;
     }
-    if (max_lat_id != NULL)
+    for (i = 0; i < num_threads; i++)
     {
-        free(max_lat_id);
+        workspace[i] = NULL;
     }
-    if (min_lon_id != NULL)
+    for (i = 0; i < num_threads; i++)
     {
-        free(min_lon_id);
+        if (polygon_workspace_new(max_num_vertices, num_latitude_edges - 1, num_longitude_edges - 1, &workspace[i])
+            != 0)
+        {
+            goto error;
+        }
     }
-    if (max_lon_id != NULL)
+    chunk = malloc(num_chunks * sizeof(cell_weight_list));
+    if (chunk == NULL)
     {
-        free(max_lon_id);
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_chunks * sizeof(cell_weight_list), __FILE__, __LINE__);
+        goto error;
+    }
+    for (i = 0; i < num_chunks; i++)
+    {
+        chunk[i].num_cells = 0;
+        chunk[i].cell_index = NULL;
+        chunk[i].weight = NULL;
+        chunk[i].status = 0;
     }
 
-    return -1;
-}
-
-static int find_matching_cells_for_points(harp_variable *latitude, harp_variable *longitude, long num_latitude_edges,
-                                          double *latitude_edges, long num_longitude_edges, double *longitude_edges,
-                                          long *num_latlon_index, long **latlon_cell_index)
-{
-    long latitude_index = -1;
-    long longitude_index = -1;
-    long cumsum_index = 0;
-    long num_elements;
-    long i;
-
-    num_elements = latitude->dimension[0];
-    for (i = 0; i < num_elements; i++)
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+#endif
+    for (i = 0; i < num_chunks; i++)
     {
-        double wrapped_longitude;
+        polygon_workspace *thread_workspace = workspace[0];
+        long first = i * num_elements / num_chunks;
+        long last = (i + 1) * num_elements / num_chunks;
+        long j;
 
-        harp_interpolate_find_index(num_latitude_edges, latitude_edges, latitude->data.double_data[i], &latitude_index);
-        if (latitude_index < 0 || latitude_index >= num_latitude_edges - 1)
+#ifdef _OPENMP
+        thread_workspace = workspace[omp_get_thread_num()];
+#endif
+        /* errors can not be set from within the parallel region; collect them per chunk and report them afterwards */
+        harp_thread_error_begin();
+        for (j = first; j < last; j++)
         {
-            num_latlon_index[i] = 0;
-            continue;
+            if (find_matching_cells_and_weights_for_polygon(thread_workspace, max_num_vertices,
+                                                            &latitude_bounds->data.double_data[j * max_num_vertices],
+                                                            &longitude_bounds->data.double_data[j * max_num_vertices],
+                                                            num_latitude_edges, latitude_edges, num_longitude_edges,
+                                                            longitude_edges, &num_latlon_index[j], &chunk[i].num_cells,
+                                                            &chunk[i].cell_index, &chunk[i].weight) != 0)
+            {
+                chunk[i].status = -1;
+                break;
+            }
         }
-        wrapped_longitude = harp_wrap(longitude->data.double_data[i], longitude_edges[0], longitude_edges[0] + 360);
-        harp_interpolate_find_index(num_longitude_edges, longitude_edges, wrapped_longitude, &longitude_index);
-        if (longitude_index < 0 || longitude_index >= num_longitude_edges - 1)
+        harp_thread_error_end(&chunk[i].error);
+    }
+
+    total_num_cells = 0;
+    for (i = 0; i < num_chunks; i++)
+    {
+        if (chunk[i].status != 0)
         {
-            num_latlon_index[i] = 0;
-            continue;
+            /* the first failing chunk gives the same error as a serial run would */
+            harp_thread_error_raise(&chunk[i].error);
+            goto error;
+        }
+        total_num_cells += chunk[i].num_cells;
+    }
+
+    if (num_chunks == 1)
+    {
+        *latlon_cell_index = chunk[0].cell_index;
+        *latlon_weight = chunk[0].weight;
+        chunk[0].cell_index = NULL;
+        chunk[0].weight = NULL;
+    }
+    else if (total_num_cells > 0)
+    {
+        long cumsum_index = 0;
+
+        *latlon_cell_index = malloc(total_num_cells * sizeof(long));
+        if (*latlon_cell_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           total_num_cells * sizeof(long), __FILE__, __LINE__);
+            goto error;
+        }
+        *latlon_weight = malloc(total_num_cells * sizeof(double));
+        if (*latlon_weight == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           total_num_cells * sizeof(double), __FILE__, __LINE__);
+            goto error;
+        }
+        for (i = 0; i < num_chunks; i++)
+        {
+            if (chunk[i].num_cells > 0)
+            {
+                memcpy(&(*latlon_cell_index)[cumsum_index], chunk[i].cell_index, chunk[i].num_cells * sizeof(long));
+                memcpy(&(*latlon_weight)[cumsum_index], chunk[i].weight, chunk[i].num_cells * sizeof(double));
+                cumsum_index += chunk[i].num_cells;
+            }
+        }
+    }
+
+    for (i = 0; i < num_chunks; i++)
+    {
+        if (chunk[i].cell_index != NULL)
+        {
+            free(chunk[i].cell_index);
+        }
+        if (chunk[i].weight != NULL)
+        {
+            free(chunk[i].weight);
+        }
+    }
+    free(chunk);
+    for (i = 0; i < num_threads; i++)
+    {
+        polygon_workspace_delete(workspace[i]);
+    }
+    free(workspace);
+
+    return 0;
+
+  error:
+    if (chunk != NULL)
+    {
+        for (i = 0; i < num_chunks; i++)
+        {
+            if (chunk[i].cell_index != NULL)
+            {
+                free(chunk[i].cell_index);
+            }
+            if (chunk[i].weight != NULL)
+            {
+                free(chunk[i].weight);
+            }
+        }
+        free(chunk);
+    }
+    if (workspace != NULL)
+    {
+        for (i = 0; i < num_threads; i++)
+        {
+            if (workspace[i] != NULL)
+            {
+                polygon_workspace_delete(workspace[i]);
+            }
+        }
+        free(workspace);
+    }
+
+    return -1;
+}
+
+static int find_matching_cells_for_points(harp_variable *latitude, harp_variable *longitude, long num_latitude_edges,
+                                          double *latitude_edges, long num_longitude_edges, double *longitude_edges,
+                                          long *num_latlon_index, long **latlon_cell_index)
+{
+    long latitude_index = -1;
+    long longitude_index = -1;
+    long cumsum_index = 0;
+    long num_elements;
+    long i;
+
+    num_elements = latitude->dimension[0];
+    for (i = 0; i < num_elements; i++)
+    {
+        double wrapped_longitude;
+
+        harp_interpolate_find_index(num_latitude_edges, latitude_edges, latitude->data.double_data[i], &latitude_index);
+        if (latitude_index < 0 || latitude_index >= num_latitude_edges - 1)
+        {
+            num_latlon_index[i] = 0;
+            continue;
+        }
+        wrapped_longitude = harp_wrap(longitude->data.double_data[i], longitude_edges[0], longitude_edges[0] + 360);
+        harp_interpolate_find_index(num_longitude_edges, longitude_edges, wrapped_longitude, &longitude_index);
+        if (longitude_index < 0 || longitude_index >= num_longitude_edges - 1)
+        {
+            num_latlon_index[i] = 0;
+            continue;
         }
         num_latlon_index[i] = 1;
         if (cumsum_index % LATLON_BLOCK_SIZE == 0)
@@ -1370,117 +1630,31 @@ static int find_matching_cells_for_points(harp_variable *latitude, harp_variable
     return 0;
 }
 
-/** \addtogroup harp_product
- * @{
- */
-
-/** Bin the product's variables.
- * This will bin all variables in the time dimension. Each time sample will be put in the bin defined by bin_index.
- * All variables with a time dimension will then be resampled using these bins.
- * The resulting value for each variable will be the average of all values for the bin (using existing count or weight
- * variables as weighting factors where available).
- * Variables with multiple dimensions will have all elements in the sub dimensions averaged on an element by element
- * basis.
- *
- * Variables that have a time dimension but no unit (or using a string data type) will be removed.
- * The exception are count and weight variables, which will be summed.
- *
- * All variables that are binned (except existing count/weight variables) are converted to a double data type.
- * Bins that have no samples will end up with a NaN value.
- *
- * If the product did not already have a 'count' variable then a 'count' variable will be added to the product that
- * will contain the number of samples per bin.
- *
- * Only non-NaN values will contribute to a bin. If there are NaN values and there is not already a variable-specific
- * count or weight variable for that variable, then a separate variable-specific count variable will be created that
- * will contain the number of non-NaN values that contributed to each bin. This count variable will have the same
- * dimensions as the variable it provides the count for.
- *
- * For angle variables a variable-specific weight variable will be created (if it did not yet exist) that contains
- * the magnitude of the sum of the unit vectors that was used to calculate the angle average.
- *
- * \param product Product to regrid.
- * \param num_bins Number of target bins.
- * \param num_elements Length of bin_index array (should equal the length of the time dimension)
- * \param bin_index Array of target bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
- *
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
+/* convert all binned variables to double, convert angles to (weighted) unit vectors, and pre-multiply variables by
+ * existing counts/weights.
+ * All of this is done on a sample by sample basis, so pre-processing a set of products and then merging them gives
+ * the same result as pre-processing the merged product.
+ * The bintype array should be large enough to also store any weight variables that get added.
  */
-LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_elements, long *bin_index)
+static int bin_preprocess(harp_product *product, binning_type *bintype)
 {
-    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
-    binning_type *bintype = NULL;
-    double nan_value = harp_nan();
     long count_size = 0;
-    int32_t *bin_count = NULL;
     int32_t *count = NULL;
     float *weight = NULL;
-    long *index = NULL;
-    long i, j, k;
+    long i, k;
     int result;
 
-    if (num_elements != product->dimension[harp_dimension_time])
-    {
-        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_elements (%ld) does not match time dimension length (%ld) "
-                       "(%s:%u)", num_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
-        return -1;
-    }
-
-    for (i = 0; i < num_elements; i++)
-    {
-        if (bin_index[i] < 0 || bin_index[i] >= num_bins)
-        {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index[%ld] (%ld) should be in the range [0..%ld) (%s:%u)",
-                           i, bin_index[i], num_bins, __FILE__, __LINE__);
-            return -1;
-        }
-    }
-
-    /* make 'bintype' big enough to also store any count/weight variables that we may want to add (i.e. 1 + factor 2) */
-    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
-    if (bintype == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
-        goto error;
-    }
     for (k = 0; k < product->num_variables; k++)
     {
-        bintype[k] = get_binning_type(product->variable[k]);
-
-        /* determine the maximum number of elements (as size for the 'count' and 'weight' arrays) */
         if (bintype[k] != binning_remove && bintype[k] != binning_skip)
         {
-            long total_num_elements = product->variable[k]->num_elements;
-
-            if (num_bins > num_elements)
-            {
-                /* use longest time dimension (before vs. after binning) */
-                total_num_elements = num_bins * (total_num_elements / num_elements);
-            }
-            if (total_num_elements > count_size)
+            if (product->variable[k]->num_elements > count_size)
             {
-                count_size = total_num_elements;
+                count_size = product->variable[k]->num_elements;
             }
         }
     }
 
-    index = malloc(num_bins * sizeof(long));
-    if (index == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_bins * sizeof(long), __FILE__, __LINE__);
-        goto error;
-    }
-    bin_count = malloc(num_bins * sizeof(int32_t));
-    if (bin_count == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_bins * sizeof(int32_t), __FILE__, __LINE__);
-        goto error;
-    }
     count = malloc(count_size * sizeof(int32_t));
     if (count == NULL)
     {
@@ -1496,22 +1670,6 @@ LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_
         goto error;
     }
 
-    /* for each bin, store the index of the first sample that contributes to the bin */
-    /* this is where we will aggregate all samples for that bin */
-    for (i = 0; i < num_bins; i++)
-    {
-        index[i] = 0;   /* initialize with 0 so harp_variable_rearrange_dimension will get valid indices for all bins */
-        bin_count[i] = 0;
-    }
-    for (i = 0; i < num_elements; i++)
-    {
-        if (bin_count[bin_index[i]] == 0)
-        {
-            index[bin_index[i]] = i;
-        }
-        bin_count[bin_index[i]]++;
-    }
-
     /* pre-process all variables */
     for (k = 0; k < product->num_variables; k++)
     {
@@ -1623,44 +1781,143 @@ LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_
         }
     }
 
-    /* sum up all samples into bins (in place) and create count variables where needed */
-    for (k = 0; k < product->num_variables; k++)
-    {
-        harp_variable *variable;
-        long num_sub_elements;
+    free(weight);
+    free(count);
 
-        if (bintype[k] == binning_skip || bintype[k] == binning_remove || bintype[k] == binning_sum)
-        {
-            /* we handle the summable variables in a second iteration to prevent wrong use of weights/counts */
-            continue;
-        }
+    return 0;
 
-        variable = product->variable[k];
-        assert(variable->dimension[0] == num_elements);
-        num_sub_elements = variable->num_elements / num_elements;
+  error:
+    if (weight != NULL)
+    {
+        free(weight);
+    }
+    if (count != NULL)
+    {
+        free(count);
+    }
+    return -1;
+}
 
-        if (bintype[k] == binning_time_min)
+/* sum all pre-processed samples into their bins and post-process the binned variables.
+ * If store_variable is not NULL then a variable-specific count/weight variable will be created for each average
+ * variable k for which store_variable[k] is set, even if none of the samples of that variable is NaN. This allows
+ * binning a subset of the bins to produce the same set of variables as binning all bins at once.
+ */
+static int bin_preprocessed(harp_product *product, binning_type *bintype, long num_bins, long num_elements,
+                            long *bin_index, const uint8_t *store_variable)
+{
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    double nan_value = harp_nan();
+    long count_size = 0;
+    int32_t *bin_count = NULL;
+    int32_t *count = NULL;
+    float *weight = NULL;
+    long *index = NULL;
+    long i, j, k;
+    int result;
+
+    for (k = 0; k < product->num_variables; k++)
+    {
+        /* determine the maximum number of elements (as size for the 'count' and 'weight' arrays) */
+        if (bintype[k] != binning_remove && bintype[k] != binning_skip)
         {
-            /* take minimum of all values per bin */
-            assert(num_sub_elements == 1);
-            for (i = 0; i < num_elements; i++)
-            {
-                long target_index = index[bin_index[i]];
+            long total_num_elements = product->variable[k]->num_elements;
 
-                if (variable->data.double_data[i] < variable->data.double_data[target_index])
-                {
-                    variable->data.double_data[target_index] = variable->data.double_data[i];
-                }
+            if (num_bins > num_elements)
+            {
+                /* use longest time dimension (before vs. after binning) */
+                total_num_elements = num_bins * (total_num_elements / num_elements);
             }
-        }
-        else if (bintype[k] == binning_time_max)
-        {
-            /* take maximum of all values per bin */
-            assert(num_sub_elements == 1);
-            for (i = 0; i < num_elements; i++)
+            if (total_num_elements > count_size)
             {
-                long target_index = index[bin_index[i]];
-
+                count_size = total_num_elements;
+            }
+        }
+    }
+
+    index = malloc(num_bins * sizeof(long));
+    if (index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_bins * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+    bin_count = malloc(num_bins * sizeof(int32_t));
+    if (bin_count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_bins * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+    count = malloc(count_size * sizeof(int32_t));
+    if (count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       count_size * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+    weight = malloc(count_size * sizeof(float));
+    if (weight == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       count_size * sizeof(float), __FILE__, __LINE__);
+        goto error;
+    }
+
+    /* for each bin, store the index of the first sample that contributes to the bin */
+    /* this is where we will aggregate all samples for that bin */
+    for (i = 0; i < num_bins; i++)
+    {
+        index[i] = 0;   /* initialize with 0 so harp_variable_rearrange_dimension will get valid indices for all bins */
+        bin_count[i] = 0;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        if (bin_count[bin_index[i]] == 0)
+        {
+            index[bin_index[i]] = i;
+        }
+        bin_count[bin_index[i]]++;
+    }
+
+    /* sum up all samples into bins (in place) and create count variables where needed */
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable;
+        long num_sub_elements;
+
+        if (bintype[k] == binning_skip || bintype[k] == binning_remove || bintype[k] == binning_sum)
+        {
+            /* we handle the summable variables in a second iteration to prevent wrong use of weights/counts */
+            continue;
+        }
+
+        variable = product->variable[k];
+        assert(variable->dimension[0] == num_elements);
+        num_sub_elements = variable->num_elements / num_elements;
+
+        if (bintype[k] == binning_time_min)
+        {
+            /* take minimum of all values per bin */
+            assert(num_sub_elements == 1);
+            for (i = 0; i < num_elements; i++)
+            {
+                long target_index = index[bin_index[i]];
+
+                if (variable->data.double_data[i] < variable->data.double_data[target_index])
+                {
+                    variable->data.double_data[target_index] = variable->data.double_data[i];
+                }
+            }
+        }
+        else if (bintype[k] == binning_time_max)
+        {
+            /* take maximum of all values per bin */
+            assert(num_sub_elements == 1);
+            for (i = 0; i < num_elements; i++)
+            {
+                long target_index = index[bin_index[i]];
+
                 if (variable->data.double_data[i] > variable->data.double_data[target_index])
                 {
                     variable->data.double_data[target_index] = variable->data.double_data[i];
@@ -1704,9 +1961,17 @@ LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_
             if (result == 1)
             {
                 use_weight_variable = 1;
+                if (store_variable != NULL && store_variable[k])
+                {
+                    store_weight_variable = 1;
+                }
             }
             else
             {
+                if (store_variable != NULL && store_variable[k])
+                {
+                    store_count_variable = 1;
+                }
                 result = get_count_for_variable(product, variable, bintype, count);
                 if (result < 0)
                 {
@@ -2022,7 +2287,6 @@ LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_
         }
     }
 
-    free(bintype);
     free(weight);
     free(count);
     free(bin_count);
@@ -2031,10 +2295,6 @@ LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_
     return 0;
 
   error:
-    if (bintype != NULL)
-    {
-        free(bintype);
-    }
     if (weight != NULL)
     {
         free(weight);
@@ -2054,83 +2314,99 @@ LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_
     return -1;
 }
 
-/** Bin the product's variables into a spatial grid.
- * This will bin all variables with a time dimension into a three dimensional time x latitude x longitude grid.
- * Each time sample will first be allocated to a time bin defined by time_bin_index (similar to \a harp_product_bin).
- * Then within that time bin the sample will be allocated to the appropriate cell(s) in the latitude/longitude grid as
- * defined by the latitude_edges and longitude_edges variables.
- *
- * The lat/lon grid will be a fixed time-independent grid and will have 'num_latitude_edges-1' latitudes and
- * 'num_longitude_edges-1' longitudes.
- * The latitude_edges and longitude_edges arrays provide the boundaries of the grid cells in degrees and need to be
- * provided in a strict ascending order. The latitude edge values need to be between -90 and 90 and for the longitude
- * edge values the constraint is that the difference between the last and first edge should be <= 360.
- *
- * If the product has latitude_bounds {time,independent} and longitude_bounds {time,independent} variables then an area
- * binning is performed. This means that each sample will be allocated to each lat/lon grid cell based on the amount of
- * overlap. This overlap calculation will treat lines between points as straight lines within the carthesian plane
- * (i.e. using a Plate Carree projection, and not using great circle arcs between points on a sphere).
- *
- * If the product doesn't have lat/lon bounds per sample, it should have latitude {time} and longitude {time} variables.
- * The binning onto the lat/lon grid will then be a point binning. This means that each sample is allocated to only one
- * grid cell based on its lat/lon coordinate. To achieve a unique assignment, for each cell the lower edge will be
- * considered inclusive and the upper edge exclusive (except for the last cell (when there is no wrap-around)).
- *
- * The resulting value for each time/lat/lon cell will be the average of all values for that cell.
- * This will be a weighted average in case an area binning is performed and a straight average for point binning.
- * Variables with multiple dimensions will have all elements in its sub dimensions averaged on an element by element
- * basis (i.e. sub dimensions will be retained).
+/** \addtogroup harp_product
+ * @{
+ */
+
+/** Bin the product's variables.
+ * This will bin all variables in the time dimension. Each time sample will be put in the bin defined by bin_index.
+ * All variables with a time dimension will then be resampled using these bins.
+ * The resulting value for each variable will be the average of all values for the bin (using existing count or weight
+ * variables as weighting factors where available).
+ * Variables with multiple dimensions will have all elements in the sub dimensions averaged on an element by element
+ * basis.
  *
  * Variables that have a time dimension but no unit (or using a string data type) will be removed.
- * Any existing count or weight variables will also be removed.
+ * The exception are count and weight variables, which will be summed.
  *
- * All variables that are binned are converted to a double data type. Cells that have no samples will end up with a NaN
- * value.
+ * All variables that are binned (except existing count/weight variables) are converted to a double data type.
+ * Bins that have no samples will end up with a NaN value.
  *
- * A 'count' variable will be added to the product that will contain the number of samples per time bin.
- * In addition, a 'weight' variable will be added that will contain the sum of weights for the contribution to each
- * cell. If a variable contained NaN values then a variable specific weight variable will be created with only the sum
- * of weights for the non-NaN entries.
+ * If the product did not already have a 'count' variable then a 'count' variable will be added to the product that
+ * will contain the number of samples per bin.
  *
- * Axis variables for the time dimension such as datetime, datetime_length, datetime_start, and datetime_stop will only
- * be binned in the time dimension (and will not gain a latitude or longitude dimension).
+ * Only non-NaN values will contribute to a bin. If there are NaN values and there is not already a variable-specific
+ * count or weight variable for that variable, then a separate variable-specific count variable will be created that
+ * will contain the number of non-NaN values that contributed to each bin. This count variable will have the same
+ * dimensions as the variable it provides the count for.
+ *
+ * For angle variables a variable-specific weight variable will be created (if it did not yet exist) that contains
+ * the magnitude of the sum of the unit vectors that was used to calculate the angle average.
  *
  * \param product Product to regrid.
- * \param num_time_bins Number of target bins in the time dimension.
- * \param num_time_elements Length of bin_index array (should equal the length of the time dimension)
- * \param time_bin_index Array of target time bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
- * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
- * \param latitude_edges latitude grid edge vales
- * \param num_longitude_edges Number of edges for the longitude grid
- *        (number of longitude columns = num_longitude_edges - 1)
- * \param longitude_edges longitude grid edge vales
+ * \param num_bins Number of target bins.
+ * \param num_elements Length of bin_index array (should equal the length of the time dimension)
+ * \param bin_index Array of target bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
  *
  * \return
  *   \arg \c 0, Success.
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
-LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bins, long num_time_elements,
-                                         long *time_bin_index, long num_latitude_edges, double *latitude_edges,
-                                         long num_longitude_edges, double *longitude_edges)
+LIBHARP_API int harp_product_bin(harp_product *product, long num_bins, long num_elements, long *bin_index)
 {
-    long spatial_block_length = (num_latitude_edges - 1) * (num_longitude_edges - 1);
-    harp_data_type data_type = harp_type_double;
-    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
-    long dimension[HARP_MAX_NUM_DIMS];
-    harp_variable *latitude = NULL;
-    harp_variable *longitude = NULL;
-    binning_type *bintype = NULL;
-    double nan_value = harp_nan();
-    long *num_latlon_index = NULL;      /* number of matching latlon cells for each sample [num_time_elements] */
-    long *latlon_cell_index = NULL;     /* flat latlon cell index for each matching cell for each sample [sum(num_latlon_index)] */
-    double *latlon_weight = NULL;       /* weight for each matching cell for each sample [sum(num_latlon_index)] */
-    long *time_index = NULL;    /* index of first contributing sample for each bin */
-    long weight_size = 0;
-    int32_t *bin_count = NULL;  /* number of contributing samples for each time bin [num_time_bins] */
-    float *weight = NULL;       /* sum of weights per latlon cell and time [num_time_bins, num_latitude_edges-1, num_longitude_edges-1] */
-    long cumsum_index;  /* index into latlon_cell_index and latlon_weight */
-    int area_binning = 0;
-    long i, j, k, l;
+    binning_type *bintype;
+    long i, k;
+
+    if (num_elements != product->dimension[harp_dimension_time])
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_elements (%ld) does not match time dimension length (%ld) "
+                       "(%s:%u)", num_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        if (bin_index[i] < 0 || bin_index[i] >= num_bins)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index[%ld] (%ld) should be in the range [0..%ld) (%s:%u)",
+                           i, bin_index[i], num_bins, __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    /* make 'bintype' big enough to also store any count/weight variables that we may want to add (i.e. 1 + factor 2) */
+    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
+    if (bintype == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
+        return -1;
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        bintype[k] = get_binning_type(product->variable[k]);
+    }
+
+    if (bin_preprocess(product, bintype) != 0)
+    {
+        free(bintype);
+        return -1;
+    }
+    if (bin_preprocessed(product, bintype, num_bins, num_elements, bin_index, NULL) != 0)
+    {
+        free(bintype);
+        return -1;
+    }
+
+    free(bintype);
+
+    return 0;
+}
+
+static int check_time_bins(const harp_product *product, long num_time_bins, long num_time_elements,
+                           long *time_bin_index)
+{
+    long i;
 
     if (product->dimension[harp_dimension_latitude] > 0 || product->dimension[harp_dimension_longitude] > 0)
     {
@@ -2156,6 +2432,14 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         }
     }
 
+    return 0;
+}
+
+static int check_spatial_grid(long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
+                              double *longitude_edges)
+{
+    long i;
+
     if (num_latitude_edges < 2)
     {
         harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "need at least 2 latitude edges to perform spatial binning");
@@ -2200,59 +2484,239 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         return -1;
     }
 
+    return 0;
+}
 
-    num_latlon_index = malloc(num_time_elements * sizeof(long));
-    if (num_latlon_index == NULL)
-    {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       num_time_elements * sizeof(long), __FILE__, __LINE__);
-        goto error;
-    }
+/* get the latitude_bounds/longitude_bounds {time,independent} of the samples (for area binning) or, if the product
+ * has no bounds, the latitude/longitude {time} of the samples (for point binning)
+ */
+static int get_spatial_footprint(const harp_product *product, harp_variable **latitude, harp_variable **longitude,
+                                 int *area_binning)
+{
+    harp_data_type data_type = harp_type_double;
+    harp_dimension_type dimension_type[2];
 
     dimension_type[0] = harp_dimension_time;
     dimension_type[1] = harp_dimension_independent;
     if (harp_product_get_derived_variable(product, "latitude_bounds", &data_type, "degree_north", 2, dimension_type,
-                                          &latitude) == 0)
+                                          latitude) == 0)
     {
         if (harp_product_get_derived_variable(product, "longitude_bounds", &data_type, "degree_east", 2, dimension_type,
-                                              &longitude) == 0)
+                                              longitude) == 0)
         {
-            area_binning = 1;
-            /* determine matching cells and weighting factors */
-            if (find_matching_cells_and_weights_for_bounds(latitude, longitude, num_latitude_edges, latitude_edges,
-                                                           num_longitude_edges, longitude_edges, num_latlon_index,
-                                                           &latlon_cell_index, &latlon_weight) != 0)
-            {
-                harp_variable_delete(latitude);
-                harp_variable_delete(longitude);
-                goto error;
-            }
-            harp_variable_delete(longitude);
+            *area_binning = 1;
+            return 0;
         }
-        harp_variable_delete(latitude);
+        harp_variable_delete(*latitude);
+    }
+    if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, dimension_type,
+                                          latitude) != 0)
+    {
+        return -1;
+    }
+    if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, dimension_type,
+                                          longitude) != 0)
+    {
+        harp_variable_delete(*latitude);
+        return -1;
+    }
+    *area_binning = 0;
+
+    return 0;
+}
+
+/* identification of the spatial footprint of all samples and the target grid for which a weight table is created */
+typedef struct footprint_info_struct
+{
+    int num_dimensions; /* 1 for point binning (latitude/longitude) or 2 for area binning (latitude/longitude_bounds) */
+    long dimension[2];  /* dimensions of the latitude/longitude (bounds) of the samples */
+    char hash[17];      /* hash of the sample positions and the target grid (see get_footprint_hash()) */
+} footprint_info;
+
+static void update_footprint_hash(uint32_t *hash, uint64_t value)
+{
+    int i;
+
+    /* we hash the value as 8 bytes in little endian order, such that the hash does not depend on the platform */
+    for (i = 0; i < 8; i++)
+    {
+        uint32_t byte = (uint32_t)((value >> (8 * i)) & 0xff);
+
+        /* we combine a 32-bit FNV-1a and a 32-bit djb2 hash */
+        hash[0] = (hash[0] ^ byte) * 16777619U;
+        hash[1] = hash[1] * 33 + byte;
+    }
+}
+
+static void update_footprint_hash_with_doubles(uint32_t *hash, const double *data, long num_elements)
+{
+    long i;
+
+    for (i = 0; i < num_elements; i++)
+    {
+        uint64_t value;
+
+        /* use the IEEE 754 bit pattern of the value */
+        memcpy(&value, &data[i], sizeof(double));
+        update_footprint_hash(hash, value);
+    }
+}
+
+/* calculate a hash (as string of 16 hexadecimal digits) that identifies the combination of the spatial footprint of
+ * all samples and the target grid
+ */
+static void get_footprint_hash(const harp_variable *latitude, const harp_variable *longitude, long num_latitude_edges,
+                               const double *latitude_edges, long num_longitude_edges, const double *longitude_edges,
+                               char *hash_string)
+{
+    uint32_t hash[2] = { 2166136261U, 5381 };
+    int i;
+
+    update_footprint_hash(hash, (uint64_t)latitude->num_dimensions);
+    for (i = 0; i < latitude->num_dimensions; i++)
+    {
+        update_footprint_hash(hash, (uint64_t)latitude->dimension[i]);
+    }
+    update_footprint_hash_with_doubles(hash, latitude->data.double_data, latitude->num_elements);
+    update_footprint_hash(hash, (uint64_t)longitude->num_dimensions);
+    for (i = 0; i < longitude->num_dimensions; i++)
+    {
+        update_footprint_hash(hash, (uint64_t)longitude->dimension[i]);
+    }
+    update_footprint_hash_with_doubles(hash, longitude->data.double_data, longitude->num_elements);
+    update_footprint_hash(hash, (uint64_t)num_latitude_edges);
+    update_footprint_hash_with_doubles(hash, latitude_edges, num_latitude_edges);
+    update_footprint_hash(hash, (uint64_t)num_longitude_edges);
+    update_footprint_hash_with_doubles(hash, longitude_edges, num_longitude_edges);
+
+    sprintf(hash_string, "%08lx%08lx", (unsigned long)hash[0], (unsigned long)hash[1]);
+}
+
+/* determine the matching cells (and weights in case of area binning) for all samples of the product
+ * if footprint is not NULL it will receive the identification of the spatial footprint and the target grid
+ */
+static int find_matching_cells(const harp_product *product, long num_latitude_edges, double *latitude_edges,
+                               long num_longitude_edges, double *longitude_edges, long *num_latlon_index,
+                               long **latlon_cell_index, double **latlon_weight, footprint_info *footprint)
+{
+    harp_variable *latitude = NULL;
+    harp_variable *longitude = NULL;
+    int area_binning;
+
+    if (get_spatial_footprint(product, &latitude, &longitude, &area_binning) != 0)
+    {
+        return -1;
     }
-    if (!area_binning)
+    if (footprint != NULL)
     {
-        if (harp_product_get_derived_variable(product, "latitude", &data_type, "degree_north", 1, dimension_type,
-                                              &latitude) != 0)
+        int i;
+
+        footprint->num_dimensions = latitude->num_dimensions;
+        for (i = 0; i < latitude->num_dimensions; i++)
         {
-            goto error;
+            footprint->dimension[i] = latitude->dimension[i];
         }
-        if (harp_product_get_derived_variable(product, "longitude", &data_type, "degree_east", 1, dimension_type,
-                                              &longitude) != 0)
+        get_footprint_hash(latitude, longitude, num_latitude_edges, latitude_edges, num_longitude_edges,
+                           longitude_edges, footprint->hash);
+    }
+    if (area_binning)
+    {
+        /* determine matching cells and weighting factors */
+        if (find_matching_cells_and_weights_for_bounds(latitude, longitude, num_latitude_edges, latitude_edges,
+                                                       num_longitude_edges, longitude_edges, num_latlon_index,
+                                                       latlon_cell_index, latlon_weight) != 0)
         {
-            goto error;
+            harp_variable_delete(latitude);
+            harp_variable_delete(longitude);
+            return -1;
         }
+    }
+    else
+    {
         if (find_matching_cells_for_points(latitude, longitude, num_latitude_edges, latitude_edges, num_longitude_edges,
-                                           longitude_edges, num_latlon_index, &latlon_cell_index) != 0)
+                                           longitude_edges, num_latlon_index, latlon_cell_index) != 0)
         {
             harp_variable_delete(latitude);
             harp_variable_delete(longitude);
-            goto error;
+            return -1;
         }
-        harp_variable_delete(latitude);
-        harp_variable_delete(longitude);
     }
+    harp_variable_delete(latitude);
+    harp_variable_delete(longitude);
+
+    return 0;
+}
+
+/* add a single sample to a [time,latitude,longitude] cell of the spatial grid
+ * returns 1 if the sample contained NaN values (for which a separate weight variable will be needed), 0 otherwise
+ */
+static int add_spatial_sample(const harp_variable *variable, harp_variable *new_variable, float *weight, int is_angle,
+                              long num_sub_elements, long sample, long target_index, double sample_weight)
+{
+    int has_nan = 0;
+    long j;
+
+    if (is_angle)
+    {
+        /* for angle variables we use one weight element per complex pair */
+        for (j = 0; j < num_sub_elements; j += 2)
+        {
+            if (!harp_isnan(variable->data.double_data[sample * num_sub_elements + j]))
+            {
+                weight[(target_index * num_sub_elements + j) / 2] += sample_weight;
+                new_variable->data.double_data[target_index * num_sub_elements + j] +=
+                    sample_weight * variable->data.double_data[sample * num_sub_elements + j];
+                new_variable->data.double_data[target_index * num_sub_elements + j + 1] +=
+                    sample_weight * variable->data.double_data[sample * num_sub_elements + j + 1];
+            }
+        }
+    }
+    else
+    {
+        for (j = 0; j < num_sub_elements; j++)
+        {
+            if (!harp_isnan(variable->data.double_data[sample * num_sub_elements + j]))
+            {
+                weight[target_index * num_sub_elements + j] += sample_weight;
+                new_variable->data.double_data[target_index * num_sub_elements + j] +=
+                    sample_weight * variable->data.double_data[sample * num_sub_elements + j];
+            }
+            else
+            {
+                has_nan = 1;
+            }
+        }
+    }
+
+    return has_nan;
+}
+
+/* sum up all samples into the spatial grid, given the matching cells (and weights) for each sample */
+static int bin_spatial(harp_product *product, long num_time_bins, long num_time_elements, long *time_bin_index,
+                       long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
+                       double *longitude_edges, long *num_latlon_index, long *latlon_cell_index, double *latlon_weight)
+{
+    long spatial_block_length = (num_latitude_edges - 1) * (num_longitude_edges - 1);
+    harp_dimension_type dimension_type[HARP_MAX_NUM_DIMS];
+    long dimension[HARP_MAX_NUM_DIMS];
+    harp_variable *latitude = NULL;
+    harp_variable *longitude = NULL;
+    binning_type *bintype = NULL;
+    double nan_value = harp_nan();
+    long *time_index = NULL;    /* index of first contributing sample for each bin */
+    long weight_size = 0;
+    int32_t *bin_count = NULL;  /* number of contributing samples for each time bin [num_time_bins] */
+    float *weight = NULL;       /* sum of weights per latlon cell and time [num_time_bins, num_latitude_edges-1, num_longitude_edges-1] */
+    int use_groups = 0; /* accumulate per group of target cells (only when running multi-threaded) */
+    long group_size = 0;        /* number of target [time,latitude,longitude] cells that are accumulated together */
+    long num_groups = 0;
+    long *group_offset = NULL;  /* offset into contribution_index/contribution_sample for each group [num_groups + 1] */
+    long *contribution_index = NULL;    /* index into latlon_cell_index/latlon_weight, ordered by group */
+    long *contribution_sample = NULL;   /* sample index for each entry in contribution_index */
+    long num_contributions;
+    long cumsum_index;  /* index into latlon_cell_index and latlon_weight */
+    int area_binning = (latlon_weight != NULL);
+    long i, k, l;
 
     /* make 'bintype' big enough to also store any count/weight variables that we may want to add (i.e. 2 + factor 2) */
     bintype = malloc((2 * product->num_variables + 2) * sizeof(binning_type));
@@ -2325,6 +2789,89 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
         }
     }
 
+    /* when running multi-threaded, group all sample/cell contributions by the [time,latitude] row of the target grid
+     * that they contribute to. Each row can then be accumulated independently (and in parallel) while the
+     * contributions for each target cell are still summed in sample order, which keeps the result independent of the
+     * number of threads used. When running single-threaded, all contributions are accumulated directly in sample order.
+     */
+#ifdef _OPENMP
+    if (omp_get_max_threads() > 1 && num_longitude_edges > 1)
+    {
+        use_groups = 1;
+        group_size = num_longitude_edges - 1;
+    }
+#endif
+    if (use_groups)
+    {
+        num_groups = (num_time_bins * spatial_block_length) / group_size;
+        num_contributions = 0;
+        for (i = 0; i < num_time_elements; i++)
+        {
+            num_contributions += num_latlon_index[i];
+        }
+        group_offset = malloc((num_groups + 1) * sizeof(long));
+        if (group_offset == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (num_groups + 1) * sizeof(long), __FILE__, __LINE__);
+            goto error;
+        }
+        if (num_contributions > 0)
+        {
+            contribution_index = malloc(num_contributions * sizeof(long));
+            if (contribution_index == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_contributions * sizeof(long), __FILE__, __LINE__);
+                goto error;
+            }
+            contribution_sample = malloc(num_contributions * sizeof(long));
+            if (contribution_sample == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_contributions * sizeof(long), __FILE__, __LINE__);
+                goto error;
+            }
+        }
+        memset(group_offset, 0, (num_groups + 1) * sizeof(long));
+        cumsum_index = 0;
+        for (i = 0; i < num_time_elements; i++)
+        {
+            long index_offset = time_bin_index[i] * spatial_block_length;
+
+            for (l = 0; l < num_latlon_index[i]; l++)
+            {
+                group_offset[(index_offset + latlon_cell_index[cumsum_index]) / group_size + 1]++;
+                cumsum_index++;
+            }
+        }
+        for (i = 0; i < num_groups; i++)
+        {
+            group_offset[i + 1] += group_offset[i];
+        }
+        /* use group_offset[group] as insertion position; this shifts each offset to the start of the next group */
+        cumsum_index = 0;
+        for (i = 0; i < num_time_elements; i++)
+        {
+            long index_offset = time_bin_index[i] * spatial_block_length;
+
+            for (l = 0; l < num_latlon_index[i]; l++)
+            {
+                long group = (index_offset + latlon_cell_index[cumsum_index]) / group_size;
+
+                contribution_index[group_offset[group]] = cumsum_index;
+                contribution_sample[group_offset[group]] = i;
+                group_offset[group]++;
+                cumsum_index++;
+            }
+        }
+        for (i = num_groups; i > 0; i--)
+        {
+            group_offset[i] = group_offset[i - 1];
+        }
+        group_offset[0] = 0;
+    }
+
     /* pre-process all variables */
     for (k = 0; k < product->num_variables; k++)
     {
@@ -2377,15 +2924,37 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
 
     /* create global weight variable */
     memset(weight, 0, num_time_bins * spatial_block_length * sizeof(float));
-    cumsum_index = 0;
-    for (i = 0; i < num_time_elements; i++)
+    if (use_groups)
     {
-        long index_offset = time_bin_index[i] * spatial_block_length;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, BIN_GROUPS_PER_TASK)
+#endif
+        for (i = 0; i < num_groups; i++)
+        {
+            long m;
+
+            for (m = group_offset[i]; m < group_offset[i + 1]; m++)
+            {
+                long index = contribution_index[m];
 
-        for (l = 0; l < num_latlon_index[i]; l++)
+                weight[time_bin_index[contribution_sample[m]] * spatial_block_length + latlon_cell_index[index]] +=
+                    area_binning ? latlon_weight[index] : 1;
+            }
+        }
+    }
+    else
+    {
+        cumsum_index = 0;
+        for (i = 0; i < num_time_elements; i++)
         {
-            weight[index_offset + latlon_cell_index[cumsum_index]] += area_binning ? latlon_weight[cumsum_index] : 1;
-            cumsum_index++;
+            long index_offset = time_bin_index[i] * spatial_block_length;
+
+            for (l = 0; l < num_latlon_index[i]; l++)
+            {
+                weight[index_offset + latlon_cell_index[cumsum_index]] +=
+                    area_binning ? latlon_weight[cumsum_index] : 1;
+                cumsum_index++;
+            }
         }
     }
     dimension_type[0] = harp_dimension_time;
@@ -2490,249 +3059,2360 @@ LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bi
             harp_variable *new_variable = NULL;
             int store_weight_variable = 0;
 
-            assert(bintype[k] == binning_average || bintype[k] == binning_angle);
+            assert(bintype[k] == binning_average || bintype[k] == binning_angle);
+
+            /* we need to create a variable that includes the lat/lon dimensions and uses the binned time dimension */
+            if (variable->num_dimensions + 2 >= HARP_MAX_NUM_DIMS)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "too many dimensions (%d) for variables %s to perform "
+                               "spatial binning", variable->num_dimensions, variable->name);
+                goto error;
+            }
+            dimension_type[0] = harp_dimension_time;
+            dimension[0] = num_time_bins;
+            dimension_type[1] = harp_dimension_latitude;
+            dimension[1] = num_latitude_edges - 1;
+            dimension_type[2] = harp_dimension_longitude;
+            dimension[2] = num_longitude_edges - 1;
+            for (i = 1; i < variable->num_dimensions; i++)
+            {
+                dimension_type[i + 2] = variable->dimension_type[i];
+                dimension[i + 2] = variable->dimension[i];
+            }
+            if (harp_variable_new(variable->name, variable->data_type, variable->num_dimensions + 2, dimension_type,
+                                  dimension, &new_variable) != 0)
+            {
+                goto error;
+            }
+            if (harp_variable_copy_attributes(variable, new_variable) != 0)
+            {
+                harp_variable_delete(new_variable);
+                goto error;
+            }
+
+            /* sum up all values per cell */
+            memset(weight, 0, weight_size * sizeof(float));
+            if (use_groups)
+            {
+#ifdef _OPENMP
+#pragma omp parallel for reduction(|:store_weight_variable) schedule(dynamic, BIN_GROUPS_PER_TASK)
+#endif
+                for (l = 0; l < num_groups; l++)
+                {
+                    long m;
+
+                    for (m = group_offset[l]; m < group_offset[l + 1]; m++)
+                    {
+                        long index = contribution_index[m];
+                        long i = contribution_sample[m];
+
+                        store_weight_variable |=
+                            add_spatial_sample(variable, new_variable, weight, bintype[k] == binning_angle,
+                                               num_sub_elements, i,
+                                               time_bin_index[i] * spatial_block_length + latlon_cell_index[index],
+                                               area_binning ? latlon_weight[index] : 1);
+                    }
+                }
+            }
+            else
+            {
+                cumsum_index = 0;
+                for (i = 0; i < num_time_elements; i++)
+                {
+                    long index_offset = time_bin_index[i] * spatial_block_length;
+
+                    for (l = 0; l < num_latlon_index[i]; l++)
+                    {
+                        store_weight_variable |=
+                            add_spatial_sample(variable, new_variable, weight, bintype[k] == binning_angle,
+                                               num_sub_elements, i, index_offset + latlon_cell_index[cumsum_index],
+                                               area_binning ? latlon_weight[cumsum_index] : 1);
+                        cumsum_index++;
+                    }
+                }
+            }
+
+            /* replace variable in product with new variable */
+            product->variable[k] = new_variable;
+            harp_variable_delete(variable);
+            variable = new_variable;
+
+            /* post-process variable */
+            if (bintype[k] == binning_angle)
+            {
+                /* convert angle variables back from complex values to angles */
+                for (i = 0; i < variable->num_elements; i += 2)
+                {
+                    if (weight[i / 2] == 0)
+                    {
+                        variable->data.double_data[i] = nan_value;
+                    }
+                    else
+                    {
+                        double x = variable->data.double_data[i];
+                        double y = variable->data.double_data[i + 1];
+
+                        weight[i / 2] = sqrt(x * x + y * y);
+                        variable->data.double_data[i] = atan2(y, x);
+                    }
+                }
+                if (harp_variable_remove_dimension(variable, variable->num_dimensions - 1, 0) != 0)
+                {
+                    goto error;
+                }
+                /* convert all angles back to the original unit */
+                if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
+                {
+                    goto error;
+                }
+                store_weight_variable = 1;
+            }
+            else
+            {
+                for (i = 0; i < variable->num_elements; i++)
+                {
+                    if (weight[i] == 0)
+                    {
+                        variable->data.double_data[i] = nan_value;
+                    }
+                    else if (bintype[k] == binning_average)
+                    {
+                        /* divide by the sum of the weights */
+                        variable->data.double_data[i] /= weight[i];
+                    }
+                }
+            }
+
+            if (store_weight_variable)
+            {
+                if (add_weight_variable(product, bintype, binning_skip, variable->name, variable->num_dimensions,
+                                        variable->dimension_type, variable->dimension, weight) != 0)
+                {
+                    goto error;
+                }
+            }
+        }
+    }
+
+    /* remove all variables that need to be removed (in reverse order!) */
+    for (k = product->num_variables - 1; k >= 0; k--)
+    {
+        if (bintype[k] == binning_remove)
+        {
+            if (harp_product_remove_variable(product, product->variable[k]) != 0)
+            {
+                goto error;
+            }
+        }
+    }
+
+    free(bintype);
+    free(weight);
+    free(time_index);
+    free(bin_count);
+    free(group_offset);
+    if (contribution_index != NULL)
+    {
+        free(contribution_index);
+    }
+    if (contribution_sample != NULL)
+    {
+        free(contribution_sample);
+    }
+
+    /* add latitude_bounds and longitude_bounds variables */
+    dimension_type[0] = harp_dimension_latitude;
+    dimension[0] = num_latitude_edges - 1;
+    dimension_type[1] = harp_dimension_independent;
+    dimension[1] = 2;
+    if (harp_variable_new("latitude_bounds", harp_type_double, 2, dimension_type, dimension, &latitude) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        latitude->data.double_data[2 * i] = latitude_edges[i];
+        latitude->data.double_data[2 * i + 1] = latitude_edges[i + 1];
+    }
+    if (harp_product_add_variable(product, latitude) != 0)
+    {
+        harp_variable_delete(latitude);
+        return -1;
+    }
+    if (harp_variable_set_unit(latitude, HARP_UNIT_LATITUDE) != 0)
+    {
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_longitude;
+    dimension[0] = num_longitude_edges - 1;
+    if (harp_variable_new("longitude_bounds", harp_type_double, 2, dimension_type, dimension, &longitude) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        longitude->data.double_data[2 * i] = longitude_edges[i];
+        longitude->data.double_data[2 * i + 1] = longitude_edges[i + 1];
+    }
+    if (harp_product_add_variable(product, longitude) != 0)
+    {
+        harp_variable_delete(longitude);
+        return -1;
+    }
+    if (harp_variable_set_unit(longitude, HARP_UNIT_LONGITUDE) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+
+  error:
+    if (bintype != NULL)
+    {
+        free(bintype);
+    }
+    if (time_index != NULL)
+    {
+        free(time_index);
+    }
+    if (bin_count != NULL)
+    {
+        free(bin_count);
+    }
+    if (weight != NULL)
+    {
+        free(weight);
+    }
+    if (group_offset != NULL)
+    {
+        free(group_offset);
+    }
+    if (contribution_index != NULL)
+    {
+        free(contribution_index);
+    }
+    if (contribution_sample != NULL)
+    {
+        free(contribution_sample);
+    }
+    return -1;
+}
+
+/** Bin the product's variables into a spatial grid.
+ * This will bin all variables with a time dimension into a three dimensional time x latitude x longitude grid.
+ * Each time sample will first be allocated to a time bin defined by time_bin_index (similar to \a harp_product_bin).
+ * Then within that time bin the sample will be allocated to the appropriate cell(s) in the latitude/longitude grid as
+ * defined by the latitude_edges and longitude_edges variables.
+ *
+ * The lat/lon grid will be a fixed time-independent grid and will have 'num_latitude_edges-1' latitudes and
+ * 'num_longitude_edges-1' longitudes.
+ * The latitude_edges and longitude_edges arrays provide the boundaries of the grid cells in degrees and need to be
+ * provided in a strict ascending order. The latitude edge values need to be between -90 and 90 and for the longitude
+ * edge values the constraint is that the difference between the last and first edge should be <= 360.
+ *
+ * If the product has latitude_bounds {time,independent} and longitude_bounds {time,independent} variables then an area
+ * binning is performed. This means that each sample will be allocated to each lat/lon grid cell based on the amount of
+ * overlap. This overlap calculation will treat lines between points as straight lines within the carthesian plane
+ * (i.e. using a Plate Carree projection, and not using great circle arcs between points on a sphere).
+ *
+ * If the product doesn't have lat/lon bounds per sample, it should have latitude {time} and longitude {time} variables.
+ * The binning onto the lat/lon grid will then be a point binning. This means that each sample is allocated to only one
+ * grid cell based on its lat/lon coordinate. To achieve a unique assignment, for each cell the lower edge will be
+ * considered inclusive and the upper edge exclusive (except for the last cell (when there is no wrap-around)).
+ *
+ * The resulting value for each time/lat/lon cell will be the average of all values for that cell.
+ * This will be a weighted average in case an area binning is performed and a straight average for point binning.
+ * Variables with multiple dimensions will have all elements in its sub dimensions averaged on an element by element
+ * basis (i.e. sub dimensions will be retained).
+ *
+ * Variables that have a time dimension but no unit (or using a string data type) will be removed.
+ * Any existing count or weight variables will also be removed.
+ *
+ * All variables that are binned are converted to a double data type. Cells that have no samples will end up with a NaN
+ * value.
+ *
+ * A 'count' variable will be added to the product that will contain the number of samples per time bin.
+ * In addition, a 'weight' variable will be added that will contain the sum of weights for the contribution to each
+ * cell. If a variable contained NaN values then a variable specific weight variable will be created with only the sum
+ * of weights for the non-NaN entries.
+ *
+ * Axis variables for the time dimension such as datetime, datetime_length, datetime_start, and datetime_stop will only
+ * be binned in the time dimension (and will not gain a latitude or longitude dimension).
+ *
+ * \param product Product to regrid.
+ * \param num_time_bins Number of target bins in the time dimension.
+ * \param num_time_elements Length of bin_index array (should equal the length of the time dimension)
+ * \param time_bin_index Array of target time bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
+ * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
+ * \param latitude_edges latitude grid edge vales
+ * \param num_longitude_edges Number of edges for the longitude grid
+ *        (number of longitude columns = num_longitude_edges - 1)
+ * \param longitude_edges longitude grid edge vales
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_bin_spatial(harp_product *product, long num_time_bins, long num_time_elements,
+                                         long *time_bin_index, long num_latitude_edges, double *latitude_edges,
+                                         long num_longitude_edges, double *longitude_edges)
+{
+    long *num_latlon_index = NULL;      /* number of matching latlon cells for each sample [num_time_elements] */
+    long *latlon_cell_index = NULL;     /* flat latlon cell index for each matching cell for each sample [sum(num_latlon_index)] */
+    double *latlon_weight = NULL;       /* weight for each matching cell for each sample [sum(num_latlon_index)] */
+
+    if (check_time_bins(product, num_time_bins, num_time_elements, time_bin_index) != 0)
+    {
+        return -1;
+    }
+    if (check_spatial_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        return -1;
+    }
+
+    num_latlon_index = malloc(num_time_elements * sizeof(long));
+    if (num_latlon_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_time_elements * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (find_matching_cells(product, num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges,
+                            num_latlon_index, &latlon_cell_index, &latlon_weight, NULL) != 0)
+    {
+        goto error;
+    }
+
+    if (bin_spatial(product, num_time_bins, num_time_elements, time_bin_index, num_latitude_edges, latitude_edges,
+                    num_longitude_edges, longitude_edges, num_latlon_index, latlon_cell_index, latlon_weight) != 0)
+    {
+        goto error;
+    }
+
+    free(num_latlon_index);
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    if (latlon_weight != NULL)
+    {
+        free(latlon_weight);
+    }
+
+    return 0;
+
+  error:
+    free(num_latlon_index);
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    if (latlon_weight != NULL)
+    {
+        free(latlon_weight);
+    }
+    return -1;
+}
+
+/** Determine the weight table for binning the product's samples into a spatial grid.
+ * This performs the (potentially expensive) geometric part of #harp_product_bin_spatial and stores the result in a
+ * new product, such that it can be reused (using #harp_product_bin_spatial_with_weights) for products that have the
+ * same spatial footprint. Since the weight table is a regular HARP product, it can be written to and read from disk
+ * using #harp_export and #harp_import.
+ *
+ * The weight table product contains the following variables:
+ *  - sample_index {independent} (int32): index in the time dimension of the sample
+ *  - cell_index {independent} (int32): flat index (latitude_index * num_longitudes + longitude_index) of the cell
+ *  - weight {independent} (double): weight of the sample for the cell (1 for point binning)
+ *  - latitude_bounds {latitude,2} and longitude_bounds {longitude,2}: the target grid
+ *  - footprint_dimension {independent} (int32): dimensions of the latitude/longitude (bounds) of the samples
+ *  - footprint_hash (string): hash of the latitude/longitude (bounds) of all samples and the target grid
+ *
+ * \param product Product for which to determine the weights.
+ * \param num_latitude_edges Number of edges for the latitude grid (number of latitude rows = num_latitude_edges - 1)
+ * \param latitude_edges latitude grid edge vales
+ * \param num_longitude_edges Number of edges for the longitude grid
+ *        (number of longitude columns = num_longitude_edges - 1)
+ * \param longitude_edges longitude grid edge vales
+ * \param weights Pointer to the C variable where the new weight table product will be stored.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_get_spatial_weights(const harp_product *product, long num_latitude_edges,
+                                                 double *latitude_edges, long num_longitude_edges,
+                                                 double *longitude_edges, harp_product **weights)
+{
+    harp_dimension_type dimension_type[2];
+    long dimension[2];
+    harp_product *weights_product = NULL;
+    harp_variable *variable = NULL;
+    long num_time_elements = product->dimension[harp_dimension_time];
+    long *num_latlon_index = NULL;
+    long *latlon_cell_index = NULL;
+    double *latlon_weight = NULL;
+    footprint_info footprint;
+    long num_cells = 0;
+    long i, j;
+
+    if (check_spatial_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        return -1;
+    }
+    if ((double)(num_latitude_edges - 1) * (num_longitude_edges - 1) > 2147483647.0 ||
+        num_time_elements > 2147483647)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "number of samples or number of grid cells too large for spatial "
+                       "weight table");
+        return -1;
+    }
+
+    if (num_time_elements > 0)
+    {
+        num_latlon_index = malloc(num_time_elements * sizeof(long));
+        if (num_latlon_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_time_elements * sizeof(long), __FILE__, __LINE__);
+            return -1;
+        }
+    }
+    if (find_matching_cells(product, num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges,
+                            num_latlon_index, &latlon_cell_index, &latlon_weight, &footprint) != 0)
+    {
+        goto error;
+    }
+    for (i = 0; i < num_time_elements; i++)
+    {
+        num_cells += num_latlon_index[i];
+    }
+
+    if (harp_product_new(&weights_product) != 0)
+    {
+        goto error;
+    }
+
+    dimension_type[0] = harp_dimension_independent;
+    dimension[0] = num_cells;
+    if (harp_variable_new("sample_index", harp_type_int32, 1, dimension_type, dimension, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    num_cells = 0;
+    for (i = 0; i < num_time_elements; i++)
+    {
+        for (j = 0; j < num_latlon_index[i]; j++)
+        {
+            variable->data.int32_data[num_cells] = (int32_t)i;
+            num_cells++;
+        }
+    }
+
+    if (harp_variable_new("cell_index", harp_type_int32, 1, dimension_type, dimension, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    for (i = 0; i < num_cells; i++)
+    {
+        variable->data.int32_data[i] = (int32_t)latlon_cell_index[i];
+    }
+
+    if (harp_variable_new("weight", harp_type_double, 1, dimension_type, dimension, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    for (i = 0; i < num_cells; i++)
+    {
+        variable->data.double_data[i] = latlon_weight != NULL ? latlon_weight[i] : 1.0;
+    }
+
+    dimension_type[0] = harp_dimension_latitude;
+    dimension[0] = num_latitude_edges - 1;
+    dimension_type[1] = harp_dimension_independent;
+    dimension[1] = 2;
+    if (harp_variable_new("latitude_bounds", harp_type_double, 2, dimension_type, dimension, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        variable->data.double_data[2 * i] = latitude_edges[i];
+        variable->data.double_data[2 * i + 1] = latitude_edges[i + 1];
+    }
+    if (harp_variable_set_unit(variable, HARP_UNIT_LATITUDE) != 0)
+    {
+        goto error;
+    }
+
+    dimension_type[0] = harp_dimension_longitude;
+    dimension[0] = num_longitude_edges - 1;
+    if (harp_variable_new("longitude_bounds", harp_type_double, 2, dimension_type, dimension, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    for (i = 0; i < dimension[0]; i++)
+    {
+        variable->data.double_data[2 * i] = longitude_edges[i];
+        variable->data.double_data[2 * i + 1] = longitude_edges[i + 1];
+    }
+    if (harp_variable_set_unit(variable, HARP_UNIT_LONGITUDE) != 0)
+    {
+        goto error;
+    }
+
+    dimension_type[0] = harp_dimension_independent;
+    dimension[0] = footprint.num_dimensions;
+    if (harp_variable_new("footprint_dimension", harp_type_int32, 1, dimension_type, dimension, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    for (i = 0; i < footprint.num_dimensions; i++)
+    {
+        variable->data.int32_data[i] = (int32_t)footprint.dimension[i];
+    }
+
+    if (harp_variable_new("footprint_hash", harp_type_string, 0, NULL, NULL, &variable) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_add_variable(weights_product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        goto error;
+    }
+    if (harp_variable_set_string_data_element(variable, 0, footprint.hash) != 0)
+    {
+        goto error;
+    }
+
+    if (product->source_product != NULL)
+    {
+        if (harp_product_set_source_product(weights_product, product->source_product) != 0)
+        {
+            goto error;
+        }
+    }
+
+    if (num_latlon_index != NULL)
+    {
+        free(num_latlon_index);
+    }
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    if (latlon_weight != NULL)
+    {
+        free(latlon_weight);
+    }
+
+    *weights = weights_product;
+    return 0;
+
+  error:
+    if (weights_product != NULL)
+    {
+        harp_product_delete(weights_product);
+    }
+    if (num_latlon_index != NULL)
+    {
+        free(num_latlon_index);
+    }
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    if (latlon_weight != NULL)
+    {
+        free(latlon_weight);
+    }
+    return -1;
+}
+
+static int get_weights_variable(const harp_product *weights, const char *name, harp_data_type data_type,
+                                int num_dimensions, const harp_dimension_type *dimension_type,
+                                harp_variable **variable)
+{
+    if (harp_product_get_variable_by_name(weights, name, variable) != 0)
+    {
+        harp_add_error_message(" (invalid spatial weight table)");
+        return -1;
+    }
+    if ((*variable)->data_type != data_type || !harp_variable_has_dimension_types(*variable, num_dimensions,
+                                                                                  dimension_type))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (variable '%s' has an invalid data "
+                       "type and/or dimensions)", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Bin the product's variables into a spatial grid using a precomputed weight table.
+ * This is the same as #harp_product_bin_spatial, except that the matching grid cells and weights for each sample are
+ * taken from a weight table that was created with #harp_product_get_spatial_weights (and the target grid is taken
+ * from the latitude_bounds and longitude_bounds variables of the weight table). No geometric calculations are
+ * performed. The weight table can only be used if the latitude/longitude (bounds) of the product are identical to the
+ * ones of the product for which the weight table was created (this is verified using the footprint_hash).
+ *
+ * \param product Product to regrid.
+ * \param num_time_bins Number of target bins in the time dimension.
+ * \param num_time_elements Length of bin_index array (should equal the length of the time dimension)
+ * \param time_bin_index Array of target time bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
+ * \param weights Weight table product.
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_bin_spatial_with_weights(harp_product *product, long num_time_bins,
+                                                      long num_time_elements, long *time_bin_index,
+                                                      const harp_product *weights)
+{
+    harp_dimension_type dimension_type[2];
+    harp_variable *sample_index_variable;
+    harp_variable *cell_index_variable;
+    harp_variable *weight_variable;
+    harp_variable *bounds_variable;
+    harp_variable *footprint_dimension_variable;
+    harp_variable *hash_variable;
+    harp_variable *latitude = NULL;
+    harp_variable *longitude = NULL;
+    double *latitude_edges = NULL;
+    double *longitude_edges = NULL;
+    long num_latitude_edges;
+    long num_longitude_edges;
+    long num_grid_cells;
+    long *num_latlon_index = NULL;
+    long *latlon_cell_index = NULL;
+    char footprint_hash[17];
+    int area_binning;
+    int k;
+    long num_cells;
+    long i;
+
+    if (check_time_bins(product, num_time_bins, num_time_elements, time_bin_index) != 0)
+    {
+        return -1;
+    }
+
+    dimension_type[0] = harp_dimension_independent;
+    if (get_weights_variable(weights, "sample_index", harp_type_int32, 1, dimension_type, &sample_index_variable) != 0)
+    {
+        return -1;
+    }
+    if (get_weights_variable(weights, "cell_index", harp_type_int32, 1, dimension_type, &cell_index_variable) != 0)
+    {
+        return -1;
+    }
+    if (get_weights_variable(weights, "weight", harp_type_double, 1, dimension_type, &weight_variable) != 0)
+    {
+        return -1;
+    }
+    if (get_weights_variable(weights, "footprint_dimension", harp_type_int32, 1, dimension_type,
+                             &footprint_dimension_variable) != 0)
+    {
+        return -1;
+    }
+    if (get_weights_variable(weights, "footprint_hash", harp_type_string, 0, dimension_type, &hash_variable) != 0)
+    {
+        return -1;
+    }
+    num_cells = sample_index_variable->num_elements;
+    if (cell_index_variable->num_elements != num_cells || weight_variable->num_elements != num_cells)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (sample_index, cell_index, and "
+                       "weight should have the same length)");
+        return -1;
+    }
+
+    /* reconstruct the target grid */
+    dimension_type[0] = harp_dimension_latitude;
+    dimension_type[1] = harp_dimension_independent;
+    if (get_weights_variable(weights, "latitude_bounds", harp_type_double, 2, dimension_type, &bounds_variable) != 0)
+    {
+        return -1;
+    }
+    if (bounds_variable->dimension[1] != 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (latitude_bounds should have an "
+                       "independent dimension of length 2)");
+        return -1;
+    }
+    num_latitude_edges = bounds_variable->dimension[0] + 1;
+    latitude_edges = malloc(num_latitude_edges * sizeof(double));
+    if (latitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_latitude_edges * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_latitude_edges - 1; i++)
+    {
+        latitude_edges[i] = bounds_variable->data.double_data[2 * i];
+        if (i > 0 && bounds_variable->data.double_data[2 * i - 1] != latitude_edges[i])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (latitude_bounds of the grid "
+                           "should be contiguous)");
+            goto error;
+        }
+    }
+    latitude_edges[num_latitude_edges - 1] = bounds_variable->data.double_data[2 * (num_latitude_edges - 2) + 1];
+
+    dimension_type[0] = harp_dimension_longitude;
+    if (get_weights_variable(weights, "longitude_bounds", harp_type_double, 2, dimension_type, &bounds_variable) != 0)
+    {
+        goto error;
+    }
+    if (bounds_variable->dimension[1] != 2)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (longitude_bounds should have an "
+                       "independent dimension of length 2)");
+        goto error;
+    }
+    num_longitude_edges = bounds_variable->dimension[0] + 1;
+    longitude_edges = malloc(num_longitude_edges * sizeof(double));
+    if (longitude_edges == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_longitude_edges * sizeof(double), __FILE__, __LINE__);
+        goto error;
+    }
+    for (i = 0; i < num_longitude_edges - 1; i++)
+    {
+        longitude_edges[i] = bounds_variable->data.double_data[2 * i];
+        if (i > 0 && bounds_variable->data.double_data[2 * i - 1] != longitude_edges[i])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (longitude_bounds of the grid "
+                           "should be contiguous)");
+            goto error;
+        }
+    }
+    longitude_edges[num_longitude_edges - 1] = bounds_variable->data.double_data[2 * (num_longitude_edges - 2) + 1];
+
+    if (check_spatial_grid(num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges) != 0)
+    {
+        goto error;
+    }
+    num_grid_cells = (num_latitude_edges - 1) * (num_longitude_edges - 1);
+
+    /* verify that the weight table was created for the same spatial footprint (first the dimensions, then the values
+     * of the sample positions and the grid edges using the hash) */
+    if (get_spatial_footprint(product, &latitude, &longitude, &area_binning) != 0)
+    {
+        goto error;
+    }
+    if (footprint_dimension_variable->num_elements != latitude->num_dimensions)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weight table was created for %s binning, but the product "
+                       "requires %s binning", footprint_dimension_variable->num_elements == 2 ? "area" : "point",
+                       area_binning ? "area" : "point");
+        harp_variable_delete(latitude);
+        harp_variable_delete(longitude);
+        goto error;
+    }
+    for (k = 0; k < latitude->num_dimensions; k++)
+    {
+        if (footprint_dimension_variable->data.int32_data[k] != latitude->dimension[k])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weight table does not match the dimensions of the "
+                           "latitude/longitude (bounds) of the product (dimension %d has length %ld; expected %ld)",
+                           k, latitude->dimension[k], (long)footprint_dimension_variable->data.int32_data[k]);
+            harp_variable_delete(latitude);
+            harp_variable_delete(longitude);
+            goto error;
+        }
+    }
+    get_footprint_hash(latitude, longitude, num_latitude_edges, latitude_edges, num_longitude_edges, longitude_edges,
+                       footprint_hash);
+    harp_variable_delete(latitude);
+    harp_variable_delete(longitude);
+    if (hash_variable->data.string_data[0] == NULL || strcmp(hash_variable->data.string_data[0], footprint_hash) != 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "spatial weight table does not match the latitude/longitude "
+                       "(bounds) of the product");
+        goto error;
+    }
+
+    /* convert the weight table into matching cells per sample */
+    if (num_time_elements > 0)
+    {
+        num_latlon_index = malloc(num_time_elements * sizeof(long));
+        if (num_latlon_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_time_elements * sizeof(long), __FILE__, __LINE__);
+            goto error;
+        }
+        memset(num_latlon_index, 0, num_time_elements * sizeof(long));
+    }
+    if (num_cells > 0)
+    {
+        latlon_cell_index = malloc(num_cells * sizeof(long));
+        if (latlon_cell_index == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_cells * sizeof(long), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+    for (i = 0; i < num_cells; i++)
+    {
+        int32_t sample_index = sample_index_variable->data.int32_data[i];
+
+        if (sample_index < 0 || sample_index >= num_time_elements ||
+            (i > 0 && sample_index < sample_index_variable->data.int32_data[i - 1]))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (sample_index[%ld] (%ld) is out "
+                           "of range or out of order)", i, (long)sample_index);
+            goto error;
+        }
+        latlon_cell_index[i] = cell_index_variable->data.int32_data[i];
+        if (latlon_cell_index[i] < 0 || latlon_cell_index[i] >= num_grid_cells)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "invalid spatial weight table (cell_index[%ld] (%ld) should be "
+                           "in the range [0..%ld))", i, latlon_cell_index[i], num_grid_cells);
+            goto error;
+        }
+        num_latlon_index[sample_index]++;
+    }
+
+    if (bin_spatial(product, num_time_bins, num_time_elements, time_bin_index, num_latitude_edges, latitude_edges,
+                    num_longitude_edges, longitude_edges, num_latlon_index, latlon_cell_index,
+                    weight_variable->data.double_data) != 0)
+    {
+        goto error;
+    }
+
+    free(latitude_edges);
+    free(longitude_edges);
+    if (num_latlon_index != NULL)
+    {
+        free(num_latlon_index);
+    }
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+
+    return 0;
+
+  error:
+    if (latitude_edges != NULL)
+    {
+        free(latitude_edges);
+    }
+    if (longitude_edges != NULL)
+    {
+        free(longitude_edges);
+    }
+    if (num_latlon_index != NULL)
+    {
+        free(num_latlon_index);
+    }
+    if (latlon_cell_index != NULL)
+    {
+        free(latlon_cell_index);
+    }
+    return -1;
+}
+
+/* determine for which average variables binning will create a variable-specific count/weight variable because at
+ * least one of the samples is NaN (while having a non-zero count/weight).
+ * Flags in store_variable are only ever set (never cleared), so this can be called for multiple products.
+ */
+static int update_store_variable(harp_product *product, binning_type *bintype, uint8_t *store_variable)
+{
+    long count_size = 0;
+    int32_t *count = NULL;
+    float *weight = NULL;
+    long i, k;
+    int result;
+
+    for (k = 0; k < product->num_variables; k++)
+    {
+        if (bintype[k] == binning_average && product->variable[k]->num_elements > count_size)
+        {
+            count_size = product->variable[k]->num_elements;
+        }
+    }
+    if (count_size == 0)
+    {
+        return 0;
+    }
+
+    count = malloc(count_size * sizeof(int32_t));
+    if (count == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       count_size * sizeof(int32_t), __FILE__, __LINE__);
+        goto error;
+    }
+    weight = malloc(count_size * sizeof(float));
+    if (weight == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       count_size * sizeof(float), __FILE__, __LINE__);
+        goto error;
+    }
+
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable = product->variable[k];
+        int use_weight_variable = 0;
+
+        if (bintype[k] != binning_average || store_variable[k])
+        {
+            continue;
+        }
+
+        result = get_weight_for_variable(product, variable, bintype, weight);
+        if (result < 0)
+        {
+            goto error;
+        }
+        if (result == 1)
+        {
+            use_weight_variable = 1;
+        }
+        else
+        {
+            result = get_count_for_variable(product, variable, bintype, count);
+            if (result < 0)
+            {
+                goto error;
+            }
+            if (result == 0)
+            {
+                for (i = 0; i < variable->num_elements; i++)
+                {
+                    count[i] = 1;
+                }
+            }
+        }
+
+        for (i = 0; i < variable->num_elements; i++)
+        {
+            if (harp_isnan(variable->data.double_data[i]) && (use_weight_variable ? weight[i] != 0 : count[i] != 0))
+            {
+                store_variable[k] = 1;
+                break;
+            }
+        }
+    }
+
+    free(weight);
+    free(count);
+
+    return 0;
+
+  error:
+    if (weight != NULL)
+    {
+        free(weight);
+    }
+    if (count != NULL)
+    {
+        free(count);
+    }
+    return -1;
+}
+
+/* HARP binning stream */
+struct harp_bin_stream_struct
+{
+    long num_bins;      /* number of target bins (-1 if the bins are defined by the values of bin variables) */
+    int num_bin_variables;
+    char **bin_variable_name;
+    harp_variable **bin_variable;       /* bin variable values of the first sample of each bin (if not binned) */
+    hashtable *bin_hash;        /* maps the key for a combination of bin variable values to the bin index */
+    char **bin_key;     /* key strings referenced by bin_hash */
+    long num_bin_keys;
+
+    harp_product *layout;       /* first sample of the first pre-processed product (removed variables are scalars) */
+    binning_type *bintype;      /* binning type for each variable of the layout product */
+    uint8_t *store_variable;    /* whether a variable-specific count/weight variable needs to be created */
+    long *record_offset;        /* offset of the data of each variable within a record (-1 for removed variables) */
+    long record_size;   /* size of a record: bin index followed by the sample data of each binned variable */
+
+    long buffer_size;   /* maximum size in bytes of the in-memory record buffer */
+    long max_buffer_records;
+    long num_buffer_records;
+    char *buffer;
+    FILE *spill_file;   /* temporary file containing sorted runs of records */
+    int num_runs;
+    long *run_length;   /* number of records for each run in the spill file */
+    long num_samples;
+};
+
+typedef struct bin_record_order_struct
+{
+    long bin;
+    long index;
+} bin_record_order;
+
+typedef struct bin_run_struct
+{
+    int64_t offset;     /* file offset of the next record to read from the spill file */
+    long num_remaining; /* number of records of the run that are still in the spill file */
+    long num_records;   /* number of records in buffer */
+    long index; /* index of the current record in buffer */
+    char *buffer;
+} bin_run;
+
+static int compare_bin_record_order(const void *a, const void *b)
+{
+    const bin_record_order *order_a = (const bin_record_order *)a;
+    const bin_record_order *order_b = (const bin_record_order *)b;
+
+    if (order_a->bin != order_b->bin)
+    {
+        return order_a->bin < order_b->bin ? -1 : 1;
+    }
+    /* keep records for the same bin in the order in which they were added */
+    return order_a->index < order_b->index ? -1 : (order_a->index > order_b->index);
+}
+
+static char *append_hex(char *str, const void *data, long num_bytes)
+{
+    static const char *hex = "0123456789abcdef";
+    long i;
+
+    for (i = 0; i < num_bytes; i++)
+    {
+        *str++ = hex[((const uint8_t *)data)[i] >> 4];
+        *str++ = hex[((const uint8_t *)data)[i] & 0xf];
+    }
+    return str;
+}
+
+/* create a key string for the combination of bin variable values of a sample.
+ * Two samples will have the same key if their values compare equal (NaN values are considered equal to each other).
+ */
+static int get_bin_key(harp_variable **variable, int num_variables, long index, char **key)
+{
+    long length = 1;
+    char *str;
+    int k;
+
+    for (k = 0; k < num_variables; k++)
+    {
+        if (variable[k]->data_type == harp_type_string)
+        {
+            length += 2;
+            if (variable[k]->data.string_data[index] != NULL)
+            {
+                length += 2 * strlen(variable[k]->data.string_data[index]);
+            }
+        }
+        else
+        {
+            length += 1 + 2 * harp_get_size_for_type(variable[k]->data_type);
+        }
+    }
+
+    *key = malloc(length);
+    if (*key == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       length, __FILE__, __LINE__);
+        return -1;
+    }
+
+    str = *key;
+    for (k = 0; k < num_variables; k++)
+    {
+        switch (variable[k]->data_type)
+        {
+            case harp_type_int8:
+                *str++ = 'b';
+                str = append_hex(str, &variable[k]->data.int8_data[index], sizeof(int8_t));
+                break;
+            case harp_type_int16:
+                *str++ = 's';
+                str = append_hex(str, &variable[k]->data.int16_data[index], sizeof(int16_t));
+                break;
+            case harp_type_int32:
+                *str++ = 'i';
+                str = append_hex(str, &variable[k]->data.int32_data[index], sizeof(int32_t));
+                break;
+            case harp_type_float:
+                {
+                    float value = variable[k]->data.float_data[index];
+
+                    *str++ = 'f';
+                    if (harp_isnan(value))
+                    {
+                        value = (float)harp_nan();
+                    }
+                    else if (value == 0)
+                    {
+                        /* make sure that -0 and +0 end up in the same bin */
+                        value = 0;
+                    }
+                    str = append_hex(str, &value, sizeof(float));
+                }
+                break;
+            case harp_type_double:
+                {
+                    double value = variable[k]->data.double_data[index];
+
+                    *str++ = 'd';
+                    if (harp_isnan(value))
+                    {
+                        value = harp_nan();
+                    }
+                    else if (value == 0)
+                    {
+                        value = 0;
+                    }
+                    str = append_hex(str, &value, sizeof(double));
+                }
+                break;
+            case harp_type_string:
+                if (variable[k]->data.string_data[index] == NULL)
+                {
+                    *str++ = 'n';
+                }
+                else
+                {
+                    *str++ = 'c';
+                    str = append_hex(str, variable[k]->data.string_data[index],
+                                     strlen(variable[k]->data.string_data[index]));
+                }
+                /* terminate variable length values so keys of consecutive variables can't overlap */
+                *str++ = '.';
+                break;
+        }
+    }
+    *str = '\0';
+
+    return 0;
+}
+
+/* determine the bin index of each sample based on the values of the bin variables.
+ * Bins are numbered in order of first occurrence over all products that are added to the stream.
+ */
+static int bin_stream_get_bin_index(harp_bin_stream *stream, harp_product *product, long **bin_index)
+{
+    harp_variable **variable = NULL;
+    long *new_bin_index = NULL; /* index of the first sample of each new bin */
+    long num_new_bins = 0;
+    long num_elements = product->dimension[harp_dimension_time];
+    long i;
+    int k;
+
+    variable = malloc(stream->num_bin_variables * sizeof(harp_variable *));
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       stream->num_bin_variables * sizeof(harp_variable *), __FILE__, __LINE__);
+        goto error;
+    }
+    for (k = 0; k < stream->num_bin_variables; k++)
+    {
+        if (harp_product_get_variable_by_name(product, stream->bin_variable_name[k], &variable[k]) != 0)
+        {
+            goto error;
+        }
+        if (variable[k]->num_dimensions != 1 || variable[k]->dimension_type[0] != harp_dimension_time)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' should be one dimensional and depend on time to "
+                           "be used for binning", stream->bin_variable_name[k]);
+            goto error;
+        }
+    }
+
+    new_bin_index = malloc(num_elements * sizeof(long));
+    if (new_bin_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+    *bin_index = malloc(num_elements * sizeof(long));
+    if (*bin_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        char *key;
+        long index;
+
+        if (get_bin_key(variable, stream->num_bin_variables, i, &key) != 0)
+        {
+            goto error;
+        }
+        index = hashtable_get_index_from_name(stream->bin_hash, key);
+        if (index < 0)
+        {
+            if (stream->num_bin_keys % BIN_KEY_BLOCK_SIZE == 0)
+            {
+                char **new_bin_key;
+
+                new_bin_key = realloc(stream->bin_key, (stream->num_bin_keys + BIN_KEY_BLOCK_SIZE) * sizeof(char *));
+                if (new_bin_key == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   (stream->num_bin_keys + BIN_KEY_BLOCK_SIZE) * sizeof(char *), __FILE__, __LINE__);
+                    free(key);
+                    goto error;
+                }
+                stream->bin_key = new_bin_key;
+            }
+            stream->bin_key[stream->num_bin_keys] = key;
+            if (hashtable_add_name(stream->bin_hash, key) != 0)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "could not add bin key to hash table (%s:%u)", __FILE__,
+                               __LINE__);
+                free(key);
+                goto error;
+            }
+            index = stream->num_bin_keys;
+            stream->num_bin_keys++;
+            new_bin_index[num_new_bins] = i;
+            num_new_bins++;
+        }
+        else
+        {
+            free(key);
+        }
+        (*bin_index)[i] = index;
+    }
+
+    if (num_new_bins > 0)
+    {
+        for (k = 0; k < stream->num_bin_variables; k++)
+        {
+            harp_variable *variable_copy;
+
+            if (get_binning_type(variable[k]) != binning_remove)
+            {
+                continue;
+            }
+
+            /* we always want to keep the variable that we bin on */
+            if (harp_variable_copy(variable[k], &variable_copy) != 0)
+            {
+                goto error;
+            }
+            if (harp_variable_rearrange_dimension(variable_copy, 0, num_new_bins, new_bin_index) != 0)
+            {
+                harp_variable_delete(variable_copy);
+                goto error;
+            }
+            if (stream->bin_variable[k] == NULL)
+            {
+                stream->bin_variable[k] = variable_copy;
+            }
+            else
+            {
+                if (harp_variable_append(stream->bin_variable[k], variable_copy) != 0)
+                {
+                    harp_variable_delete(variable_copy);
+                    goto error;
+                }
+                harp_variable_delete(variable_copy);
+            }
+        }
+    }
+
+    free(new_bin_index);
+    free(variable);
+
+    return 0;
+
+  error:
+    if (new_bin_index != NULL)
+    {
+        free(new_bin_index);
+    }
+    if (variable != NULL)
+    {
+        free(variable);
+    }
+    return -1;
+}
+
+/* use the first pre-processed product to determine the variables, data types, and dimensions of the binned samples */
+static int bin_stream_init_layout(harp_bin_stream *stream, const harp_product *product, const binning_type *bintype)
+{
+    long first_index = 0;
+    int k;
+
+    if (harp_product_new(&stream->layout) != 0)
+    {
+        return -1;
+    }
+    if (product->history != NULL)
+    {
+        if (harp_product_set_history(stream->layout, product->history) != 0)
+        {
+            return -1;
+        }
+    }
+
+    stream->bintype = malloc(product->num_variables * sizeof(binning_type));
+    if (stream->bintype == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(binning_type), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->store_variable = malloc(product->num_variables * sizeof(uint8_t));
+    if (stream->store_variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->record_offset = malloc(product->num_variables * sizeof(long));
+    if (stream->record_offset == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+
+    stream->record_size = sizeof(long);
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable = product->variable[k];
+        harp_variable *layout_variable;
+
+        /* all variables are time dependent (as if the product is the result of a merge) */
+        assert(bintype[k] != binning_skip);
+
+        stream->bintype[k] = bintype[k];
+        stream->store_variable[k] = 0;
+        if (bintype[k] == binning_remove)
+        {
+            /* removed variables only need to keep their name and position */
+            if (harp_variable_new(variable->name, harp_type_int8, 0, NULL, NULL, &layout_variable) != 0)
+            {
+                return -1;
+            }
+            stream->record_offset[k] = -1;
+        }
+        else
+        {
+            if (harp_variable_copy(variable, &layout_variable) != 0)
+            {
+                return -1;
+            }
+            if (harp_variable_rearrange_dimension(layout_variable, 0, 1, &first_index) != 0)
+            {
+                harp_variable_delete(layout_variable);
+                return -1;
+            }
+            stream->record_offset[k] = stream->record_size;
+            stream->record_size += layout_variable->num_elements * harp_get_size_for_type(variable->data_type);
+        }
+        if (harp_product_add_variable(stream->layout, layout_variable) != 0)
+        {
+            harp_variable_delete(layout_variable);
+            return -1;
+        }
+    }
+
+    stream->max_buffer_records = stream->buffer_size / stream->record_size;
+    if (stream->max_buffer_records < 1)
+    {
+        stream->max_buffer_records = 1;
+    }
+    stream->buffer = malloc(stream->max_buffer_records * stream->record_size);
+    if (stream->buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       stream->max_buffer_records * stream->record_size, __FILE__, __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int bin_stream_check_layout(const harp_bin_stream *stream, const harp_product *product,
+                                   const binning_type *bintype)
+{
+    int i, k;
+
+    if (product->num_variables != stream->layout->num_variables)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product has %d variables but previously binned products have %d "
+                       "variables", product->num_variables, stream->layout->num_variables);
+        return -1;
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable = product->variable[k];
+        harp_variable *layout_variable = stream->layout->variable[k];
+
+        if (strcmp(variable->name, layout_variable->name) != 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable '%s' of product does not match variable '%s' of "
+                           "previously binned products", variable->name, layout_variable->name);
+            return -1;
+        }
+        if (bintype[k] != stream->bintype[k])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "binning type of variable '%s' does not match binning type "
+                           "for previously binned products", variable->name);
+            return -1;
+        }
+        if (bintype[k] == binning_remove)
+        {
+            continue;
+        }
+        if (variable->data_type != layout_variable->data_type ||
+            variable->num_dimensions != layout_variable->num_dimensions)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "data type or dimensions of variable '%s' do not match those "
+                           "of previously binned products", variable->name);
+            return -1;
+        }
+        for (i = 1; i < variable->num_dimensions; i++)
+        {
+            if (variable->dimension_type[i] != layout_variable->dimension_type[i] ||
+                variable->dimension[i] != layout_variable->dimension[i])
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "data type or dimensions of variable '%s' do not match "
+                               "those of previously binned products", variable->name);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int bin_stream_sort_buffer(harp_bin_stream *stream, bin_record_order **order)
+{
+    long i;
+
+    *order = malloc(stream->num_buffer_records * sizeof(bin_record_order));
+    if (*order == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       stream->num_buffer_records * sizeof(bin_record_order), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < stream->num_buffer_records; i++)
+    {
+        memcpy(&(*order)[i].bin, &stream->buffer[i * stream->record_size], sizeof(long));
+        (*order)[i].index = i;
+    }
+    qsort(*order, stream->num_buffer_records, sizeof(bin_record_order), compare_bin_record_order);
+
+    return 0;
+}
+
+/* sort the records in the buffer by bin and write them as a new run to the spill file */
+static int bin_stream_spill_buffer(harp_bin_stream *stream)
+{
+    bin_record_order *order;
+    long *new_run_length;
+    long i;
+
+    if (stream->spill_file == NULL)
+    {
+        stream->spill_file = tmpfile();
+        if (stream->spill_file == NULL)
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "could not create temporary file for binning (%s)", strerror(errno));
+            return -1;
+        }
+    }
+
+    new_run_length = realloc(stream->run_length, (stream->num_runs + 1) * sizeof(long));
+    if (new_run_length == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (stream->num_runs + 1) * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->run_length = new_run_length;
+
+    if (bin_stream_sort_buffer(stream, &order) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < stream->num_buffer_records; i++)
+    {
+        if (fwrite(&stream->buffer[order[i].index * stream->record_size], stream->record_size, 1,
+                   stream->spill_file) != 1)
+        {
+            harp_set_error(HARP_ERROR_FILE_WRITE, "could not write to temporary file for binning (%s)",
+                           strerror(errno));
+            free(order);
+            return -1;
+        }
+    }
+    free(order);
+
+    stream->run_length[stream->num_runs] = stream->num_buffer_records;
+    stream->num_runs++;
+    stream->num_buffer_records = 0;
+
+    return 0;
+}
+
+static int bin_run_read(bin_run *run, FILE *spill_file, long max_num_records, long record_size)
+{
+    run->num_records = run->num_remaining < max_num_records ? run->num_remaining : max_num_records;
+    if (spill_file_seek(spill_file, run->offset) != 0)
+    {
+        harp_set_error(HARP_ERROR_FILE_READ, "could not read from temporary file for binning (%s)", strerror(errno));
+        return -1;
+    }
+    if (fread(run->buffer, record_size, run->num_records, spill_file) != (size_t)run->num_records)
+    {
+        harp_set_error(HARP_ERROR_FILE_READ, "could not read from temporary file for binning (%s)", strerror(errno));
+        return -1;
+    }
+    run->offset += (int64_t)run->num_records * record_size;
+    run->num_remaining -= run->num_records;
+    run->index = 0;
+
+    return 0;
+}
+
+static long bin_run_get_bin(const bin_run *run, long record_size)
+{
+    long bin;
+
+    memcpy(&bin, &run->buffer[run->index * record_size], sizeof(long));
+
+    return bin;
+}
+
+/* restore the heap property (smallest bin first; the earliest run first for equal bins) starting at 'position' */
+static void bin_run_heap_sift_down(bin_run *run, int *heap, int heap_size, int position, long record_size)
+{
+    for (;;)
+    {
+        int smallest = position;
+        int child;
+
+        for (child = 2 * position + 1; child <= 2 * position + 2 && child < heap_size; child++)
+        {
+            long child_bin = bin_run_get_bin(&run[heap[child]], record_size);
+            long smallest_bin = bin_run_get_bin(&run[heap[smallest]], record_size);
+
+            if (child_bin < smallest_bin || (child_bin == smallest_bin && heap[child] < heap[smallest]))
+            {
+                smallest = child;
+            }
+        }
+        if (smallest == position)
+        {
+            return;
+        }
+        child = heap[position];
+        heap[position] = heap[smallest];
+        heap[smallest] = child;
+        position = smallest;
+    }
+}
+
+/* bin all records of a chunk (records are sorted by bin and cover all bins in the range first_bin..last_bin) and
+ * append the result to the binned product.
+ */
+static int bin_stream_bin_chunk(harp_bin_stream *stream, const char *chunk, long num_records, long first_bin,
+                                long last_bin, harp_product **binned_product)
+{
+    harp_product *product = NULL;
+    binning_type *bintype = NULL;
+    long *bin_index = NULL;
+    long i;
+    int k;
+
+    if (harp_product_copy(stream->layout, &product) != 0)
+    {
+        goto error;
+    }
+    if (harp_product_resize_dimension(product, harp_dimension_time, num_records) != 0)
+    {
+        goto error;
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        harp_variable *variable = product->variable[k];
+        long sample_size;
+
+        if (stream->record_offset[k] < 0)
+        {
+            continue;
+        }
+        sample_size = (variable->num_elements / num_records) * harp_get_size_for_type(variable->data_type);
+        for (i = 0; i < num_records; i++)
+        {
+            memcpy(&((char *)variable->data.ptr)[i * sample_size],
+                   &chunk[i * stream->record_size + stream->record_offset[k]], sample_size);
+        }
+    }
+
+    bin_index = malloc(num_records * sizeof(long));
+    if (bin_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_records * sizeof(long), __FILE__, __LINE__);
+        goto error;
+    }
+    for (i = 0; i < num_records; i++)
+    {
+        memcpy(&bin_index[i], &chunk[i * stream->record_size], sizeof(long));
+        bin_index[i] -= first_bin;
+    }
+
+    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
+    if (bintype == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
+        goto error;
+    }
+    memcpy(bintype, stream->bintype, product->num_variables * sizeof(binning_type));
+
+    if (bin_preprocessed(product, bintype, last_bin - first_bin + 1, num_records, bin_index,
+                         stream->store_variable) != 0)
+    {
+        goto error;
+    }
+
+    if (*binned_product == NULL)
+    {
+        *binned_product = product;
+    }
+    else
+    {
+        if (harp_product_append(*binned_product, product) != 0)
+        {
+            goto error;
+        }
+        harp_product_delete(product);
+    }
+
+    free(bintype);
+    free(bin_index);
+
+    return 0;
+
+  error:
+    if (bintype != NULL)
+    {
+        free(bintype);
+    }
+    if (bin_index != NULL)
+    {
+        free(bin_index);
+    }
+    if (product != NULL)
+    {
+        harp_product_delete(product);
+    }
+    return -1;
+}
+
+/** Create a new binning stream for binning a sequence of products without having to merge them in memory first.
+ * Samples are added to the stream product by product using harp_bin_stream_add_product(). Each sample is assigned to
+ * a bin using a bin index that is provided with each product. The binned result is retrieved using
+ * harp_bin_stream_finish().
+ *
+ * The pre-processed samples are kept in a memory buffer of limited size (see harp_bin_stream_set_buffer_size()).
+ * Each time this buffer is full, its samples are sorted by bin and written as a run to a temporary file. At the end
+ * all runs are merged and the samples are binned a range of bins at a time.
+ *
+ * The result is the same as (bit for bit) merging all products using harp_product_append() and then calling
+ * harp_product_bin() on the merged product, but without the need to keep all samples in memory. Only the binned
+ * product and all samples of the largest bin need to fit in memory.
+ *
+ * \param num_bins Number of target bins.
+ * \param new_stream Pointer to the C variable where the new binning stream will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_bin_stream_new(long num_bins, harp_bin_stream **new_stream)
+{
+    harp_bin_stream *stream;
+
+    if (num_bins < 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_bins (%ld) should be larger than zero (%s:%u)", num_bins,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    stream = (harp_bin_stream *)malloc(sizeof(harp_bin_stream));
+    if (stream == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_bin_stream), __FILE__, __LINE__);
+        return -1;
+    }
+    stream->num_bins = num_bins;
+    stream->num_bin_variables = 0;
+    stream->bin_variable_name = NULL;
+    stream->bin_variable = NULL;
+    stream->bin_hash = NULL;
+    stream->bin_key = NULL;
+    stream->num_bin_keys = 0;
+    stream->layout = NULL;
+    stream->bintype = NULL;
+    stream->store_variable = NULL;
+    stream->record_offset = NULL;
+    stream->record_size = 0;
+    stream->buffer_size = BIN_STREAM_BUFFER_SIZE;
+    stream->max_buffer_records = 0;
+    stream->num_buffer_records = 0;
+    stream->buffer = NULL;
+    stream->spill_file = NULL;
+    stream->num_runs = 0;
+    stream->run_length = NULL;
+    stream->num_samples = 0;
+
+    *new_stream = stream;
+
+    return 0;
+}
+
+/** Create a new binning stream that bins all samples that have the same combination of values for the given variables.
+ * This is the streaming equivalent of the bin() operation with a list of variable names (see harp_bin_stream_new()).
+ * Bins are ordered by first occurrence of each combination of values over all products that are added.
+ * Bin variables that would otherwise be removed by the binning (such as variables without unit) are kept and will
+ * contain the value for the first sample of each bin.
+ *
+ * \param num_variables Number of variables.
+ * \param variable_name List of names of variables that define the bins (based on equal value combination).
+ * \param new_stream Pointer to the C variable where the new binning stream will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_bin_stream_new_with_variable(int num_variables, const char **variable_name,
+                                                  harp_bin_stream **new_stream)
+{
+    harp_bin_stream *stream;
+    int k;
+
+    if (num_variables < 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "binning requires at least one variable");
+        return -1;
+    }
+
+    if (harp_bin_stream_new(1, &stream) != 0)
+    {
+        return -1;
+    }
+    stream->num_bins = -1;
+
+    stream->bin_variable_name = malloc(num_variables * sizeof(char *));
+    if (stream->bin_variable_name == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_variables * sizeof(char *), __FILE__, __LINE__);
+        harp_bin_stream_delete(stream);
+        return -1;
+    }
+    stream->bin_variable = malloc(num_variables * sizeof(harp_variable *));
+    if (stream->bin_variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_variables * sizeof(harp_variable *), __FILE__, __LINE__);
+        free(stream->bin_variable_name);
+        stream->bin_variable_name = NULL;
+        harp_bin_stream_delete(stream);
+        return -1;
+    }
+    for (k = 0; k < num_variables; k++)
+    {
+        stream->bin_variable_name[k] = NULL;
+        stream->bin_variable[k] = NULL;
+    }
+    stream->num_bin_variables = num_variables;
+    for (k = 0; k < num_variables; k++)
+    {
+        stream->bin_variable_name[k] = strdup(variable_name[k]);
+        if (stream->bin_variable_name[k] == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            harp_bin_stream_delete(stream);
+            return -1;
+        }
+    }
+
+    stream->bin_hash = hashtable_new(1);
+    if (stream->bin_hash == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hash table) (%s:%u)", __FILE__,
+                       __LINE__);
+        harp_bin_stream_delete(stream);
+        return -1;
+    }
+
+    *new_stream = stream;
+
+    return 0;
+}
+
+/** Set the maximum size of the in-memory sample buffer of a binning stream.
+ * When the buffer is full, its content is written to a temporary file. The default buffer size is 64MB.
+ * The buffer size can only be changed before the first product is added to the stream.
+ * \param stream Binning stream.
+ * \param buffer_size Maximum size of the buffer in bytes.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_bin_stream_set_buffer_size(harp_bin_stream *stream, long buffer_size)
+{
+    if (buffer_size < 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer_size (%ld) should be larger than zero (%s:%u)",
+                       buffer_size, __FILE__, __LINE__);
+        return -1;
+    }
+    if (stream->layout != NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "buffer size can not be changed after products have been added "
+                       "to the binning stream");
+        return -1;
+    }
+    stream->buffer_size = buffer_size;
+
+    return 0;
+}
+
+/** Add the samples of a product to a binning stream.
+ * The product is first updated as if it was the result of a merge (see harp_product_append()) and is then
+ * pre-processed for binning (which will modify the product). The product itself is not kept by the stream.
+ *
+ * All products added to a stream should have the same variables (in the same order) with the same data types and
+ * (non-time) dimension lengths.
+ *
+ * \param stream Binning stream.
+ * \param product Product whose samples should be added.
+ * \param num_elements Length of bin_index array (should equal the length of the time dimension).
+ * \param bin_index Array of target bin index numbers (0 .. num_bins-1) for each sample in the time dimension.
+ *   This should be NULL for binning streams created with harp_bin_stream_new_with_variable().
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_bin_stream_add_product(harp_bin_stream *stream, harp_product *product, long num_elements,
+                                            long *bin_index)
+{
+    binning_type *bintype = NULL;
+    long *variable_bin_index = NULL;
+    long i;
+    int k;
+
+    if (stream->num_bins < 0 && bin_index != NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index should be NULL for a binning stream that bins on "
+                       "variable values (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (stream->num_bins >= 0 && bin_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* make sure the product looks like it is the result of a merge */
+    if (harp_product_append(product, NULL) != 0)
+    {
+        return -1;
+    }
+
+    if (num_elements != product->dimension[harp_dimension_time])
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_elements (%ld) does not match time dimension length (%ld) "
+                       "(%s:%u)", num_elements, product->dimension[harp_dimension_time], __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_elements == 0)
+    {
+        /* nothing to do */
+        return 0;
+    }
+
+    if (stream->num_bins < 0)
+    {
+        if (bin_stream_get_bin_index(stream, product, &variable_bin_index) != 0)
+        {
+            goto error;
+        }
+        bin_index = variable_bin_index;
+    }
+    else
+    {
+        for (i = 0; i < num_elements; i++)
+        {
+            if (bin_index[i] < 0 || bin_index[i] >= stream->num_bins)
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "bin_index[%ld] (%ld) should be in the range [0..%ld) "
+                               "(%s:%u)", i, bin_index[i], stream->num_bins, __FILE__, __LINE__);
+                return -1;
+            }
+        }
+    }
+
+    bintype = malloc((2 * product->num_variables + 1) * sizeof(binning_type));
+    if (bintype == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (2 * product->num_variables + 1) * sizeof(binning_type), __FILE__, __LINE__);
+        goto error;
+    }
+    for (k = 0; k < product->num_variables; k++)
+    {
+        bintype[k] = get_binning_type(product->variable[k]);
+    }
+    if (bin_preprocess(product, bintype) != 0)
+    {
+        goto error;
+    }
+
+    if (stream->layout == NULL)
+    {
+        if (bin_stream_init_layout(stream, product, bintype) != 0)
+        {
+            goto error;
+        }
+    }
+    else if (bin_stream_check_layout(stream, product, bintype) != 0)
+    {
+        goto error;
+    }
+    if (update_store_variable(product, bintype, stream->store_variable) != 0)
+    {
+        goto error;
+    }
+
+    for (i = 0; i < num_elements; i++)
+    {
+        char *record;
+
+        if (stream->num_buffer_records == stream->max_buffer_records)
+        {
+            if (bin_stream_spill_buffer(stream) != 0)
+            {
+                goto error;
+            }
+        }
+        record = &stream->buffer[stream->num_buffer_records * stream->record_size];
+        memcpy(record, &bin_index[i], sizeof(long));
+        for (k = 0; k < product->num_variables; k++)
+        {
+            harp_variable *variable = product->variable[k];
+            long sample_size;
+
+            if (stream->record_offset[k] < 0)
+            {
+                continue;
+            }
+            sample_size = (variable->num_elements / num_elements) * harp_get_size_for_type(variable->data_type);
+            memcpy(&record[stream->record_offset[k]], &((char *)variable->data.ptr)[i * sample_size], sample_size);
+        }
+        stream->num_buffer_records++;
+    }
+    stream->num_samples += num_elements;
+
+    free(bintype);
+    if (variable_bin_index != NULL)
+    {
+        free(variable_bin_index);
+    }
+
+    return 0;
+
+  error:
+    if (bintype != NULL)
+    {
+        free(bintype);
+    }
+    if (variable_bin_index != NULL)
+    {
+        free(variable_bin_index);
+    }
+    return -1;
+}
+
+/** Retrieve the binned product from a binning stream.
+ * This merges all sorted runs of samples (from the temporary file) and bins the samples a range of bins at a time.
+ * After calling this function, the only valid operation on the stream is harp_bin_stream_delete().
+ * \param stream Binning stream.
+ * \param product Pointer to the C variable where the binned product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_bin_stream_finish(harp_bin_stream *stream, harp_product **product)
+{
+    harp_product *binned_product = NULL;
+    bin_run *run = NULL;
+    int *heap = NULL;
+    int heap_size = 0;
+    char *chunk = NULL;
+    long max_chunk_records;
+    long num_chunk_records = 0;
+    long num_bins;
+    long first_bin = 0;
+    long current_bin = -1;
+    long run_buffer_records;
+    int num_runs;
+    int k;
+
+    if (stream->num_samples == 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "no samples have been added to the binning stream");
+        return -1;
+    }
+    num_bins = stream->num_bins < 0 ? stream->num_bin_keys : stream->num_bins;
+
+    if (stream->spill_file == NULL)
+    {
+        bin_record_order *order;
+        char *sorted_buffer;
+        long i;
+
+        /* all records are still in memory, so just sort them into a single run */
+        sorted_buffer = malloc(stream->num_buffer_records * stream->record_size);
+        if (sorted_buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           stream->num_buffer_records * stream->record_size, __FILE__, __LINE__);
+            goto error;
+        }
+        if (bin_stream_sort_buffer(stream, &order) != 0)
+        {
+            free(sorted_buffer);
+            goto error;
+        }
+        for (i = 0; i < stream->num_buffer_records; i++)
+        {
+            memcpy(&sorted_buffer[i * stream->record_size], &stream->buffer[order[i].index * stream->record_size],
+                   stream->record_size);
+        }
+        free(order);
+        free(stream->buffer);
+        stream->buffer = sorted_buffer;
+        num_runs = 1;
+        run_buffer_records = stream->num_buffer_records;
+    }
+    else
+    {
+        if (stream->num_buffer_records > 0)
+        {
+            if (bin_stream_spill_buffer(stream) != 0)
+            {
+                goto error;
+            }
+        }
+        free(stream->buffer);
+        stream->buffer = NULL;
+        num_runs = stream->num_runs;
+        /* divide the memory of the sample buffer over the read buffers of all runs */
+        run_buffer_records = stream->max_buffer_records / num_runs;
+        if (run_buffer_records < 1)
+        {
+            run_buffer_records = 1;
+        }
+    }
+
+    run = malloc(num_runs * sizeof(bin_run));
+    if (run == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_runs * sizeof(bin_run), __FILE__, __LINE__);
+        goto error;
+    }
+    for (k = 0; k < num_runs; k++)
+    {
+        run[k].buffer = NULL;
+    }
+    heap = malloc(num_runs * sizeof(int));
+    if (heap == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_runs * sizeof(int), __FILE__, __LINE__);
+        goto error;
+    }
+
+    if (stream->spill_file == NULL)
+    {
+        run[0].offset = 0;
+        run[0].num_remaining = 0;
+        run[0].num_records = stream->num_buffer_records;
+        run[0].index = 0;
+        run[0].buffer = stream->buffer;
+        stream->buffer = NULL;
+        heap[0] = 0;
+        heap_size = 1;
+    }
+    else
+    {
+        int64_t offset = 0;
 
-            /* we need to create a variable that includes the lat/lon dimensions and uses the binned time dimension */
-            if (variable->num_dimensions + 2 >= HARP_MAX_NUM_DIMS)
+        for (k = 0; k < num_runs; k++)
+        {
+            run[k].offset = offset;
+            run[k].num_remaining = stream->run_length[k];
+            offset += (int64_t)stream->run_length[k] * stream->record_size;
+            run[k].buffer = malloc(run_buffer_records * stream->record_size);
+            if (run[k].buffer == NULL)
             {
-                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "too many dimensions (%d) for variables %s to perform "
-                               "spatial binning", variable->num_dimensions, variable->name);
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               run_buffer_records * stream->record_size, __FILE__, __LINE__);
                 goto error;
             }
-            dimension_type[0] = harp_dimension_time;
-            dimension[0] = num_time_bins;
-            dimension_type[1] = harp_dimension_latitude;
-            dimension[1] = num_latitude_edges - 1;
-            dimension_type[2] = harp_dimension_longitude;
-            dimension[2] = num_longitude_edges - 1;
-            for (i = 1; i < variable->num_dimensions; i++)
-            {
-                dimension_type[i + 2] = variable->dimension_type[i];
-                dimension[i + 2] = variable->dimension[i];
-            }
-            if (harp_variable_new(variable->name, variable->data_type, variable->num_dimensions + 2, dimension_type,
-                                  dimension, &new_variable) != 0)
+            if (bin_run_read(&run[k], stream->spill_file, run_buffer_records, stream->record_size) != 0)
             {
                 goto error;
             }
-            if (harp_variable_copy_attributes(variable, new_variable) != 0)
+            heap[k] = k;
+        }
+        heap_size = num_runs;
+        for (k = heap_size / 2 - 1; k >= 0; k--)
+        {
+            bin_run_heap_sift_down(run, heap, heap_size, k, stream->record_size);
+        }
+    }
+
+    /* bin the records a chunk at a time; a chunk always contains all records of each of its bins */
+    max_chunk_records = stream->max_buffer_records;
+    chunk = malloc(max_chunk_records * stream->record_size);
+    if (chunk == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       max_chunk_records * stream->record_size, __FILE__, __LINE__);
+        goto error;
+    }
+    while (heap_size > 0)
+    {
+        bin_run *next_run = &run[heap[0]];
+        long bin = bin_run_get_bin(next_run, stream->record_size);
+
+        if (bin != current_bin && num_chunk_records >= max_chunk_records)
+        {
+            if (bin_stream_bin_chunk(stream, chunk, num_chunk_records, first_bin, current_bin, &binned_product) != 0)
             {
-                harp_variable_delete(new_variable);
                 goto error;
             }
+            first_bin = current_bin + 1;
+            num_chunk_records = 0;
+        }
+        if (num_chunk_records == max_chunk_records)
+        {
+            char *new_chunk;
 
-            /* sum up all values per cell */
-            memset(weight, 0, weight_size * sizeof(float));
-            cumsum_index = 0;
-            for (i = 0; i < num_time_elements; i++)
+            /* all records of a bin need to be in the same chunk */
+            new_chunk = realloc(chunk, 2 * max_chunk_records * stream->record_size);
+            if (new_chunk == NULL)
             {
-                long index_offset = time_bin_index[i] * spatial_block_length;
-
-                for (l = 0; l < num_latlon_index[i]; l++)
-                {
-                    long target_index = index_offset + latlon_cell_index[cumsum_index];
-                    double sample_weight = area_binning ? latlon_weight[cumsum_index] : 1;
-
-                    if (bintype[k] == binning_angle)
-                    {
-                        /* for angle variables we use one weight element per complex pair */
-                        for (j = 0; j < num_sub_elements; j += 2)
-                        {
-                            if (!harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                            {
-                                weight[(target_index * num_sub_elements + j) / 2] += sample_weight;
-                                new_variable->data.double_data[target_index * num_sub_elements + j] +=
-                                    sample_weight * variable->data.double_data[i * num_sub_elements + j];
-                                new_variable->data.double_data[target_index * num_sub_elements + j + 1] +=
-                                    sample_weight * variable->data.double_data[i * num_sub_elements + j + 1];
-                            }
-                        }
-                    }
-                    else
-                    {
-                        for (j = 0; j < num_sub_elements; j++)
-                        {
-                            if (!harp_isnan(variable->data.double_data[i * num_sub_elements + j]))
-                            {
-                                weight[target_index * num_sub_elements + j] += sample_weight;
-                                new_variable->data.double_data[target_index * num_sub_elements + j] +=
-                                    sample_weight * variable->data.double_data[i * num_sub_elements + j];
-                            }
-                            else
-                            {
-                                store_weight_variable = 1;
-                            }
-                        }
-                    }
-                    cumsum_index++;
-                }
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               2 * max_chunk_records * stream->record_size, __FILE__, __LINE__);
+                goto error;
             }
+            chunk = new_chunk;
+            max_chunk_records *= 2;
+        }
+        memcpy(&chunk[num_chunk_records * stream->record_size],
+               &next_run->buffer[next_run->index * stream->record_size], stream->record_size);
+        num_chunk_records++;
+        current_bin = bin;
 
-            /* replace variable in product with new variable */
-            product->variable[k] = new_variable;
-            harp_variable_delete(variable);
-            variable = new_variable;
-
-            /* post-process variable */
-            if (bintype[k] == binning_angle)
-            {
-                /* convert angle variables back from complex values to angles */
-                for (i = 0; i < variable->num_elements; i += 2)
-                {
-                    if (weight[i / 2] == 0)
-                    {
-                        variable->data.double_data[i] = nan_value;
-                    }
-                    else
-                    {
-                        double x = variable->data.double_data[i];
-                        double y = variable->data.double_data[i + 1];
-
-                        weight[i / 2] = sqrt(x * x + y * y);
-                        variable->data.double_data[i] = atan2(y, x);
-                    }
-                }
-                if (harp_variable_remove_dimension(variable, variable->num_dimensions - 1, 0) != 0)
-                {
-                    goto error;
-                }
-                /* convert all angles back to the original unit */
-                if (harp_convert_unit("rad", variable->unit, variable->num_elements, variable->data.double_data) != 0)
-                {
-                    goto error;
-                }
-                store_weight_variable = 1;
-            }
-            else
+        next_run->index++;
+        if (next_run->index == next_run->num_records)
+        {
+            if (next_run->num_remaining == 0)
             {
-                for (i = 0; i < variable->num_elements; i++)
-                {
-                    if (weight[i] == 0)
-                    {
-                        variable->data.double_data[i] = nan_value;
-                    }
-                    else if (bintype[k] == binning_average)
-                    {
-                        /* divide by the sum of the weights */
-                        variable->data.double_data[i] /= weight[i];
-                    }
-                }
+                heap_size--;
+                heap[0] = heap[heap_size];
             }
-
-            if (store_weight_variable)
+            else if (bin_run_read(next_run, stream->spill_file, run_buffer_records, stream->record_size) != 0)
             {
-                if (add_weight_variable(product, bintype, binning_skip, variable->name, variable->num_dimensions,
-                                        variable->dimension_type, variable->dimension, weight) != 0)
-                {
-                    goto error;
-                }
+                goto error;
             }
         }
+        bin_run_heap_sift_down(run, heap, heap_size, 0, stream->record_size);
+    }
+    if (bin_stream_bin_chunk(stream, chunk, num_chunk_records, first_bin, num_bins - 1, &binned_product) != 0)
+    {
+        goto error;
     }
 
-    /* remove all variables that need to be removed (in reverse order!) */
-    for (k = product->num_variables - 1; k >= 0; k--)
+    for (k = 0; k < stream->num_bin_variables; k++)
     {
-        if (bintype[k] == binning_remove)
+        if (stream->bin_variable[k] != NULL)
         {
-            if (harp_product_remove_variable(product, product->variable[k]) != 0)
+            if (harp_product_add_variable(binned_product, stream->bin_variable[k]) != 0)
             {
                 goto error;
             }
+            stream->bin_variable[k] = NULL;
         }
     }
 
-    free(bintype);
-    free(weight);
-    free(time_index);
-    free(bin_count);
-    free(num_latlon_index);
-    if (latlon_cell_index != NULL)
-    {
-        free(latlon_cell_index);
-    }
-    if (latlon_weight != NULL)
+    free(chunk);
+    free(heap);
+    for (k = 0; k < num_runs; k++)
     {
-        free(latlon_weight);
+        if (run[k].buffer != NULL)
+        {
+            free(run[k].buffer);
+        }
     }
+    free(run);
 
-    /* add latitude_bounds and longitude_bounds variables */
-    dimension_type[0] = harp_dimension_latitude;
-    dimension[0] = num_latitude_edges - 1;
-    dimension_type[1] = harp_dimension_independent;
-    dimension[1] = 2;
-    if (harp_variable_new("latitude_bounds", harp_type_double, 2, dimension_type, dimension, &latitude) != 0)
+    *product = binned_product;
+
+    return 0;
+
+  error:
+    if (chunk != NULL)
     {
-        return -1;
+        free(chunk);
     }
-    for (i = 0; i < dimension[0]; i++)
+    if (heap != NULL)
     {
-        latitude->data.double_data[2 * i] = latitude_edges[i];
-        latitude->data.double_data[2 * i + 1] = latitude_edges[i + 1];
+        free(heap);
     }
-    if (harp_product_add_variable(product, latitude) != 0)
+    if (run != NULL)
     {
-        harp_variable_delete(latitude);
-        return -1;
+        for (k = 0; k < num_runs; k++)
+        {
+            if (run[k].buffer != NULL)
+            {
+                free(run[k].buffer);
+            }
+        }
+        free(run);
     }
-    if (harp_variable_set_unit(latitude, HARP_UNIT_LATITUDE) != 0)
+    if (binned_product != NULL)
     {
-        return -1;
+        harp_product_delete(binned_product);
     }
+    return -1;
+}
 
-    dimension_type[0] = harp_dimension_longitude;
-    dimension[0] = num_longitude_edges - 1;
-    if (harp_variable_new("longitude_bounds", harp_type_double, 2, dimension_type, dimension, &longitude) != 0)
+/** Delete a binning stream.
+ * This also removes the temporary file that was used by the stream.
+ * \param stream Binning stream.
+ */
+LIBHARP_API void harp_bin_stream_delete(harp_bin_stream *stream)
+{
+    long i;
+    int k;
+
+    if (stream == NULL)
     {
-        return -1;
+        return;
     }
-    for (i = 0; i < dimension[0]; i++)
+    if (stream->bin_variable_name != NULL)
     {
-        longitude->data.double_data[2 * i] = longitude_edges[i];
-        longitude->data.double_data[2 * i + 1] = longitude_edges[i + 1];
+        for (k = 0; k < stream->num_bin_variables; k++)
+        {
+            if (stream->bin_variable_name[k] != NULL)
+            {
+                free(stream->bin_variable_name[k]);
+            }
+        }
+        free(stream->bin_variable_name);
     }
-    if (harp_product_add_variable(product, longitude) != 0)
+    if (stream->bin_variable != NULL)
     {
-        harp_variable_delete(longitude);
-        return -1;
+        for (k = 0; k < stream->num_bin_variables; k++)
+        {
+            if (stream->bin_variable[k] != NULL)
+            {
+                harp_variable_delete(stream->bin_variable[k]);
+            }
+        }
+        free(stream->bin_variable);
     }
-    if (harp_variable_set_unit(longitude, HARP_UNIT_LONGITUDE) != 0)
+    if (stream->bin_hash != NULL)
     {
-        return -1;
+        hashtable_delete(stream->bin_hash);
     }
-
-    return 0;
-
-  error:
-    if (bintype != NULL)
+    if (stream->bin_key != NULL)
     {
-        free(bintype);
+        for (i = 0; i < stream->num_bin_keys; i++)
+        {
+            free(stream->bin_key[i]);
+        }
+        free(stream->bin_key);
     }
-    if (time_index != NULL)
+    if (stream->layout != NULL)
     {
-        free(time_index);
+        harp_product_delete(stream->layout);
     }
-    if (bin_count != NULL)
+    if (stream->bintype != NULL)
     {
-        free(bin_count);
+        free(stream->bintype);
     }
-    if (weight != NULL)
+    if (stream->store_variable != NULL)
     {
-        free(weight);
+        free(stream->store_variable);
     }
-    if (num_latlon_index != NULL)
+    if (stream->record_offset != NULL)
     {
-        free(num_latlon_index);
+        free(stream->record_offset);
     }
-    if (latlon_cell_index != NULL)
+    if (stream->buffer != NULL)
     {
-        free(latlon_cell_index);
+        free(stream->buffer);
     }
-    if (latlon_weight != NULL)
+    if (stream->spill_file != NULL)
     {
-        free(latlon_weight);
+        fclose(stream->spill_file);
     }
-    return -1;
+    if (stream->run_length != NULL)
+    {
+        free(stream->run_length);
+    }
+    free(stream);
 }
 
 /**
@@ -3028,7 +5708,7 @@ int harp_product_bin_with_variable(harp_product *product, int num_variables, con
                         equal = variable[k]->data.int32_data[index[j]] == variable[k]->data.int32_data[i];
                         break;
                     case harp_type_float:
-                        if (check_nan)
+                        if (check_nan[k])
                         {
                             equal = harp_isnan(variable[k]->data.float_data[index[j]]);
                         }
@@ -3038,7 +5718,7 @@ int harp_product_bin_with_variable(harp_product *product, int num_variables, con
                         }
                         break;
                     case harp_type_double:
-                        if (check_nan)
+                        if (check_nan[k])
                         {
                             equal = harp_isnan(variable[k]->data.double_data[index[j]]);
                         }
@@ -3209,3 +5889,47 @@ int harp_product_bin_spatial_full(harp_product *product, long num_latitude_edges
     free(bin_index);
     return 0;
 }
+
+/** Perform a spatial binning using a precomputed weight table such that all samples end up in a single time bin.
+ *
+ * \param product Product to regrid.
+ * \param weights Weight table product (see #harp_product_get_spatial_weights).
+ *
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+int harp_product_bin_spatial_with_weights_full(harp_product *product, const harp_product *weights)
+{
+    long *bin_index;
+    long num_elements;
+    long i;
+
+    num_elements = product->dimension[harp_dimension_time];
+    if (num_elements == 0)
+    {
+        /* nothing to do */
+        return 0;
+    }
+
+    bin_index = malloc(num_elements * sizeof(long));
+    if (bin_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        bin_index[i] = 0;
+    }
+
+    if (harp_product_bin_spatial_with_weights(product, 1, num_elements, bin_index, weights) != 0)
+    {
+        free(bin_index);
+        return -1;
+    }
+
+    free(bin_index);
+    return 0;
+}
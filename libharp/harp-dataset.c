@@ -45,6 +45,10 @@
 #ifdef HAVE_DIRENT_H
 #include <dirent.h>
 #endif
+#ifdef HAVE_POSIX_FADVISE
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #ifdef WIN32
 #include "windows.h"
@@ -421,6 +425,37 @@ static int add_directory(harp_dataset *dataset, const char *pathname, const char
     return 0;
 }
 
+struct harp_dataset_import_iter_struct
+{
+    harp_dataset *dataset;
+    char *operations;
+    char *options;
+    long *order;        /* indices of the products in the order in which they should be imported */
+    int num_prefetch;   /* number of upcoming product files to read ahead */
+    long position;      /* position in 'order' of the next product to import */
+    long prefetch_position;     /* position in 'order' of the next product file to read ahead */
+};
+
+/* Ask the operating system to start reading the file into its page cache in the background, so a subsequent import
+ * of the file does not have to wait for the I/O. This is only a hint; any problems with the file are ignored here and
+ * will be reported by the import itself.
+ */
+static void prefetch_file(const char *filename)
+{
+#ifdef HAVE_POSIX_FADVISE
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd >= 0)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        close(fd);
+    }
+#else
+    (void)filename;
+#endif
+}
+
 /** \addtogroup harp_dataset
  * @{
  */
@@ -748,4 +783,201 @@ LIBHARP_API int harp_dataset_add_product(harp_dataset *dataset, const char *sour
     return 0;
 }
 
+/** Create an iterator for importing all products of a dataset.
+ * The iterator imports the products one by one, in the order given by \a order or, if \a order is NULL, in the sorted
+ * order of the dataset (i.e. sorted by source_product). Each call to harp_dataset_import_iter_next() imports the next
+ * product using harp_import() with the given \a operations and \a options.
+ * While a product is imported (and processed by the caller), the files of the next \a num_prefetch products are read
+ * ahead in the background by the operating system (on systems that support this), such that the import of those
+ * products does not have to wait for I/O. The products themselves are always imported in order, so the result is
+ * identical to calling harp_import() for each product in turn.
+ * The dataset should have been created using harp_dataset_import() (such that the metadata, and thus the filename, is
+ * available for each product) and should not be modified while the iterator is in use.
+ * \param dataset Dataset containing the products to import.
+ * \param order Indices of the products in the dataset in the order in which they should be imported (optional).
+ * Should contain \a dataset->num_products entries.
+ * \param operations Operations to perform as part of the import of each product (optional); see harp_import().
+ * \param options Ingestion module specific options (optional); see harp_import().
+ * \param num_prefetch Number of upcoming product files to read ahead (0 disables read ahead).
+ * \param new_iter Pointer to the C variable where the new iterator will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_dataset_import_iter_new(harp_dataset *dataset, const long *order, const char *operations,
+                                             const char *options, int num_prefetch, harp_dataset_import_iter **new_iter)
+{
+    harp_dataset_import_iter *iter;
+    long i;
+
+    if (dataset == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "dataset is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_prefetch < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_prefetch argument (%d) is not valid (%s:%u)", num_prefetch,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
+        if (order != NULL && (order[i] < 0 || order[i] >= dataset->num_products))
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "order[%ld] (%ld) is not a valid product index (%s:%u)", i,
+                           order[i], __FILE__, __LINE__);
+            return -1;
+        }
+        if (dataset->metadata[i] == NULL || dataset->metadata[i]->filename == NULL)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "no filename available for product '%s' in dataset",
+                           dataset->source_product[i]);
+            return -1;
+        }
+    }
+
+    iter = (harp_dataset_import_iter *)malloc(sizeof(harp_dataset_import_iter));
+    if (iter == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_dataset_import_iter), __FILE__, __LINE__);
+        return -1;
+    }
+    iter->dataset = dataset;
+    iter->operations = NULL;
+    iter->options = NULL;
+    iter->order = NULL;
+    iter->num_prefetch = num_prefetch;
+    iter->position = 0;
+    iter->prefetch_position = 0;
+
+    if (operations != NULL)
+    {
+        iter->operations = strdup(operations);
+        if (iter->operations == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            harp_dataset_import_iter_delete(iter);
+            return -1;
+        }
+    }
+    if (options != NULL)
+    {
+        iter->options = strdup(options);
+        if (iter->options == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            harp_dataset_import_iter_delete(iter);
+            return -1;
+        }
+    }
+    if (dataset->num_products > 0)
+    {
+        iter->order = (long *)malloc(dataset->num_products * sizeof(long));
+        if (iter->order == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           dataset->num_products * sizeof(long), __FILE__, __LINE__);
+            harp_dataset_import_iter_delete(iter);
+            return -1;
+        }
+        memcpy(iter->order, order != NULL ? order : dataset->sorted_index, dataset->num_products * sizeof(long));
+    }
+
+    *new_iter = iter;
+
+    return 0;
+}
+
+/** Import the next product of a dataset import iterator.
+ * If all products have been imported, \a product will be set to NULL (and \a index to -1).
+ * \param iter Dataset import iterator.
+ * \param index Pointer to the C variable where the index of the imported product in the dataset will be stored
+ * (optional).
+ * \param product Pointer to the C variable where the imported product will be stored. The caller is the owner of the
+ * returned product.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_dataset_import_iter_next(harp_dataset_import_iter *iter, long *index, harp_product **product)
+{
+    harp_dataset *dataset;
+    long product_index;
+
+    if (iter == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "iter is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    dataset = iter->dataset;
+    if (iter->position >= dataset->num_products)
+    {
+        if (index != NULL)
+        {
+            *index = -1;
+        }
+        *product = NULL;
+        return 0;
+    }
+
+    /* keep the read ahead window filled: the current product file and the next num_prefetch product files */
+    if (iter->num_prefetch > 0)
+    {
+        while (iter->prefetch_position <= iter->position + iter->num_prefetch &&
+               iter->prefetch_position < dataset->num_products)
+        {
+            prefetch_file(dataset->metadata[iter->order[iter->prefetch_position]]->filename);
+            iter->prefetch_position++;
+        }
+    }
+
+    product_index = iter->order[iter->position];
+    if (harp_import(dataset->metadata[product_index]->filename, iter->operations, iter->options, product) != 0)
+    {
+        return -1;
+    }
+    iter->position++;
+
+    if (index != NULL)
+    {
+        *index = product_index;
+    }
+
+    return 0;
+}
+
+/** Delete a dataset import iterator.
+ * \param iter Dataset import iterator.
+ */
+LIBHARP_API void harp_dataset_import_iter_delete(harp_dataset_import_iter *iter)
+{
+    if (iter == NULL)
+    {
+        return;
+    }
+    if (iter->operations != NULL)
+    {
+        free(iter->operations);
+    }
+    if (iter->options != NULL)
+    {
+        free(iter->options);
+    }
+    if (iter->order != NULL)
+    {
+        free(iter->order);
+    }
+    free(iter);
+}
+
 /** @} */
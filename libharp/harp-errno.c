@@ -36,10 +36,19 @@
 #include <stdarg.h>
 #include <string.h>
 
-#define MAX_ERROR_INFO_LENGTH	4096
-
 static int (*harp_warning_handler) (const char *, va_list ap) = NULL;
-static char harp_error_message_buffer[MAX_ERROR_INFO_LENGTH + 1];
+static char harp_error_message_buffer[HARP_MAX_ERROR_INFO_LENGTH + 1];
+
+#ifdef _OPENMP
+/* error state for worker threads (see harp_thread_error_begin())
+ * while 'thread_error_active' is set for a thread, errors set from that thread are stored in 'thread_errno' and
+ * 'thread_error_message_buffer' of that thread instead of in the global harp_errno and message buffer
+ */
+static int thread_error_active = 0;
+static int thread_errno = HARP_SUCCESS;
+static char thread_error_message_buffer[HARP_MAX_ERROR_INFO_LENGTH + 1];
+#pragma omp threadprivate(thread_error_active, thread_errno, thread_error_message_buffer)
+#endif
 
 /** \defgroup harp_error HARP Error
  * With a few exceptions almost all HARP functions return an integer that indicate whether the function was able to
@@ -180,8 +189,20 @@ LIBHARP_API int harp_errno = HARP_SUCCESS;
 
 /** @} */
 
+static char *get_error_message_buffer(void)
+{
+#ifdef _OPENMP
+    if (thread_error_active)
+    {
+        return thread_error_message_buffer;
+    }
+#endif
+    return harp_error_message_buffer;
+}
+
 static void add_error_message_vargs(const char *message, va_list ap)
 {
+    char *buffer = get_error_message_buffer();
     size_t current_length;
 
     if (message == NULL)
@@ -189,13 +210,13 @@ static void add_error_message_vargs(const char *message, va_list ap)
         return;
     }
 
-    current_length = strlen(harp_error_message_buffer);
-    if (current_length >= MAX_ERROR_INFO_LENGTH)
+    current_length = strlen(buffer);
+    if (current_length >= HARP_MAX_ERROR_INFO_LENGTH)
     {
         return;
     }
-    vsnprintf(&harp_error_message_buffer[current_length], MAX_ERROR_INFO_LENGTH - current_length, message, ap);
-    harp_error_message_buffer[MAX_ERROR_INFO_LENGTH] = '\0';
+    vsnprintf(&buffer[current_length], HARP_MAX_ERROR_INFO_LENGTH - current_length, message, ap);
+    buffer[HARP_MAX_ERROR_INFO_LENGTH] = '\0';
 }
 
 static int add_error_message(const char *message, ...)
@@ -211,15 +232,63 @@ static int add_error_message(const char *message, ...)
 
 static void set_error_message_vargs(const char *message, va_list ap)
 {
+    char *buffer = get_error_message_buffer();
+
     if (message == NULL)
     {
-        harp_error_message_buffer[0] = '\0';
+        buffer[0] = '\0';
     }
     else
     {
-        vsnprintf(harp_error_message_buffer, MAX_ERROR_INFO_LENGTH, message, ap);
-        harp_error_message_buffer[MAX_ERROR_INFO_LENGTH] = '\0';
+        vsnprintf(buffer, HARP_MAX_ERROR_INFO_LENGTH, message, ap);
+        buffer[HARP_MAX_ERROR_INFO_LENGTH] = '\0';
+    }
+}
+
+/* Redirect errors that are set from the calling (worker) thread to a thread specific error state.
+ * This allows HARP functions to be called from multiple threads in parallel without them overwriting each other's
+ * errors (and the error state of the main thread). Each harp_thread_error_begin() call should be matched by a
+ * harp_thread_error_end() call from the same thread.
+ */
+void harp_thread_error_begin(void)
+{
+#ifdef _OPENMP
+    thread_error_active = 1;
+    thread_errno = HARP_SUCCESS;
+    thread_error_message_buffer[0] = '\0';
+#endif
+}
+
+/* End the redirection of errors for the calling thread and store the last error that was set from the thread in
+ * 'error' (error->err will be HARP_SUCCESS if no error was set). Use harp_thread_error_raise() to set this error for
+ * the main thread.
+ */
+void harp_thread_error_end(harp_thread_error *error)
+{
+#ifdef _OPENMP
+    if (thread_error_active)
+    {
+        thread_error_active = 0;
+        error->err = thread_errno;
+        strcpy(error->message, thread_error_message_buffer);
+        return;
     }
+#endif
+    error->err = HARP_SUCCESS;
+    error->message[0] = '\0';
+}
+
+/* Set an error that was collected from a worker thread using harp_thread_error_end().
+ * Without OpenMP errors are never redirected, so the error will then already have been set.
+ */
+void harp_thread_error_raise(const harp_thread_error *error)
+{
+#ifdef _OPENMP
+    harp_errno = error->err;
+    strcpy(harp_error_message_buffer, error->message);
+#else
+    (void)error;
+#endif
 }
 
 void harp_add_coda_cursor_path_to_error_message(const coda_cursor *cursor)
@@ -254,7 +323,18 @@ LIBHARP_API void harp_set_error(int err, const char *message, ...)
 {
     va_list ap;
 
+#ifdef _OPENMP
+    if (thread_error_active)
+    {
+        thread_errno = err;
+    }
+    else
+    {
+        harp_errno = err;
+    }
+#else
     harp_errno = err;
+#endif
 
     va_start(ap, message);
     set_error_message_vargs(message, ap);
@@ -287,10 +367,20 @@ LIBHARP_API void harp_set_error(int err, const char *message, ...)
  */
 LIBHARP_API const char *harp_errno_to_string(int err)
 {
-    if (err == harp_errno && harp_error_message_buffer[0] != '\0')
+    const char *buffer = get_error_message_buffer();
+    int current_errno = harp_errno;
+
+#ifdef _OPENMP
+    if (thread_error_active)
+    {
+        current_errno = thread_errno;
+    }
+#endif
+
+    if (err == current_errno && buffer[0] != '\0')
     {
         /* return the custom error message for the current HARP error */
-        return harp_error_message_buffer;
+        return buffer;
     }
     else
     {
@@ -373,9 +463,9 @@ LIBHARP_API const char *harp_errno_to_string(int err)
                 return "no data left after operation";
 
             default:
-                if (err == harp_errno)
+                if (err == current_errno)
                 {
-                    return harp_error_message_buffer;
+                    return buffer;
                 }
                 else
                 {
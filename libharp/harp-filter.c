@@ -35,15 +35,24 @@
 #include <stdlib.h>
 #include <string.h>
 
-static void free_string_data(char **first, char **last)
+static void free_string_data(const harp_string_arena *arena, char **first, char **last)
 {
     for (; first != last; first++)
     {
-        if (*first != NULL)
-        {
-            free(*first);
-            *first = NULL;
-        }
+        harp_string_arena_free_string(arena, *first);
+        *first = NULL;
+    }
+}
+
+static void null_array(harp_data_type data_type, const harp_string_arena *arena, long num_elements, harp_array data)
+{
+    if (data_type == harp_type_string)
+    {
+        free_string_data(arena, data.string_data, data.string_data + num_elements);
+    }
+    else
+    {
+        harp_array_null(data_type, num_elements, data);
     }
 }
 
@@ -160,8 +169,8 @@ static void filter_array_double(long num_source_elements, const uint8_t *mask, c
     }
 }
 
-static void filter_array_string(long num_source_elements, const uint8_t *mask, char **source,
-                                long num_target_elements, char **target)
+static void filter_array_string(const harp_string_arena *arena, long num_source_elements, const uint8_t *mask,
+                                char **source, long num_target_elements, char **target)
 {
     char **source_end;
     char **target_end;
@@ -173,11 +182,7 @@ static void filter_array_string(long num_source_elements, const uint8_t *mask, c
         {
             if (target != source)
             {
-                if (*target != NULL)
-                {
-                    free(*target);
-                }
-
+                harp_string_arena_free_string(arena, *target);
                 *target = *source;
                 *source = NULL;
             }
@@ -187,11 +192,11 @@ static void filter_array_string(long num_source_elements, const uint8_t *mask, c
         }
     }
 
-    free_string_data(target, target_end);
+    free_string_data(arena, target, target_end);
 }
 
-static void filter_array(harp_data_type data_type, long num_source_elements, const uint8_t *mask, harp_array source,
-                         long num_target_elements, harp_array target)
+static void filter_array(harp_data_type data_type, const harp_string_arena *arena, long num_source_elements,
+                         const uint8_t *mask, harp_array source, long num_target_elements, harp_array target)
 {
     if (mask == NULL)
     {
@@ -201,7 +206,7 @@ static void filter_array(harp_data_type data_type, long num_source_elements, con
         {
             if (data_type == harp_type_string)
             {
-                free_string_data(target.string_data, target.string_data + num_target_elements);
+                free_string_data(arena, target.string_data, target.string_data + num_target_elements);
             }
 
             memcpy(target.ptr, source.ptr, num_target_elements * harp_get_size_for_type(data_type));
@@ -236,7 +241,7 @@ static void filter_array(harp_data_type data_type, long num_source_elements, con
                                     target.double_data);
                 break;
             case harp_type_string:
-                filter_array_string(num_source_elements, mask, source.string_data, num_target_elements,
+                filter_array_string(arena, num_source_elements, mask, source.string_data, num_target_elements,
                                     target.string_data);
                 break;
             default:
@@ -251,6 +256,8 @@ static void filter_array(harp_data_type data_type, long num_source_elements, con
  * evaluates to true. The length of the source array is allowed to be larger than the length of the target array, as
  * long as the total number of elements that will be copied is smaller than or equal to the length of the target array.
  * \param data_type           Data type of source and target arrays
+ * \param arena               String arena that owns (some of) the strings in the source and target arrays (can be
+ *     NULL); strings in the arena are not freed
  * \param num_dimensions      Number of dimensions of source and target arrays
  * \param source_dimension    Dimension length for each source dimension
  * \param source_mask         Source mask; If NULL, all elements from the source array will be copied. Otherwise, the
@@ -259,8 +266,9 @@ static void filter_array(harp_data_type data_type, long num_source_elements, con
  * \param target_dimension    Resulting dimension length for each target dimension
  * \param target              Target array.
  */
-void harp_array_filter(harp_data_type data_type, int num_dimensions, const long *source_dimension,
-                       const uint8_t **source_mask, harp_array source, const long *target_dimension, harp_array target)
+void harp_array_filter(harp_data_type data_type, const harp_string_arena *arena, int num_dimensions,
+                       const long *source_dimension, const uint8_t **source_mask, harp_array source,
+                       const long *target_dimension, harp_array target)
 {
     long data_type_size;
     long source_stride[HARP_MAX_NUM_DIMS];
@@ -273,14 +281,14 @@ void harp_array_filter(harp_data_type data_type, int num_dimensions, const long
     /* Special case for scalars. */
     if (num_dimensions == 0)
     {
-        filter_array(data_type, 1, NULL, source, 1, target);
+        filter_array(data_type, arena, 1, NULL, source, 1, target);
         return;
     }
 
     if (num_dimensions == 1)
     {
         /* Special case for 1-D arrays. */
-        filter_array(data_type, *source_dimension, *source_mask, source, *target_dimension, target);
+        filter_array(data_type, arena, *source_dimension, *source_mask, source, *target_dimension, target);
         return;
     }
 
@@ -324,7 +332,8 @@ void harp_array_filter(harp_data_type data_type, int num_dimensions, const long
 
                 if (num_blocks > 0)
                 {
-                    harp_array_null(data_type, num_blocks * target_stride[dimension_index] / data_type_size, target);
+                    null_array(data_type, arena, num_blocks * target_stride[dimension_index] / data_type_size,
+                               target);
                     target.ptr = (void *)(((char *)target.ptr) + num_blocks * target_stride[dimension_index]);
                 }
 
@@ -346,7 +355,7 @@ void harp_array_filter(harp_data_type data_type, int num_dimensions, const long
         if (dimension_index > 0)
         {
             /* Filter the fastest running dimension. */
-            filter_array(data_type, source_dimension[dimension_index], source_mask[dimension_index], source,
+            filter_array(data_type, arena, source_dimension[dimension_index], source_mask[dimension_index], source,
                          target_dimension[dimension_index], target);
 
             /* Move to the next index on the previous dimension. */
@@ -444,8 +453,8 @@ int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set
 
     if (!has_2D_masks)
     {
-        harp_array_filter(variable->data_type, variable->num_dimensions, variable->dimension, mask, variable->data,
-                          new_dimension, variable->data);
+        harp_array_filter(variable->data_type, HARP_VARIABLE_INTERNAL(variable)->string_arena, variable->num_dimensions,
+                          variable->dimension, mask, variable->data, new_dimension, variable->data);
     }
     else
     {
@@ -495,8 +504,9 @@ int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set
         {
             if (mask[0] == NULL || *mask[0])
             {
-                harp_array_filter(variable->data_type, variable->num_dimensions - 1, &variable->dimension[1], &mask[1],
-                                  source, &new_dimension[1], target);
+                harp_array_filter(variable->data_type, HARP_VARIABLE_INTERNAL(variable)->string_arena,
+                                  variable->num_dimensions - 1, &variable->dimension[1], &mask[1], source,
+                                  &new_dimension[1], target);
 
                 target.ptr = (void *)(((char *)target.ptr) + target_stride);
             }
@@ -516,7 +526,7 @@ int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set
     /* Free any remaining string data. */
     if (variable->data_type == harp_type_string)
     {
-        free_string_data(variable->data.string_data + new_num_elements,
+        free_string_data(HARP_VARIABLE_INTERNAL(variable)->string_arena, variable->data.string_data + new_num_elements,
                          variable->data.string_data + variable->num_elements);
     }
 
@@ -533,6 +543,7 @@ int harp_variable_filter(harp_variable *variable, const harp_dimension_mask_set
             return -1;
         }
         variable->data.ptr = new_data;
+        HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
     }
 
     /* Update variable attributes. */
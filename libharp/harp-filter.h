@@ -35,7 +35,7 @@
 #include "harp-internal.h"
 #include "harp-operation.h"
 
-void harp_array_filter(harp_data_type data_type, int num_dimensions,
+void harp_array_filter(harp_data_type data_type, const harp_string_arena *arena, int num_dimensions,
                        const long *source_dimension, const uint8_t **source_mask, harp_array source,
                        const long *target_dimension, harp_array target);
 
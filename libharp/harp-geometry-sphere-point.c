@@ -35,6 +35,9 @@
 #include <math.h>
 #include <stdlib.h>
 
+/* number of points that are processed in one go by the batch distance functions */
+#define POINT_BATCH_SIZE 256
+
 /* Check if two spherical points are equal */
 int harp_spherical_point_equal(const harp_spherical_point *pointa, const harp_spherical_point *pointb)
 {
@@ -221,6 +224,112 @@ double harp_spherical_point_distance(const harp_spherical_point *pointp, const h
     }
 }
 
+/* Calculate the squared chord length (i.e. the squared Euclidean distance between the unit vectors) between a
+ * reference point and each point in a latitude/longitude array (in [deg]).
+ * The loop is kept free of branches and function calls other than sin/cos. Note that compilers will only vectorise
+ * it if sin/cos can be replaced by vector math routines (e.g. GCC with -ffast-math, or -fno-math-errno and glibc's
+ * libmvec), which a default HARP build does not enable.
+ */
+static void chord_length_squared_array(const harp_vector3d *reference, long num_points, const double *latitude,
+                                       const double *longitude, double *chord_length_squared)
+{
+    long i;
+
+    for (i = 0; i < num_points; i++)
+    {
+        double latitude_rad = latitude[i] * (double)(CONST_DEG2RAD);
+        double longitude_rad = longitude[i] * (double)(CONST_DEG2RAD);
+        double cos_latitude = cos(latitude_rad);
+        double dx = cos_latitude * cos(longitude_rad) - reference->x;
+        double dy = cos_latitude * sin(longitude_rad) - reference->y;
+        double dz = sin(latitude_rad) - reference->z;
+
+        chord_length_squared[i] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+/* Calculate the surface distance [rad] between a point and each point in a latitude/longitude array (in [deg]).
+ * NaN values for latitude or longitude result in a NaN distance.
+ */
+void harp_spherical_point_distance_array(const harp_spherical_point *point, long num_points, const double *latitude,
+                                         const double *longitude, double *distance)
+{
+    harp_vector3d reference;
+    long i;
+
+    harp_vector3d_from_spherical_point(&reference, point);
+
+    chord_length_squared_array(&reference, num_points, latitude, longitude, distance);
+    for (i = 0; i < num_points; i++)
+    {
+        /* a chord of length c spans an angle of 2 * asin(c / 2) */
+        distance[i] = 2 * asin(0.5 * sqrt(distance[i]));
+        if (HARP_GEOMETRY_FPzero(distance[i]))
+        {
+            distance[i] = 0.0;
+        }
+    }
+}
+
+/* Set mask[i] to 0 for all points in the latitude/longitude array (in [deg]) that are further than max_distance [rad]
+ * from the given point. Mask entries for points that are within the distance are left unmodified.
+ * The comparison is performed on the chord length, so no inverse trigonometric function is needed per point.
+ * Points with a NaN latitude or longitude are always masked out.
+ */
+void harp_spherical_point_distance_filter(const harp_spherical_point *point, double max_distance, long num_points,
+                                          const double *latitude, const double *longitude, uint8_t *mask)
+{
+    harp_vector3d reference;
+    double max_chord_length_squared;
+    long i;
+
+    if (!(max_distance >= 0))
+    {
+        for (i = 0; i < num_points; i++)
+        {
+            mask[i] = 0;
+        }
+        return;
+    }
+
+    /* distances below the geometry epsilon are considered to be 0 */
+    if (max_distance < HARP_GEOMETRY_EPSILON)
+    {
+        max_distance = HARP_GEOMETRY_EPSILON;
+    }
+    if (max_distance >= M_PI)
+    {
+        /* all points (except those with NaN coordinates) are within range */
+        max_chord_length_squared = 4.0;
+    }
+    else
+    {
+        max_chord_length_squared = 2 * sin(max_distance / 2);
+        max_chord_length_squared *= max_chord_length_squared;
+    }
+
+    harp_vector3d_from_spherical_point(&reference, point);
+
+    for (i = 0; i < num_points; i += POINT_BATCH_SIZE)
+    {
+        double chord_length_squared[POINT_BATCH_SIZE];
+        long num_batch_points = num_points - i;
+        long j;
+
+        if (num_batch_points > POINT_BATCH_SIZE)
+        {
+            num_batch_points = POINT_BATCH_SIZE;
+        }
+
+        chord_length_squared_array(&reference, num_batch_points, &latitude[i], &longitude[i], chord_length_squared);
+        for (j = 0; j < num_batch_points; j++)
+        {
+            /* a NaN chord length will compare false and thus results in a 0 */
+            mask[i + j] &= (chord_length_squared[j] <= max_chord_length_squared);
+        }
+    }
+}
+
 
 /** Calculate the distance between two points on the surface of the Earth in meters
  * \ingroup harp_geometry
@@ -251,3 +360,51 @@ LIBHARP_API int harp_geometry_get_point_distance(double latitude_a, double longi
 
     return 0;
 }
+
+/** Calculate the distance between a point and each point in a list of points on the surface of the Earth in meters
+ * \ingroup harp_geometry
+ * This function assumes a spherical earth.
+ * It is equivalent to calling harp_geometry_get_point_distance() for each point in the list, but is considerably
+ * faster for large lists since the position of the reference point is only computed once.
+ * \param latitude Latitude of the reference point
+ * \param longitude Longitude of the reference point
+ * \param num_points Number of points in \a latitude_points and \a longitude_points
+ * \param latitude_points Latitudes of the points
+ * \param longitude_points Longitudes of the points
+ * \param distance Array of \a num_points elements in which the surface distance in [m] between the reference point
+ * and each of the points will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_geometry_get_point_distances(double latitude, double longitude, long num_points,
+                                                  const double *latitude_points, const double *longitude_points,
+                                                  double *distance)
+{
+    harp_spherical_point point;
+    long i;
+
+    if (num_points < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_points argument (%ld) is negative (%s:%u)", num_points,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_points > 0 && (latitude_points == NULL || longitude_points == NULL || distance == NULL))
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "point or distance array is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    point.lat = latitude * (double)(CONST_DEG2RAD);
+    point.lon = longitude * (double)(CONST_DEG2RAD);
+    harp_spherical_point_check(&point);
+
+    harp_spherical_point_distance_array(&point, num_points, latitude_points, longitude_points, distance);
+    for (i = 0; i < num_points; i++)
+    {
+        distance[i] *= CONST_EARTH_RADIUS_WGS84_SPHERE;
+    }
+
+    return 0;
+}
@@ -169,6 +169,10 @@ void harp_spherical_point_from_vector3d(harp_spherical_point *point, const harp_
 void harp_spherical_point_rad_from_deg(harp_spherical_point *point);
 void harp_spherical_point_deg_from_rad(harp_spherical_point *point);
 double harp_spherical_point_distance(const harp_spherical_point *pointp, const harp_spherical_point *pointq);
+void harp_spherical_point_distance_array(const harp_spherical_point *point, long num_points, const double *latitude,
+                                         const double *longitude, double *distance);
+void harp_spherical_point_distance_filter(const harp_spherical_point *point, double max_distance, long num_points,
+                                          const double *latitude, const double *longitude, uint8_t *mask);
 
 /* Spherical line functions */
 void harp_spherical_line_begin(harp_spherical_point *point, const harp_spherical_line *line);
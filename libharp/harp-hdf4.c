@@ -533,22 +533,10 @@ static int read_variable(harp_product *product, int32 sds_id)
             return -1;
         }
 
-        for (i = 0; i < variable->num_elements; i++)
+        if (harp_variable_set_string_data_from_char_array(variable, length, buffer) != 0)
         {
-            char *str;
-
-            str = malloc((length + 1) * sizeof(char));
-            if (str == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (length + 1) * sizeof(char), __FILE__, __LINE__);
-                free(buffer);
-                return -1;
-            }
-
-            memcpy(str, &buffer[i * length], length);
-            str[length] = '\0';
-            variable->data.string_data[i] = str;
+            free(buffer);
+            return -1;
         }
 
         free(buffer);
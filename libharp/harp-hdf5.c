@@ -38,6 +38,23 @@
 #include "hdf5.h"
 #include "hdf5_hl.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/* With zlib (and HDF5 >= 1.8.11 for direct chunk writes) HARP compresses the chunks of variables itself, using multiple
+ * threads if OpenMP is available, and passes the compressed chunks to HDF5 as-is. Otherwise compression is left to
+ * H5Dwrite(), which always runs single threaded.
+ */
+#if defined(HAVE_ZLIB) && H5_VERSION_GE(1, 8, 11)
+#define WITH_CHUNK_COMPRESSION
+#endif
+
+/* Maximum amount of (uncompressed) variable data in bytes that is compressed in one go. The compressed chunks of all
+ * variables in a batch are kept in memory until they are written, so this bounds the additional memory use.
+ */
+#define MAX_COMPRESSION_BATCH_SIZE 268435456
+
 /* String value used in netCDF-4 files as the NAME attribute for dimension scales without coordinate variables. This
  * #define statement was copied verbatim from netcdf.h and should be kept in sync with future updates of the netCDF-4
  * library.
@@ -86,6 +103,26 @@ typedef struct hdf5_dimension_ids_struct
     long length[HARP_NUM_DIM_TYPES];
 } hdf5_dimension_ids;
 
+/* Shared handle to a product file that stays open while variables with deferred data refer to it. */
+typedef struct hdf5_file_struct
+{
+    hid_t file_id;
+    int ref_count;
+} hdf5_file;
+
+typedef struct hdf5_variable_loader_struct
+{
+    hdf5_file *file;
+    char *dataset_name;
+} hdf5_variable_loader;
+
+/* Strictly increasing list of time indices that should be read for time dependent variables. */
+typedef struct hdf5_time_selection_struct
+{
+    long num_indices;
+    const long *index;
+} hdf5_time_selection;
+
 static void dimensions_init(hdf5_dimensions *dimensions)
 {
     dimensions->num_dimensions = 0;
@@ -371,57 +408,480 @@ static int get_link_iteration_index_type(hid_t group_id, H5_index_t * index_type
     return 0;
 }
 
-static int set_compression(hid_t plist_id, harp_variable *variable)
+/* determine the chunk shape for a variable with elements of 'element_size' bytes */
+static void get_chunk_dimensions(const harp_variable *variable, long element_size, hsize_t *chunk_dimension)
+{
+    long max_length = 4294967295;
+    long chunk_size = harp_option_hdf5_chunk_size;
+    long max_num_elements;
+    long num_inner_elements;
+    int i;
+
+    /* HDF5 allows at most 2^32-1 elements and 4GB per chunk */
+    max_num_elements = max_length;
+    if (element_size > 0 && max_length / element_size < max_num_elements)
+    {
+        max_num_elements = max_length / element_size;
+    }
+    if (chunk_size > 0 && element_size > 0 && chunk_size / element_size < max_num_elements)
+    {
+        max_num_elements = chunk_size / element_size;
+    }
+    if (max_num_elements < 1)
+    {
+        max_num_elements = 1;
+    }
+
+    /* split along the outer-most dimensions (i.e. the time dimension for time dependent variables) first, such that
+     * a chunk consists of a block of consecutive 'rows' of the variable */
+    num_inner_elements = variable->num_elements;
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        chunk_dimension[i] = variable->dimension[i] > 0 ? variable->dimension[i] : 1;
+    }
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        if (variable->dimension[i] == 0)
+        {
+            break;
+        }
+        num_inner_elements /= variable->dimension[i];
+        if (num_inner_elements <= max_num_elements)
+        {
+            long length = max_num_elements / (num_inner_elements > 0 ? num_inner_elements : 1);
+
+            if (length < variable->dimension[i])
+            {
+                chunk_dimension[i] = length;
+            }
+            break;
+        }
+        chunk_dimension[i] = 1;
+    }
+}
+
+static int set_compression(hid_t plist_id, harp_variable *variable, long element_size)
 {
     int level = harp_get_option_hdf5_compression();
 
     if (level > 0 && variable->num_dimensions > 0)
     {
-        long max_length = 4294967295;
         hsize_t dimension[HARP_MAX_NUM_DIMS];
+        long chunk_num_elements = 1;
         int i;
 
         /* set chunk configuration (we need chunking to enable compression) */
-        /* we want to use the largest block possible while staying within the 2^32-1 elements per chunk limit */
+        get_chunk_dimensions(variable, element_size, dimension);
+        if (H5Pset_chunk(plist_id, variable->num_dimensions, dimension) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+        if (harp_option_hdf5_shuffle)
+        {
+            if (H5Pset_shuffle(plist_id) < 0)
+            {
+                harp_set_error(HARP_ERROR_HDF5, NULL);
+                return -1;
+            }
+        }
         for (i = 0; i < variable->num_dimensions; i++)
         {
-            dimension[i] = variable->dimension[i];
+            chunk_num_elements *= (long)dimension[i];
+        }
+        /* szip needs an even number of (at most 32) pixels per block that does not exceed the chunk size; very small
+         * chunks (and string variables, which szip does not support) use deflate instead */
+        if (harp_option_hdf5_compression_filter == 1 && variable->data_type != harp_type_string &&
+            chunk_num_elements >= 2)
+        {
+            unsigned int filter_config;
+            unsigned int pixels_per_block = chunk_num_elements < 32 ? (unsigned int)(chunk_num_elements & ~1) : 32;
+
+            if (H5Zfilter_avail(H5Z_FILTER_SZIP) <= 0 ||
+                H5Zget_filter_info(H5Z_FILTER_SZIP, &filter_config) < 0 ||
+                !(filter_config & H5Z_FILTER_CONFIG_ENCODE_ENABLED))
+            {
+                harp_set_error(HARP_ERROR_EXPORT, "szip compression is not supported by the HDF5 library");
+                return -1;
+            }
+            if (H5Pset_szip(plist_id, H5_SZIP_NN_OPTION_MASK, pixels_per_block) < 0)
+            {
+                harp_set_error(HARP_ERROR_HDF5, NULL);
+                return -1;
+            }
+        }
+        else if (H5Pset_deflate(plist_id, level) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
         }
-        if (variable->num_elements > max_length)
+    }
+    return 0;
+}
+
+#ifdef WITH_CHUNK_COMPRESSION
+typedef struct hdf5_chunk_struct
+{
+    unsigned char *data;
+    size_t size;        /* size of the compressed data, or of the buffer that could not be allocated */
+    int status;         /* 0: ok, -1: out of memory, -2: zlib error */
+} hdf5_chunk;
+
+/* Compressed chunks of a variable in the order of the chunk grid (last dimension varying fastest). */
+typedef struct hdf5_compressed_variable_struct
+{
+    hsize_t chunk_dimension[HARP_MAX_NUM_DIMS];
+    unsigned char fill_value[8];        /* value used by HDF5 to pad edge chunks (in native byte order) */
+    long num_chunks;
+    hdf5_chunk *chunk;
+} hdf5_compressed_variable;
+
+static void compressed_variable_delete(hdf5_compressed_variable *compressed)
+{
+    if (compressed != NULL)
+    {
+        if (compressed->chunk != NULL)
         {
-            long num_elements = variable->num_elements;
-            int i = 0;
+            long i;
 
-            while (i < variable->num_dimensions - 1)
+            for (i = 0; i < compressed->num_chunks; i++)
             {
-                num_elements /= (long)dimension[i];
-                if (num_elements <= max_length)
+                if (compressed->chunk[i].data != NULL)
                 {
-                    dimension[i] = max_length / num_elements;
-                    num_elements *= (long)dimension[i];
-                    break;
+                    free(compressed->chunk[i].data);
                 }
-                dimension[i] = 1;
-                i++;
             }
-            if (num_elements > max_length)
+            free(compressed->chunk);
+        }
+        free(compressed);
+    }
+}
+
+/* returns whether set_compression() will configure a filter pipeline that compress_chunk() can reproduce */
+static int use_chunk_compression(const harp_variable *variable)
+{
+    if (harp_get_option_hdf5_compression() == 0 || variable->num_dimensions == 0 || variable->num_elements == 0)
+    {
+        return 0;
+    }
+    /* strings and szip compression are left to HDF5 */
+    return variable->data_type != harp_type_string && harp_option_hdf5_compression_filter == 0;
+}
+
+/* determine the offset (in elements) of the chunk with the given index in the chunk grid */
+static void get_chunk_offset(const harp_variable *variable, const hsize_t *chunk_dimension, long index,
+                             hsize_t *offset)
+{
+    int i;
+
+    for (i = variable->num_dimensions - 1; i >= 0; i--)
+    {
+        long num_chunks = (long)((variable->dimension[i] + chunk_dimension[i] - 1) / chunk_dimension[i]);
+
+        offset[i] = (index % num_chunks) * chunk_dimension[i];
+        index /= num_chunks;
+    }
+}
+
+/* compress a single chunk exactly as the HDF5 shuffle (optional) and deflate filters would; this function is called
+ * from multiple threads at once, so it only reports errors via the chunk status
+ */
+static void compress_chunk(const harp_variable *variable, hdf5_compressed_variable *compressed, long index)
+{
+    hdf5_chunk *chunk = &compressed->chunk[index];
+    long element_size = harp_get_size_for_type(variable->data_type);
+    int num_dimensions = variable->num_dimensions;
+    hsize_t offset[HARP_MAX_NUM_DIMS];
+    long length[HARP_MAX_NUM_DIMS];
+    long position[HARP_MAX_NUM_DIMS];
+    long num_chunk_elements = 1;
+    long num_rows = 1;
+    int is_edge_chunk = 0;
+    unsigned char *buffer;
+    uLongf compressed_size;
+    size_t buffer_size;
+    long i;
+    int j;
+
+    get_chunk_offset(variable, compressed->chunk_dimension, index, offset);
+    for (j = 0; j < num_dimensions; j++)
+    {
+        num_chunk_elements *= (long)compressed->chunk_dimension[j];
+        length[j] = (long)compressed->chunk_dimension[j];
+        if (offset[j] + length[j] > (hsize_t)variable->dimension[j])
+        {
+            /* edge chunks are partially filled; the remainder is ignored by readers */
+            length[j] = variable->dimension[j] - (long)offset[j];
+            is_edge_chunk = 1;
+        }
+        position[j] = 0;
+    }
+    for (j = 0; j < num_dimensions - 1; j++)
+    {
+        num_rows *= length[j];
+    }
+
+    buffer_size = num_chunk_elements * element_size;
+    buffer = malloc(buffer_size);
+    if (buffer == NULL)
+    {
+        chunk->size = buffer_size;
+        chunk->status = -1;
+        return;
+    }
+    if (is_edge_chunk)
+    {
+        /* pad the part of the chunk that lies outside the dataset in the same way as HDF5 would */
+        for (i = 0; i < num_chunk_elements; i++)
+        {
+            memcpy(&buffer[i * element_size], compressed->fill_value, element_size);
+        }
+    }
+
+    /* gather the chunk one row (along the inner-most dimension) at a time */
+    for (i = 0; i < num_rows; i++)
+    {
+        long source = 0;
+        long target = 0;
+
+        for (j = 0; j < num_dimensions - 1; j++)
+        {
+            source = source * variable->dimension[j] + (long)offset[j] + position[j];
+            target = target * (long)compressed->chunk_dimension[j] + position[j];
+        }
+        source = source * variable->dimension[num_dimensions - 1] + (long)offset[num_dimensions - 1];
+        target = target * (long)compressed->chunk_dimension[num_dimensions - 1];
+        memcpy(&buffer[target * element_size], &((unsigned char *)variable->data.ptr)[source * element_size],
+               length[num_dimensions - 1] * element_size);
+
+        for (j = num_dimensions - 2; j >= 0; j--)
+        {
+            position[j]++;
+            if (position[j] < length[j])
             {
-                dimension[i] = max_length;
+                break;
             }
+            position[j] = 0;
         }
-        if (H5Pset_chunk(plist_id, variable->num_dimensions, dimension) < 0)
+    }
+
+    if (harp_option_hdf5_shuffle && element_size > 1 && num_chunk_elements > 1)
+    {
+        unsigned char *shuffled;
+
+        /* the shuffle filter stores the first bytes of all elements, followed by all second bytes, etc. */
+        shuffled = malloc(buffer_size);
+        if (shuffled == NULL)
+        {
+            free(buffer);
+            chunk->size = buffer_size;
+            chunk->status = -1;
+            return;
+        }
+        for (i = 0; i < num_chunk_elements; i++)
+        {
+            for (j = 0; j < element_size; j++)
+            {
+                shuffled[j * num_chunk_elements + i] = buffer[i * element_size + j];
+            }
+        }
+        free(buffer);
+        buffer = shuffled;
+    }
+
+    compressed_size = compressBound((uLong)buffer_size);
+    chunk->data = malloc(compressed_size);
+    if (chunk->data == NULL)
+    {
+        free(buffer);
+        chunk->size = compressed_size;
+        chunk->status = -1;
+        return;
+    }
+    if (compress2(chunk->data, &compressed_size, buffer, (uLong)buffer_size, harp_get_option_hdf5_compression())
+        != Z_OK)
+    {
+        free(buffer);
+        chunk->status = -2;
+        return;
+    }
+    free(buffer);
+    chunk->size = compressed_size;
+    chunk->status = 0;
+}
+
+/* compress all chunks of the variables first_index..last_index-1 (for as far as they are eligible) in parallel */
+static int compress_variables(const harp_product *product, int first_index, int last_index,
+                              hdf5_compressed_variable **compressed)
+{
+    long *task_chunk;
+    int *task_variable;
+    long num_tasks = 0;
+    long i;
+    int k;
+
+    for (k = first_index; k < last_index; k++)
+    {
+        const harp_variable *variable = product->variable[k];
+        hdf5_compressed_variable *compressed_variable;
+        hid_t dcpl_id;
+        int j;
+
+        compressed[k - first_index] = NULL;
+        if (!use_chunk_compression(variable))
+        {
+            continue;
+        }
+
+        compressed_variable = malloc(sizeof(hdf5_compressed_variable));
+        if (compressed_variable == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(hdf5_compressed_variable), __FILE__, __LINE__);
+            return -1;
+        }
+        compressed[k - first_index] = compressed_variable;
+        compressed_variable->chunk = NULL;
+
+        /* HDF5 pads partial chunks with the fill value of the dataset creation property list (which write_variable()
+         * leaves at its default) */
+        dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
+        if (dcpl_id < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            return -1;
+        }
+        if (H5Pget_fill_value(dcpl_id, get_hdf5_type(variable->data_type), compressed_variable->fill_value) < 0)
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
+            H5Pclose(dcpl_id);
             return -1;
         }
-        if (H5Pset_deflate(plist_id, level) < 0)
+        H5Pclose(dcpl_id);
+
+        get_chunk_dimensions(variable, harp_get_size_for_type(variable->data_type),
+                             compressed_variable->chunk_dimension);
+        compressed_variable->num_chunks = 1;
+        for (j = 0; j < variable->num_dimensions; j++)
+        {
+            compressed_variable->num_chunks *= (long)((variable->dimension[j] +
+                                                       compressed_variable->chunk_dimension[j] - 1) /
+                                                      compressed_variable->chunk_dimension[j]);
+        }
+        compressed_variable->chunk = calloc(compressed_variable->num_chunks, sizeof(hdf5_chunk));
+        if (compressed_variable->chunk == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           compressed_variable->num_chunks * sizeof(hdf5_chunk), __FILE__, __LINE__);
+            return -1;
+        }
+        num_tasks += compressed_variable->num_chunks;
+    }
+
+    if (num_tasks == 0)
+    {
+        return 0;
+    }
+
+    task_variable = malloc(num_tasks * sizeof(int));
+    if (task_variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(int), __FILE__, __LINE__);
+        return -1;
+    }
+    task_chunk = malloc(num_tasks * sizeof(long));
+    if (task_chunk == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_tasks * sizeof(long), __FILE__, __LINE__);
+        free(task_variable);
+        return -1;
+    }
+    num_tasks = 0;
+    for (k = first_index; k < last_index; k++)
+    {
+        if (compressed[k - first_index] != NULL)
+        {
+            for (i = 0; i < compressed[k - first_index]->num_chunks; i++)
+            {
+                task_variable[num_tasks] = k;
+                task_chunk[num_tasks] = i;
+                num_tasks++;
+            }
+        }
+    }
+
+    /* chunks of all variables in the batch are compressed concurrently */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (i = 0; i < num_tasks; i++)
+    {
+        compress_chunk(product->variable[task_variable[i]], compressed[task_variable[i] - first_index],
+                       task_chunk[i]);
+    }
+
+    free(task_chunk);
+    free(task_variable);
+
+    for (k = first_index; k < last_index; k++)
+    {
+        if (compressed[k - first_index] == NULL)
+        {
+            continue;
+        }
+        for (i = 0; i < compressed[k - first_index]->num_chunks; i++)
+        {
+            hdf5_chunk *chunk = &compressed[k - first_index]->chunk[i];
+
+            if (chunk->status == -1)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               chunk->size, __FILE__, __LINE__);
+                return -1;
+            }
+            if (chunk->status != 0)
+            {
+                harp_set_error(HARP_ERROR_EXPORT, "could not compress data of variable '%s'",
+                               product->variable[k]->name);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int write_compressed_chunks(hid_t dataset_id, const harp_variable *variable,
+                                   const hdf5_compressed_variable *compressed)
+{
+    long i;
+
+    for (i = 0; i < compressed->num_chunks; i++)
+    {
+        hsize_t offset[HARP_MAX_NUM_DIMS];
+        herr_t result;
+
+        get_chunk_offset(variable, compressed->chunk_dimension, i, offset);
+        /* a filter mask of 0 indicates that all filters of the pipeline were applied to the chunk */
+#if H5_VERSION_GE(1, 10, 3)
+        result = H5Dwrite_chunk(dataset_id, H5P_DEFAULT, 0, offset, compressed->chunk[i].size,
+                                compressed->chunk[i].data);
+#else
+        result = H5DOwrite_chunk(dataset_id, H5P_DEFAULT, 0, offset, compressed->chunk[i].size,
+                                 compressed->chunk[i].data);
+#endif
+        if (result < 0)
         {
             harp_set_error(HARP_ERROR_HDF5, NULL);
             return -1;
         }
     }
+
     return 0;
 }
+#endif
 
 static int read_string_attribute(hid_t obj_id, const char *name, char **data)
 {
@@ -771,18 +1231,237 @@ static int read_variable_dimensions(const char *variable_name, hid_t dataset_id,
         }
     }
 
-    *num_dimensions = hdf5_num_dimensions;
-    for (i = 0; i < hdf5_num_dimensions; i++)
+    *num_dimensions = hdf5_num_dimensions;
+    for (i = 0; i < hdf5_num_dimensions; i++)
+    {
+        dimension_type[i] = hdf5_dimension_type[i];
+        dimension[i] = (long)hdf5_dimension[i];
+    }
+
+    return 0;
+}
+
+/* create the file and memory dataspaces that select the given time indices from a time dependent variable */
+static int create_time_selection_spaces(hid_t dataset_id, const harp_variable *variable,
+                                        const hdf5_time_selection *selection, hid_t *file_space_id,
+                                        hid_t *mem_space_id)
+{
+    hsize_t start[HARP_MAX_NUM_DIMS];
+    hsize_t count[HARP_MAX_NUM_DIMS];
+    hsize_t dimension[HARP_MAX_NUM_DIMS];
+    H5S_seloper_t op = H5S_SELECT_SET;
+    hid_t space_id;
+    long i;
+    int j;
+
+    space_id = H5Dget_space(dataset_id);
+    if (space_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    for (j = 0; j < variable->num_dimensions; j++)
+    {
+        start[j] = 0;
+        count[j] = variable->dimension[j];
+        dimension[j] = variable->dimension[j];
+    }
+
+    /* select each run of consecutive indices as a single hyperslab */
+    i = 0;
+    while (i < selection->num_indices)
+    {
+        long run_length = 1;
+
+        while (i + run_length < selection->num_indices &&
+               selection->index[i + run_length] == selection->index[i] + run_length)
+        {
+            run_length++;
+        }
+        start[0] = selection->index[i];
+        count[0] = run_length;
+        if (H5Sselect_hyperslab(space_id, op, start, NULL, count, NULL) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            H5Sclose(space_id);
+            return -1;
+        }
+        op = H5S_SELECT_OR;
+        i += run_length;
+    }
+
+    *mem_space_id = H5Screate_simple(variable->num_dimensions, dimension, NULL);
+    if (*mem_space_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Sclose(space_id);
+        return -1;
+    }
+
+    *file_space_id = space_id;
+
+    return 0;
+}
+
+static int read_string_data(hid_t dataset_id, hid_t file_space_id, hid_t mem_space_id, harp_variable *variable)
+{
+    char *buffer;
+    hid_t type_id;
+    hsize_t type_size;
+    hid_t mem_type_id;
+
+    type_id = H5Dget_type(dataset_id);
+    if (type_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    type_size = H5Tget_size(type_id);
+    if (type_size == 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Tclose(type_id);
+        return -1;
+    }
+
+    H5Tclose(type_id);
+
+    mem_type_id = H5Tcopy(H5T_C_S1);
+    if (mem_type_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    if (H5Tset_size(mem_type_id, type_size) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Tclose(mem_type_id);
+        return -1;
+    }
+
+    if (H5Tset_strpad(mem_type_id, H5T_STR_NULLPAD) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        H5Tclose(mem_type_id);
+        return -1;
+    }
+
+    buffer = malloc(variable->num_elements * type_size * sizeof(char));
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       variable->num_elements * type_size * sizeof(char), __FILE__, __LINE__);
+        H5Tclose(mem_type_id);
+        return -1;
+    }
+
+    if (H5Dread(dataset_id, mem_type_id, mem_space_id, file_space_id, H5P_DEFAULT, buffer) < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        free(buffer);
+        H5Tclose(mem_type_id);
+        return -1;
+    }
+
+    H5Tclose(mem_type_id);
+
+    if (harp_variable_set_string_data_from_char_array(variable, (long)type_size, buffer) != 0)
+    {
+        free(buffer);
+        return -1;
+    }
+
+    free(buffer);
+
+    return 0;
+}
+
+static int read_variable_data(hid_t dataset_id, harp_variable *variable, const hdf5_time_selection *selection)
+{
+    hid_t file_space_id = H5S_ALL;
+    hid_t mem_space_id = H5S_ALL;
+    int result = 0;
+
+    if (selection != NULL && variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time)
+    {
+        if (create_time_selection_spaces(dataset_id, variable, selection, &file_space_id, &mem_space_id) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (variable->data_type == harp_type_string)
+    {
+        result = read_string_data(dataset_id, file_space_id, mem_space_id, variable);
+    }
+    else
+    {
+        if (H5Dread(dataset_id, get_hdf5_type(variable->data_type), mem_space_id, file_space_id, H5P_DEFAULT,
+                    variable->data.ptr) < 0)
+        {
+            harp_set_error(HARP_ERROR_HDF5, NULL);
+            result = -1;
+        }
+    }
+
+    if (file_space_id != H5S_ALL)
+    {
+        H5Sclose(file_space_id);
+        H5Sclose(mem_space_id);
+    }
+
+    return result;
+}
+
+static int load_variable_data(harp_variable *variable, void *user_data)
+{
+    hdf5_variable_loader *loader = (hdf5_variable_loader *)user_data;
+    hid_t dataset_id;
+
+    dataset_id = H5Dopen(loader->file->file_id, loader->dataset_name);
+    if (dataset_id < 0)
+    {
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    if (read_variable_data(dataset_id, variable, NULL) != 0)
     {
-        dimension_type[i] = hdf5_dimension_type[i];
-        dimension[i] = (long)hdf5_dimension[i];
+        H5Dclose(dataset_id);
+        return -1;
     }
 
+    H5Dclose(dataset_id);
+
     return 0;
 }
 
+static void hdf5_file_release(hdf5_file *file)
+{
+    file->ref_count--;
+    if (file->ref_count == 0)
+    {
+        H5Fclose(file->file_id);
+        free(file);
+    }
+}
+
+static void hdf5_variable_loader_delete(void *user_data)
+{
+    hdf5_variable_loader *loader = (hdf5_variable_loader *)user_data;
+
+    hdf5_file_release(loader->file);
+    free(loader->dataset_name);
+    free(loader);
+}
+
+/* if 'file' is not NULL, the variable data is not read, but a loader is attached to the variable instead */
+/* if 'selection' is not NULL, only the selected time indices are read for time dependent variables */
 static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimension_ids *dimension_ids,
-                         harp_product *product)
+                         harp_product *product, hdf5_file *file, const hdf5_time_selection *selection)
 {
     const char *variable_name;
     harp_variable *variable;
@@ -802,114 +1481,67 @@ static int read_variable(hid_t dataset_id, const char *name, const hdf5_dimensio
         return -1;
     }
 
-    variable_name = name;
-    if (strncmp(name, "_nc4_non_coord_", 15) == 0)
-    {
-        variable_name = &name[15];
-    }
-    if (harp_variable_new(variable_name, data_type, num_dimensions, dimension_type, dimension, &variable) != 0)
+    if (selection != NULL && num_dimensions > 0 && dimension_type[0] == harp_dimension_time)
     {
-        return -1;
+        if (selection->index[selection->num_indices - 1] >= dimension[0])
+        {
+            harp_set_error(HARP_ERROR_INVALID_INDEX, "time index (%ld) exceeds time dimension length (%ld) of "
+                           "dataset '%s'", selection->index[selection->num_indices - 1], dimension[0], name);
+            return -1;
+        }
+        dimension[0] = selection->num_indices;
     }
 
-    if (harp_product_add_variable(product, variable) != 0)
+    variable_name = name;
+    if (strncmp(name, "_nc4_non_coord_", 15) == 0)
     {
-        harp_variable_delete(variable);
-        return -1;
+        variable_name = &name[15];
     }
-
-    /* Read variable data. */
-    if (variable->data_type == harp_type_string)
+    if (file != NULL)
     {
-        char *buffer;
-        hid_t type_id;
-        hsize_t type_size;
-        hid_t mem_type_id;
-        long i;
-
-        type_id = H5Dget_type(dataset_id);
-        if (type_id < 0)
-        {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            return -1;
-        }
-
-        type_size = H5Tget_size(type_id);
-        if (type_size == 0)
-        {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            H5Tclose(type_id);
-            return -1;
-        }
-
-        H5Tclose(type_id);
-
-        mem_type_id = H5Tcopy(H5T_C_S1);
-        if (mem_type_id < 0)
-        {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            return -1;
-        }
-
-        if (H5Tset_size(mem_type_id, type_size) < 0)
-        {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            H5Tclose(mem_type_id);
-            return -1;
-        }
-
-        if (H5Tset_strpad(mem_type_id, H5T_STR_NULLPAD) < 0)
-        {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            H5Tclose(mem_type_id);
-            return -1;
-        }
+        hdf5_variable_loader *loader;
 
-        buffer = malloc(variable->num_elements * type_size * sizeof(char));
-        if (buffer == NULL)
+        loader = (hdf5_variable_loader *)malloc(sizeof(hdf5_variable_loader));
+        if (loader == NULL)
         {
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           variable->num_elements * type_size * sizeof(char), __FILE__, __LINE__);
-            H5Tclose(mem_type_id);
+                           sizeof(hdf5_variable_loader), __FILE__, __LINE__);
             return -1;
         }
-
-        if (H5Dread(dataset_id, mem_type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer) < 0)
+        loader->file = file;
+        loader->dataset_name = strdup(name);
+        if (loader->dataset_name == NULL)
         {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
-            free(buffer);
-            H5Tclose(mem_type_id);
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                           __LINE__);
+            free(loader);
             return -1;
         }
 
-        H5Tclose(mem_type_id);
-
-        for (i = 0; i < variable->num_elements; i++)
+        if (harp_variable_new_with_loader(variable_name, data_type, num_dimensions, dimension_type, dimension,
+                                          load_variable_data, hdf5_variable_loader_delete, loader, &variable) != 0)
         {
-            char *str;
-
-            str = malloc((type_size + 1) * sizeof(char));
-            if (str == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (type_size + 1) * sizeof(char), __FILE__, __LINE__);
-                free(buffer);
-                return -1;
-            }
-
-            memcpy(str, &buffer[i * type_size], type_size);
-            str[type_size] = '\0';
-            variable->data.string_data[i] = str;
+            free(loader->dataset_name);
+            free(loader);
+            return -1;
         }
+        file->ref_count++;
+    }
+    else if (harp_variable_new(variable_name, data_type, num_dimensions, dimension_type, dimension, &variable) != 0)
+    {
+        return -1;
+    }
 
-        free(buffer);
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
     }
-    else
+
+    if (file == NULL)
     {
-        if (H5Dread(dataset_id, get_hdf5_type(variable->data_type), H5S_ALL, H5S_ALL, H5P_DEFAULT,
-                    variable->data.ptr) < 0)
+        if (read_variable_data(dataset_id, variable, selection) != 0)
         {
-            harp_set_error(HARP_ERROR_HDF5, NULL);
             return -1;
         }
     }
@@ -1143,6 +1775,8 @@ typedef struct hdf5_read_variable_func_args_struct
 {
     hdf5_dimension_ids *dimension_ids;
     harp_product *product;
+    hdf5_file *file;
+    const hdf5_time_selection *selection;
 } hdf5_read_variable_func_args;
 
 /* don't use -1 on error, otherwise the HDF5 library starts printing error messages to the console */
@@ -1203,7 +1837,7 @@ static herr_t hdf5_read_variable_func(hid_t group_id, const char *name, const H5
         }
     }
 
-    if (read_variable(dataset_id, name, args->dimension_ids, args->product) != 0)
+    if (read_variable(dataset_id, name, args->dimension_ids, args->product, args->file, args->selection) != 0)
     {
         H5Dclose(dataset_id);
         return 1;
@@ -1214,7 +1848,8 @@ static herr_t hdf5_read_variable_func(hid_t group_id, const char *name, const H5
     return 0;
 }
 
-static int read_variables(hid_t group_id, hdf5_dimension_ids *dimension_ids, harp_product *product)
+static int read_variables(hid_t group_id, hdf5_dimension_ids *dimension_ids, harp_product *product, hdf5_file *file,
+                          const hdf5_time_selection *selection)
 {
     hdf5_read_variable_func_args args;
     H5_index_t index_type;
@@ -1226,6 +1861,8 @@ static int read_variables(hid_t group_id, hdf5_dimension_ids *dimension_ids, har
 
     args.dimension_ids = dimension_ids;
     args.product = product;
+    args.file = file;
+    args.selection = selection;
 
     return (H5Literate(group_id, index_type, H5_ITER_INC, NULL, hdf5_read_variable_func, &args) != 0 ? -1 : 0);
 }
@@ -1265,7 +1902,7 @@ static int read_attributes(hid_t group_id, harp_product *product)
     return 0;
 }
 
-static int read_product(hid_t file_id, harp_product *product)
+static int read_product(hid_t file_id, harp_product *product, hdf5_file *file, const hdf5_time_selection *selection)
 {
     hdf5_dimension_ids dimension_ids = { {0}, {{0, 0}}, {0} };
     hid_t root_id;
@@ -1285,7 +1922,7 @@ static int read_product(hid_t file_id, harp_product *product)
     }
 
     /* Read variables. */
-    if (read_variables(root_id, &dimension_ids, product) != 0)
+    if (read_variables(root_id, &dimension_ids, product, file, selection) != 0)
     {
         H5Gclose(root_id);
         return -1;
@@ -1335,11 +1972,93 @@ static int verify_product(hid_t file_id)
     return -1;
 }
 
-int harp_import_hdf5(const char *filename, harp_product **product)
+int harp_import_hdf5(const char *filename, int lazy, harp_product **product)
+{
+    harp_product *new_product;
+    hdf5_file *file = NULL;
+    hid_t file_id;
+
+    file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file_id < 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        harp_set_error(HARP_ERROR_HDF5, NULL);
+        return -1;
+    }
+
+    if (verify_product(file_id) != 0)
+    {
+        H5Fclose(file_id);
+        return -1;
+    }
+
+    if (lazy)
+    {
+        /* the file is kept open for as long as there are variables that refer to it */
+        file = (hdf5_file *)malloc(sizeof(hdf5_file));
+        if (file == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(hdf5_file), __FILE__, __LINE__);
+            H5Fclose(file_id);
+            return -1;
+        }
+        file->file_id = file_id;
+        file->ref_count = 1;
+    }
+
+    if (harp_product_new(&new_product) != 0)
+    {
+        if (file != NULL)
+        {
+            hdf5_file_release(file);
+        }
+        else
+        {
+            H5Fclose(file_id);
+        }
+        return -1;
+    }
+
+    if (read_product(file_id, new_product, file, NULL) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        harp_product_delete(new_product);
+        if (file != NULL)
+        {
+            hdf5_file_release(file);
+        }
+        else
+        {
+            H5Fclose(file_id);
+        }
+        return -1;
+    }
+
+    *product = new_product;
+
+    if (file != NULL)
+    {
+        hdf5_file_release(file);
+    }
+    else
+    {
+        H5Fclose(file_id);
+    }
+
+    return 0;
+}
+
+/* import only the given (strictly increasing) time indices of all time dependent variables */
+int harp_import_hdf5_time_subset(const char *filename, long num_indices, const long *index, harp_product **product)
 {
+    hdf5_time_selection selection;
     harp_product *new_product;
     hid_t file_id;
 
+    selection.num_indices = num_indices;
+    selection.index = index;
+
     file_id = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
     if (file_id < 0)
     {
@@ -1360,7 +2079,7 @@ int harp_import_hdf5(const char *filename, harp_product **product)
         return -1;
     }
 
-    if (read_product(file_id, new_product) != 0)
+    if (read_product(file_id, new_product, NULL, &selection) != 0)
     {
         harp_add_error_message(" (%s)", filename);
         harp_product_delete(new_product);
@@ -1688,7 +2407,13 @@ static int write_numeric_attribute(hid_t obj_id, const char *name, harp_data_typ
     return 0;
 }
 
+#ifdef WITH_CHUNK_COMPRESSION
+/* if 'compressed' is not NULL, it contains the data of the variable as compressed chunks */
+static int write_variable(hid_t group_id, const char *name, harp_variable *variable,
+                          const hdf5_compressed_variable *compressed)
+#else
 static int write_variable(hid_t group_id, const char *name, harp_variable *variable)
+#endif
 {
     hsize_t dimension[HARP_MAX_NUM_DIMS];
     hid_t space_id;
@@ -1767,7 +2492,7 @@ static int write_variable(hid_t group_id, const char *name, harp_variable *varia
             return -1;
         }
 
-        if (set_compression(dcpl_id, variable) != 0)
+        if (set_compression(dcpl_id, variable, length) != 0)
         {
             H5Pclose(dcpl_id);
             H5Sclose(space_id);
@@ -1828,7 +2553,7 @@ static int write_variable(hid_t group_id, const char *name, harp_variable *varia
             return -1;
         }
 
-        if (set_compression(dcpl_id, variable) != 0)
+        if (set_compression(dcpl_id, variable, harp_get_size_for_type(variable->data_type)) != 0)
         {
             H5Pclose(dcpl_id);
             H5Sclose(space_id);
@@ -1847,6 +2572,17 @@ static int write_variable(hid_t group_id, const char *name, harp_variable *varia
         H5Pclose(dcpl_id);
         H5Sclose(space_id);
 
+#ifdef WITH_CHUNK_COMPRESSION
+        if (compressed != NULL)
+        {
+            if (write_compressed_chunks(dataset_id, variable, compressed) != 0)
+            {
+                H5Dclose(dataset_id);
+                return -1;
+            }
+        }
+        else
+#endif
         if (H5Dwrite(dataset_id, get_hdf5_type(variable->data_type), H5S_ALL, H5S_ALL, H5P_DEFAULT,
                      variable->data.ptr) < 0)
         {
@@ -2294,11 +3030,127 @@ static int write_attributes(hid_t group_id, const harp_product *product)
     return 0;
 }
 
+#ifdef WITH_CHUNK_COMPRESSION
+static int write_variables(hid_t group_id, const harp_product *product)
+{
+    hdf5_compressed_variable **compressed;
+    int first_index = 0;
+    int num_compressed = 0;
+    int i;
+
+    if (product->num_variables == 0)
+    {
+        return 0;
+    }
+
+    compressed = malloc(product->num_variables * sizeof(hdf5_compressed_variable *));
+    if (compressed == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->num_variables * sizeof(hdf5_compressed_variable *), __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* compress the variables in batches (of at least one variable) of at most MAX_COMPRESSION_BATCH_SIZE bytes */
+    while (first_index < product->num_variables)
+    {
+        long batch_size = 0;
+        int last_index = first_index;
+
+        while (last_index < product->num_variables)
+        {
+            const harp_variable *variable = product->variable[last_index];
+            long size = 0;
+
+            if (use_chunk_compression(variable))
+            {
+                size = variable->num_elements * harp_get_size_for_type(variable->data_type);
+            }
+            if (last_index > first_index && batch_size + size > MAX_COMPRESSION_BATCH_SIZE)
+            {
+                break;
+            }
+            batch_size += size;
+            last_index++;
+        }
+
+        num_compressed = last_index - first_index;
+        for (i = 0; i < num_compressed; i++)
+        {
+            compressed[i] = NULL;
+        }
+        if (compress_variables(product, first_index, last_index, compressed) != 0)
+        {
+            goto error;
+        }
+
+        for (i = first_index; i < last_index; i++)
+        {
+            char *name;
+
+            name = get_hdf5_variable_name(product, product->variable[i]);
+            if (name == NULL)
+            {
+                goto error;
+            }
+            if (write_variable(group_id, name, product->variable[i], compressed[i - first_index]) != 0)
+            {
+                free(name);
+                goto error;
+            }
+            free(name);
+
+            /* release the compressed data as soon as it has been written */
+            compressed_variable_delete(compressed[i - first_index]);
+            compressed[i - first_index] = NULL;
+        }
+
+        first_index = last_index;
+    }
+
+    free(compressed);
+
+    return 0;
+
+  error:
+    for (i = 0; i < num_compressed; i++)
+    {
+        compressed_variable_delete(compressed[i]);
+    }
+    free(compressed);
+
+    return -1;
+}
+#else
+static int write_variables(hid_t group_id, const harp_product *product)
+{
+    int i;
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        char *name;
+
+        name = get_hdf5_variable_name(product, product->variable[i]);
+        if (name == NULL)
+        {
+            return -1;
+        }
+        if (write_variable(group_id, name, product->variable[i]) != 0)
+        {
+            free(name);
+            return -1;
+        }
+        free(name);
+    }
+
+    return 0;
+}
+#endif
+
 static int write_product(hid_t file_id, const harp_product *product)
 {
     hid_t root_id;
     hdf5_dimensions dimensions;
-    int i;
 
     root_id = H5Gopen(file_id, "/");
     if (root_id < 0)
@@ -2338,23 +3190,11 @@ static int write_product(hid_t file_id, const harp_product *product)
         return -1;
     }
 
-    for (i = 0; i < product->num_variables; i++)
+    if (write_variables(root_id, product) != 0)
     {
-        char *name;
-
-        name = get_hdf5_variable_name(product, product->variable[i]);
-        if (name == NULL)
-        {
-            return -1;
-        }
-        if (write_variable(root_id, name, product->variable[i]) != 0)
-        {
-            free(name);
-            dimensions_done(&dimensions);
-            H5Gclose(root_id);
-            return -1;
-        }
-        free(name);
+        dimensions_done(&dimensions);
+        H5Gclose(root_id);
+        return -1;
     }
 
     if (finalize_dimensions(root_id, product, &dimensions) != 0)
@@ -2465,3 +3305,22 @@ void harp_hdf5_add_error_message(void)
 {
     H5Ewalk(H5E_WALK_UPWARD, add_error_message, NULL);
 }
+
+/* Returns 1 if the HDF5 library was built with thread-safety enabled (i.e. it can be used from multiple threads at the
+ * same time), 0 otherwise.
+ */
+int harp_hdf5_is_thread_safe(void)
+{
+#if H5_VERSION_GE(1, 8, 16)
+    hbool_t is_thread_safe;
+
+    if (H5is_library_threadsafe(&is_thread_safe) < 0)
+    {
+        return 0;
+    }
+
+    return is_thread_safe ? 1 : 0;
+#else
+    return 0;
+#endif
+}
@@ -374,6 +374,26 @@ static int read_datetime_stop(void *user_data, harp_array data)
     return read_datetime_from_attributes(info, "/@time_coverage_end", &data.double_data[0]);
 }
 
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    if (read_datetime_from_attributes(info, "/@time_coverage_start", datetime_start) != 0)
+    {
+        return -1;
+    }
+    if (read_datetime_from_attributes(info, "/@time_coverage_end", datetime_stop) != 0)
+    {
+        return -1;
+    }
+
+    /* convert from seconds since 2000-01-01 to days since 2000-01-01 */
+    *datetime_start /= 86400.0;
+    *datetime_stop /= 86400.0;
+
+    return 0;
+}
+
 static int read_dimensions(void *user_data, long dimension[HARP_NUM_DIM_TYPES])
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -554,6 +574,7 @@ static void register_fields_for_daily_l3u_cloud_data(void)
                                    "(corrected=false)", 1, corrected_options);
 
     product_definition = harp_ingestion_register_product(module, "ESACCI_CLOUD_L3_Daily", NULL, read_dimensions);
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
 
     /* latitude */
     description = "latitude of the ground pixel center";
@@ -878,6 +899,7 @@ static void register_fields_for_monthly_l3c_cloud_data(void)
                                    "(corrected=false)", 1, corrected_options);
 
     product_definition = harp_ingestion_register_product(module, "ESACCI_CLOUD_L3_Monthly", NULL, read_dimensions);
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
 
     /* latitude */
     description = "latitude of the ground pixel center";
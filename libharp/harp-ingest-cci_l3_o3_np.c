@@ -289,6 +289,26 @@ static int read_datetime_stop(void *user_data, harp_array data)
     return read_datetime(info, "/@time_coverage_end", &data.double_data[0]);
 }
 
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+
+    if (read_datetime(info, "/@time_coverage_start", datetime_start) != 0)
+    {
+        return -1;
+    }
+    if (read_datetime(info, "/@time_coverage_end", datetime_stop) != 0)
+    {
+        return -1;
+    }
+
+    /* convert from seconds since 2000-01-01 to days since 2000-01-01 */
+    *datetime_start /= 86400.0;
+    *datetime_stop /= 86400.0;
+
+    return 0;
+}
+
 static int read_longitude(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -426,6 +446,7 @@ int harp_ingestion_module_cci_l3_o3_np_init(void)
 
     /* ESACCI_OZONE_L3_NP product */
     product_definition = harp_ingestion_register_product(module, "ESACCI_OZONE_L3_NP", NULL, read_dimensions);
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
 
     /* datetime_start */
     description = "time coverage start";
@@ -37,9 +37,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define SECONDS_FROM_1993_TO_2000 (220838400 + 5)
 
+/* read grid data in ranges of whole latitude rows, with a total size of about RANGE_READ_SIZE bytes */
+#define RANGE_READ_SIZE (8 * 1024 * 1024)
+
 /* The parameter id values and their link to GRIB1 table2Version/indicatorOfParameter and
  * GRIB2 discipline/parameterCategory/parameterNumber values are taken from
  * http://apps.ecmwf.int/codes/grib/param-db
@@ -255,6 +261,10 @@ typedef struct ingest_info_struct
      * GRIB2 grid_data_parameter_ref = ((2 * 256 + discipline) * 256 + parameterCategory) * 256 + parameterNumber */
     long *grid_data_parameter_ref;      /* [num_grid_data] */
     coda_cursor *parameter_cursor;      /* [num_grid_data], array of cursors to /[]/data([])/values for each param */
+    /* additional handles to the same product for decoding grid data in parallel (only used with OpenMP) */
+    int num_thread_products;
+    coda_product **thread_product;      /* [num_thread_products] */
+    coda_cursor *thread_parameter_cursor;       /* [num_thread_products, num_grid_data] */
     double *level;      /* [num_grid_data] */
 
     double datetime;
@@ -283,6 +293,11 @@ typedef struct ingest_info_struct
     long num_levels;    /* max(1, num_grib_levels) */
     long num_grib_levels;       /* number of levels as reported in the GRIB file */
     double *coordinate_values;  /* [2 * (num_grib_levels + 1)], contains ap and bp coefficients */
+    /* pressure = a + b * surface_pressure coefficients for each HARP vertical level (level 0 = surface) */
+    double *pressure_a; /* [num_levels] */
+    double *pressure_b; /* [num_levels] */
+    double *pressure_bounds_a;  /* [num_levels, 2] */
+    double *pressure_bounds_b;  /* [num_levels, 2] */
 
     long num_wavelengths;       /* for AOD */
 
@@ -290,6 +305,15 @@ typedef struct ingest_info_struct
     long *grid_data_index;      /* [NUM_GRIB_PARAMETERS, num_levels] */
 } ingest_info;
 
+/* Gaussian latitudes only depend on the truncation number N, so we compute them only once for each N */
+typedef struct gaussian_latitudes_struct
+{
+    long trunc;
+    double *latitude;   /* [2 * trunc] */
+    struct gaussian_latitudes_struct *next;
+} gaussian_latitudes;
+
+static gaussian_latitudes *gaussian_latitudes_cache = NULL;
 
 /* The gaussian latitude calculation routines are taken from the grib_api software (Apache Licence Version 2.0) */
 
@@ -373,6 +397,80 @@ static int grib_get_gaussian_latitudes(long trunc, double *lats)
     return 0;
 }
 
+static int get_gaussian_latitudes(long trunc, double *lats)
+{
+    gaussian_latitudes *entry = NULL;
+    int result = 0;
+
+    /* ingestion_init() can be called from multiple threads at once (see harp_set_option_ingestion_num_threads()) */
+#ifdef _OPENMP
+#pragma omp critical (harp_ecmwf_grib_gaussian_latitudes)
+#endif
+    {
+        entry = gaussian_latitudes_cache;
+        while (entry != NULL && entry->trunc != trunc)
+        {
+            entry = entry->next;
+        }
+        if (entry == NULL)
+        {
+            entry = malloc(sizeof(gaussian_latitudes));
+            if (entry == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               sizeof(gaussian_latitudes), __FILE__, __LINE__);
+                result = -1;
+            }
+            else
+            {
+                entry->trunc = trunc;
+                entry->latitude = malloc(2 * trunc * sizeof(double));
+                if (entry->latitude == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   2 * trunc * sizeof(double), __FILE__, __LINE__);
+                    free(entry);
+                    entry = NULL;
+                    result = -1;
+                }
+                else if (grib_get_gaussian_latitudes(trunc, entry->latitude) != 0)
+                {
+                    harp_set_error(HARP_ERROR_INGESTION, "could not determine Gaussian latitudes for N=%ld", trunc);
+                    free(entry->latitude);
+                    free(entry);
+                    entry = NULL;
+                    result = -1;
+                }
+                else
+                {
+                    entry->next = gaussian_latitudes_cache;
+                    gaussian_latitudes_cache = entry;
+                }
+            }
+        }
+    }
+    if (result != 0)
+    {
+        return -1;
+    }
+
+    memcpy(lats, entry->latitude, 2 * trunc * sizeof(double));
+
+    return 0;
+}
+
+void harp_ingestion_module_ecmwf_grib_done(void)
+{
+    while (gaussian_latitudes_cache != NULL)
+    {
+        gaussian_latitudes *entry = gaussian_latitudes_cache;
+
+        gaussian_latitudes_cache = entry->next;
+        free(entry->latitude);
+        free(entry);
+    }
+}
+
 static grib_parameter get_grib1_parameter(int parameter_ref)
 {
     uint8_t table2Version = (parameter_ref >> 8) & 0xff;
@@ -882,40 +980,350 @@ static int read_grid_data(ingest_info *info, long grid_data_index, long latitude
                                                 data.float_data);
 }
 
+/* read the grid data for latitude rows [latitude_offset, latitude_offset + latitude_length) using the given set of
+ * parameter cursors; this function does not set the HARP error, so it can be called from multiple threads */
+static int read_grid_data_range(ingest_info *info, const coda_cursor *parameter_cursor, long grid_data_index,
+                                long latitude_offset, long latitude_length, float *data)
+{
+    long num_elements = latitude_length * info->num_longitudes;
+    long i, j;
+
+    if (grid_data_index < 0)
+    {
+        float missing_value = (float)harp_nan();
+
+        /* this specific grid data (e.g. height level or specific wavelength) is not available */
+        for (i = 0; i < num_elements; i++)
+        {
+            data[i] = missing_value;
+        }
+        return 0;
+    }
+
+    /* the rows are stored in descending latitude order, so the range is a contiguous block in reverse order */
+    if (coda_cursor_read_float_partial_array(&parameter_cursor[grid_data_index],
+                                             (info->num_latitudes - latitude_offset - latitude_length) *
+                                             info->num_longitudes, num_elements, data) != 0)
+    {
+        return -1;
+    }
+
+    /* flip latitude dimension, so it becomes ascending */
+    for (i = 0; i < latitude_length / 2; i++)
+    {
+        float *row_a = &data[i * info->num_longitudes];
+        float *row_b = &data[(latitude_length - 1 - i) * info->num_longitudes];
+
+        for (j = 0; j < info->num_longitudes; j++)
+        {
+            float value = row_a[j];
+
+            row_a[j] = row_b[j];
+            row_b[j] = value;
+        }
+    }
+
+    return 0;
+}
+
 static int read_2d_grid_data(ingest_info *info, grib_parameter parameter, long index, harp_array data)
 {
     assert(info->has_parameter[parameter]);
     return read_grid_data(info, info->grid_data_index[parameter * info->num_levels], index, data);
 }
 
-static int read_3d_grid_data(ingest_info *info, grib_parameter parameter, long index, harp_array data)
+#ifdef _OPENMP
+/* position 'new_cursor' in 'product' at the same location as 'cursor' is in its (identical) product */
+static int copy_cursor_to_product(const coda_cursor *cursor, coda_product *product, coda_cursor *new_cursor)
 {
-    long dimension_transpose[2];
+    coda_type_class type_class[CODA_CURSOR_MAXDEPTH];
+    long index[CODA_CURSOR_MAXDEPTH];
+    coda_cursor parent = *cursor;
+    int depth;
+    int k;
+
+    if (coda_cursor_get_depth(&parent, &depth) != 0)
+    {
+        return -1;
+    }
+    for (k = depth - 1; k >= 0; k--)
+    {
+        if (coda_cursor_get_index(&parent, &index[k]) != 0)
+        {
+            return -1;
+        }
+        if (coda_cursor_goto_parent(&parent) != 0)
+        {
+            return -1;
+        }
+        if (coda_cursor_get_type_class(&parent, &type_class[k]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    if (coda_cursor_set_product(new_cursor, product) != 0)
+    {
+        return -1;
+    }
+    for (k = 0; k < depth; k++)
+    {
+        if (type_class[k] == coda_array_class)
+        {
+            if (coda_cursor_goto_array_element_by_index(new_cursor, index[k]) != 0)
+            {
+                return -1;
+            }
+        }
+        else if (coda_cursor_goto_record_field_by_index(new_cursor, index[k]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* open the product 'num_threads - 1' more times and position cursors at the grid data in each of them, such that
+ * each thread can decode GRIB messages using its own product handle */
+static int init_thread_products(ingest_info *info, int num_threads)
+{
+    const char *filename;
+    long num_grid_data_index = NUM_GRIB_PARAMETERS * info->num_levels;
     long i;
+    int j;
 
-    assert(info->has_parameter[parameter]);
+    if (coda_get_product_filename(info->product, &filename) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
 
-    dimension_transpose[0] = info->num_levels;
-    dimension_transpose[1] = info->num_longitudes;
+    info->thread_product = malloc((num_threads - 1) * sizeof(coda_product *));
+    if (info->thread_product == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (num_threads - 1) * sizeof(coda_product *), __FILE__, __LINE__);
+        return -1;
+    }
+    for (j = 0; j < num_threads - 1; j++)
+    {
+        info->thread_product[j] = NULL;
+    }
+    info->num_thread_products = num_threads - 1;
 
-    /* we read the data as [vertical,longitude] */
-    for (i = 0; i < info->num_levels; i++)
+    info->thread_parameter_cursor = malloc((num_threads - 1) * info->num_grid_data * sizeof(coda_cursor));
+    if (info->thread_parameter_cursor == NULL)
     {
-        harp_array subgrid;
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (num_threads - 1) * info->num_grid_data * sizeof(coda_cursor), __FILE__, __LINE__);
+        return -1;
+    }
 
-        subgrid.float_data = &data.float_data[i * info->num_longitudes];
-        /* invert the loop because level 0 = TOA */
-        if (read_grid_data(info, info->grid_data_index[(parameter + 1) * info->num_levels - 1 - i], index, subgrid) !=
-            0)
+    for (j = 0; j < num_threads - 1; j++)
+    {
+        coda_cursor *thread_parameter_cursor = &info->thread_parameter_cursor[j * info->num_grid_data];
+
+        if (coda_open(filename, &info->thread_product[j]) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        /* only the cursors of supported parameters are ever used */
+        for (i = 0; i < num_grid_data_index; i++)
+        {
+            long grid_data_index = info->grid_data_index[i];
+
+            if (grid_data_index >= 0)
+            {
+                if (copy_cursor_to_product(&info->parameter_cursor[grid_data_index], info->thread_product[j],
+                                           &thread_parameter_cursor[grid_data_index]) != 0)
+                {
+                    harp_set_error(HARP_ERROR_CODA, NULL);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* decode the levels of a parameter in parallel, where each thread decodes whole GRIB messages using its own product
+ * handle and writes the values directly into the [latitude,longitude,vertical] result */
+static int read_3d_grid_data_parallel(ingest_info *info, grib_parameter parameter, long latitude_offset,
+                                      long latitude_length, int num_threads, harp_array data)
+{
+    long num_elements = latitude_length * info->num_longitudes;
+    long num_levels = info->num_levels;
+    harp_thread_error *thread_error;    /* [num_threads] */
+    long *failed_level; /* [num_threads] */
+    int failed_thread = -1;
+    int j;
+
+    if (info->num_thread_products == 0)
+    {
+        if (init_thread_products(info, num_threads) != 0)
         {
             return -1;
         }
     }
-    /* and then reorder dimensions from [vertical,longitude] to [longitude,vertical] */
-    if (harp_array_transpose(harp_type_float, 2, dimension_transpose, NULL, data) != 0)
+    else if (num_threads > info->num_thread_products + 1)
+    {
+        num_threads = info->num_thread_products + 1;
+    }
+
+    thread_error = malloc(num_threads * sizeof(harp_thread_error));
+    if (thread_error == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_threads * sizeof(harp_thread_error), __FILE__, __LINE__);
+        return -1;
+    }
+    failed_level = malloc(num_threads * sizeof(long));
+    if (failed_level == NULL)
     {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_threads * sizeof(long), __FILE__, __LINE__);
+        free(thread_error);
         return -1;
     }
+    for (j = 0; j < num_threads; j++)
+    {
+        failed_level[j] = -1;
+    }
+
+    /* each thread keeps the error of the first level it failed on, which is raised from this thread afterwards */
+#pragma omp parallel num_threads(num_threads)
+    {
+        const coda_cursor *parameter_cursor = info->parameter_cursor;
+        int thread_num = omp_get_thread_num();
+        float *buffer;
+        long i, k;
+
+        if (thread_num > 0)
+        {
+            parameter_cursor = &info->thread_parameter_cursor[(thread_num - 1) * info->num_grid_data];
+        }
+        buffer = malloc(num_elements * sizeof(float));
+
+#pragma omp for schedule(dynamic, 1)
+        for (i = 0; i < num_levels; i++)
+        {
+            long grid_data_index = info->grid_data_index[(parameter + 1) * num_levels - 1 - i];
+
+            if (failed_level[thread_num] >= 0)
+            {
+                continue;
+            }
+            harp_thread_error_begin();
+            if (buffer == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_elements * sizeof(float), __FILE__, __LINE__);
+                failed_level[thread_num] = i;
+            }
+            /* invert the loop because level 0 = TOA */
+            else if (read_grid_data_range(info, parameter_cursor, grid_data_index, latitude_offset, latitude_length,
+                                          buffer) != 0)
+            {
+                harp_set_error(HARP_ERROR_CODA, NULL);
+                failed_level[thread_num] = i;
+            }
+            harp_thread_error_end(&thread_error[thread_num]);
+            if (failed_level[thread_num] >= 0)
+            {
+                continue;
+            }
+            for (k = 0; k < num_elements; k++)
+            {
+                data.float_data[k * num_levels + i] = buffer[k];
+            }
+        }
+
+        if (buffer != NULL)
+        {
+            free(buffer);
+        }
+    }
+
+    for (j = 0; j < num_threads; j++)
+    {
+        if (failed_level[j] >= 0 && (failed_thread < 0 || failed_level[j] < failed_level[failed_thread]))
+        {
+            failed_thread = j;
+        }
+    }
+    if (failed_thread >= 0)
+    {
+        harp_thread_error_raise(&thread_error[failed_thread]);
+        free(failed_level);
+        free(thread_error);
+        return -1;
+    }
+
+    free(failed_level);
+    free(thread_error);
+
+    return 0;
+}
+#endif
+
+static int read_3d_grid_data(ingest_info *info, grib_parameter parameter, long latitude_offset, long latitude_length,
+                             harp_array data)
+{
+    long num_elements = latitude_length * info->num_longitudes;
+    long num_levels = info->num_levels;
+    float *buffer;
+    long i, k;
+
+    assert(info->has_parameter[parameter]);
+
+#ifdef _OPENMP
+    /* only decode in parallel if CODA can be used from multiple threads and if OpenMP will actually provide the threads
+     * (i.e. when we are not called from a thread that reads variables in parallel, unless nested parallelism is
+     * enabled) */
+    if (harp_option_ingestion_num_threads > 1 && num_levels > 1 &&
+        omp_get_active_level() < omp_get_max_active_levels() && harp_ingestion_is_thread_safe(info->product))
+    {
+        int num_threads = harp_option_ingestion_num_threads;
+
+        if (num_threads > num_levels)
+        {
+            num_threads = (int)num_levels;
+        }
+        return read_3d_grid_data_parallel(info, parameter, latitude_offset, latitude_length, num_threads, data);
+    }
+#endif
+
+    buffer = malloc(num_elements * sizeof(float));
+    if (buffer == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_elements * sizeof(float), __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* we read the data per level as [latitude,longitude] and store it in the [latitude,longitude,vertical] result */
+    for (i = 0; i < num_levels; i++)
+    {
+        long grid_data_index = info->grid_data_index[(parameter + 1) * num_levels - 1 - i];
+
+        /* invert the loop because level 0 = TOA */
+        if (read_grid_data_range(info, info->parameter_cursor, grid_data_index, latitude_offset, latitude_length,
+                                 buffer) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            free(buffer);
+            return -1;
+        }
+        for (k = 0; k < num_elements; k++)
+        {
+            data.float_data[k * num_levels + i] = buffer[k];
+        }
+    }
+
+    free(buffer);
 
     return 0;
 }
@@ -942,15 +1350,40 @@ static int read_datetime(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_latitude(void *user_data, long index, harp_array data)
+static long get_optimal_range_length(void *user_data)
 {
-    *data.double_data = ((ingest_info *)user_data)->latitude[index];
+    ingest_info *info = (ingest_info *)user_data;
+    long num_rows;
+
+    /* the largest grid variable is pressure_bounds with [longitude,vertical,2] elements per latitude row */
+    num_rows = RANGE_READ_SIZE / (info->num_longitudes * info->num_levels * 2 * sizeof(float));
+    if (num_rows < 1)
+    {
+        num_rows = 1;
+    }
+
+    return num_rows;
+}
+
+static long get_num_latitudes(void *user_data)
+{
+    return ((ingest_info *)user_data)->num_latitudes;
+}
+
+static long get_num_longitudes(void *user_data)
+{
+    return ((ingest_info *)user_data)->num_longitudes;
+}
+
+static int read_latitude(void *user_data, long index_offset, long index_length, harp_array data)
+{
+    memcpy(data.double_data, &((ingest_info *)user_data)->latitude[index_offset], index_length * sizeof(double));
     return 0;
 }
 
-static int read_longitude(void *user_data, long index, harp_array data)
+static int read_longitude(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    *data.double_data = ((ingest_info *)user_data)->longitude[index];
+    memcpy(data.double_data, &((ingest_info *)user_data)->longitude[index_offset], index_length * sizeof(double));
     return 0;
 }
 
@@ -998,14 +1431,14 @@ static int read_wavelengths(void *user_data, harp_array data)
     return 0;
 }
 
-static int read_crwc(void *user_data, long index, harp_array data)
+static int read_crwc(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_crwc, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_crwc, index_offset, index_length, data);
 }
 
-static int read_cswc(void *user_data, long index, harp_array data)
+static int read_cswc(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_cswc, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_cswc, index_offset, index_length, data);
 }
 
 static int read_tclw(void *user_data, long index, harp_array data)
@@ -1023,14 +1456,14 @@ static int read_z(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_z, index, data);
 }
 
-static int read_t(void *user_data, long index, harp_array data)
+static int read_t(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_t, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_t, index_offset, index_length, data);
 }
 
-static int read_q(void *user_data, long index, harp_array data)
+static int read_q(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_q, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_q, index_offset, index_length, data);
 }
 
 static int read_tcwv(void *user_data, long index, harp_array data)
@@ -1038,23 +1471,27 @@ static int read_tcwv(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_tcwv, index, data);
 }
 
-static int read_vo(void *user_data, long index, harp_array data)
+static int read_vo(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_vo, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_vo, index_offset, index_length, data);
 }
 
-static int read_lnsp(void *user_data, long index, harp_array data)
+static int read_lnsp(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
+    long num_elements = index_length * info->num_longitudes;
     long i;
 
-    if (read_2d_grid_data(info, grib_param_lnsp, index, data) != 0)
+    assert(info->has_parameter[grib_param_lnsp]);
+    if (read_grid_data_range(info, info->parameter_cursor, info->grid_data_index[grib_param_lnsp * info->num_levels],
+                             index_offset, index_length, data.float_data) != 0)
     {
+        harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
 
     /* turn lognormal surface pressure (Pa) into surface pressure values (Pa) */
-    for (i = 0; i < info->num_longitudes; i++)
+    for (i = 0; i < num_elements; i++)
     {
         data.float_data[i] = expf(data.float_data[i]);
     }
@@ -1062,55 +1499,56 @@ static int read_lnsp(void *user_data, long index, harp_array data)
     return 0;
 }
 
-static int read_pressure(void *user_data, long index, harp_array data)
+static int read_pressure(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
-    double *ap = info->coordinate_values;
-    double *bp = &info->coordinate_values[info->num_levels + 1];
+    const double *a = info->pressure_a;
+    const double *b = info->pressure_b;
+    long num_levels = info->num_levels;
     long i, k;
 
-    if (read_lnsp(user_data, index, data) != 0)
+    if (read_lnsp(user_data, index_offset, index_length, data) != 0)
     {
         return -1;
     }
 
-    for (k = info->num_longitudes - 1; k >= 0; k--)
+    /* expand in place from the back, since the surface pressure for grid point k is stored at data[k] */
+    for (k = index_length * info->num_longitudes - 1; k >= 0; k--)
     {
         double surface_pressure = data.float_data[k];
+        float *pressure = &data.float_data[k * num_levels];
 
-        for (i = 0; i < info->num_levels; i++)
+        for (i = num_levels - 1; i >= 0; i--)
         {
-            /* invert the loop because level 0 = TOA */
-            data.float_data[((k + 1) * info->num_levels - 1 - i)] =
-                (float)(0.5 * (ap[i] + ap[i + 1] + (bp[i] + bp[i + 1]) * surface_pressure));
+            pressure[i] = (float)(a[i] + b[i] * surface_pressure);
         }
     }
 
     return 0;
 }
 
-static int read_pressure_bounds(void *user_data, long index, harp_array data)
+static int read_pressure_bounds(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
-    double *ap = info->coordinate_values;
-    double *bp = &info->coordinate_values[info->num_levels + 1];
+    const double *a = info->pressure_bounds_a;
+    const double *b = info->pressure_bounds_b;
+    long num_bounds = 2 * info->num_levels;
     long i, k;
 
-    if (read_lnsp(user_data, index, data) != 0)
+    if (read_lnsp(user_data, index_offset, index_length, data) != 0)
     {
         return -1;
     }
 
-    for (k = info->num_longitudes - 1; k >= 0; k--)
+    /* expand in place from the back, since the surface pressure for grid point k is stored at data[k] */
+    for (k = index_length * info->num_longitudes - 1; k >= 0; k--)
     {
         double surface_pressure = data.float_data[k];
+        float *pressure_bounds = &data.float_data[k * num_bounds];
 
-        for (i = 0; i < info->num_levels; i++)
+        for (i = num_bounds - 1; i >= 0; i--)
         {
-            /* invert the loop because level 0 = TOA */
-            data.float_data[2 * ((k + 1) * info->num_levels - 1 - i)] =
-                (float)(ap[i + 1] + bp[i + 1] * surface_pressure);
-            data.float_data[2 * ((k + 1) * info->num_levels - 1 - i) + 1] = (float)(ap[i] + bp[i] * surface_pressure);
+            pressure_bounds[i] = (float)(a[i] + b[i] * surface_pressure);
         }
     }
 
@@ -1147,24 +1585,24 @@ static int read_lsm(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_lsm, index, data);
 }
 
-static int read_clwc(void *user_data, long index, harp_array data)
+static int read_clwc(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_clwc, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_clwc, index_offset, index_length, data);
 }
 
-static int read_ciwc(void *user_data, long index, harp_array data)
+static int read_ciwc(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_ciwc, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_ciwc, index_offset, index_length, data);
 }
 
-static int read_co2(void *user_data, long index, harp_array data)
+static int read_co2(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_co2, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_co2, index_offset, index_length, data);
 }
 
-static int read_ch4(void *user_data, long index, harp_array data)
+static int read_ch4(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_ch4, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_ch4, index_offset, index_length, data);
 }
 
 static int read_pm1(void *user_data, long index, harp_array data)
@@ -1182,24 +1620,24 @@ static int read_pm10(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_pm10, index, data);
 }
 
-static int read_no2(void *user_data, long index, harp_array data)
+static int read_no2(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_no2, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_no2, index_offset, index_length, data);
 }
 
-static int read_so2(void *user_data, long index, harp_array data)
+static int read_so2(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_so2, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_so2, index_offset, index_length, data);
 }
 
-static int read_co(void *user_data, long index, harp_array data)
+static int read_co(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_co, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_co, index_offset, index_length, data);
 }
 
-static int read_hcho(void *user_data, long index, harp_array data)
+static int read_hcho(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_hcho, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_hcho, index_offset, index_length, data);
 }
 
 static int read_tcno2(void *user_data, long index, harp_array data)
@@ -1222,9 +1660,9 @@ static int read_tchcho(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_tchcho, index, data);
 }
 
-static int read_go3(void *user_data, long index, harp_array data)
+static int read_go3(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_go3, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_go3, index_offset, index_length, data);
 }
 
 static int read_gtco3(void *user_data, long index, harp_array data)
@@ -1337,49 +1775,49 @@ static int read_fmaod(void *user_data, long index, harp_array data)
     return read_2d_grid_data((ingest_info *)user_data, grib_param_aodfm550, index, data);
 }
 
-static int read_aerext(void *user_data, long index, harp_array data)
+static int read_aerext(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_aerext1064, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_aerext1064, index_offset, index_length, data);
 }
 
-static int read_aerbackscat(void *user_data, long index, harp_array data)
+static int read_aerbackscat(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_aerbackscatgnd1064, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_aerbackscatgnd1064, index_offset, index_length, data);
 }
 
-static int read_hno3(void *user_data, long index, harp_array data)
+static int read_hno3(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_hno3, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_hno3, index_offset, index_length, data);
 }
 
-static int read_pan(void *user_data, long index, harp_array data)
+static int read_pan(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_pan, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_pan, index_offset, index_length, data);
 }
 
-static int read_c5h8(void *user_data, long index, harp_array data)
+static int read_c5h8(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_c5h8, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_c5h8, index_offset, index_length, data);
 }
 
-static int read_no(void *user_data, long index, harp_array data)
+static int read_no(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_no, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_no, index_offset, index_length, data);
 }
 
-static int read_oh(void *user_data, long index, harp_array data)
+static int read_oh(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_oh, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_oh, index_offset, index_length, data);
 }
 
-static int read_c2h6(void *user_data, long index, harp_array data)
+static int read_c2h6(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_c2h6, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_c2h6, index_offset, index_length, data);
 }
 
-static int read_c3h8(void *user_data, long index, harp_array data)
+static int read_c3h8(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return read_3d_grid_data((ingest_info *)user_data, grib_param_c3h8, index, data);
+    return read_3d_grid_data((ingest_info *)user_data, grib_param_c3h8, index_offset, index_length, data);
 }
 
 static int read_tc_ch4(void *user_data, long index, harp_array data)
@@ -2015,7 +2453,7 @@ static int get_lat_lon_grid(coda_cursor *cursor, int grib_version, ingest_info *
                 harp_set_error(HARP_ERROR_INGESTION, "invalid value for N for Gaussian grid");
                 return -1;
             }
-            if (grib_get_gaussian_latitudes(N, info->latitude) != 0)
+            if (get_gaussian_latitudes(N, info->latitude) != 0)
             {
                 return -1;
             }
@@ -2112,6 +2550,42 @@ static int get_lat_lon_grid(coda_cursor *cursor, int grib_version, ingest_info *
     return 0;
 }
 
+/* precompute the coefficients of the pressure (bounds) per HARP vertical level, such that pressure = a + b * ps */
+static int init_pressure_coefficients(ingest_info *info)
+{
+    double *ap = info->coordinate_values;
+    double *bp = &info->coordinate_values[info->num_levels + 1];
+    long num_levels = info->num_levels;
+    long i;
+
+    info->pressure_a = malloc(num_levels * sizeof(double));
+    info->pressure_b = malloc(num_levels * sizeof(double));
+    info->pressure_bounds_a = malloc(2 * num_levels * sizeof(double));
+    info->pressure_bounds_b = malloc(2 * num_levels * sizeof(double));
+    if (info->pressure_a == NULL || info->pressure_b == NULL || info->pressure_bounds_a == NULL ||
+        info->pressure_bounds_b == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       6 * num_levels * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < num_levels; i++)
+    {
+        /* invert the level order because GRIB level 0 = TOA */
+        long k = num_levels - 1 - i;
+
+        info->pressure_a[k] = 0.5 * (ap[i] + ap[i + 1]);
+        info->pressure_b[k] = 0.5 * (bp[i] + bp[i + 1]);
+        info->pressure_bounds_a[2 * k] = ap[i + 1];
+        info->pressure_bounds_b[2 * k] = bp[i + 1];
+        info->pressure_bounds_a[2 * k + 1] = ap[i];
+        info->pressure_bounds_b[2 * k + 1] = bp[i];
+    }
+
+    return 0;
+}
+
 static int init_cursors_and_grid(ingest_info *info)
 {
     coda_cursor cursor;
@@ -2578,6 +3052,13 @@ static int init_cursors_and_grid(ingest_info *info)
 
     /* initialize grid_data_index */
     info->num_levels = info->num_grib_levels > 0 ? info->num_grib_levels : 1;
+    if (info->coordinate_values != NULL)
+    {
+        if (init_pressure_coefficients(info) != 0)
+        {
+            return -1;
+        }
+    }
     info->grid_data_index = malloc(NUM_GRIB_PARAMETERS * info->num_levels * sizeof(long *));
     if (info->grid_data_index == NULL)
     {
@@ -2704,6 +3185,23 @@ static void ingest_info_delete(ingest_info *info)
         {
             free(info->parameter_cursor);
         }
+        if (info->thread_product != NULL)
+        {
+            int i;
+
+            for (i = 0; i < info->num_thread_products; i++)
+            {
+                if (info->thread_product[i] != NULL)
+                {
+                    coda_close(info->thread_product[i]);
+                }
+            }
+            free(info->thread_product);
+        }
+        if (info->thread_parameter_cursor != NULL)
+        {
+            free(info->thread_parameter_cursor);
+        }
         if (info->level != NULL)
         {
             free(info->level);
@@ -2720,6 +3218,22 @@ static void ingest_info_delete(ingest_info *info)
         {
             free(info->coordinate_values);
         }
+        if (info->pressure_a != NULL)
+        {
+            free(info->pressure_a);
+        }
+        if (info->pressure_b != NULL)
+        {
+            free(info->pressure_b);
+        }
+        if (info->pressure_bounds_a != NULL)
+        {
+            free(info->pressure_bounds_a);
+        }
+        if (info->pressure_bounds_b != NULL)
+        {
+            free(info->pressure_bounds_b);
+        }
         if (info->grid_data_index != NULL)
         {
             free(info->grid_data_index);
@@ -2746,6 +3260,9 @@ static int ingest_info_new(coda_product *product, ingest_info **new_info)
     info->num_grid_data = 0;
     info->grid_data_parameter_ref = NULL;
     info->parameter_cursor = NULL;
+    info->num_thread_products = 0;
+    info->thread_product = NULL;
+    info->thread_parameter_cursor = NULL;
     info->level = NULL;
     info->datetime = 0;
     info->reference_datetime = 0;
@@ -2768,6 +3285,10 @@ static int ingest_info_new(coda_product *product, ingest_info **new_info)
     info->num_levels = 1;
     info->num_grib_levels = 0;
     info->coordinate_values = NULL;
+    info->pressure_a = NULL;
+    info->pressure_b = NULL;
+    info->pressure_bounds_a = NULL;
+    info->pressure_bounds_b = NULL;
     info->num_wavelengths = 0;
     info->grid_data_index = NULL;
 
@@ -3168,9 +3689,10 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* longitude */
     description = "longitude of the grid cell mid-point (WGS84)";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "longitude", harp_type_double,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "longitude", harp_type_double,
                                                                       1, &dimension_type[2], NULL, description,
-                                                                      "degree_east", NULL, read_longitude);
+                                                                      "degree_east", NULL, get_num_longitudes,
+                                                                      read_longitude);
     harp_variable_definition_set_valid_range_double(variable_definition, 0.0, 360.0);
     description = "based on linear interpolation using Ni points from first to last grid point";
     path = "/[]/grib1/grid/Ni, /[]/grib1/grid/longitudeOfFirstGridPoint, /[]/grib1/grid/longitudeOfLastGridPoint";
@@ -3180,9 +3702,10 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* latitude */
     description = "latitude of the grid cell mid-point (WGS84)";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "latitude", harp_type_double,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "latitude", harp_type_double,
                                                                       1, &dimension_type[1], NULL, description,
-                                                                      "degree_north", NULL, read_latitude);
+                                                                      "degree_north", NULL, get_num_latitudes,
+                                                                      read_latitude);
     harp_variable_definition_set_valid_range_double(variable_definition, -90.0, 90.0);
     description = "based on linear interpolation using Nj points from first to last grid point";
     path = "/[]/grib1/grid/Nj, /[]/grib1/grid/latitudeOfFirstGridPoint, /[]/grib1/grid/latitudeOfLastGridPoint";
@@ -3202,17 +3725,19 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* crwc: RWC_mass_mixing_ratio */
     description = "specific rain water content";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "RWC_mass_mixing_ratio",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "RWC_mass_mixing_ratio",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", include_crwc, read_crwc);
+                                                                      description, "kg/kg", include_crwc,
+                                                                      get_optimal_range_length, read_crwc);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,75)",
                                "(discipline,category,number) = (0,1,85)");
 
     /* cswc: SWC_mass_mixing_ratio */
     description = "specific snow water content";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "SWC_mass_mixing_ratio",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "SWC_mass_mixing_ratio",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", include_cswc, read_cswc);
+                                                                      description, "kg/kg", include_cswc,
+                                                                      get_optimal_range_length, read_cswc);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,76)",
                                "(discipline,category,number) = (0,1,86)");
 
@@ -3242,17 +3767,19 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* t: temperature */
     description = "temperature";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "temperature",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "temperature",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "K", include_t, read_t);
+                                                                      description, "K", include_t,
+                                                                      get_optimal_range_length, read_t);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,130), (160,130), (170,130), (180,130), "
                                "or (190,130)", "(discipline,category,number) = (0,0,0)");
 
     /* q: H2O_mass_mixing_ratio */
     description = "specific humidity";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "H2O_mass_mixing_ratio",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "H2O_mass_mixing_ratio",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", include_q, read_q);
+                                                                      description, "kg/kg", include_q,
+                                                                      get_optimal_range_length, read_q);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,133), (160,133), (170,133), (180,133), "
                                "or (190,133)", "(discipline,category,number) = (0,1,0)");
 
@@ -3266,28 +3793,30 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* vo: relative_vorticity */
     description = "relative vorticity";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "relative_vorticity",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "relative_vorticity",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "1/s", include_vo, read_vo);
+                                                                      description, "1/s", include_vo,
+                                                                      get_optimal_range_length, read_vo);
     add_value_variable_mapping(variable_definition,
                                "(table,indicator) = (160,138), (128,138), (170,138), (180, 138) or (190,138)",
                                "(discipline,category,number) = (0,2,12)");
 
     /* lnsp: surface_pressure */
     description = "pressure at the surface";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "surface_pressure",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "surface_pressure",
                                                                       harp_type_float, 2, &dimension_type[1], NULL,
-                                                                      description, "Pa", include_lnsp, read_lnsp);
+                                                                      description, "Pa", include_lnsp,
+                                                                      get_optimal_range_length, read_lnsp);
     add_value_variable_mapping(variable_definition,
                                "(table,indicator) = (128,152) or (190,152); returned value = exp(lnsp)",
                                "(discipline,category,number) = (0,3,25); returned value = exp(lnsp)");
 
     /* pressure */
     description = "pressure";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "pressure",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "pressure",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
                                                                       description, "Pa", include_pressure,
-                                                                      read_pressure);
+                                                                      get_optimal_range_length, read_pressure);
     description = "the coordinateValues contain [a(1), ..., a(N+1), b(1), ..., b(N+1)] coefficients for the N+1 "
         "vertical layer boundaries; p(N-i) = (a(i) + a(i+1) + (b(i) + b(i+1))exp(lnsp))/2";
     harp_variable_definition_add_mapping(variable_definition, NULL, "surface_pressure is available and at least one "
@@ -3296,10 +3825,11 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* pressure_bounds */
     description = "pressure_bounds";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "pressure_bounds",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "pressure_bounds",
                                                                       harp_type_float, 4, &dimension_type[1],
                                                                       &bounds_dimension[1], description, "Pa",
-                                                                      include_pressure, read_pressure_bounds);
+                                                                      include_pressure, get_optimal_range_length,
+                                                                      read_pressure_bounds);
     description = "the coordinateValues contain [a(1), ..., a(N+1), b(1), ..., b(N+1)] coefficients for the N+1 "
         "vertical layer boundaries; p(N-i,1) = a(i) + b(i)exp(lnsp); p(N-i,2) = a(i+1) + b(i+1)exp(lnsp)";
     harp_variable_definition_add_mapping(variable_definition, NULL, "surface_pressure is available and at least one "
@@ -3359,35 +3889,37 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* clwc: LWC_mass_mixing_ratio */
     description = "specific cloud liquid water content";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "LWC_mass_mixing_ratio",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "LWC_mass_mixing_ratio",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", include_clwc, read_clwc);
+                                                                      description, "kg/kg", include_clwc,
+                                                                      get_optimal_range_length, read_clwc);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,246)",
                                "(discipline,category,number) = (0,1,83)");
 
     /* ciwc: IWC_mass_mixing_ratio */
     description = "specific cloud ice water content";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition, "IWC_mass_mixing_ratio",
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition, "IWC_mass_mixing_ratio",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", include_ciwc, read_ciwc);
+                                                                      description, "kg/kg", include_ciwc,
+                                                                      get_optimal_range_length, read_ciwc);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (128,247)",
                                "(discipline,category,number) = (0,1,84)");
 
     /* co2: CO2_mass_mixing_ratio_dry_air */
     description = "carbon dioxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "CO2_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_co2, read_co2);
+                                                                      include_co2, get_optimal_range_length, read_co2);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,61)",
                                "(discipline,category,number) = (192,210,61)");
 
     /* ch4: CH4_mass_mixing_ratio_dry_air */
     description = "methane mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "CH4_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_ch4, read_ch4);
+                                                                      include_ch4, get_optimal_range_length, read_ch4);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,62) or (217,4)",
                                "(discipline,category,number) = (192,210,62) or (192,217,4)");
 
@@ -3417,37 +3949,38 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* no2: NO2_mass_mixing_ratio_dry_air */
     description = "nitrogen dioxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "NO2_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_no2, read_no2);
+                                                                      include_no2, get_optimal_range_length, read_no2);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,121)",
                                "(discipline,category,number) = (192,210,121)");
 
     /* so2: SO2_mass_mixing_ratio_dry_air */
     description = "sulphur dioxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "SO2_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_so2, read_so2);
+                                                                      include_so2, get_optimal_range_length, read_so2);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,122)",
                                "(discipline,category,number) = (192,210,122)");
 
     /* co: CO_mass_mixing_ratio_dry_air */
     description = "carbon monoxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "CO_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_co, read_co);
+                                                                      include_co, get_optimal_range_length, read_co);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,123)",
                                "(discipline,category,number) = (192,210,123)");
 
     /* hcho: HCHO_mass_mixing_ratio_dry_air */
     description = "formaldehyde mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "HCHO_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_hcho, read_hcho);
+                                                                      include_hcho,
+                                                                      get_optimal_range_length, read_hcho);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,124)",
                                "(discipline,category,number) = (192,210,124)");
 
@@ -3486,10 +4019,10 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* go3: O3_mass_mixing_ratio_dry_air */
     description = "ozone mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "O3_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_go3, read_go3);
+                                                                      include_go3, get_optimal_range_length, read_go3);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (210,203)",
                                "(discipline,category,number) = (192,210,203)");
 
@@ -3575,83 +4108,89 @@ int harp_ingestion_module_ecmwf_grib_init(void)
 
     /* aerext1064: aerosol_extinction_coefficient */
     description = "aerosol extinction coefficient (at 1064nm)";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "aerosol_extinction_coefficient",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "1/m", include_aerext, read_aerext);
+                                                                      description, "1/m", include_aerext,
+                                                                      get_optimal_range_length, read_aerext);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (215,182)",
                                "(discipline,category,number) = (192,215,182)");
 
     /* aerbackscatgnd1064: aerosol_backscatter_coefficient */
     description = "aerosol backscatter coefficient (at 1064nm from ground)";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "aerosol_backscatter_coefficient",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
                                                                       description, "1/msr", include_aerbackscat,
-                                                                      read_aerbackscat);
+                                                                      get_optimal_range_length, read_aerbackscat);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (215,188)",
                                "(discipline,category,number) = (192,215,188)");
 
     /* hno3: HNO3_mass_mixing_ratio_dry_air */
     description = "nitric acid mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "HNO3_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_hno3, read_hno3);
+                                                                      include_hno3,
+                                                                      get_optimal_range_length, read_hno3);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,6)",
                                "(discipline,category,number) = (192,217,6)");
 
     /* pan: C2H3NO5_mass_mixing_ratio_dry_air */
     description = "peroxyacetyl nitrate (PAN) mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "C2H3NO5_mass_mixing_ratio_dry_air",
                                                                       harp_type_float, 3, &dimension_type[1], NULL,
-                                                                      description, "kg/kg", include_pan, read_pan);
+                                                                      description, "kg/kg", include_pan,
+                                                                      get_optimal_range_length, read_pan);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,13)",
                                "(discipline,category,number) = (192,217,13)");
 
     /* c5h8: C5H8_mass_mixing_ratio_dry_air */
     description = "isoprene mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "C5H8_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_c5h8, read_c5h8);
+                                                                      include_c5h8,
+                                                                      get_optimal_range_length, read_c5h8);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,16)",
                                "(discipline,category,number) = (192,217,16)");
 
     /* no: NO_mass_mixing_ratio_dry_air */
     description = "nitrogen monoxide mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "NO_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_no, read_no);
+                                                                      include_no, get_optimal_range_length, read_no);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,27)",
                                "(discipline,category,number) = (192,217,27)");
 
     /* oh: OH_mass_mixing_ratio_dry_air */
     description = "hydroxyl radical mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "OH_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_oh, read_oh);
+                                                                      include_oh, get_optimal_range_length, read_oh);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,30)",
                                "(discipline,category,number) = (192,217,30)");
 
     /* c2h6: C2H6_mass_mixing_ratio_dry_air */
     description = "ethane mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "C2H6_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_c2h6, read_c2h6);
+                                                                      include_c2h6,
+                                                                      get_optimal_range_length, read_c2h6);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,45)",
                                "(discipline,category,number) = (192,217,45)");
 
     /* c3h8: C3H8_mass_mixing_ratio_dry_air */
     description = "propane mass mixing ratio";
-    variable_definition = harp_ingestion_register_variable_block_read(product_definition,
+    variable_definition = harp_ingestion_register_variable_range_read(product_definition,
                                                                       "C3H8_mass_mixing_ratio_dry_air", harp_type_float,
                                                                       3, &dimension_type[1], NULL, description, "kg/kg",
-                                                                      include_c3h8, read_c3h8);
+                                                                      include_c3h8,
+                                                                      get_optimal_range_length, read_c3h8);
     add_value_variable_mapping(variable_definition, "(table,indicator) = (217,47)",
                                "(discipline,category,number) = (192,217,47)");
 
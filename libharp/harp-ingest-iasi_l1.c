@@ -50,6 +50,9 @@ typedef enum main_data_variable_enum
 #define SPECTRA_PER_SCAN        4
 #define SPECTRA_PER_SCANLINE   (SPECTRA_PER_SCAN * SCANS_PER_SCANLINE)
 
+/* Target size in bytes of a single range read of spectral data (which is read in blocks of whole scanlines). */
+#define RANGE_READ_SIZE (8 * 1024 * 1024)
+
 typedef struct ingest_info_struct
 {
     coda_product *product;
@@ -63,6 +66,10 @@ typedef struct ingest_info_struct
     int16_t *scale_factors;
     int16_t *channel_first;
     int16_t *channel_last;
+    long num_scaled_samples;    /* Number of samples of a spectrum that are covered by the scale factors */
+    int16_t *scaled_sample_channel;     /* Channel number for each scaled sample */
+    double *scaled_sample_factor;       /* Scale factor (10^-SF) for each scaled sample */
+    int16_t *spectrum_buffer;   /* Raw spectra of one scanline (allocated from the ingestion memory pool) */
 } ingest_info;
 
 static int get_main_data(ingest_info *info, const char *fieldname, main_data_variable var_type,
@@ -123,127 +130,195 @@ static int get_main_data(ingest_info *info, const char *fieldname, main_data_var
     return 0;
 }
 
-static int get_spectra_sample_data(ingest_info *info, long row, float *float_data_array)
+static long get_optimal_range_length(void *user_data)
 {
-    int32_t first_channel;
-    int16_t measured_spectrum_data[8700];
-    int16_t *spectrum_data;
-    coda_cursor cursor;
-    float *float_data;
-    int16_t scale_nr, channel_nr;
-    int16_t *start_of_this_spectrum;
+    ingest_info *info = (ingest_info *)user_data;
+    long num_scanlines;
 
-    float_data = float_data_array;
-    cursor = info->mdr_cursors[row / SPECTRA_PER_SCANLINE];
-    if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNsfirst1b") != 0)
+    /* read whole scanlines, with a total size of about RANGE_READ_SIZE bytes */
+    num_scanlines = RANGE_READ_SIZE / (SPECTRA_PER_SCANLINE * info->num_pixels * sizeof(float));
+    if (num_scanlines < 1)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
+        num_scanlines = 1;
     }
-    if (coda_cursor_read_int32(&cursor, &first_channel) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    coda_cursor_goto_parent(&cursor);
 
-    /* GS1cSpect contains int16 and has the following dimensions: */
-    /* dim[0] = SCANS_PER_SCANLINE (fixed at 30)                  */
-    /* dim[1] = SPECTRA_PER_SCAN (fixed at 4)                     */
-    /* dim[2] = pixels in one spectrum (fixed at 8700)            */
-    if (coda_cursor_goto_record_field_by_name(&cursor, "GS1cSpect") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
+    return num_scanlines * SPECTRA_PER_SCANLINE;
+}
+
+static int get_spectra_range_data(ingest_info *info, long index_offset, long index_length, float *float_data)
+{
+    int16_t *measured_spectrum_data;
+    long index = index_offset;
+    long i, k;
 
-    if (coda_cursor_read_int16_partial_array(&cursor, (row % SPECTRA_PER_SCANLINE) * info->num_pixels,
-                                             info->num_pixels, measured_spectrum_data) != 0)
+    if (info->spectrum_buffer == NULL)
     {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
+        /* the buffer is kept for all range reads and is released together with the pool at the end of the ingestion */
+        info->spectrum_buffer = harp_memory_pool_malloc(harp_ingestion_get_memory_pool(),
+                                                        SPECTRA_PER_SCANLINE * info->num_pixels * sizeof(int16_t));
+        if (info->spectrum_buffer == NULL)
+        {
+            return -1;
+        }
     }
-    spectrum_data = measured_spectrum_data;
+    measured_spectrum_data = info->spectrum_buffer;
 
-    start_of_this_spectrum = spectrum_data;
-    for (scale_nr = 0; scale_nr < info->nr_scale_factors; scale_nr++)
+    /* read the spectra per scanline, with a single partial read for all requested spectra in the scanline */
+    while (index < index_offset + index_length)
     {
-        spectrum_data = start_of_this_spectrum + info->channel_first[scale_nr] - first_channel;
-        for (channel_nr = info->channel_first[scale_nr]; channel_nr <= info->channel_last[scale_nr]; channel_nr++)
+        int32_t first_channel;
+        coda_cursor cursor;
+        long num_spectra;
+
+        num_spectra = SPECTRA_PER_SCANLINE - index % SPECTRA_PER_SCANLINE;
+        if (index + num_spectra > index_offset + index_length)
+        {
+            num_spectra = index_offset + index_length - index;
+        }
+
+        cursor = info->mdr_cursors[index / SPECTRA_PER_SCANLINE];
+        if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNsfirst1b") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_int32(&cursor, &first_channel) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        coda_cursor_goto_parent(&cursor);
+        for (k = 0; k < info->num_scaled_samples; k++)
+        {
+            if (info->scaled_sample_channel[k] < first_channel ||
+                info->scaled_sample_channel[k] - first_channel >= info->num_pixels)
+            {
+                harp_set_error(HARP_ERROR_INGESTION, "product error detected (scale factor channel range does not "
+                               "match IDefNsfirst1b)");
+                return -1;
+            }
+        }
+
+        /* GS1cSpect contains int16 and has the following dimensions: */
+        /* dim[0] = SCANS_PER_SCANLINE (fixed at 30)                  */
+        /* dim[1] = SPECTRA_PER_SCAN (fixed at 4)                     */
+        /* dim[2] = pixels in one spectrum (fixed at 8700)            */
+        if (coda_cursor_goto_record_field_by_name(&cursor, "GS1cSpect") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_int16_partial_array(&cursor, (index % SPECTRA_PER_SCANLINE) * info->num_pixels,
+                                                 num_spectra * info->num_pixels, measured_spectrum_data) != 0)
         {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+
+        for (i = 0; i < num_spectra; i++)
+        {
+            const int16_t *spectrum_data = &measured_spectrum_data[i * info->num_pixels];
+
             /* Because this data has limited precision (it was stored in */
             /* an int16), we store the radiance in a float.              */
-            *float_data = (float)((*spectrum_data) * pow(10.0, -(info->scale_factors[scale_nr])));
-            float_data++;
-            spectrum_data++;
+            for (k = 0; k < info->num_scaled_samples; k++)
+            {
+                float_data[k] = (float)(spectrum_data[info->scaled_sample_channel[k] - first_channel] *
+                                        info->scaled_sample_factor[k]);
+            }
+            for (; k < info->num_pixels; k++)
+            {
+                float_data[k] = 0;
+            }
+            float_data += info->num_pixels;
         }
+
+        index += num_spectra;
     }
-    spectrum_data = start_of_this_spectrum + info->num_pixels;
 
     return 0;
 }
 
-static int get_wavenumber_sample_data(ingest_info *info, long row, float *float_data_array)
+static int get_wavenumber_range_data(ingest_info *info, long index_offset, long index_length, float *float_data)
 {
-    double sample_width;
-    int32_t first_sample, last_sample, sample;
-    coda_cursor cursor;
-    float *float_data;
-    long i;
+    long index = index_offset;
 
-    float_data = float_data_array;
-    cursor = info->mdr_cursors[row / SPECTRA_PER_SCANLINE];
-    if (coda_cursor_goto_record_field_by_name(&cursor, "IDefSpectDWn1b") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_double(&cursor, &sample_width) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    coda_cursor_goto_parent(&cursor);
-    if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNsfirst1b") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_int32(&cursor, &first_sample) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    coda_cursor_goto_parent(&cursor);
-    if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNslast1b") != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (coda_cursor_read_int32(&cursor, &last_sample) != 0)
-    {
-        harp_set_error(HARP_ERROR_CODA, NULL);
-        return -1;
-    }
-    if (last_sample < first_sample)
-    {
-        harp_set_error(HARP_SUCCESS, "product error detected (IDefNslast1b < IDefNsfirst1b)");
-        return -1;
-    }
-    if ((last_sample - first_sample + 1) > info->num_pixels)
+    while (index < index_offset + index_length)
     {
-        harp_set_error(HARP_SUCCESS, "product error detected (IDefNslast1b - IDefNsfirst1b + 1 > 8700)");
-        return -1;
-    }
-    for (sample = first_sample, i = 0; sample <= last_sample; sample++, i++)
-    {
-        *float_data = (float)(sample_width * sample);
-        float_data++;
-    }
-    for (; i < info->num_pixels; i++)
-    {
-        float_data++;
+        double sample_width;
+        int32_t first_sample, last_sample, sample;
+        coda_cursor cursor;
+        long num_spectra;
+        long i, j;
+
+        num_spectra = SPECTRA_PER_SCANLINE - index % SPECTRA_PER_SCANLINE;
+        if (index + num_spectra > index_offset + index_length)
+        {
+            num_spectra = index_offset + index_length - index;
+        }
+
+        cursor = info->mdr_cursors[index / SPECTRA_PER_SCANLINE];
+        if (coda_cursor_goto_record_field_by_name(&cursor, "IDefSpectDWn1b") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_double(&cursor, &sample_width) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        coda_cursor_goto_parent(&cursor);
+        if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNsfirst1b") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_int32(&cursor, &first_sample) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        coda_cursor_goto_parent(&cursor);
+        if (coda_cursor_goto_record_field_by_name(&cursor, "IDefNslast1b") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_int32(&cursor, &last_sample) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (last_sample < first_sample)
+        {
+            harp_set_error(HARP_SUCCESS, "product error detected (IDefNslast1b < IDefNsfirst1b)");
+            return -1;
+        }
+        if ((last_sample - first_sample + 1) > info->num_pixels)
+        {
+            harp_set_error(HARP_SUCCESS, "product error detected (IDefNslast1b - IDefNsfirst1b + 1 > 8700)");
+            return -1;
+        }
+
+        /* the wavenumber grid is the same for all spectra within a scanline */
+        for (sample = first_sample, i = 0; sample <= last_sample; sample++, i++)
+        {
+            float_data[i] = (float)(sample_width * sample);
+        }
+        for (; i < info->num_pixels; i++)
+        {
+            float_data[i] = 0;
+        }
+        for (j = 1; j < num_spectra; j++)
+        {
+            memcpy(&float_data[j * info->num_pixels], float_data, info->num_pixels * sizeof(float));
+        }
+        float_data += num_spectra * info->num_pixels;
+
+        index += num_spectra;
     }
+
     return 0;
 }
 
@@ -263,6 +338,14 @@ static void ingestion_done(void *user_data)
     {
         free(info->channel_last);
     }
+    if (info->scaled_sample_channel != NULL)
+    {
+        free(info->scaled_sample_channel);
+    }
+    if (info->scaled_sample_factor != NULL)
+    {
+        free(info->scaled_sample_factor);
+    }
 
     free(info);
 }
@@ -303,6 +386,37 @@ static int read_datetime(void *user_data, harp_array data)
     return retval;
 }
 
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    coda_cursor cursor;
+    double mdr_time[2];
+    int i;
+
+    /* the measurement times increase monotonically, so we only need the record start times of the first and last
+     * scanline instead of the times of all scanlines */
+    for (i = 0; i < 2; i++)
+    {
+        cursor = info->mdr_cursors[i == 0 ? 0 : info->valid_scanlines - 1];
+        if (coda_cursor_goto(&cursor, "RECORD_HEADER/RECORD_START_TIME") != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_double(&cursor, &mdr_time[i]) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+    }
+
+    /* convert from seconds since 2000-01-01 to days since 2000-01-01 (see read_datetime() for the scan times) */
+    *datetime_start = mdr_time[0] / 86400.0;
+    *datetime_stop = (mdr_time[1] + ((SCANS_PER_SCANLINE - 1) * 8.0 / 37)) / 86400.0;
+
+    return 0;
+}
+
 static int read_orbit_index(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -338,14 +452,14 @@ static int read_longitude(void *user_data, harp_array data)
     return get_main_data((ingest_info *)user_data, "GGeoSondLoc", LONGITUDE, data.double_data);
 }
 
-static int read_spectral_radiance_sample(void *user_data, long index, harp_array data)
+static int read_spectral_radiance(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_spectra_sample_data((ingest_info *)user_data, index, data.float_data);
+    return get_spectra_range_data((ingest_info *)user_data, index_offset, index_length, data.float_data);
 }
 
-static int read_wavenumber_sample(void *user_data, long index, harp_array data)
+static int read_wavenumber(void *user_data, long index_offset, long index_length, harp_array data)
 {
-    return get_wavenumber_sample_data((ingest_info *)user_data, index, data.float_data);
+    return get_wavenumber_range_data((ingest_info *)user_data, index_offset, index_length, data.float_data);
 }
 
 static int read_scan_subindex(void *user_data, harp_array data)
@@ -452,6 +566,53 @@ static int init_dimensions(ingest_info *info)
     return 0;
 }
 
+/* Determine the channel number and scale factor for each sample of a spectrum, so the scaling can be applied to all
+ * spectra without having to evaluate the scale factor ranges (and powers of 10) for each spectrum again.
+ */
+static int init_sample_scaling(ingest_info *info, long max_scale_factors)
+{
+    int16_t scale_nr, channel_nr;
+    long k;
+
+    if (info->nr_scale_factors > max_scale_factors)
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "product error detected (IDefScaleSondNbScale > %ld)", max_scale_factors);
+        return -1;
+    }
+
+    info->num_scaled_samples = 0;
+    for (scale_nr = 0; scale_nr < info->nr_scale_factors; scale_nr++)
+    {
+        if (info->channel_last[scale_nr] >= info->channel_first[scale_nr])
+        {
+            info->num_scaled_samples += info->channel_last[scale_nr] - info->channel_first[scale_nr] + 1;
+        }
+    }
+    if (info->num_scaled_samples > info->num_pixels)
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "product error detected (scale factors cover more than %ld samples)",
+                       info->num_pixels);
+        return -1;
+    }
+
+    CHECKED_MALLOC(info->scaled_sample_channel, info->num_pixels * sizeof(int16_t));
+    CHECKED_MALLOC(info->scaled_sample_factor, info->num_pixels * sizeof(double));
+    k = 0;
+    for (scale_nr = 0; scale_nr < info->nr_scale_factors; scale_nr++)
+    {
+        double factor = pow(10.0, -(info->scale_factors[scale_nr]));
+
+        for (channel_nr = info->channel_first[scale_nr]; channel_nr <= info->channel_last[scale_nr]; channel_nr++)
+        {
+            info->scaled_sample_channel[k] = channel_nr;
+            info->scaled_sample_factor[k] = factor;
+            k++;
+        }
+    }
+
+    return 0;
+}
+
 static int read_GIADR_scalefactors(ingest_info *info)
 {
     coda_cursor cursor;
@@ -521,7 +682,8 @@ static int read_GIADR_scalefactors(ingest_info *info)
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    return 0;
+
+    return init_sample_scaling(info, max_scale_factors);
 }
 
 static int ingestion_init(const harp_ingestion_module *module, coda_product *product,
@@ -579,6 +741,7 @@ int harp_ingestion_module_iasi_l1_init(void)
     description = "IASI Level 1 products contain a number of scanlines, each scanline contains 30 scans, each scan "
         "contains 4 spectra and each spectrum contains 8700 measurements";
     harp_product_definition_add_mapping(product_definition, description, NULL);
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
 
     dimension_type[0] = harp_dimension_time;
     dimension_type[1] = harp_dimension_spectral;
@@ -619,9 +782,9 @@ int harp_ingestion_module_iasi_l1_init(void)
     /* wavenumber_radiance */
     description = "measured radiances";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavenumber_radiance", harp_type_float, 2,
+        harp_ingestion_register_variable_range_read(product_definition, "wavenumber_radiance", harp_type_float, 2,
                                                     dimension_type, NULL, description, "W/m^2.sr.m^-1", NULL,
-                                                    read_spectral_radiance_sample);
+                                                    get_optimal_range_length, read_spectral_radiance);
     path = "/MDR[]/MDR/GS1cSpect[], /MDR[]/MDR/IDefNsfirst1b, /GIADR_ScaleFactors/IDefScaleSondNbScale, "
         "/GIADR_ScaleFactors/IDefScaleSondScaleFactor[], /GIADR_ScaleFactors/IdefScaleSondNsfirst[], "
         "/GIADR_ScaleFactors/IDefScaleSondNslast[]";
@@ -634,9 +797,9 @@ int harp_ingestion_module_iasi_l1_init(void)
     /* wavenumber */
     description = "nominal wavelength assignment for each of the detector pixels";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavenumber", harp_type_float, 2,
+        harp_ingestion_register_variable_range_read(product_definition, "wavenumber", harp_type_float, 2,
                                                     dimension_type, NULL, description, "m^-1", NULL,
-                                                    read_wavenumber_sample);
+                                                    get_optimal_range_length, read_wavenumber);
     path = "/MDR[]/MDR/IDefSpectDWn1b, /MDR[]/MDR/IDefNsfirst1b, /MDR[]/MDR/IDefNslast1b";
     description = "wavenumber[i] = IDefSpectDWn1b * (i + IDefNsfirst1b - 1). ";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, description);
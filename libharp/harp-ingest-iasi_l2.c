@@ -178,6 +178,30 @@ static int read_time(void *user_data, long index, harp_array data)
     return 0;
 }
 
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    harp_array data;
+
+    /* the measurement times increase monotonically, so only the times of the first and last measurement are needed */
+    data.double_data = datetime_start;
+    if (read_time(user_data, 0, data) != 0)
+    {
+        return -1;
+    }
+    data.double_data = datetime_stop;
+    if (read_time(user_data, info->num_main - 1, data) != 0)
+    {
+        return -1;
+    }
+
+    /* convert from seconds since 2000-01-01 to days since 2000-01-01 */
+    *datetime_start /= 86400.0;
+    *datetime_stop /= 86400.0;
+
+    return 0;
+}
+
 static int read_orbit_index(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -635,6 +659,7 @@ int harp_ingestion_module_iasi_l2_init(void)
                                             ingestion_init, ingestion_done);
     product_definition =
         harp_ingestion_register_product(module, "IASI_L2", "IASI L2 total column densities", read_dimensions);
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
 
     /* datetime */
     description = "The time of the measurement at end of integration time";
@@ -397,6 +397,57 @@ static int read_time(void *user_data, harp_array data)
     return 0;
 }
 
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    harp_array data;
+    long i;
+
+    data.double_data = malloc(info->num_times * sizeof(double));
+    if (data.double_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       info->num_times * sizeof(double), __FILE__, __LINE__);
+        return -1;
+    }
+    if (read_time(user_data, data) != 0)
+    {
+        free(data.double_data);
+        return -1;
+    }
+
+    *datetime_start = harp_plusinf();
+    *datetime_stop = harp_mininf();
+    for (i = 0; i < info->num_times; i++)
+    {
+        if (harp_isnan(data.double_data[i]))
+        {
+            continue;
+        }
+        if (data.double_data[i] < *datetime_start)
+        {
+            *datetime_start = data.double_data[i];
+        }
+        if (data.double_data[i] > *datetime_stop)
+        {
+            *datetime_stop = data.double_data[i];
+        }
+    }
+    free(data.double_data);
+
+    if (harp_isplusinf(*datetime_start))
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "cannot determine valid start value for datetime range");
+        return -1;
+    }
+
+    /* convert from seconds since 2000-01-01 to days since 2000-01-01 */
+    *datetime_start /= 86400.0;
+    *datetime_stop /= 86400.0;
+
+    return 0;
+}
+
 static int read_longitude(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -848,6 +899,8 @@ static void register_datetime_variable(harp_product_definition *product_definiti
     harp_dimension_type dimension_type[1] = { harp_dimension_time };
     const char *description;
 
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
+
     description = "time of the measurement";
     variable_definition =
         harp_ingestion_register_variable_full_read(product_definition, "datetime", harp_type_double, 1, dimension_type,
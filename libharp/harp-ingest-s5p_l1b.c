@@ -50,6 +50,9 @@
 /* Maximum length of a path string in generated mapping descriptions. */
 #define MAX_PATH_LENGTH 256
 
+/* Target size in bytes of a single range read of spectral data (which is read in blocks of whole scanlines). */
+#define RANGE_READ_SIZE (8 * 1024 * 1024)
+
 typedef struct ingest_info_struct
 {
     coda_product *product;
@@ -66,6 +69,7 @@ typedef struct ingest_info_struct
 
     coda_cursor wavelength_cursor;
     harp_scalar wavelength_fill_value;
+    float *wavelength_data;     /* cached wavelength grid for all pixels (#pixels x #channels) */
     coda_cursor observable_cursor;
     harp_scalar observable_fill_value;
 } ingest_info;
@@ -357,7 +361,13 @@ static int parse_option_band(ingest_info *info, const harp_ingestion_options *op
 
 static void ingestion_done(void *user_data)
 {
-    free(user_data);
+    ingest_info *info = (ingest_info *)user_data;
+
+    if (info->wavelength_data != NULL)
+    {
+        free(info->wavelength_data);
+    }
+    free(info);
 }
 
 static int ingestion_init_s5p_l1b_ir(const harp_ingestion_module *module, coda_product *product,
@@ -377,6 +387,7 @@ static int ingestion_init_s5p_l1b_ir(const harp_ingestion_module *module, coda_p
     }
     info->product = product;
     info->band = 1;
+    info->wavelength_data = NULL;
 
     if (parse_option_band(info, options) != 0)
     {
@@ -456,6 +467,7 @@ static int ingestion_init_s5p_l1b_ra(const harp_ingestion_module *module, coda_p
     }
     info->product = product;
     info->band = -1;
+    info->wavelength_data = NULL;
 
     if (init_cursors(info, NULL) != 0)
     {
@@ -511,20 +523,10 @@ static int read_scan_subindex(void *user_data, long index, harp_array data)
     return 0;
 }
 
-static int read_datetime(void *user_data, harp_array data)
+static int read_time_reference(ingest_info *info, double *time_reference)
 {
-    ingest_info *info = (ingest_info *)user_data;
     coda_cursor cursor;
-    harp_scalar fill_value;
-    double time_reference;
     long coda_num_elements;
-    long i;
-
-    /* Even though the product specification may not accurately describe this, S5P treats all days as having 86400
-     * seconds (as does HARP). The time value is thus the sum of:
-     * - the S5P time reference as seconds since 2010 (using 86400 seconds per day)
-     * - the number of seconds since the S5P time reference
-     */
 
     /* Read reference time in seconds since 2010-01-01 */
     cursor = info->observation_cursor;
@@ -549,14 +551,37 @@ static int read_datetime(void *user_data, harp_array data)
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (coda_cursor_read_double(&cursor, &time_reference) != 0)
+    if (coda_cursor_read_double(&cursor, time_reference) != 0)
     {
         harp_set_error(HARP_ERROR_CODA, NULL);
         return -1;
     }
-    if (time_reference == DEFAULT_FILL_VALUE_INT)
+    if (*time_reference == DEFAULT_FILL_VALUE_INT)
+    {
+        *time_reference = coda_NaN();
+    }
+
+    return 0;
+}
+
+static int read_datetime(void *user_data, harp_array data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    coda_cursor cursor;
+    harp_scalar fill_value;
+    double time_reference;
+    long coda_num_elements;
+    long i;
+
+    /* Even though the product specification may not accurately describe this, S5P treats all days as having 86400
+     * seconds (as does HARP). The time value is thus the sum of:
+     * - the S5P time reference as seconds since 2010 (using 86400 seconds per day)
+     * - the number of seconds since the S5P time reference
+     */
+
+    if (read_time_reference(info, &time_reference) != 0)
     {
-        time_reference = coda_NaN();
+        return -1;
     }
 
     /* Read difference in milliseconds (ms) between the time reference and the start of the observation. */
@@ -609,6 +634,98 @@ static int read_datetime(void *user_data, harp_array data)
     return 0;
 }
 
+/* find the first (or last if 'reverse' is set) value of the delta_time array that is not a fill value */
+static int read_valid_delta_time(ingest_info *info, int reverse, double *value)
+{
+    coda_cursor cursor;
+    coda_cursor fill_value_cursor;
+    double fill_value;
+    long coda_num_elements;
+    long i;
+
+    cursor = info->observation_cursor;
+    if (coda_cursor_goto_record_field_by_name(&cursor, "delta_time") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    fill_value_cursor = cursor;
+    if (coda_cursor_goto(&fill_value_cursor, "@FillValue[0]") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_double(&fill_value_cursor, &fill_value) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_get_num_elements(&cursor, &coda_num_elements) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    for (i = 0; i < coda_num_elements; i++)
+    {
+        if (coda_cursor_goto_array_element_by_index(&cursor, reverse ? coda_num_elements - 1 - i : i) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_double(&cursor, value) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        coda_cursor_goto_parent(&cursor);
+        if (*value != fill_value && !harp_isnan(*value))
+        {
+            return 0;
+        }
+    }
+
+    harp_set_error(HARP_ERROR_INGESTION, "cannot determine valid %s value for datetime range",
+                   reverse ? "stop" : "start");
+    return -1;
+}
+
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    double time_reference;
+    double datetime[2];
+
+    /* delta_time increases monotonically, so only the first and last valid values need to be read instead of the
+     * full datetime variable */
+    if (read_time_reference(info, &time_reference) != 0)
+    {
+        return -1;
+    }
+    if (read_valid_delta_time(info, 0, &datetime[0]) != 0)
+    {
+        return -1;
+    }
+    if (read_valid_delta_time(info, 1, &datetime[1]) != 0)
+    {
+        return -1;
+    }
+    if (harp_isnan(time_reference))
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "cannot determine valid start value for datetime range");
+        return -1;
+    }
+    datetime[0] = time_reference + datetime[0] / 1e3;
+    datetime[1] = time_reference + datetime[1] / 1e3;
+    if (harp_convert_unit("seconds since 2010-01-01", "days since 2000-01-01", 2, datetime) != 0)
+    {
+        return -1;
+    }
+    *datetime_start = datetime[0];
+    *datetime_stop = datetime[1];
+
+    return 0;
+}
+
 static int read_orbit_index(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -743,27 +860,68 @@ static int read_viewing_zenith_angle(void *user_data, harp_array data)
     return read_dataset(info->geo_data_cursor, "viewing_zenith_angle", info->num_scanlines * info->num_pixels, data);
 }
 
-static int read_wavelength(void *user_data, long index, harp_array data)
+static long get_optimal_range_length(void *user_data)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    long num_scanlines;
+
+    /* read whole scanlines, with a total size of about RANGE_READ_SIZE bytes */
+    num_scanlines = RANGE_READ_SIZE / (info->num_pixels * info->num_channels * sizeof(float));
+    if (num_scanlines < 1)
+    {
+        num_scanlines = 1;
+    }
+
+    return num_scanlines * info->num_pixels;
+}
+
+static int read_wavelength(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
-    long offset;
+    long i;
 
-    /* Compute the offset into an array of dimensions #pixels x #channels (either calibrated_wavelength or
-     * nominal_wavelength) using a pixel index derived from the provided index on the time dimension (of length
-     * #scanlines x #pixels).
+    if (info->wavelength_data == NULL)
+    {
+        /* the wavelength grid (either calibrated_wavelength or nominal_wavelength) has dimensions #pixels x #channels
+         * and is the same for all scanlines, so read it once in full */
+        harp_array wavelength_data;
+
+        wavelength_data.float_data = malloc(info->num_pixels * info->num_channels * sizeof(float));
+        if (wavelength_data.float_data == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           info->num_pixels * info->num_channels * sizeof(float), __FILE__, __LINE__);
+            return -1;
+        }
+        if (read_partial_dataset(&info->wavelength_cursor, 0, info->num_pixels * info->num_channels, wavelength_data,
+                                 info->wavelength_fill_value) != 0)
+        {
+            free(wavelength_data.float_data);
+            return -1;
+        }
+        info->wavelength_data = wavelength_data.float_data;
+    }
+
+    /* Copy the wavelengths for each pixel, using a pixel index derived from the index on the time dimension (of
+     * length #scanlines x #pixels).
      */
-    offset = (index - (index / info->num_pixels) * info->num_pixels) * info->num_channels;
+    for (i = 0; i < index_length; i++)
+    {
+        long pixel_index = (index_offset + i) % info->num_pixels;
+
+        memcpy(&data.float_data[i * info->num_channels], &info->wavelength_data[pixel_index * info->num_channels],
+               info->num_channels * sizeof(float));
+    }
 
-    return read_partial_dataset(&info->wavelength_cursor, offset, info->num_channels, data,
-                                info->wavelength_fill_value);
+    return 0;
 }
 
-static int read_observable(void *user_data, long index, harp_array data)
+static int read_observable(void *user_data, long index_offset, long index_length, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
 
-    return read_partial_dataset(&info->observable_cursor, index * info->num_channels, info->num_channels, data,
-                                info->observable_fill_value);
+    return read_partial_dataset(&info->observable_cursor, index_offset * info->num_channels,
+                                index_length * info->num_channels, data, info->observable_fill_value);
 }
 
 static void register_irradiance_product_variables(harp_product_definition *product_definition,
@@ -783,6 +941,8 @@ static void register_irradiance_product_variables(harp_product_definition *produ
         "scanline is computed as the index on the temporal dimension modulo the number of scanlines";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, NULL, description);
 
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
+
     description = "time of the measurement";
     variable_definition =
         harp_ingestion_register_variable_full_read(product_definition, "datetime", harp_type_double, 1, dimension_type,
@@ -805,16 +965,17 @@ static void register_irradiance_product_variables(harp_product_definition *produ
     /* Irradiance. */
     description = "calibrated wavelength";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavelength", harp_type_float, 2,
-                                                    dimension_type, NULL, description, "nm", NULL, read_wavelength);
+        harp_ingestion_register_variable_range_read(product_definition, "wavelength", harp_type_float, 2,
+                                                    dimension_type, NULL, description, "nm", NULL,
+                                                    get_optimal_range_length, read_wavelength);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/INSTRUMENT/calibrated_wavelength[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "spectral photon irradiance";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "photon_irradiance", harp_type_float, 2,
+        harp_ingestion_register_variable_range_read(product_definition, "photon_irradiance", harp_type_float, 2,
                                                     dimension_type, NULL, description, "mol/(s.m^2.nm)", NULL,
-                                                    read_observable);
+                                                    get_optimal_range_length, read_observable);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/OBSERVATIONS/irradiance[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -839,6 +1000,8 @@ static void register_radiance_product_variables(harp_product_definition *product
         "number of scanlines";
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, NULL, description);
 
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
+
     description = "time of the measurement";
     variable_definition =
         harp_ingestion_register_variable_full_read(product_definition, "datetime", harp_type_double, 1, dimension_type,
@@ -961,16 +1124,17 @@ static void register_radiance_product_variables(harp_product_definition *product
     /* Radiance. */
     description = "nominal wavelength";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "wavelength", harp_type_float, 2,
-                                                    dimension_type, NULL, description, "nm", NULL, read_wavelength);
+        harp_ingestion_register_variable_range_read(product_definition, "wavelength", harp_type_float, 2,
+                                                    dimension_type, NULL, description, "nm", NULL,
+                                                    get_optimal_range_length, read_wavelength);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/INSTRUMENT/nominal_wavelength[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 
     description = "spectral photon radiance";
     variable_definition =
-        harp_ingestion_register_variable_block_read(product_definition, "photon_radiance", harp_type_float, 2,
+        harp_ingestion_register_variable_range_read(product_definition, "photon_radiance", harp_type_float, 2,
                                                     dimension_type, NULL, description, "mol/(s.m^2.nm.sr)", NULL,
-                                                    read_observable);
+                                                    get_optimal_range_length, read_observable);
     snprintf(path, MAX_PATH_LENGTH, "/%s/STANDARD_MODE/OBSERVATIONS/radiance[]", product_group_name);
     harp_variable_definition_add_mapping(variable_definition, NULL, NULL, path, NULL);
 }
@@ -1058,6 +1058,104 @@ static int read_time_coverage_resolution(void *user_data, harp_array data)
     return 0;
 }
 
+/* find the first (or last if 'reverse' is set) value of a delta_time array that is not a fill value */
+static int read_valid_delta_time(coda_cursor cursor, int reverse, double *value)
+{
+    coda_cursor fill_value_cursor;
+    double fill_value;
+    long num_elements;
+    long i;
+
+    if (coda_cursor_goto_record_field_by_name(&cursor, "delta_time") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    fill_value_cursor = cursor;
+    if (coda_cursor_goto(&fill_value_cursor, "@FillValue[0]") != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_read_double(&fill_value_cursor, &fill_value) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    if (coda_cursor_get_num_elements(&cursor, &num_elements) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        return -1;
+    }
+    for (i = 0; i < num_elements; i++)
+    {
+        if (coda_cursor_goto_array_element_by_index(&cursor, reverse ? num_elements - 1 - i : i) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        if (coda_cursor_read_double(&cursor, value) != 0)
+        {
+            harp_set_error(HARP_ERROR_CODA, NULL);
+            return -1;
+        }
+        coda_cursor_goto_parent(&cursor);
+        if (*value != fill_value && !harp_isnan(*value))
+        {
+            return 0;
+        }
+    }
+
+    harp_set_error(HARP_ERROR_INGESTION, "cannot determine valid %s value for datetime range",
+                   reverse ? "stop" : "start");
+    return -1;
+}
+
+static int read_datetime_range(void *user_data, double *datetime_start, double *datetime_stop)
+{
+    ingest_info *info = (ingest_info *)user_data;
+    harp_array data;
+    double time_reference;
+    double time_length;
+    double datetime[2];
+
+    /* delta_time increases monotonically, so only the first and last valid values need to be read instead of the
+     * full datetime_start/datetime_length variables */
+    data.ptr = &time_reference;
+    if (read_dataset(info->product_cursor, "time", harp_type_double, 1, data) != 0)
+    {
+        return -1;
+    }
+    data.ptr = &time_length;
+    if (read_time_coverage_resolution(info, data) != 0)
+    {
+        return -1;
+    }
+    if (read_valid_delta_time(info->product_cursor, 0, &datetime[0]) != 0)
+    {
+        return -1;
+    }
+    if (read_valid_delta_time(info->product_cursor, 1, &datetime[1]) != 0)
+    {
+        return -1;
+    }
+    if (harp_isnan(time_reference))
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "cannot determine valid start value for datetime range");
+        return -1;
+    }
+    datetime[0] = time_reference + datetime[0] / 1e3;
+    datetime[1] = time_reference + datetime[1] / 1e3 + time_length;
+    if (harp_convert_unit("seconds since 2010-01-01", "days since 2000-01-01", 2, datetime) != 0)
+    {
+        return -1;
+    }
+    *datetime_start = datetime[0];
+    *datetime_stop = datetime[1];
+
+    return 0;
+}
+
 static int read_orbit_index(void *user_data, harp_array data)
 {
     ingest_info *info = (ingest_info *)user_data;
@@ -4339,6 +4437,8 @@ static void register_core_variables(harp_product_definition *product_definition,
     harp_variable_definition *variable_definition;
     harp_dimension_type dimension_type[1] = { harp_dimension_time };
 
+    harp_ingestion_register_datetime_range_read(product_definition, read_datetime_range);
+
     /* scan_subindex */
     description = "pixel index (0-based) within the scanline";
     variable_definition =
@@ -0,0 +1,887 @@
+/*
+ * Copyright (C) 2015-2020 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+#include "harp-ingestion.h"
+#include "harp-program.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
+
+#ifdef WIN32
+#include "windows.h"
+#include <process.h>
+#include <sys/utime.h>
+#define getpid _getpid
+#define utime _utime
+#define PATH_SEPARATOR "\\"
+#else
+#include <unistd.h>
+#include <utime.h>
+#define PATH_SEPARATOR "/"
+#endif
+
+/* cache entries are named 'harp-<32 hexadecimal digits>.nc' */
+#define CACHE_ENTRY_PREFIX "harp-"
+#define CACHE_ENTRY_SUFFIX ".nc"
+#define CACHE_ENTRY_NAME_LENGTH 40
+
+static char *harp_ingestion_cache_path = NULL;
+
+typedef struct cache_key_struct
+{
+    uint64_t hash[2];
+} cache_key;
+
+typedef struct cache_entry_struct
+{
+    char *path;
+    int64_t size;
+    time_t mtime;
+} cache_entry;
+
+/** Set the directory that is used as cache for the results of ingestions.
+ * \ingroup harp_general
+ * When a cache directory is set, harp_import() will store the product that results from the ingestion of a non-HARP
+ * file in the cache directory. A subsequent import of the same file (same path, size, and modification time), using
+ * the same ingestion options and the same leading ingestion operations, will then read the product from the cache
+ * instead of ingesting the file again. Entries are only reused by the same HARP and CODA versions and only if CODA
+ * still identifies the file as the same product class, type, and version.
+ * Only the leading operations that can be performed during ingestion (filters, keep(), exclude()) are part of the
+ * cached result; the remaining operations are always applied to the product after it is taken from the cache.
+ * Filters that refer to external files (collocate_left()/collocate_right(), area and point_in_area filters) end the
+ * cached part of the operations.
+ * Cached products are stored in HARP netCDF format. The total size of the cache is bounded by the
+ * harp_set_option_ingestion_cache_size() option; when it is exceeded the least recently used entries are removed.
+ * The directory should already exist and can be shared by multiple processes.
+ * If no path was set, the cache directory is taken from the HARP_INGESTION_CACHE environment variable (if set) when
+ * harp_init() is called.
+ * \param path Path to the cache directory (or NULL to disable the cache).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_ingestion_cache_path(const char *path)
+{
+    if (harp_ingestion_cache_path != NULL)
+    {
+        free(harp_ingestion_cache_path);
+        harp_ingestion_cache_path = NULL;
+    }
+    if (path == NULL)
+    {
+        return 0;
+    }
+    harp_ingestion_cache_path = strdup(path);
+    if (harp_ingestion_cache_path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    return 0;
+}
+
+/** Retrieve the directory that is used as cache for the results of ingestions.
+ * \ingroup harp_general
+ * \see harp_set_ingestion_cache_path()
+ * \return Path to the cache directory, or NULL if the cache is disabled.
+ */
+LIBHARP_API const char *harp_get_ingestion_cache_path(void)
+{
+    return harp_ingestion_cache_path;
+}
+
+int harp_ingestion_cache_init(void)
+{
+    if (harp_ingestion_cache_path == NULL && getenv("HARP_INGESTION_CACHE") != NULL)
+    {
+        return harp_set_ingestion_cache_path(getenv("HARP_INGESTION_CACHE"));
+    }
+
+    return 0;
+}
+
+static void cache_key_update(cache_key *key, const char *str, long length)
+{
+    long i;
+
+    for (i = 0; i < length; i++)
+    {
+        unsigned char c = (unsigned char)str[i];
+
+        /* FNV-1a and sdbm, which together give a 128 bit key */
+        key->hash[0] = (key->hash[0] ^ c) * 0x100000001b3ULL;
+        key->hash[1] = c + (key->hash[1] << 6) + (key->hash[1] << 16) - key->hash[1];
+    }
+}
+
+static void cache_key_add(cache_key *key, const char *name, const char *value)
+{
+    cache_key_update(key, name, strlen(name));
+    cache_key_update(key, "=", 1);
+    cache_key_update(key, value, strlen(value));
+    cache_key_update(key, "\n", 1);
+}
+
+/* Split an operations string into the individual (whitespace trimmed) operations.
+ * Operations are separated by ';' characters (outside string values). Empty operations are skipped.
+ */
+static int split_operations(const char *operations, int *num_statements, char ***statement)
+{
+    char **statement_list = NULL;
+    int num_statement_list = 0;
+    int in_string = 0;
+    long start = 0;
+    long i;
+
+    for (i = 0;; i++)
+    {
+        if (in_string)
+        {
+            if (operations[i] == '\\' && operations[i + 1] != '\0')
+            {
+                i++;
+            }
+            else if (operations[i] == '"')
+            {
+                in_string = 0;
+            }
+            if (operations[i] != '\0')
+            {
+                continue;
+            }
+        }
+        else if (operations[i] == '"')
+        {
+            in_string = 1;
+            continue;
+        }
+        if (operations[i] == ';' || operations[i] == '\0')
+        {
+            long end = i;
+
+            while (start < end && (operations[start] == ' ' || operations[start] == '\t' ||
+                                   operations[start] == '\n' || operations[start] == '\r'))
+            {
+                start++;
+            }
+            while (end > start && (operations[end - 1] == ' ' || operations[end - 1] == '\t' ||
+                                   operations[end - 1] == '\n' || operations[end - 1] == '\r'))
+            {
+                end--;
+            }
+            if (end > start)
+            {
+                char **new_statement_list;
+
+                new_statement_list = (char **)realloc(statement_list, (num_statement_list + 1) * sizeof(char *));
+                if (new_statement_list == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   (num_statement_list + 1) * sizeof(char *), __FILE__, __LINE__);
+                    break;
+                }
+                statement_list = new_statement_list;
+                statement_list[num_statement_list] = (char *)malloc(end - start + 1);
+                if (statement_list[num_statement_list] == NULL)
+                {
+                    harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                                   end - start + 1, __FILE__, __LINE__);
+                    break;
+                }
+                memcpy(statement_list[num_statement_list], &operations[start], end - start);
+                statement_list[num_statement_list][end - start] = '\0';
+                num_statement_list++;
+            }
+            if (operations[i] == '\0')
+            {
+                *num_statements = num_statement_list;
+                *statement = statement_list;
+                return 0;
+            }
+            start = i + 1;
+        }
+    }
+
+    /* out of memory */
+    for (i = 0; i < num_statement_list; i++)
+    {
+        free(statement_list[i]);
+    }
+    if (statement_list != NULL)
+    {
+        free(statement_list);
+    }
+    return -1;
+}
+
+/* Join operations using ';' as separator (the result is NULL if there are no operations). */
+static int join_operations(int num_statements, char **statement, char **operations)
+{
+    long length = 0;
+    int i;
+
+    if (num_statements == 0)
+    {
+        *operations = NULL;
+        return 0;
+    }
+    for (i = 0; i < num_statements; i++)
+    {
+        length += strlen(statement[i]) + 1;
+    }
+    *operations = (char *)malloc(length);
+    if (*operations == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", length,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    strcpy(*operations, statement[0]);
+    for (i = 1; i < num_statements; i++)
+    {
+        strcat(*operations, ";");
+        strcat(*operations, statement[i]);
+    }
+
+    return 0;
+}
+
+/* Add operations to the key in canonical form: whitespace outside string values is collapsed into a single space and
+ * removed entirely next to punctuation, such that e.g. 'keep(a, b)' and 'keep(a,b)' result in the same key.
+ */
+static void cache_key_add_operations(cache_key *key, const char *operations)
+{
+    const char *punctuation = "()[],;=<>!";
+    int in_string = 0;
+    int pending_space = 0;
+    char last = '\0';
+    const char *c;
+
+    cache_key_update(key, "operations=", 11);
+    for (c = operations; *c != '\0'; c++)
+    {
+        if (in_string)
+        {
+            cache_key_update(key, c, 1);
+            if (*c == '\\' && c[1] != '\0')
+            {
+                c++;
+                cache_key_update(key, c, 1);
+            }
+            else if (*c == '"')
+            {
+                in_string = 0;
+            }
+            last = '"';
+            continue;
+        }
+        if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r')
+        {
+            pending_space = 1;
+            continue;
+        }
+        if (pending_space && strchr(punctuation, *c) == NULL && strchr(punctuation, last) == NULL)
+        {
+            cache_key_update(key, " ", 1);
+        }
+        pending_space = 0;
+        cache_key_update(key, c, 1);
+        if (*c == '"')
+        {
+            in_string = 1;
+        }
+        last = *c;
+    }
+    cache_key_update(key, "\n", 1);
+}
+
+static int compare_options(const void *a, const void *b)
+{
+    return strcmp((*(harp_ingestion_option **)a)->name, (*(harp_ingestion_option **)b)->name);
+}
+
+static int cache_key_add_options(cache_key *key, const char *options)
+{
+    harp_ingestion_options *option_list;
+    int i;
+
+    if (options == NULL)
+    {
+        cache_key_add(key, "options", "");
+        return 0;
+    }
+    if (harp_ingestion_options_from_string(options, &option_list) != 0)
+    {
+        return -1;
+    }
+    /* the order in which options are given is not relevant */
+    qsort(option_list->option, option_list->num_options, sizeof(harp_ingestion_option *), compare_options);
+    cache_key_update(key, "options=", 8);
+    for (i = 0; i < option_list->num_options; i++)
+    {
+        cache_key_update(key, option_list->option[i]->name, strlen(option_list->option[i]->name));
+        cache_key_update(key, "=", 1);
+        cache_key_update(key, option_list->option[i]->value, strlen(option_list->option[i]->value));
+        cache_key_update(key, ";", 1);
+    }
+    cache_key_update(key, "\n", 1);
+    harp_ingestion_options_delete(option_list);
+
+    return 0;
+}
+
+/* Only operations that are (potentially) performed as part of the ingestion itself, and whose result only depends on
+ * the product, are part of the cached result.
+ */
+static int is_cacheable_operation(const harp_operation *operation)
+{
+    switch (operation->type)
+    {
+        case operation_bit_mask_filter:
+        case operation_comparison_filter:
+        case operation_exclude_variable:
+        case operation_index_comparison_filter:
+        case operation_index_membership_filter:
+        case operation_keep_variable:
+        case operation_longitude_range_filter:
+        case operation_membership_filter:
+        case operation_point_distance_filter:
+        case operation_string_comparison_filter:
+        case operation_string_membership_filter:
+        case operation_valid_range_filter:
+            return 1;
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/* Split the operations into the leading operations that are part of the cached result and the remaining operations.
+ * If the cache can not be used for these operations, use_cache will be set to 0.
+ */
+static int get_cached_operations(const char *operations, char **cached_operations, char **remaining_operations,
+                                 int *use_cache)
+{
+    harp_program *program;
+    char **statement;
+    int num_statements;
+    int num_cached_statements = 0;
+    int result = 0;
+    int i;
+
+    *cached_operations = NULL;
+    *remaining_operations = NULL;
+    *use_cache = 1;
+    if (operations == NULL)
+    {
+        return 0;
+    }
+
+    if (harp_program_from_string(operations, &program) != 0)
+    {
+        return -1;
+    }
+    if (split_operations(operations, &num_statements, &statement) != 0)
+    {
+        harp_program_delete(program);
+        return -1;
+    }
+
+    if (num_statements == program->num_operations)
+    {
+        while (num_cached_statements < num_statements &&
+               is_cacheable_operation(program->operation[num_cached_statements]))
+        {
+            num_cached_statements++;
+        }
+        result = join_operations(num_cached_statements, statement, cached_operations);
+        if (result == 0)
+        {
+            result = join_operations(num_statements - num_cached_statements, &statement[num_cached_statements],
+                                     remaining_operations);
+            if (result != 0)
+            {
+                if (*cached_operations != NULL)
+                {
+                    free(*cached_operations);
+                    *cached_operations = NULL;
+                }
+            }
+        }
+    }
+    else
+    {
+        /* we could not match the operations string to the parsed operations */
+        *use_cache = 0;
+    }
+
+    for (i = 0; i < num_statements; i++)
+    {
+        free(statement[i]);
+    }
+    if (statement != NULL)
+    {
+        free(statement);
+    }
+    harp_program_delete(program);
+
+    return result;
+}
+
+/* Add the ingestion module, the CODA product class/type/version and the CODA version with which the product is
+ * ingested to the key, such that an update of the CODA definitions or of CODA that changes how a product is
+ * interpreted does not result in the reuse of stale cache entries. */
+static int cache_key_add_product_definition(cache_key *key, const char *filename)
+{
+    harp_ingestion_module *module;
+    coda_product *product;
+    const char *product_class;
+    const char *product_type;
+    char buffer[32];
+    int version;
+
+    if (harp_ingestion_find_module(filename, &module, &product) != 0)
+    {
+        return -1;
+    }
+    if (coda_get_product_class(product, &product_class) != 0 || coda_get_product_type(product, &product_type) != 0 ||
+        coda_get_product_version(product, &version) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        coda_close(product);
+        return -1;
+    }
+    cache_key_add(key, "module", module->name);
+    cache_key_add(key, "product_class", product_class);
+    cache_key_add(key, "product_type", product_type);
+    sprintf(buffer, "%d", version);
+    cache_key_add(key, "product_version", buffer);
+    coda_close(product);
+
+    cache_key_add(key, "coda", libcoda_version);
+
+    return 0;
+}
+
+static int get_cache_entry_path(const char *filename, const struct stat *statbuf, const char *options,
+                                const char *cached_operations, char **entry_path)
+{
+    cache_key key;
+    char *abspath;
+    char buffer[64];
+
+    key.hash[0] = 0xcbf29ce484222325ULL;
+    key.hash[1] = 0;
+
+    cache_key_add(&key, "harp", libharp_version);
+    if (cache_key_add_product_definition(&key, filename) != 0)
+    {
+        return -1;
+    }
+#ifdef WIN32
+    abspath = _fullpath(NULL, filename, 0);
+#else
+    abspath = realpath(filename, NULL);
+#endif
+    cache_key_add(&key, "file", abspath != NULL ? abspath : filename);
+    if (abspath != NULL)
+    {
+        free(abspath);
+    }
+    sprintf(buffer, "%ld", (long)statbuf->st_size);
+    cache_key_add(&key, "size", buffer);
+    sprintf(buffer, "%ld", (long)statbuf->st_mtime);
+    cache_key_add(&key, "mtime", buffer);
+    if (cache_key_add_options(&key, options) != 0)
+    {
+        return -1;
+    }
+    cache_key_add_operations(&key, cached_operations != NULL ? cached_operations : "");
+
+    *entry_path = (char *)malloc(strlen(harp_ingestion_cache_path) + 1 + CACHE_ENTRY_NAME_LENGTH + 1);
+    if (*entry_path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(harp_ingestion_cache_path) + 1 + CACHE_ENTRY_NAME_LENGTH + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    sprintf(*entry_path, "%s" PATH_SEPARATOR CACHE_ENTRY_PREFIX "%08lx%08lx%08lx%08lx" CACHE_ENTRY_SUFFIX,
+            harp_ingestion_cache_path, (unsigned long)(key.hash[0] >> 32), (unsigned long)(key.hash[0] & 0xffffffff),
+            (unsigned long)(key.hash[1] >> 32), (unsigned long)(key.hash[1] & 0xffffffff));
+
+    return 0;
+}
+
+static int is_cache_entry_name(const char *name)
+{
+    return strlen(name) == CACHE_ENTRY_NAME_LENGTH &&
+        strncmp(name, CACHE_ENTRY_PREFIX, strlen(CACHE_ENTRY_PREFIX)) == 0 &&
+        strcmp(&name[CACHE_ENTRY_NAME_LENGTH - strlen(CACHE_ENTRY_SUFFIX)], CACHE_ENTRY_SUFFIX) == 0;
+}
+
+static int add_cache_entry(const char *name, int *num_entries, cache_entry **entries)
+{
+    struct stat statbuf;
+    cache_entry *entry;
+    char *path;
+
+    path = (char *)malloc(strlen(harp_ingestion_cache_path) + 1 + strlen(name) + 1);
+    if (path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(harp_ingestion_cache_path) + 1 + strlen(name) + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    sprintf(path, "%s" PATH_SEPARATOR "%s", harp_ingestion_cache_path, name);
+    if (stat(path, &statbuf) != 0)
+    {
+        /* the entry may have been removed by another process */
+        free(path);
+        return 0;
+    }
+
+    if (*num_entries % BLOCK_SIZE == 0)
+    {
+        cache_entry *new_entries;
+
+        new_entries = (cache_entry *)realloc(*entries, (*num_entries + BLOCK_SIZE) * sizeof(cache_entry));
+        if (new_entries == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           (*num_entries + BLOCK_SIZE) * sizeof(cache_entry), __FILE__, __LINE__);
+            free(path);
+            return -1;
+        }
+        *entries = new_entries;
+    }
+    entry = &(*entries)[*num_entries];
+    entry->path = path;
+    entry->size = (int64_t)statbuf.st_size;
+    entry->mtime = statbuf.st_mtime;
+    (*num_entries)++;
+
+    return 0;
+}
+
+static int get_cache_entries(int *num_entries, cache_entry **entries)
+{
+#ifdef WIN32
+    WIN32_FIND_DATA FileData;
+    HANDLE hSearch;
+    char *pattern;
+
+    pattern = malloc(strlen(harp_ingestion_cache_path) + 4 + 1);
+    if (pattern == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (long)strlen(harp_ingestion_cache_path) + 4 + 1, __FILE__, __LINE__);
+        return -1;
+    }
+    sprintf(pattern, "%s\\*.*", harp_ingestion_cache_path);
+    hSearch = FindFirstFile(pattern, &FileData);
+    free(pattern);
+
+    if (hSearch == INVALID_HANDLE_VALUE)
+    {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_NO_MORE_FILES)
+        {
+            /* no files found */
+            return 0;
+        }
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not access directory '%s'", harp_ingestion_cache_path);
+        return -1;
+    }
+
+    do
+    {
+        if (!(FileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && is_cache_entry_name(FileData.cFileName))
+        {
+            if (add_cache_entry(FileData.cFileName, num_entries, entries) != 0)
+            {
+                FindClose(hSearch);
+                return -1;
+            }
+        }
+    } while (FindNextFile(hSearch, &FileData));
+    FindClose(hSearch);
+#else
+    DIR *dirp = NULL;
+    struct dirent *dp = NULL;
+
+    dirp = opendir(harp_ingestion_cache_path);
+    if (dirp == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "could not open directory %s", harp_ingestion_cache_path);
+        return -1;
+    }
+    while ((dp = readdir(dirp)) != NULL)
+    {
+        if (is_cache_entry_name(dp->d_name))
+        {
+            if (add_cache_entry(dp->d_name, num_entries, entries) != 0)
+            {
+                closedir(dirp);
+                return -1;
+            }
+        }
+    }
+    closedir(dirp);
+#endif
+
+    return 0;
+}
+
+static int compare_cache_entries(const void *a, const void *b)
+{
+    time_t mtime_a = ((cache_entry *)a)->mtime;
+    time_t mtime_b = ((cache_entry *)b)->mtime;
+
+    return mtime_a < mtime_b ? -1 : (mtime_a > mtime_b ? 1 : 0);
+}
+
+/* Remove the least recently used entries (other than the given entry) until the cache fits within its maximum size. */
+static int evict_cache_entries(const char *entry_path)
+{
+    cache_entry *entries = NULL;
+    int num_entries = 0;
+    int64_t max_size;
+    int64_t size = 0;
+    int result;
+    int i;
+
+    if (harp_option_ingestion_cache_size == 0)
+    {
+        return 0;
+    }
+    max_size = (int64_t)harp_option_ingestion_cache_size * 1024 * 1024;
+
+    result = get_cache_entries(&num_entries, &entries);
+    if (result == 0)
+    {
+        for (i = 0; i < num_entries; i++)
+        {
+            size += entries[i].size;
+        }
+        if (size > max_size)
+        {
+            qsort(entries, num_entries, sizeof(cache_entry), compare_cache_entries);
+            for (i = 0; i < num_entries && size > max_size; i++)
+            {
+                if (strcmp(entries[i].path, entry_path) != 0)
+                {
+                    /* ignore errors; the entry may already have been removed by another process */
+                    remove(entries[i].path);
+                    size -= entries[i].size;
+                }
+            }
+        }
+    }
+    for (i = 0; i < num_entries; i++)
+    {
+        free(entries[i].path);
+    }
+    if (entries != NULL)
+    {
+        free(entries);
+    }
+
+    return result;
+}
+
+/* Store a product in the cache. The product is first written to a temporary file which is then moved into place, such
+ * that other processes that use the same cache never see a partially written entry.
+ */
+static int store_cache_entry(const char *entry_path, const harp_product *product)
+{
+    char *tmp_path;
+
+    tmp_path = (char *)malloc(strlen(entry_path) + 32);
+    if (tmp_path == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       strlen(entry_path) + 32, __FILE__, __LINE__);
+        return -1;
+    }
+    sprintf(tmp_path, "%s.%ld.tmp", entry_path, (long)getpid());
+    if (harp_export_netcdf(tmp_path, 0, product) != 0)
+    {
+        remove(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+    if (rename(tmp_path, entry_path) != 0)
+    {
+        /* on some systems rename() fails if the entry was stored by another process in the mean time */
+        remove(tmp_path);
+    }
+    free(tmp_path);
+
+    return evict_cache_entries(entry_path);
+}
+
+static int import_cache_entry(const char *entry_path, int lazy, harp_product **product)
+{
+    if (harp_import_netcdf(entry_path, lazy, product) != 0)
+    {
+        return -1;
+    }
+    if (harp_product_verify(*product) != 0)
+    {
+        harp_product_delete(*product);
+        return -1;
+    }
+
+    /* update the modification time, which is used to determine the least recently used entries */
+    utime(entry_path, NULL);
+
+    return 0;
+}
+
+static int ingest_using_cache_entry(const char *filename, const char *options, const char *entry_path,
+                                    const char *cached_operations, const char *remaining_operations, int lazy,
+                                    harp_product **product)
+{
+    struct stat statbuf;
+    harp_product *cached_product = NULL;
+
+    if (stat(entry_path, &statbuf) == 0)
+    {
+        if (import_cache_entry(entry_path, lazy || remaining_operations != NULL, &cached_product) != 0)
+        {
+            /* treat an unreadable entry as a cache miss */
+            harp_report_warning("ignoring ingestion cache entry '%s' (%s)", entry_path,
+                                harp_errno_to_string(harp_errno));
+            remove(entry_path);
+            cached_product = NULL;
+        }
+    }
+    if (cached_product == NULL)
+    {
+        if (harp_ingest(filename, cached_operations, options, &cached_product) != 0)
+        {
+            return -1;
+        }
+        if (harp_product_is_empty(cached_product))
+        {
+            /* an empty product is returned as-is (without applying the remaining operations), as harp_ingest() does */
+            *product = cached_product;
+            return 0;
+        }
+        if (store_cache_entry(entry_path, cached_product) != 0)
+        {
+            /* a failure to update the cache should not make the import fail */
+            harp_report_warning("could not store product in ingestion cache (%s)", harp_errno_to_string(harp_errno));
+        }
+    }
+
+    if (remaining_operations != NULL)
+    {
+        if (harp_product_execute_operations(cached_product, remaining_operations) != 0)
+        {
+            harp_product_delete(cached_product);
+            return -1;
+        }
+    }
+    if (!lazy)
+    {
+        if (harp_product_ensure_loaded(cached_product) != 0)
+        {
+            harp_product_delete(cached_product);
+            return -1;
+        }
+    }
+
+    *product = cached_product;
+
+    return 0;
+}
+
+/* Ingest a product, using the ingestion cache if it is enabled (see harp_set_ingestion_cache_path()).
+ * If 'lazy' is set, the data of variables of a product that is imported from the cache is only read when needed. */
+int harp_ingest_cached(const char *filename, const char *operations, const char *options, int lazy,
+                       harp_product **product)
+{
+    struct stat statbuf;
+    char *cached_operations;
+    char *remaining_operations;
+    char *entry_path;
+    int use_cache;
+    int result;
+
+    if (harp_ingestion_cache_path == NULL || stat(filename, &statbuf) != 0)
+    {
+        /* without a cache, or if the file can not be accessed (which harp_ingest() will report), ingest directly */
+        return harp_ingest(filename, operations, options, product);
+    }
+
+    if (get_cached_operations(operations, &cached_operations, &remaining_operations, &use_cache) != 0)
+    {
+        return -1;
+    }
+    if (!use_cache)
+    {
+        result = harp_ingest(filename, operations, options, product);
+    }
+    else
+    {
+        result = get_cache_entry_path(filename, &statbuf, options, cached_operations, &entry_path);
+        if (result == 0)
+        {
+            result = ingest_using_cache_entry(filename, options, entry_path, cached_operations, remaining_operations,
+                                              lazy, product);
+            free(entry_path);
+        }
+    }
+
+    if (cached_operations != NULL)
+    {
+        free(cached_operations);
+    }
+    if (remaining_operations != NULL)
+    {
+        free(remaining_operations);
+    }
+
+    return result;
+}
@@ -63,6 +63,7 @@ int harp_ingestion_module_cci_l3_o3_ttoc_init(void);
 int harp_ingestion_module_cci_l4_o3_np_init(void);
 int harp_ingestion_module_earlinet_l2_aerosol_init(void);
 int harp_ingestion_module_ecmwf_grib_init(void);
+void harp_ingestion_module_ecmwf_grib_done(void);
 int harp_ingestion_module_geoms_ftir_init(void);
 int harp_ingestion_module_geoms_mwr_init(void);
 int harp_ingestion_module_geoms_lidar_init(void);
@@ -1360,6 +1361,8 @@ void harp_ingestion_done(void)
         free(module_register);
         module_register = NULL;
 
+        harp_ingestion_module_ecmwf_grib_done();
+
         coda_done();
     }
 }
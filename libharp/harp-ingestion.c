@@ -37,6 +37,7 @@
 #include "harp-filter.h"
 #include "harp-filter-collocation.h"
 #include "harp-geometry.h"
+#include "harp-memory-pool.h"
 #include "harp-operation.h"
 #include "harp-program.h"
 
@@ -44,6 +45,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 typedef struct read_buffer_struct
 {
@@ -66,9 +70,12 @@ typedef struct ingest_info_struct
     uint8_t product_mask;
     uint8_t *variable_mask;     /* indicates for each variable whether it should be included in the product */
 
+    const char *filename;       /* product filename */
     const char *basename;       /* product basename */
+    const harp_ingestion_options *option_list;  /* ingestion options that were passed to the ingestion module */
     harp_product *product;      /* resulting HARP product */
 
+    harp_memory_pool *pool;     /* pool from which all read buffers are allocated */
     read_buffer *block_buffer;  /* buffer used for storing results from 'read_all' and 'read_range' */
     int (*block_buffer_read_all) (void *user_data, harp_array data);    /* 'read_all' that was used to fill buffer */
     /* 'read_range' that was used to fill buffer */
@@ -79,6 +86,12 @@ typedef struct ingest_info_struct
     long block_buffer_num_blocks;       /* number of blocks that can fit in the buffer */
 } ingest_info;
 
+/* memory pool of the ingestion that is reading a variable on this thread (see harp_ingestion_get_memory_pool()) */
+static harp_memory_pool *current_pool = NULL;
+#ifdef _OPENMP
+#pragma omp threadprivate(current_pool)
+#endif
+
 static void read_buffer_free_string_data(read_buffer *buffer)
 {
     if (buffer->data_type == harp_type_string)
@@ -97,25 +110,26 @@ static void read_buffer_free_string_data(read_buffer *buffer)
     }
 }
 
-static void read_buffer_delete(read_buffer *buffer)
+static void read_buffer_delete(harp_memory_pool *pool, read_buffer *buffer)
 {
     if (buffer != NULL)
     {
         if (buffer->data.ptr != NULL)
         {
             read_buffer_free_string_data(buffer);
-            free(buffer->data.ptr);
+            harp_memory_pool_free(pool, buffer->data.ptr);
         }
 
-        free(buffer);
+        harp_memory_pool_free(pool, buffer);
     }
 }
 
-static int read_buffer_new(harp_data_type data_type, long num_elements, read_buffer **new_buffer)
+static int read_buffer_new(harp_memory_pool *pool, harp_data_type data_type, long num_elements,
+                           read_buffer **new_buffer)
 {
     read_buffer *buffer;
 
-    buffer = (read_buffer *)malloc(sizeof(read_buffer));
+    buffer = (read_buffer *)harp_memory_pool_malloc(pool, sizeof(read_buffer));
     if (buffer == NULL)
     {
         return -1;
@@ -128,12 +142,10 @@ static int read_buffer_new(harp_data_type data_type, long num_elements, read_buf
 
     if (buffer->buffer_size > 0)
     {
-        buffer->data.ptr = malloc(buffer->buffer_size);
+        buffer->data.ptr = harp_memory_pool_malloc(pool, buffer->buffer_size);
         if (buffer->data.ptr == NULL)
         {
-            read_buffer_delete(buffer);
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           buffer->buffer_size, __FILE__, __LINE__);
+            read_buffer_delete(pool, buffer);
             return -1;
         }
 
@@ -144,7 +156,8 @@ static int read_buffer_new(harp_data_type data_type, long num_elements, read_buf
     return 0;
 }
 
-static int read_buffer_resize(read_buffer *buffer, harp_data_type data_type, long num_elements)
+static int read_buffer_resize(harp_memory_pool *pool, read_buffer *buffer, harp_data_type data_type,
+                              long num_elements)
 {
     size_t new_buffer_size = num_elements * harp_get_size_for_type(data_type);
 
@@ -152,11 +165,9 @@ static int read_buffer_resize(read_buffer *buffer, harp_data_type data_type, lon
     {
         void *ptr;
 
-        ptr = realloc(buffer->data.ptr, new_buffer_size);
+        ptr = harp_memory_pool_realloc(pool, buffer->data.ptr, new_buffer_size);
         if (ptr == NULL)
         {
-            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           new_buffer_size, __FILE__, __LINE__);
             return -1;
         }
         buffer->data.ptr = ptr;
@@ -197,7 +208,10 @@ static void ingestion_done(ingest_info *info)
 
         harp_product_delete(info->product);
 
-        read_buffer_delete(info->block_buffer);
+        read_buffer_delete(info->pool, info->block_buffer);
+
+        /* release all temporary buffers of the ingestion in one go */
+        harp_memory_pool_delete(info->pool);
 
         free(info);
     }
@@ -223,16 +237,25 @@ static int ingestion_init(ingest_info **new_info)
     info->dimension_mask_set = NULL;
     info->product_mask = 1;
     info->variable_mask = NULL;
+    info->filename = NULL;
     info->basename = NULL;
+    info->option_list = NULL;
     info->product = NULL;
+    info->pool = NULL;
     info->block_buffer = NULL;
     info->block_buffer_read_all = NULL;
+    info->block_buffer_read_range = NULL;
 
     if (harp_dimension_mask_set_new(&info->dimension_mask_set) != 0)
     {
         ingestion_done(info);
         return -1;
     }
+    if (harp_memory_pool_new(&info->pool) != 0)
+    {
+        ingestion_done(info);
+        return -1;
+    }
 
     *new_info = info;
     return 0;
@@ -331,14 +354,14 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
 
             if (info->block_buffer == NULL)
             {
-                if (read_buffer_new(variable_def->data_type, num_elements, &info->block_buffer) != 0)
+                if (read_buffer_new(info->pool, variable_def->data_type, num_elements, &info->block_buffer) != 0)
                 {
                     return -1;
                 }
             }
             else
             {
-                if (read_buffer_resize(info->block_buffer, variable_def->data_type, num_elements) != 0)
+                if (read_buffer_resize(info->pool, info->block_buffer, variable_def->data_type, num_elements) != 0)
                 {
                     return -1;
                 }
@@ -388,15 +411,15 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
 
             if (info->block_buffer == NULL)
             {
-                if (read_buffer_new(variable_def->data_type, info->block_buffer_num_blocks * num_block_elements,
-                                    &info->block_buffer) != 0)
+                if (read_buffer_new(info->pool, variable_def->data_type,
+                                    info->block_buffer_num_blocks * num_block_elements, &info->block_buffer) != 0)
                 {
                     return -1;
                 }
             }
             else
             {
-                if (read_buffer_resize(info->block_buffer, variable_def->data_type,
+                if (read_buffer_resize(info->pool, info->block_buffer, variable_def->data_type,
                                        info->block_buffer_num_blocks * num_block_elements) != 0)
                 {
                     return -1;
@@ -437,8 +460,160 @@ static int read_block(ingest_info *info, const harp_variable_definition *variabl
     return 0;
 }
 
-static int get_variable(ingest_info *info, const harp_variable_definition *variable_def,
-                        const harp_dimension_mask_set *dimension_mask_set, harp_variable **new_variable)
+static long get_max_range_length(ingest_info *info, const harp_variable_definition *variable_def, long num_blocks)
+{
+    long max_range_length;
+
+    assert(variable_def->get_optimal_range_length != NULL);
+    max_range_length = variable_def->get_optimal_range_length(info->user_data);
+    if (max_range_length > num_blocks)
+    {
+        max_range_length = num_blocks;
+    }
+    if (max_range_length < 1)
+    {
+        max_range_length = 1;
+    }
+
+    return max_range_length;
+}
+
+/* Find the next range of blocks that needs to be read for the given mask, starting the search at *range_offset.
+ * Surviving blocks that are separated by at most harp_option_ingestion_max_range_gap masked out blocks are combined
+ * into a single range. A range will never be longer than max_range_length blocks.
+ * A mask of NULL means that all blocks survive.
+ * Returns 1 if a range was found, or 0 if there are no more surviving blocks.
+ */
+static int get_next_masked_range(const uint8_t *mask, long num_blocks, long max_range_length, long *range_offset,
+                                 long *range_length)
+{
+    long offset = *range_offset;
+    long end;
+    long i;
+
+    if (mask != NULL)
+    {
+        while (offset < num_blocks && !mask[offset])
+        {
+            offset++;
+        }
+    }
+    if (offset >= num_blocks)
+    {
+        return 0;
+    }
+
+    if (mask == NULL)
+    {
+        end = offset + max_range_length;
+        if (end > num_blocks)
+        {
+            end = num_blocks;
+        }
+    }
+    else
+    {
+        end = offset + 1;
+        for (i = end; i < num_blocks && i - offset < max_range_length; i++)
+        {
+            if (mask[i])
+            {
+                end = i + 1;
+            }
+            else if (i - end >= harp_option_ingestion_max_range_gap)
+            {
+                /* the gap of masked out blocks has become too large */
+                break;
+            }
+        }
+    }
+
+    *range_offset = offset;
+    *range_length = end - offset;
+
+    return 1;
+}
+
+/* Read the blocks of a variable for which the mask is set into consecutive blocks of 'data' using one read_range()
+ * call per range of surviving blocks. Ranges in which all blocks survive are read directly into 'data'.
+ */
+static int read_masked_ranges(ingest_info *info, const harp_variable_definition *variable_def, long num_blocks,
+                              long num_block_elements, const uint8_t *mask, harp_array data)
+{
+    read_buffer *buffer = NULL;
+    long block_size;
+    long max_range_length;
+    long range_offset = 0;
+    long range_length;
+    long i;
+
+    assert(variable_def->read_range != NULL);
+    block_size = harp_get_size_for_type(variable_def->data_type) * num_block_elements;
+    max_range_length = get_max_range_length(info, variable_def, num_blocks);
+
+    while (get_next_masked_range(mask, num_blocks, max_range_length, &range_offset, &range_length))
+    {
+        long num_surviving = 0;
+
+        for (i = range_offset; i < range_offset + range_length; i++)
+        {
+            if (mask[i])
+            {
+                num_surviving++;
+            }
+        }
+
+        if (num_surviving == range_length)
+        {
+            if (variable_def->read_range(info->user_data, range_offset, range_length, data) != 0)
+            {
+                read_buffer_delete(info->pool, buffer);
+                return -1;
+            }
+            data.ptr = (void *)(((char *)data.ptr) + range_length * block_size);
+        }
+        else
+        {
+            /* the range contains masked out blocks, so read via an intermediate buffer */
+            if (buffer == NULL)
+            {
+                if (read_buffer_new(info->pool, variable_def->data_type, max_range_length * num_block_elements,
+                                    &buffer) != 0)
+                {
+                    return -1;
+                }
+            }
+            if (variable_def->read_range(info->user_data, range_offset, range_length, buffer->data) != 0)
+            {
+                read_buffer_delete(info->pool, buffer);
+                return -1;
+            }
+            for (i = 0; i < range_length; i++)
+            {
+                if (mask[range_offset + i])
+                {
+                    memcpy(data.ptr, &buffer->data.int8_data[i * block_size], block_size);
+                    if (variable_def->data_type == harp_type_string)
+                    {
+                        /* ownership of the strings has been transferred to 'data' */
+                        memset(&buffer->data.int8_data[i * block_size], 0, block_size);
+                    }
+                    data.ptr = (void *)(((char *)data.ptr) + block_size);
+                }
+            }
+            read_buffer_free_string_data(buffer);
+        }
+
+        range_offset += range_length;
+    }
+
+    read_buffer_delete(info->pool, buffer);
+
+    return 0;
+}
+
+static int read_variable(ingest_info *info, const harp_variable_definition *variable_def,
+                         const harp_dimension_mask_set *dimension_mask_set, harp_variable **new_variable)
 {
     harp_variable *variable;
 
@@ -554,14 +729,14 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
 
             /* we read the whole non-time-dependent variable data once (in full) and then filter for each sample */
             num_buffer_elements = harp_get_num_elements(num_dimensions - 1, &dimension[1]);
-            if (read_buffer_new(variable->data_type, num_buffer_elements, &buffer) != 0)
+            if (read_buffer_new(info->pool, variable->data_type, num_buffer_elements, &buffer) != 0)
             {
                 harp_variable_delete(variable);
                 return -1;
             }
             if (read_all(info, variable_def, buffer->data) != 0)
             {
-                read_buffer_delete(buffer);
+                read_buffer_delete(info->pool, buffer);
                 harp_variable_delete(variable);
                 return -1;
             }
@@ -595,8 +770,8 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
             {
                 if (dimension_mask[0] == NULL || dimension_mask[0]->mask[i])
                 {
-                    harp_array_filter(variable->data_type, num_dimensions - 1, &dimension[1], &mask[1], buffer->data,
-                                      &masked_dimension[1], block);
+                    harp_array_filter(variable->data_type, NULL, num_dimensions - 1, &dimension[1], &mask[1],
+                                      buffer->data, &masked_dimension[1], block);
 
                     block.ptr = (void *)(((char *)block.ptr) + block_stride);
                 }
@@ -610,7 +785,7 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                 }
             }
 
-            read_buffer_delete(buffer);
+            read_buffer_delete(info->pool, buffer);
         }
         else
         {
@@ -635,10 +810,17 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                     const uint8_t *mask[HARP_MAX_NUM_DIMS];
                     long mask_stride[HARP_MAX_NUM_DIMS - 1];
                     long num_buffer_elements;
+                    long max_range_length = 1;
                     read_buffer *buffer;
 
                     num_buffer_elements = harp_get_num_elements(variable_def->num_dimensions - 1, &dimension[1]);
-                    if (read_buffer_new(variable->data_type, num_buffer_elements, &buffer) != 0)
+                    if (variable_def->read_range != NULL)
+                    {
+                        /* the buffer will hold a range of blocks */
+                        max_range_length = get_max_range_length(info, variable_def, dimension[0]);
+                    }
+                    if (read_buffer_new(info->pool, variable->data_type, max_range_length * num_buffer_elements,
+                                        &buffer) != 0)
                     {
                         harp_variable_delete(variable);
                         return -1;
@@ -666,51 +848,112 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
                         }
                     }
 
-                    for (i = 0; i < dimension[0]; i++)
+                    if (variable_def->read_range != NULL)
                     {
-                        if (mask[0] == NULL || mask[0][i])
+                        const uint8_t *block_mask[HARP_MAX_NUM_DIMS];
+                        long range_offset = 0;
+                        long range_length;
+
+                        block_mask[0] = NULL;
+                        while (get_next_masked_range(mask[0], dimension[0], max_range_length, &range_offset,
+                                                     &range_length))
                         {
-                            if (read_block(info, variable_def, i, buffer->data) != 0)
+                            harp_array buffer_block;
+
+                            if (variable_def->read_range(info->user_data, range_offset, range_length,
+                                                         buffer->data) != 0)
                             {
-                                read_buffer_delete(buffer);
+                                read_buffer_delete(info->pool, buffer);
                                 harp_variable_delete(variable);
                                 return -1;
                             }
 
-                            harp_array_filter(variable->data_type, variable_def->num_dimensions - 1, &dimension[1],
-                                              &mask[1], buffer->data, &masked_dimension[1], block);
+                            buffer_block = buffer->data;
+                            for (i = range_offset; i < range_offset + range_length; i++)
+                            {
+                                if (mask[0] == NULL || mask[0][i])
+                                {
+                                    for (j = 1; j < variable->num_dimensions; j++)
+                                    {
+                                        block_mask[j] = mask[j] == NULL ? NULL : mask[j] + i * mask_stride[j];
+                                    }
+                                    harp_array_filter(variable->data_type, NULL, variable_def->num_dimensions - 1,
+                                                      &dimension[1], &block_mask[1], buffer_block,
+                                                      &masked_dimension[1], block);
+
+                                    block.ptr = (void *)(((char *)block.ptr) + block_stride);
+                                }
+                                buffer_block.ptr = (void *)(((char *)buffer_block.ptr) + num_buffer_elements *
+                                                            harp_get_size_for_type(variable->data_type));
+                            }
                             read_buffer_free_string_data(buffer);
 
-                            block.ptr = (void *)(((char *)block.ptr) + block_stride);
+                            range_offset += range_length;
                         }
-
-                        for (j = 1; j < variable->num_dimensions; j++)
+                    }
+                    else
+                    {
+                        for (i = 0; i < dimension[0]; i++)
                         {
-                            if (mask[j] != NULL)
+                            if (mask[0] == NULL || mask[0][i])
+                            {
+                                if (read_block(info, variable_def, i, buffer->data) != 0)
+                                {
+                                    read_buffer_delete(info->pool, buffer);
+                                    harp_variable_delete(variable);
+                                    return -1;
+                                }
+
+                                harp_array_filter(variable->data_type, NULL, variable_def->num_dimensions - 1,
+                                                  &dimension[1], &mask[1], buffer->data, &masked_dimension[1],
+                                                  block);
+                                read_buffer_free_string_data(buffer);
+
+                                block.ptr = (void *)(((char *)block.ptr) + block_stride);
+                            }
+
+                            for (j = 1; j < variable->num_dimensions; j++)
                             {
-                                mask[j] += mask_stride[j];
+                                if (mask[j] != NULL)
+                                {
+                                    mask[j] += mask_stride[j];
+                                }
                             }
                         }
                     }
 
-                    read_buffer_delete(buffer);
+                    read_buffer_delete(info->pool, buffer);
                 }
                 else
                 {
                     /* we can read directly into the variable */
                     assert(dimension_mask[0] != NULL);
-                    for (i = 0; i < dimension[0]; i++)
+                    if (variable_def->read_range != NULL)
                     {
-                        if (!dimension_mask[0]->mask[i])
-                        {
-                            continue;
-                        }
-                        if (read_block(info, variable_def, i, block) != 0)
+                        /* read each range of surviving samples with a single read_range() call */
+                        if (read_masked_ranges(info, variable_def, dimension[0],
+                                               harp_get_num_elements(variable_def->num_dimensions - 1, &dimension[1]),
+                                               dimension_mask[0]->mask, block) != 0)
                         {
                             harp_variable_delete(variable);
                             return -1;
                         }
-                        block.ptr = (void *)(((char *)block.ptr) + block_stride);
+                    }
+                    else
+                    {
+                        for (i = 0; i < dimension[0]; i++)
+                        {
+                            if (!dimension_mask[0]->mask[i])
+                            {
+                                continue;
+                            }
+                            if (read_block(info, variable_def, i, block) != 0)
+                            {
+                                harp_variable_delete(variable);
+                                return -1;
+                            }
+                            block.ptr = (void *)(((char *)block.ptr) + block_stride);
+                        }
                     }
                 }
             }
@@ -767,6 +1010,39 @@ static int get_variable(ingest_info *info, const harp_variable_definition *varia
     return 0;
 }
 
+static int get_variable(ingest_info *info, const harp_variable_definition *variable_def,
+                        const harp_dimension_mask_set *dimension_mask_set, harp_variable **new_variable)
+{
+    harp_memory_pool *previous_pool = current_pool;
+    int result;
+
+    current_pool = info->pool;
+    result = read_variable(info, variable_def, dimension_mask_set, new_variable);
+    current_pool = previous_pool;
+
+    return result;
+}
+
+/* read a variable that will be added to the ingested product; only these reads are included in the profiling results
+ * (and not the reads of e.g. the latitude/longitude variables that are needed for area masks) */
+static int get_product_variable(ingest_info *info, const harp_variable_definition *variable_def,
+                                const harp_dimension_mask_set *dimension_mask_set, harp_variable **new_variable)
+{
+    harp_profile_timer timer;
+    size_t pool_bytes = harp_memory_pool_get_total_bytes(info->pool);
+
+    harp_profile_timer_start(&timer);
+    if (get_variable(info, variable_def, dimension_mask_set, new_variable) != 0)
+    {
+        return -1;
+    }
+    /* each thread has its own pool, so the difference only contains the read buffers of this variable */
+    harp_profile_timer_stop_variable(&timer, "ingestion", *new_variable,
+                                     (double)(harp_memory_pool_get_total_bytes(info->pool) - pool_bytes));
+
+    return 0;
+}
+
 static int find_variable_definition(ingest_info *info, const char *name, harp_variable_definition **variable_def)
 {
     int index;
@@ -946,14 +1222,14 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
 
     if (variable_def->num_dimensions == 0)
     {
-        if (read_buffer_new(variable_def->data_type, 1, &buffer) != 0)
+        if (read_buffer_new(info->pool, variable_def->data_type, 1, &buffer) != 0)
         {
             return -1;
         }
 
         if (read_block(info, variable_def, 0, buffer->data) != 0)
         {
-            read_buffer_delete(buffer);
+            read_buffer_delete(info->pool, buffer);
             return -1;
         }
 
@@ -978,13 +1254,13 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
             if (result < 0)
             {
-                read_buffer_delete(buffer);
+                read_buffer_delete(info->pool, buffer);
                 return -1;
             }
             info->product_mask = result;
         }
 
-        read_buffer_delete(buffer);
+        read_buffer_delete(info->pool, buffer);
     }
     else if (variable_def->num_dimensions == 1 && variable_def->dimension_type[0] != harp_dimension_independent)
     {
@@ -1013,7 +1289,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
         }
 
-        if (read_buffer_new(variable_def->data_type, 1, &buffer) != 0)
+        if (read_buffer_new(info->pool, variable_def->data_type, 1, &buffer) != 0)
         {
             if (info->dimension_mask_set[dimension_type]->num_dimensions == 2)
             {
@@ -1032,7 +1308,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
                     {
                         harp_dimension_mask_delete(dimension_mask);
                     }
-                    read_buffer_delete(buffer);
+                    read_buffer_delete(info->pool, buffer);
                     return -1;
                 }
 
@@ -1065,7 +1341,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
                             {
                                 harp_dimension_mask_delete(dimension_mask);
                             }
-                            read_buffer_delete(buffer);
+                            read_buffer_delete(info->pool, buffer);
                             return -1;
                         }
                         dimension_mask->mask[i] = result;
@@ -1078,7 +1354,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
         }
 
-        read_buffer_delete(buffer);
+        read_buffer_delete(info->pool, buffer);
 
         if (info->dimension_mask_set[dimension_type]->num_dimensions == 2)
         {
@@ -1136,7 +1412,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
         }
         dimension_mask = info->dimension_mask_set[dimension_type];
 
-        if (read_buffer_new(variable_def->data_type, info->dimension[dimension_type], &buffer) != 0)
+        if (read_buffer_new(info->pool, variable_def->data_type, info->dimension[dimension_type], &buffer) != 0)
         {
             return -1;
         }
@@ -1150,7 +1426,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
 
                 if (read_block(info, variable_def, i, buffer->data) != 0)
                 {
-                    read_buffer_delete(buffer);
+                    read_buffer_delete(info->pool, buffer);
                     return -1;
                 }
 
@@ -1184,7 +1460,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
                                 }
                                 if (result < 0)
                                 {
-                                    read_buffer_delete(buffer);
+                                    read_buffer_delete(info->pool, buffer);
                                     return -1;
                                 }
                                 dimension_mask->mask[index] = result;
@@ -1216,7 +1492,7 @@ static int execute_value_filter(ingest_info *info, harp_program *program)
             }
         }
 
-        read_buffer_delete(buffer);
+        read_buffer_delete(info->pool, buffer);
     }
     else
     {
@@ -1400,42 +1676,54 @@ static int execute_point_filter(ingest_info *info, harp_program *program)
 
     mask = info->dimension_mask_set[harp_dimension_time]->mask;
 
-    for (i = 0; i < num_points; i++)
+    for (k = 0; k < num_operations; k++)
     {
-        if (mask[i])
+        harp_operation_point_filter *operation;
+
+        operation = (harp_operation_point_filter *)program->operation[program->current_index + k];
+        if (operation->type == operation_point_distance_filter)
         {
-            harp_spherical_point point;
+            harp_operation_point_distance_filter *distance_filter = (harp_operation_point_distance_filter *)operation;
 
-            point.lat = latitude->data.double_data[i];
-            point.lon = longitude->data.double_data[i];
-            harp_spherical_point_rad_from_deg(&point);
-            harp_spherical_point_check(&point);
+            /* evaluate the distance filter for all points at once */
+            harp_spherical_point_distance_filter(&distance_filter->point,
+                                                 distance_filter->distance / CONST_EARTH_RADIUS_WGS84_SPHERE,
+                                                 num_points, latitude->data.double_data,
+                                                 longitude->data.double_data, mask);
+            continue;
+        }
 
-            for (k = 0; k < num_operations; k++)
+        for (i = 0; i < num_points; i++)
+        {
+            if (mask[i])
             {
-                if (mask[i])
-                {
-                    harp_operation_point_filter *operation;
-                    int result;
+                harp_spherical_point point;
+                int result;
 
-                    operation = (harp_operation_point_filter *)program->operation[program->current_index + k];
-                    result = operation->eval(operation, &point);
-                    if (result < 0)
-                    {
-                        harp_variable_delete(latitude);
-                        harp_variable_delete(longitude);
-                        return -1;
-                    }
-                    mask[i] = result;
+                point.lat = latitude->data.double_data[i];
+                point.lon = longitude->data.double_data[i];
+                harp_spherical_point_rad_from_deg(&point);
+                harp_spherical_point_check(&point);
+
+                result = operation->eval(operation, &point);
+                if (result < 0)
+                {
+                    harp_variable_delete(latitude);
+                    harp_variable_delete(longitude);
+                    return -1;
                 }
-            }
-            if (!mask[i])
-            {
-                info->dimension_mask_set[harp_dimension_time]->masked_dimension_length--;
+                mask[i] = result;
             }
         }
     }
 
+    if (harp_dimension_mask_update_masked_length(info->dimension_mask_set[harp_dimension_time]) != 0)
+    {
+        harp_variable_delete(latitude);
+        harp_variable_delete(longitude);
+        return -1;
+    }
+
     if (dimension_mask_set_has_empty_masks(info->dimension_mask_set))
     {
         info->product_mask = 0;
@@ -1782,6 +2070,7 @@ static int evaluate_ingestion_mask(ingest_info *info, harp_program *program)
             case operation_bin_collocated:
             case operation_bin_full:
             case operation_bin_spatial:
+            case operation_bin_spatial_with_weights:
             case operation_bin_with_variables:
             case operation_clamp:
             case operation_derive_variable:
@@ -1813,12 +2102,283 @@ static int evaluate_ingestion_mask(ingest_info *info, harp_program *program)
     return 0;
 }
 
-/* Ingest a product while taking into account filter operations at the head of program.
+/* Returns the memory pool of the ingestion for which a variable is being read on the calling thread (or NULL if no
+ * variable is being read). Ingestion modules can use this pool for temporary buffers of their read functions. Memory
+ * that is not freed explicitly is released at the end of the ingestion (after the ingestion_done of the module).
  */
-static int get_product(ingest_info *info, harp_program *program)
+harp_memory_pool *harp_ingestion_get_memory_pool(void)
+{
+    return current_pool;
+}
+
+/* Returns 1 if data can be read from 'product' (and from other handles to the same file) by multiple threads at the
+ * same time, 0 otherwise. This requires HARP to be built with OpenMP and the CODA library to be built thread-safe
+ * (HARP_CODA_THREADSAFE). Since CODA reads HDF4 and HDF5 products using the HDF4/HDF5 libraries, reading these formats
+ * in parallel additionally requires a thread-safe build of the HDF5 library (HDF4 is never thread-safe).
+ */
+int harp_ingestion_is_thread_safe(coda_product *product)
+{
+#if defined(_OPENMP) && defined(HARP_CODA_THREADSAFE)
+    coda_format format;
+
+    if (coda_get_product_format(product, &format) != 0)
+    {
+        return 0;
+    }
+    switch (format)
+    {
+        case coda_format_hdf4:
+            return 0;
+        case coda_format_hdf5:
+#ifdef HAVE_HDF5
+            return harp_hdf5_is_thread_safe();
+#else
+            return 0;
+#endif
+        default:
+            break;
+    }
+
+    return 1;
+#else
+    (void)product;
+
+    return 0;
+#endif
+}
+
+#ifdef _OPENMP
+/* Create an additional ingestion for the product of 'info', with its own CODA product handle and ingestion module
+ * state, such that variables can be read from it in parallel to the reading of variables from 'info'.
+ */
+static int ingestion_worker_init(ingest_info *info, ingest_info **new_worker)
+{
+    ingest_info *worker;
+
+    assert(info->filename != NULL);
+
+    if (ingestion_init(&worker) != 0)
+    {
+        return -1;
+    }
+    worker->module = info->module;
+    worker->filename = info->filename;
+    worker->basename = info->basename;
+    worker->option_list = info->option_list;
+
+    if (coda_open(info->filename, &worker->cproduct) != 0)
+    {
+        harp_set_error(HARP_ERROR_CODA, NULL);
+        ingestion_done(worker);
+        return -1;
+    }
+    if (worker->module->ingestion_init(worker->module, worker->cproduct, worker->option_list,
+                                       &worker->product_definition, &worker->user_data) != 0)
+    {
+        ingestion_done(worker);
+        return -1;
+    }
+    if (init_product_dimensions(worker) != 0)
+    {
+        ingestion_done(worker);
+        return -1;
+    }
+    if (worker->product_definition != info->product_definition ||
+        memcmp(worker->dimension, info->dimension, HARP_NUM_DIM_TYPES * sizeof(long)) != 0)
+    {
+        harp_set_error(HARP_ERROR_INGESTION, "product '%s' could not be opened consistently for multi-threaded "
+                       "ingestion", info->basename);
+        ingestion_done(worker);
+        return -1;
+    }
+
+    *new_worker = worker;
+    return 0;
+}
+
+/* Read the included variables using 'num_threads' threads, where each thread reads whole variables using its own
+ * CODA product handle. Variables are added to the product in the order of the product definition, so the result is
+ * identical to that of reading the variables one after another.
+ */
+static int read_variables_parallel(ingest_info *info, int num_threads, int num_variables)
+{
+    ingest_info **worker = NULL;
+    harp_variable **variable = NULL;
+    harp_thread_error *thread_error = NULL;
+    int *variable_index = NULL;
+    int result = -1;
+    int i, k;
+
+    worker = malloc(num_threads * sizeof(ingest_info *));
+    variable = malloc(num_variables * sizeof(harp_variable *));
+    variable_index = malloc(num_variables * sizeof(int));
+    thread_error = malloc(num_variables * sizeof(harp_thread_error));
+    if (worker == NULL || variable == NULL || variable_index == NULL || thread_error == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_threads * sizeof(ingest_info *) + num_variables * (sizeof(harp_variable *) + sizeof(int) +
+                                                                               sizeof(harp_thread_error)),
+                       __FILE__, __LINE__);
+        goto cleanup;
+    }
+    for (i = 0; i < num_threads; i++)
+    {
+        worker[i] = NULL;
+    }
+    k = 0;
+    for (i = 0; i < info->product_definition->num_variable_definitions; i++)
+    {
+        if (info->variable_mask[i])
+        {
+            variable_index[k] = i;
+            variable[k] = NULL;
+            k++;
+        }
+    }
+    assert(k == num_variables);
+
+    /* the first thread reads using the main ingestion, the other threads each get their own */
+    for (i = 1; i < num_threads; i++)
+    {
+        if (ingestion_worker_init(info, &worker[i]) != 0)
+        {
+            goto cleanup;
+        }
+    }
+
+    /* errors are collected per variable and raised from this (the calling) thread after the parallel region */
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+    for (k = 0; k < num_variables; k++)
+    {
+        int thread_num = omp_get_thread_num();
+        ingest_info *thread_info = (thread_num == 0 ? info : worker[thread_num]);
+
+        harp_thread_error_begin();
+        if (get_product_variable(thread_info, info->product_definition->variable_definition[variable_index[k]],
+                                 info->dimension_mask_set, &variable[k]) != 0)
+        {
+            variable[k] = NULL;
+        }
+        harp_thread_error_end(&thread_error[k]);
+        if (variable[k] == NULL && thread_error[k].err == HARP_SUCCESS)
+        {
+            /* make sure the failure is reported even if no error was set */
+            thread_error[k].err = HARP_ERROR_INGESTION;
+        }
+    }
+
+    /* report the error of the first failing variable, which is the error a single threaded ingestion would give */
+    for (k = 0; k < num_variables; k++)
+    {
+        if (variable[k] == NULL)
+        {
+            harp_thread_error_raise(&thread_error[k]);
+            goto cleanup;
+        }
+    }
+    for (k = 0; k < num_variables; k++)
+    {
+        if (harp_product_add_variable(info->product, variable[k]) != 0)
+        {
+            goto cleanup;
+        }
+        variable[k] = NULL;
+    }
+
+    result = 0;
+
+  cleanup:
+    if (variable != NULL)
+    {
+        for (k = 0; k < num_variables; k++)
+        {
+            harp_variable_delete(variable[k]);
+        }
+        free(variable);
+    }
+    if (worker != NULL)
+    {
+        for (i = 1; i < num_threads; i++)
+        {
+            if (worker[i] != NULL)
+            {
+                /* report the memory statistics of all threads as a single ingestion */
+                harp_memory_pool_merge_statistics(info->pool, worker[i]->pool);
+            }
+            ingestion_done(worker[i]);
+        }
+        free(worker);
+    }
+    if (variable_index != NULL)
+    {
+        free(variable_index);
+    }
+    if (thread_error != NULL)
+    {
+        free(thread_error);
+    }
+
+    return result;
+}
+#endif
+
+static int read_variables(ingest_info *info)
 {
+    int num_variables = 0;
     int i;
 
+    for (i = 0; i < info->product_definition->num_variable_definitions; i++)
+    {
+        if (info->variable_mask[i])
+        {
+            num_variables++;
+        }
+    }
+
+#ifdef _OPENMP
+    if (harp_option_ingestion_num_threads > 1 && num_variables > 1 && info->filename != NULL &&
+        harp_ingestion_is_thread_safe(info->cproduct))
+    {
+        int num_threads = harp_option_ingestion_num_threads;
+
+        if (num_threads > num_variables)
+        {
+            num_threads = num_variables;
+        }
+
+        return read_variables_parallel(info, num_threads, num_variables);
+    }
+#endif
+
+    for (i = 0; i < info->product_definition->num_variable_definitions; i++)
+    {
+        harp_variable *variable;
+
+        if (!info->variable_mask[i])
+        {
+            continue;
+        }
+
+        if (get_product_variable(info, info->product_definition->variable_definition[i], info->dimension_mask_set,
+                                 &variable) != 0)
+        {
+            return -1;
+        }
+
+        if (harp_product_add_variable(info->product, variable) != 0)
+        {
+            harp_variable_delete(variable);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Ingest a product while taking into account filter operations at the head of program.
+ */
+static int get_product(ingest_info *info, harp_program *program)
+{
     if (harp_product_new(&info->product) != 0)
     {
         return -1;
@@ -1866,26 +2426,9 @@ static int get_product(ingest_info *info, harp_program *program)
     }
 
     /* read all variables, applying dimension masks on the fly */
-    for (i = 0; i < info->product_definition->num_variable_definitions; i++)
+    if (read_variables(info) != 0)
     {
-        harp_variable *variable;
-
-        if (!info->variable_mask[i])
-        {
-            continue;
-        }
-
-        if (get_variable(info, info->product_definition->variable_definition[i], info->dimension_mask_set,
-                         &variable) != 0)
-        {
-            return -1;
-        }
-
-        if (harp_product_add_variable(info->product, variable) != 0)
-        {
-            harp_variable_delete(variable);
-            return -1;
-        }
+        return -1;
     }
 
     /* verify ingested product */
@@ -1930,7 +2473,9 @@ static int ingest(const char *filename, harp_program *program, const harp_ingest
     }
     assert(info->product_definition != NULL);
 
+    info->filename = filename;
     info->basename = harp_basename(filename);
+    info->option_list = option_list;
 
     /* ingest the product */
     if (get_product(info, program) != 0)
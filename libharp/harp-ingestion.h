@@ -33,6 +33,7 @@
 #define HARP_INGESTION_H
 
 #include "harp-internal.h"
+#include "harp-memory-pool.h"
 #include "coda.h"
 
 typedef struct harp_ingestion_option_struct
@@ -184,6 +185,10 @@ int harp_product_definition_get_variable_index(const harp_product_definition *pr
 /* Ingestion module. */
 int harp_ingestion_module_validate_options(harp_ingestion_module *module, const harp_ingestion_options *options);
 
+/* Multi-threaded ingestion. */
+int harp_ingestion_is_thread_safe(coda_product *product);
+harp_memory_pool *harp_ingestion_get_memory_pool(void);
+
 /* Module register. */
 int harp_ingestion_find_module(const char *filename, harp_ingestion_module **module, coda_product **product);
 harp_ingestion_module_register *harp_ingestion_get_module_register(void);
@@ -62,15 +62,75 @@
 /* maximum length for file paths */
 #define HARP_MAX_PATH_LENGTH 4096
 
+/* maximum length of error messages */
+#define HARP_MAX_ERROR_INFO_LENGTH 4096
+
 /* clamp function */
 #define HARP_CLAMP(var, min, max) if (var < min) var = min; if (var > max) var = max;
 
 extern int harp_option_enable_aux_afgl86;
 extern int harp_option_enable_aux_usstd76;
+extern int harp_option_hdf5_compression_filter;
+extern int harp_option_hdf5_shuffle;
+extern long harp_option_hdf5_chunk_size;
+extern int harp_option_netcdf_unlimited_time;
+extern long harp_option_ingestion_max_range_gap;
+extern int harp_option_ingestion_num_threads;
+extern long harp_option_ingestion_cache_size;
+extern int harp_option_profiling;
 
 typedef int (*harp_conversion_function) (harp_variable *variable, const harp_variable **source_variable);
 typedef int (*harp_conversion_enabled_function) (void);
 
+/* the load function reads the data into variable->data, which has already been allocated (and zero initialised) */
+typedef int (*harp_variable_load_function) (harp_variable *variable, void *user_data);
+typedef void (*harp_variable_loader_done_function) (void *user_data);
+
+/* deferred reader for the data of a variable of a lazily imported product (see harp_variable_ensure_loaded()) */
+struct harp_variable_loader_struct
+{
+    harp_variable_load_function load;
+    harp_variable_loader_done_function done;    /* releases user_data; called once the loader is no longer needed */
+    void *user_data;
+};
+
+/* internal state of a variable that is not part of the public harp_variable struct
+ * all variables are allocated as a harp_variable_internal (by harp_variable_new() and harp_variable_copy()), so any
+ * harp_variable pointer can be converted to a harp_variable_internal pointer using HARP_VARIABLE_INTERNAL()
+ */
+typedef struct harp_variable_internal_struct
+{
+    harp_variable variable;     /* needs to be the first field */
+    struct harp_variable_loader_struct *loader; /* deferred reader of 'data' (NULL if data is loaded) */
+    struct harp_string_arena_struct *string_arena;      /* shared storage for strings in 'data' (can be NULL) */
+    long num_allocated_elements;        /* number of elements 'data' has room for (0 if equal to num_elements) */
+} harp_variable_internal;
+
+#define HARP_VARIABLE_INTERNAL(var) ((harp_variable_internal *)(var))
+
+/* contiguous storage for the strings of a string variable (see harp_variable_pack_string_data())
+ * string_data elements of the variable may point into 'data' or may be individually allocated; strings in the arena
+ * are never modified or freed individually, so several elements can share the same arena string
+ * each distinct string value is only stored once: the arena acts as the dictionary for the variable and
+ * 'dictionary' maps each value to its index in 'value_offset'
+ */
+typedef struct harp_string_arena_struct
+{
+    char *data;
+    size_t size;        /* number of bytes in use */
+    size_t allocated_size;      /* number of bytes allocated for 'data' */
+    long num_values;    /* number of distinct strings in the arena */
+    size_t *value_offset;       /* offset in 'data' of each distinct string (in increasing order) */
+    struct hashtable_struct *dictionary;
+} harp_string_arena;
+
+/* error that was set from a worker thread (see harp_thread_error_begin()) */
+typedef struct harp_thread_error_struct
+{
+    int err;
+    char message[HARP_MAX_ERROR_INFO_LENGTH + 1];
+} harp_thread_error;
+
 typedef enum harp_collocation_filter_type_enum
 {
     harp_collocation_left,
@@ -153,10 +213,19 @@ void harp_hdf4_add_error_message(void);
 #endif
 #ifdef HAVE_HDF5
 void harp_hdf5_add_error_message(void);
+int harp_hdf5_is_thread_safe(void);
 #endif
 void harp_add_coda_cursor_path_to_error_message(const coda_cursor *cursor);
+void harp_thread_error_begin(void);
+void harp_thread_error_end(harp_thread_error *error);
+void harp_thread_error_raise(const harp_thread_error *error);
 
 /* Variables */
+int harp_variable_new_with_loader(const char *name, harp_data_type data_type, int num_dimensions,
+                                  const harp_dimension_type *dimension_type, const long *dimension,
+                                  harp_variable_load_function load, harp_variable_loader_done_function done,
+                                  void *user_data, harp_variable **new_variable);
+int harp_variable_grow_time_capacity(harp_variable *variable, long time_length);
 int harp_variable_get_flag_values_string(const harp_variable *variable, char **flag_values);
 int harp_variable_get_flag_meanings_string(const harp_variable *variable, char **flag_meanings);
 int harp_variable_set_enumeration_values_using_flag_meanings(harp_variable *variable, const char *flag_meanings);
@@ -165,6 +234,9 @@ int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dim
 int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, long num_dim_elements,
                                       const long *dim_element_ids);
 int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const uint8_t *mask);
+int harp_variable_set_string_data_from_char_array(harp_variable *variable, long string_length, const char *buffer);
+void harp_string_arena_free_string(const harp_string_arena *arena, char *str);
+long harp_string_arena_get_value_index(const harp_string_arena *arena, const char *str);
 int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long length);
 int harp_variable_remove_dimension(harp_variable *variable, int dim_index, long index);
 int harp_variable_squash_dimension(harp_variable *variable, int dim_index);
@@ -175,6 +247,7 @@ int harp_product_rearrange_dimension(harp_product *product, harp_dimension_type
 int harp_product_filter_by_index(harp_product *product, const char *index_variable, long num_elements, int32_t *index);
 int harp_product_filter_dimension(harp_product *product, harp_dimension_type dimension_type, const uint8_t *mask);
 int harp_product_remove_dimension(harp_product *product, harp_dimension_type dimension_type);
+int harp_product_resize_dimension(harp_product *product, harp_dimension_type dimension_type, long length);
 void harp_product_remove_all_variables(harp_product *product);
 int harp_product_get_datetime_range(const harp_product *product, double *datetime_start, double *datetime_stop);
 int harp_product_get_derived_bounds_for_grid(harp_product *product, harp_variable *grid, harp_variable **bounds);
@@ -182,6 +255,7 @@ int harp_product_get_storage_size(const harp_product *product, int with_attribut
 int harp_product_bin_full(harp_product *product);
 int harp_product_bin_spatial_full(harp_product *product, long num_latitude_edges, double *latitude_edges,
                                   long num_longitude_edges, double *longitude_edges);
+int harp_product_bin_spatial_with_weights_full(harp_product *product, const harp_product *weights);
 int harp_product_bin_with_collocated_dataset(harp_product *product, harp_collocation_result *collocation_result);
 int harp_product_bin_with_variable(harp_product *product, int num_variables, const char **variable_name);
 int harp_product_clamp_dimension(harp_product *product, harp_dimension_type dimension_type,
@@ -193,9 +267,10 @@ int harp_product_clamp_dimension(harp_product *product, harp_dimension_type dime
 int harp_import_hdf4(const char *filename, harp_product **product);
 #endif
 #ifdef HAVE_HDF5
-int harp_import_hdf5(const char *filename, harp_product **product);
+int harp_import_hdf5(const char *filename, int lazy, harp_product **product);
+int harp_import_hdf5_time_subset(const char *filename, long num_indices, const long *index, harp_product **product);
 #endif
-int harp_import_netcdf(const char *filename, harp_product **product);
+int harp_import_netcdf(const char *filename, int lazy, harp_product **product);
 
 #ifdef HAVE_HDF4
 int harp_export_hdf4(const char *filename, const harp_product *product);
@@ -203,7 +278,8 @@ int harp_export_hdf4(const char *filename, const harp_product *product);
 #ifdef HAVE_HDF5
 int harp_export_hdf5(const char *filename, const harp_product *product);
 #endif
-int harp_export_netcdf(const char *filename, const harp_product *product);
+int harp_export_netcdf(const char *filename, int unlimited_time, const harp_product *product);
+int harp_export_append_netcdf(const char *filename, const harp_product *product);
 
 #ifdef HAVE_HDF4
 int harp_import_metadata_hdf4(const char *filename, harp_product_metadata *metadata);
@@ -219,6 +295,23 @@ int harp_ingest(const char *filename, const char *operations, const char *option
 int harp_ingest_test(const char *filename, int (*print) (const char *, ...));
 int harp_ingest_metadata(const char *filename, const char *options, harp_product_metadata *metadata);
 void harp_ingestion_done(void);
+int harp_ingest_cached(const char *filename, const char *operations, const char *options, int lazy,
+                       harp_product **product);
+int harp_ingestion_cache_init(void);
+
+/* Profiling */
+typedef struct harp_profile_timer_struct
+{
+    int active;
+    double wall_time;
+    double cpu_time;
+} harp_profile_timer;
+
+void harp_profile_timer_start(harp_profile_timer *timer);
+void harp_profile_timer_stop_variable(const harp_profile_timer *timer, const char *category,
+                                      const harp_variable *variable, double num_pool_bytes);
+void harp_profile_timer_stop_product(const harp_profile_timer *timer, const char *category, const char *name,
+                                     const harp_product *product);
 
 /* Units */
 typedef struct harp_unit_converter_struct harp_unit_converter;
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2015-2020 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+#include "harp-memory-pool.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the smallest block handed out by a pool is 2^MIN_SIZE_CLASS bytes */
+#define MIN_SIZE_CLASS 6
+/* blocks of more than 2^MAX_SIZE_CLASS bytes are allocated with their exact size and are not reused
+ * (rounding these up to a power of two could almost double the memory use of large buffers) */
+#define MAX_SIZE_CLASS 20
+#define LARGE_SIZE_CLASS (MAX_SIZE_CLASS + 1)
+
+typedef union memory_block_union
+{
+    struct
+    {
+        union memory_block_union *prev_block;   /* previous block in the list of all blocks of the pool */
+        union memory_block_union *next_block;   /* next block in the list of all blocks of the pool */
+        union memory_block_union *next_free;    /* next block in the free list of the size class */
+        size_t size;    /* the block has room for 'size' bytes (excluding this header) */
+        int size_class; /* size == 2^size_class, or LARGE_SIZE_CLASS for blocks that are allocated exactly */
+    } info;
+    /* make sure that the memory following the header is aligned for any type */
+    long double align_long_double;
+    double align_double;
+    void *align_ptr;
+} memory_block;
+
+struct harp_memory_pool_struct
+{
+    memory_block *block;        /* list of all blocks that were allocated by the pool */
+    memory_block *free_block[MAX_SIZE_CLASS + 1];       /* free list for each size class */
+    size_t bytes_in_use;        /* size of all blocks that are currently handed out */
+    size_t peak_bytes;  /* maximum value that 'bytes_in_use' has had */
+    size_t total_bytes; /* sum of the sizes of all blocks that were handed out */
+    int report_statistics;      /* whether to pass the statistics to the statistics handler on deletion */
+};
+
+static void (*harp_memory_statistics_handler) (size_t peak_bytes, size_t total_bytes) = NULL;
+
+static int get_size_class(size_t size)
+{
+    int size_class = MIN_SIZE_CLASS;
+
+    if (size > ((size_t)1 << MAX_SIZE_CLASS))
+    {
+        return LARGE_SIZE_CLASS;
+    }
+    while (((size_t)1 << size_class) < size)
+    {
+        size_class++;
+    }
+
+    return size_class;
+}
+
+static void add_block(harp_memory_pool *pool, memory_block *block)
+{
+    block->info.prev_block = NULL;
+    block->info.next_block = pool->block;
+    if (pool->block != NULL)
+    {
+        pool->block->info.prev_block = block;
+    }
+    pool->block = block;
+}
+
+static void remove_block(harp_memory_pool *pool, memory_block *block)
+{
+    if (block->info.prev_block != NULL)
+    {
+        block->info.prev_block->info.next_block = block->info.next_block;
+    }
+    else
+    {
+        pool->block = block->info.next_block;
+    }
+    if (block->info.next_block != NULL)
+    {
+        block->info.next_block->info.prev_block = block->info.prev_block;
+    }
+}
+
+static void add_bytes_in_use(harp_memory_pool *pool, size_t size)
+{
+    pool->bytes_in_use += size;
+    if (pool->bytes_in_use > pool->peak_bytes)
+    {
+        pool->peak_bytes = pool->bytes_in_use;
+    }
+    pool->total_bytes += size;
+}
+
+int harp_memory_pool_new(harp_memory_pool **new_pool)
+{
+    harp_memory_pool *pool;
+    int i;
+
+    pool = (harp_memory_pool *)malloc(sizeof(harp_memory_pool));
+    if (pool == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_memory_pool), __FILE__, __LINE__);
+        return -1;
+    }
+    pool->block = NULL;
+    for (i = 0; i <= MAX_SIZE_CLASS; i++)
+    {
+        pool->free_block[i] = NULL;
+    }
+    pool->bytes_in_use = 0;
+    pool->peak_bytes = 0;
+    pool->total_bytes = 0;
+    pool->report_statistics = 1;
+
+    *new_pool = pool;
+    return 0;
+}
+
+/* release all memory of the pool (this includes blocks that were not freed explicitly)
+ * the statistics of the pool are passed to the handler set with harp_set_memory_statistics_handler() (if any),
+ * unless they were merged into another pool using harp_memory_pool_merge_statistics()
+ */
+void harp_memory_pool_delete(harp_memory_pool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    if (harp_memory_statistics_handler != NULL && pool->report_statistics)
+    {
+        harp_memory_statistics_handler(pool->peak_bytes, pool->total_bytes);
+    }
+
+    while (pool->block != NULL)
+    {
+        memory_block *block = pool->block;
+
+        pool->block = block->info.next_block;
+        free(block);
+    }
+    free(pool);
+}
+
+/* add the statistics of 'other_pool' to those of 'pool', such that a single report is made for both pools
+ * this is used for pools that were in use at the same time (e.g. by different threads of the same ingestion), so the
+ * peak usage of 'pool' becomes the sum of both peaks (an upper bound of the combined peak)
+ * 'other_pool' will no longer report its statistics when it is deleted
+ */
+void harp_memory_pool_merge_statistics(harp_memory_pool *pool, harp_memory_pool *other_pool)
+{
+    pool->peak_bytes += other_pool->peak_bytes;
+    pool->total_bytes += other_pool->total_bytes;
+    other_pool->report_statistics = 0;
+}
+
+/* returns the sum of the sizes of all blocks that were handed out by the pool (including blocks that were freed) */
+size_t harp_memory_pool_get_total_bytes(const harp_memory_pool *pool)
+{
+    return pool->total_bytes;
+}
+
+/* returns a block of at least 'size' bytes, or NULL (with harp_errno set) if no memory could be allocated */
+void *harp_memory_pool_malloc(harp_memory_pool *pool, size_t size)
+{
+    memory_block *block = NULL;
+    size_t block_size;
+    int size_class;
+
+    size_class = get_size_class(size);
+    if (size_class == LARGE_SIZE_CLASS)
+    {
+        block_size = size;
+    }
+    else
+    {
+        block_size = (size_t)1 << size_class;
+        block = pool->free_block[size_class];
+    }
+    if (block != NULL)
+    {
+        pool->free_block[size_class] = block->info.next_free;
+    }
+    else
+    {
+        block = (memory_block *)malloc(sizeof(memory_block) + block_size);
+        if (block == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(memory_block) + block_size, __FILE__, __LINE__);
+            return NULL;
+        }
+        block->info.size = block_size;
+        block->info.size_class = size_class;
+        add_block(pool, block);
+    }
+    block->info.next_free = NULL;
+
+    add_bytes_in_use(pool, block_size);
+
+    return (void *)(block + 1);
+}
+
+/* resize a block that was obtained from the pool (existing content is preserved)
+ * if the block already has room for 'size' bytes, the same block is returned
+ */
+void *harp_memory_pool_realloc(harp_memory_pool *pool, void *ptr, size_t size)
+{
+    memory_block *block;
+    void *new_ptr;
+
+    if (ptr == NULL)
+    {
+        return harp_memory_pool_malloc(pool, size);
+    }
+
+    block = ((memory_block *)ptr) - 1;
+    if (size <= block->info.size)
+    {
+        return ptr;
+    }
+
+    if (block->info.size_class == LARGE_SIZE_CLASS)
+    {
+        memory_block *new_block;
+        size_t old_size = block->info.size;
+
+        /* large blocks are resized in place (if possible) using the regular allocator */
+        remove_block(pool, block);
+        new_block = (memory_block *)realloc(block, sizeof(memory_block) + size);
+        if (new_block == NULL)
+        {
+            add_block(pool, block);
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(memory_block) + size, __FILE__, __LINE__);
+            return NULL;
+        }
+        new_block->info.size = size;
+        add_block(pool, new_block);
+        pool->bytes_in_use -= old_size;
+        add_bytes_in_use(pool, size);
+
+        return (void *)(new_block + 1);
+    }
+
+    new_ptr = harp_memory_pool_malloc(pool, size);
+    if (new_ptr == NULL)
+    {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, block->info.size);
+    harp_memory_pool_free(pool, ptr);
+
+    return new_ptr;
+}
+
+/* return a block to the pool, so it can be reused by later allocations of the same size class
+ * blocks that were allocated with their exact size are released immediately
+ */
+void harp_memory_pool_free(harp_memory_pool *pool, void *ptr)
+{
+    memory_block *block;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    block = ((memory_block *)ptr) - 1;
+    assert(block->info.next_free == NULL);
+    pool->bytes_in_use -= block->info.size;
+    if (block->info.size_class == LARGE_SIZE_CLASS)
+    {
+        remove_block(pool, block);
+        free(block);
+        return;
+    }
+    block->info.next_free = pool->free_block[block->info.size_class];
+    pool->free_block[block->info.size_class] = block;
+}
+
+/** \addtogroup harp_general
+ * @{
+ */
+
+/** Get a reference to the current handler for memory statistics.
+ * If no memory statistics handler was set, the NULL pointer will be returned.
+ * \param handler Pointer to the variable in which the reference to the handler function will be stored.
+ * \return
+ *   \arg \c  0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_get_memory_statistics_handler(void (**handler) (size_t peak_bytes, size_t total_bytes))
+{
+    *handler = harp_memory_statistics_handler;
+    return 0;
+}
+
+/** Set handler for memory statistics.
+ * Temporary buffers that HARP needs while ingesting a product are taken from a memory pool that is released in one go
+ * at the end of the ingestion. When the pool is released, the \a handler function is called with the peak amount of
+ * memory (in bytes) that was in use from the pool at any one time and the total amount of memory (in bytes) that was
+ * handed out by the pool during the ingestion. For a multi-threaded ingestion (see
+ * harp_set_option_ingestion_num_threads()) the handler is called once with the combined statistics of all threads,
+ * where the peak amount is the sum of the peak amounts of the individual threads.
+ * You can pass NULL to disable the reporting of memory statistics.
+ * \param handler Function that will receive the memory statistics of each ingestion.
+ * \return
+ *   \arg \c  0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_memory_statistics_handler(void (*handler) (size_t peak_bytes, size_t total_bytes))
+{
+    harp_memory_statistics_handler = handler;
+    return 0;
+}
+
+/** @} */
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015-2020 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HARP_MEMORY_POOL_H
+#define HARP_MEMORY_POOL_H
+
+#include <stddef.h>
+
+/* A memory pool hands out blocks of memory that are rounded up to a power of two (size class).
+ * Blocks that are freed are kept in the pool and reused for later requests of the same size class. Large blocks (more
+ * than 1MiB) are allocated with their exact size and are released as soon as they are freed. All memory of the pool
+ * (including blocks that were not freed explicitly) is released at once when the pool is deleted.
+ */
+typedef struct harp_memory_pool_struct harp_memory_pool;
+
+int harp_memory_pool_new(harp_memory_pool **new_pool);
+void harp_memory_pool_delete(harp_memory_pool *pool);
+void harp_memory_pool_merge_statistics(harp_memory_pool *pool, harp_memory_pool *other_pool);
+size_t harp_memory_pool_get_total_bytes(const harp_memory_pool *pool);
+void *harp_memory_pool_malloc(harp_memory_pool *pool, size_t size);
+void *harp_memory_pool_realloc(harp_memory_pool *pool, void *ptr, size_t size);
+void harp_memory_pool_free(harp_memory_pool *pool, void *ptr);
+
+#endif
@@ -38,6 +38,9 @@
 
 #include "netcdf.h"
 
+/* maximum size in bytes of a variable (or of one record of a record variable) in the netCDF-3 64-bit offset format */
+#define MAX_CLASSIC_VARIABLE_SIZE 4294967292LL
+
 typedef enum netcdf_dimension_type_enum
 {
     netcdf_dimension_time,
@@ -56,6 +59,20 @@ typedef struct netcdf_dimensions_struct
     long *length;
 } netcdf_dimensions;
 
+/* netCDF file that is kept open for the lazily loaded variables of an imported product */
+typedef struct netcdf_file_struct
+{
+    int ncid;
+    int ref_count;
+} netcdf_file;
+
+typedef struct netcdf_variable_loader_struct
+{
+    netcdf_file *file;
+    int varid;
+    long string_length;
+} netcdf_variable_loader;
+
 static const char *get_dimension_type_name(netcdf_dimension_type dimension_type)
 {
     switch (dimension_type)
@@ -425,7 +442,99 @@ static int read_numeric_attribute(int ncid, int varid, const char *name, harp_da
     return 0;
 }
 
-static int read_variable(harp_product *product, int ncid, int varid, netcdf_dimensions *dimensions)
+static int read_variable_data(int ncid, int varid, long string_length, harp_variable *variable)
+{
+    int result;
+
+    if (variable->data_type == harp_type_string)
+    {
+        char *buffer;
+
+        buffer = malloc(variable->num_elements * string_length * sizeof(char));
+        if (buffer == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           variable->num_elements * string_length * sizeof(char), __FILE__, __LINE__);
+            return -1;
+        }
+
+        result = nc_get_var_text(ncid, varid, buffer);
+        if (result != NC_NOERR)
+        {
+            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+            free(buffer);
+            return -1;
+        }
+
+        if (harp_variable_set_string_data_from_char_array(variable, string_length, buffer) != 0)
+        {
+            free(buffer);
+            return -1;
+        }
+
+        free(buffer);
+    }
+    else
+    {
+        switch (variable->data_type)
+        {
+            case harp_type_int8:
+                result = nc_get_var_schar(ncid, varid, variable->data.int8_data);
+                break;
+            case harp_type_int16:
+                result = nc_get_var_short(ncid, varid, variable->data.int16_data);
+                break;
+            case harp_type_int32:
+                result = nc_get_var_int(ncid, varid, variable->data.int32_data);
+                break;
+            case harp_type_float:
+                result = nc_get_var_float(ncid, varid, variable->data.float_data);
+                break;
+            case harp_type_double:
+                result = nc_get_var_double(ncid, varid, variable->data.double_data);
+                break;
+            default:
+                assert(0);
+                exit(1);
+        }
+
+        if (result != NC_NOERR)
+        {
+            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int load_variable_data(harp_variable *variable, void *user_data)
+{
+    netcdf_variable_loader *loader = (netcdf_variable_loader *)user_data;
+
+    return read_variable_data(loader->file->ncid, loader->varid, loader->string_length, variable);
+}
+
+static void netcdf_file_release(netcdf_file *file)
+{
+    file->ref_count--;
+    if (file->ref_count == 0)
+    {
+        nc_close(file->ncid);
+        free(file);
+    }
+}
+
+static void netcdf_variable_loader_delete(void *user_data)
+{
+    netcdf_variable_loader *loader = (netcdf_variable_loader *)user_data;
+
+    netcdf_file_release(loader->file);
+    free(loader);
+}
+
+/* if 'file' is not NULL, the variable data is not read, but a loader is attached to the variable instead */
+static int read_variable(harp_product *product, int ncid, int varid, netcdf_dimensions *dimensions, netcdf_file *file)
 {
     harp_variable *variable;
     harp_data_type data_type;
@@ -436,6 +545,7 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
     nc_type netcdf_data_type;
     int netcdf_num_dimensions;
     int netcdf_dim_id[NC_MAX_VAR_DIMS];
+    long string_length;
     int result;
     long i;
 
@@ -494,89 +604,51 @@ static int read_variable(harp_product *product, int ncid, int varid, netcdf_dime
         dimension[i] = dimensions->length[netcdf_dim_id[i]];
     }
 
-    if (harp_variable_new(netcdf_name, data_type, num_dimensions, dimension_type, dimension, &variable) != 0)
-    {
-        return -1;
-    }
-
-    if (harp_product_add_variable(product, variable) != 0)
+    string_length = 0;
+    if (data_type == harp_type_string)
     {
-        harp_variable_delete(variable);
-        return -1;
+        assert(netcdf_num_dimensions > 0);
+        string_length = dimensions->length[netcdf_dim_id[netcdf_num_dimensions - 1]];
     }
 
-    /* Read data. */
-    if (data_type == harp_type_string)
+    if (file != NULL)
     {
-        char *buffer;
-        long length;
-
-        assert(netcdf_num_dimensions > 0);
-        length = dimensions->length[netcdf_dim_id[netcdf_num_dimensions - 1]];
+        netcdf_variable_loader *loader;
 
-        buffer = malloc(variable->num_elements * length * sizeof(char));
-        if (buffer == NULL)
+        loader = (netcdf_variable_loader *)malloc(sizeof(netcdf_variable_loader));
+        if (loader == NULL)
         {
             harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                           variable->num_elements * length * sizeof(char), __FILE__, __LINE__);
+                           sizeof(netcdf_variable_loader), __FILE__, __LINE__);
             return -1;
         }
+        loader->file = file;
+        loader->varid = varid;
+        loader->string_length = string_length;
 
-        result = nc_get_var_text(ncid, varid, buffer);
-        if (result != NC_NOERR)
+        if (harp_variable_new_with_loader(netcdf_name, data_type, num_dimensions, dimension_type, dimension,
+                                          load_variable_data, netcdf_variable_loader_delete, loader, &variable) != 0)
         {
-            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
-            free(buffer);
+            free(loader);
             return -1;
         }
-
-        for (i = 0; i < variable->num_elements; i++)
-        {
-            char *str;
-
-            str = malloc((length + 1) * sizeof(char));
-            if (str == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                               (length + 1) * sizeof(char), __FILE__, __LINE__);
-                free(buffer);
-                return -1;
-            }
-
-            memcpy(str, &buffer[i * length], length);
-            str[length] = '\0';
-            variable->data.string_data[i] = str;
-        }
-
-        free(buffer);
+        file->ref_count++;
     }
-    else
+    else if (harp_variable_new(netcdf_name, data_type, num_dimensions, dimension_type, dimension, &variable) != 0)
     {
-        switch (data_type)
-        {
-            case harp_type_int8:
-                result = nc_get_var_schar(ncid, varid, variable->data.int8_data);
-                break;
-            case harp_type_int16:
-                result = nc_get_var_short(ncid, varid, variable->data.int16_data);
-                break;
-            case harp_type_int32:
-                result = nc_get_var_int(ncid, varid, variable->data.int32_data);
-                break;
-            case harp_type_float:
-                result = nc_get_var_float(ncid, varid, variable->data.float_data);
-                break;
-            case harp_type_double:
-                result = nc_get_var_double(ncid, varid, variable->data.double_data);
-                break;
-            default:
-                assert(0);
-                exit(1);
-        }
+        return -1;
+    }
 
-        if (result != NC_NOERR)
+    if (harp_product_add_variable(product, variable) != 0)
+    {
+        harp_variable_delete(variable);
+        return -1;
+    }
+
+    if (file == NULL)
+    {
+        if (read_variable_data(ncid, varid, string_length, variable) != 0)
         {
-            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
             return -1;
         }
     }
@@ -714,22 +786,11 @@ static int verify_product(int ncid)
     return -1;
 }
 
-static int read_product(int ncid, harp_product *product, netcdf_dimensions *dimensions)
+static int read_dimensions(int ncid, int num_dimensions, netcdf_dimensions *dimensions)
 {
-    int num_dimensions;
-    int num_variables;
-    int num_attributes;
-    int unlim_dim;
     int result;
     int i;
 
-    result = nc_inq(ncid, &num_dimensions, &num_variables, &num_attributes, &unlim_dim);
-    if (result != NC_NOERR)
-    {
-        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
-        return -1;
-    }
-
     for (i = 0; i < num_dimensions; i++)
     {
         netcdf_dimension_type dimension_type;
@@ -755,9 +816,33 @@ static int read_product(int ncid, harp_product *product, netcdf_dimensions *dime
         }
     }
 
+    return 0;
+}
+
+static int read_product(int ncid, harp_product *product, netcdf_dimensions *dimensions, netcdf_file *file)
+{
+    int num_dimensions;
+    int num_variables;
+    int num_attributes;
+    int unlim_dim;
+    int result;
+    int i;
+
+    result = nc_inq(ncid, &num_dimensions, &num_variables, &num_attributes, &unlim_dim);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+
+    if (read_dimensions(ncid, num_dimensions, dimensions) != 0)
+    {
+        return -1;
+    }
+
     for (i = 0; i < num_variables; i++)
     {
-        if (read_variable(product, ncid, i, dimensions) != 0)
+        if (read_variable(product, ncid, i, dimensions, file) != 0)
         {
             return -1;
         }
@@ -794,10 +879,11 @@ static int read_product(int ncid, harp_product *product, netcdf_dimensions *dime
     return 0;
 }
 
-int harp_import_netcdf(const char *filename, harp_product **product)
+int harp_import_netcdf(const char *filename, int lazy, harp_product **product)
 {
     harp_product *new_product;
     netcdf_dimensions dimensions;
+    netcdf_file *file = NULL;
     int ncid;
     int result;
 
@@ -820,30 +906,66 @@ int harp_import_netcdf(const char *filename, harp_product **product)
         return -1;
     }
 
+    if (lazy)
+    {
+        /* the file is kept open for as long as there are variables that refer to it */
+        file = (netcdf_file *)malloc(sizeof(netcdf_file));
+        if (file == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           sizeof(netcdf_file), __FILE__, __LINE__);
+            nc_close(ncid);
+            return -1;
+        }
+        file->ncid = ncid;
+        file->ref_count = 1;
+    }
+
     if (harp_product_new(&new_product) != 0)
     {
-        nc_close(ncid);
+        if (file != NULL)
+        {
+            netcdf_file_release(file);
+        }
+        else
+        {
+            nc_close(ncid);
+        }
         return -1;
     }
 
     dimensions_init(&dimensions);
 
-    if (read_product(ncid, new_product, &dimensions) != 0)
+    if (read_product(ncid, new_product, &dimensions, file) != 0)
     {
         dimensions_done(&dimensions);
         harp_product_delete(new_product);
-        nc_close(ncid);
+        if (file != NULL)
+        {
+            netcdf_file_release(file);
+        }
+        else
+        {
+            nc_close(ncid);
+        }
         return -1;
     }
 
     dimensions_done(&dimensions);
 
-    result = nc_close(ncid);
-    if (result != NC_NOERR)
+    if (file != NULL)
     {
-        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
-        harp_product_delete(new_product);
-        return -1;
+        netcdf_file_release(file);
+    }
+    else
+    {
+        result = nc_close(ncid);
+        if (result != NC_NOERR)
+        {
+            harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+            harp_product_delete(new_product);
+            return -1;
+        }
     }
 
     *product = new_product;
@@ -1017,7 +1139,8 @@ int harp_import_metadata_netcdf(const char *filename, harp_product_metadata *met
     return 0;
 }
 
-static int write_dimensions(int ncid, const netcdf_dimensions *dimensions)
+/* if 'unlimited_time' is set, the time dimension is defined as the (unlimited) record dimension */
+static int write_dimensions(int ncid, const netcdf_dimensions *dimensions, int unlimited_time)
 {
     int result;
     int i;
@@ -1026,7 +1149,11 @@ static int write_dimensions(int ncid, const netcdf_dimensions *dimensions)
     {
         int dim_id;
 
-        if (dimensions->type[i] == netcdf_dimension_independent)
+        if (dimensions->type[i] == netcdf_dimension_time && unlimited_time)
+        {
+            result = nc_def_dim(ncid, get_dimension_type_name(netcdf_dimension_time), NC_UNLIMITED, &dim_id);
+        }
+        else if (dimensions->type[i] == netcdf_dimension_independent)
         {
             char name[64];
 
@@ -1222,38 +1349,60 @@ static int write_variable_definition(int ncid, const harp_variable *variable, ne
     return 0;
 }
 
-static int write_variable(int ncid, int varid, const harp_variable *variable)
+/* Write the data of a variable. For time dependent variables the data is written starting at record 'time_offset'
+ * of the time dimension. String data is padded to (at least) 'min_string_length' characters.
+ */
+static int write_variable(int ncid, int varid, const harp_variable *variable, size_t time_offset,
+                          long min_string_length)
 {
+    size_t start[NC_MAX_VAR_DIMS];
+    size_t count[NC_MAX_VAR_DIMS];
     int result = NC_NOERR;
+    int i;
+
+    assert(variable->num_dimensions < NC_MAX_VAR_DIMS);
+
+    for (i = 0; i < variable->num_dimensions; i++)
+    {
+        start[i] = 0;
+        count[i] = (size_t)variable->dimension[i];
+    }
+    if (variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time)
+    {
+        start[0] = time_offset;
+    }
 
     switch (variable->data_type)
     {
         case harp_type_int8:
-            result = nc_put_var_schar(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_schar(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_int16:
-            result = nc_put_var_short(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_short(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_int32:
-            result = nc_put_var_int(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_int(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_float:
-            result = nc_put_var_float(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_float(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_double:
-            result = nc_put_var_double(ncid, varid, variable->data.ptr);
+            result = nc_put_vara_double(ncid, varid, start, count, variable->data.ptr);
             break;
         case harp_type_string:
             {
+                long string_length;
                 char *buffer;
 
-                if (harp_get_char_array_from_string_array(variable->num_elements, variable->data.string_data, 1, NULL,
-                                                          &buffer) != 0)
+                if (harp_get_char_array_from_string_array(variable->num_elements, variable->data.string_data,
+                                                          min_string_length, &string_length, &buffer) != 0)
                 {
                     return -1;
                 }
 
-                result = nc_put_var_text(ncid, varid, buffer);
+                start[variable->num_dimensions] = 0;
+                count[variable->num_dimensions] = (size_t)string_length;
+                result = nc_put_vara_text(ncid, varid, start, count, buffer);
                 free(buffer);
             }
             break;
@@ -1268,7 +1417,7 @@ static int write_variable(int ncid, int varid, const harp_variable *variable)
     return 0;
 }
 
-static int write_product(int ncid, const harp_product *product, netcdf_dimensions *dimensions)
+static int write_product(int ncid, const harp_product *product, netcdf_dimensions *dimensions, int unlimited_time)
 {
     harp_scalar datetime_start;
     harp_scalar datetime_stop;
@@ -1348,7 +1497,7 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
     }
 
     /* write dimensions */
-    if (write_dimensions(ncid, dimensions) != 0)
+    if (write_dimensions(ncid, dimensions, unlimited_time) != 0)
     {
         return -1;
     }
@@ -1375,7 +1524,7 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
     /* write variable data */
     for (i = 0; i < product->num_variables; i++)
     {
-        if (write_variable(ncid, i, product->variable[i]) != 0)
+        if (write_variable(ncid, i, product->variable[i], 0, 1) != 0)
         {
             return -1;
         }
@@ -1384,7 +1533,47 @@ static int write_product(int ncid, const harp_product *product, netcdf_dimension
     return 0;
 }
 
-int harp_export_netcdf(const char *filename, const harp_product *product)
+/* returns 1 if the size of one of the variables (or, for record variables, the size of a single record) exceeds what
+ * can be stored in the classic and 64-bit offset netCDF formats
+ */
+static int requires_64bit_data(const harp_product *product, int unlimited_time)
+{
+    int i;
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const harp_variable *variable = product->variable[i];
+        int64_t size;
+
+        if (variable->data_type == harp_type_string)
+        {
+            long length;
+
+            length = harp_get_max_string_length(variable->num_elements, variable->data.string_data);
+            size = (int64_t)variable->num_elements * (length == 0 ? 1 : length);
+        }
+        else
+        {
+            size = (int64_t)variable->num_elements * harp_get_size_for_type(variable->data_type);
+        }
+        if (unlimited_time && variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time &&
+            variable->dimension[0] > 0)
+        {
+            size /= variable->dimension[0];
+        }
+        if (size > MAX_CLASSIC_VARIABLE_SIZE)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* if 'unlimited_time' is set, the time dimension is stored as the netCDF record dimension, so time samples can be
+ * appended to the file later on (see harp_export_append_netcdf())
+ */
+int harp_export_netcdf(const char *filename, int unlimited_time, const harp_product *product)
 {
     netcdf_dimensions dimensions;
     int64_t size;
@@ -1408,9 +1597,14 @@ int harp_export_netcdf(const char *filename, const harp_product *product)
     {
         return -1;
     }
-    if (size > 1073741824)
+    if (requires_64bit_data(product, unlimited_time))
+    {
+        /* variables larger than 4GB can only be stored using the CDF-5 format (readable with netCDF 4.4 or higher) */
+        flags |= NC_64BIT_DATA;
+    }
+    else if (size > 1073741824 || unlimited_time)
     {
-        /* files larger than 1GB will be stored using 64-bit offsets */
+        /* files larger than 1GB (or files that can grow by appending records) will be stored using 64-bit offsets */
         flags |= NC_64BIT_OFFSET;
     }
     result = nc_create(filename, flags, &ncid);
@@ -1423,7 +1617,7 @@ int harp_export_netcdf(const char *filename, const harp_product *product)
 
     dimensions_init(&dimensions);
 
-    if (write_product(ncid, product, &dimensions) != 0)
+    if (write_product(ncid, product, &dimensions, unlimited_time) != 0)
     {
         harp_add_error_message(" (%s)", filename);
         nc_close(ncid);
@@ -1443,3 +1637,389 @@ int harp_export_netcdf(const char *filename, const harp_product *product)
 
     return 0;
 }
+
+/* Verify that a product variable can be appended to the corresponding variable in the file. The id of the variable in
+ * the file and (for string variables) the length of its string dimension are returned.
+ */
+static int verify_append_variable(int ncid, int unlim_dim, const netcdf_dimensions *dimensions,
+                                  const harp_variable *variable, int *varid, long *string_length)
+{
+    nc_type netcdf_data_type;
+    int netcdf_num_dimensions;
+    int netcdf_dim_id[NC_MAX_VAR_DIMS];
+    int num_dimensions;
+    int result;
+    int i;
+
+    result = nc_inq_varid(ncid, variable->name, varid);
+    if (result == NC_ENOTVAR)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "variable '%s' does not exist in file", variable->name);
+        return -1;
+    }
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+
+    result = nc_inq_var(ncid, *varid, NULL, &netcdf_data_type, &netcdf_num_dimensions, netcdf_dim_id, NULL);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        return -1;
+    }
+
+    if (netcdf_data_type != get_netcdf_type(variable->data_type))
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "variable '%s' has a different data type in file", variable->name);
+        return -1;
+    }
+
+    num_dimensions = netcdf_num_dimensions;
+    if (variable->data_type == harp_type_string)
+    {
+        num_dimensions--;
+    }
+    if (num_dimensions != variable->num_dimensions)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "variable '%s' has %d dimensions in file; expected %d", variable->name,
+                       num_dimensions, variable->num_dimensions);
+        return -1;
+    }
+
+    for (i = 0; i < num_dimensions; i++)
+    {
+        int dim_id = netcdf_dim_id[i];
+
+        if (dimensions->type[dim_id] != get_netcdf_dimension_type(variable->dimension_type[i]))
+        {
+            harp_set_error(HARP_ERROR_EXPORT, "dimension %d of variable '%s' is of type '%s' in file; expected '%s'",
+                           i, variable->name, get_dimension_type_name(dimensions->type[dim_id]),
+                           harp_get_dimension_type_name(variable->dimension_type[i]));
+            return -1;
+        }
+
+        if (variable->dimension_type[i] == harp_dimension_time)
+        {
+            if (i != 0 || dim_id != unlim_dim)
+            {
+                harp_set_error(HARP_ERROR_EXPORT, "dimension %d of variable '%s' is not the record dimension of the "
+                               "file", i, variable->name);
+                return -1;
+            }
+        }
+        else if (dimensions->length[dim_id] != variable->dimension[i])
+        {
+            harp_set_error(HARP_ERROR_EXPORT, "dimension %d of variable '%s' has length %ld in file; expected %ld", i,
+                           variable->name, dimensions->length[dim_id], variable->dimension[i]);
+            return -1;
+        }
+    }
+
+    *string_length = 0;
+    if (variable->data_type == harp_type_string)
+    {
+        int dim_id = netcdf_dim_id[num_dimensions];
+
+        if (dimensions->type[dim_id] != netcdf_dimension_string)
+        {
+            harp_set_error(HARP_ERROR_EXPORT, "inner-most dimension of variable '%s' is of type '%s' in file; "
+                           "expected '%s'", variable->name, get_dimension_type_name(dimensions->type[dim_id]),
+                           get_dimension_type_name(netcdf_dimension_string));
+            return -1;
+        }
+
+        /* the string dimension can not grow, so longer strings can not be appended */
+        *string_length = dimensions->length[dim_id];
+        if (harp_get_max_string_length(variable->num_elements, variable->data.string_data) > *string_length)
+        {
+            harp_set_error(HARP_ERROR_EXPORT, "variable '%s' contains strings that are longer than the string "
+                           "dimension (%ld) in file", variable->name, *string_length);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Time independent variables are not written when appending, but they should be equal to the data in the file. */
+static int verify_append_static_variable(int ncid, int varid, long string_length, const harp_variable *variable)
+{
+    harp_variable *file_variable;
+    int equal = 1;
+    long i;
+
+    if (harp_variable_new(variable->name, variable->data_type, variable->num_dimensions, variable->dimension_type,
+                          variable->dimension, &file_variable) != 0)
+    {
+        return -1;
+    }
+
+    if (read_variable_data(ncid, varid, string_length, file_variable) != 0)
+    {
+        harp_variable_delete(file_variable);
+        return -1;
+    }
+
+    if (variable->data_type == harp_type_string)
+    {
+        for (i = 0; i < variable->num_elements && equal; i++)
+        {
+            const char *str = variable->data.string_data[i];
+
+            equal = strcmp(str == NULL ? "" : str, file_variable->data.string_data[i]) == 0;
+        }
+    }
+    else
+    {
+        equal = memcmp(variable->data.ptr, file_variable->data.ptr,
+                       (size_t)variable->num_elements * harp_get_size_for_type(variable->data_type)) == 0;
+    }
+
+    harp_variable_delete(file_variable);
+
+    if (!equal)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "time independent variable '%s' differs from the variable in file",
+                       variable->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* extend the datetime range in the global attributes (if present) with the datetime range of the appended product */
+static int update_datetime_range(int ncid, const harp_product *product)
+{
+    harp_data_type data_type;
+    harp_scalar file_datetime_start;
+    harp_scalar file_datetime_stop;
+    double datetime_start;
+    double datetime_stop;
+
+    if (nc_inq_att(ncid, NC_GLOBAL, "datetime_start", NULL, NULL) != NC_NOERR ||
+        nc_inq_att(ncid, NC_GLOBAL, "datetime_stop", NULL, NULL) != NC_NOERR)
+    {
+        return 0;
+    }
+
+    if (harp_product_get_datetime_range(product, &datetime_start, &datetime_stop) != 0)
+    {
+        return 0;
+    }
+
+    if (read_numeric_attribute(ncid, NC_GLOBAL, "datetime_start", &data_type, &file_datetime_start) != 0)
+    {
+        return -1;
+    }
+    if (data_type != harp_type_double)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "attribute 'datetime_start' has invalid type");
+        return -1;
+    }
+    if (read_numeric_attribute(ncid, NC_GLOBAL, "datetime_stop", &data_type, &file_datetime_stop) != 0)
+    {
+        return -1;
+    }
+    if (data_type != harp_type_double)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "attribute 'datetime_stop' has invalid type");
+        return -1;
+    }
+
+    /* the size of the attributes does not change, so they can be updated without leaving data mode */
+    if (datetime_start < file_datetime_start.double_data)
+    {
+        file_datetime_start.double_data = datetime_start;
+        if (write_numeric_attribute(ncid, NC_GLOBAL, "datetime_start", harp_type_double, file_datetime_start) != 0)
+        {
+            return -1;
+        }
+    }
+    if (datetime_stop > file_datetime_stop.double_data)
+    {
+        file_datetime_stop.double_data = datetime_stop;
+        if (write_numeric_attribute(ncid, NC_GLOBAL, "datetime_stop", harp_type_double, file_datetime_stop) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int append_product(int ncid, const harp_product *product)
+{
+    netcdf_dimensions dimensions;
+    int *varid = NULL;
+    long *string_length = NULL;
+    size_t num_records;
+    int num_dimensions;
+    int num_variables;
+    int num_attributes;
+    int unlim_dim;
+    int result;
+    int i;
+
+    dimensions_init(&dimensions);
+
+    result = nc_inq(ncid, &num_dimensions, &num_variables, &num_attributes, &unlim_dim);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        goto error;
+    }
+
+    if (read_dimensions(ncid, num_dimensions, &dimensions) != 0)
+    {
+        goto error;
+    }
+
+    if (unlim_dim < 0 || dimensions.type[unlim_dim] != netcdf_dimension_time)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "file does not have '%s' as record dimension",
+                       get_dimension_type_name(netcdf_dimension_time));
+        goto error;
+    }
+    num_records = (size_t)dimensions.length[unlim_dim];
+
+    if (product->dimension[harp_dimension_time] == 0)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "product does not have a '%s' dimension",
+                       harp_get_dimension_type_name(harp_dimension_time));
+        goto error;
+    }
+
+    if (num_variables != product->num_variables)
+    {
+        harp_set_error(HARP_ERROR_EXPORT, "product has %d variables; file has %d", product->num_variables,
+                       num_variables);
+        goto error;
+    }
+
+    if (num_variables > 0)
+    {
+        varid = malloc(num_variables * sizeof(int));
+        if (varid == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_variables * sizeof(int), __FILE__, __LINE__);
+            goto error;
+        }
+        string_length = malloc(num_variables * sizeof(long));
+        if (string_length == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_variables * sizeof(long), __FILE__, __LINE__);
+            goto error;
+        }
+    }
+
+    /* verify all variables before writing anything, so an incompatible product leaves the file untouched */
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_variable *variable = product->variable[i];
+
+        if (verify_append_variable(ncid, unlim_dim, &dimensions, variable, &varid[i], &string_length[i]) != 0)
+        {
+            goto error;
+        }
+        if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+        {
+            if (verify_append_static_variable(ncid, varid[i], string_length[i], variable) != 0)
+            {
+                goto error;
+            }
+        }
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_variable *variable = product->variable[i];
+
+        if (variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time)
+        {
+            if (write_variable(ncid, varid[i], variable, num_records, string_length[i]) != 0)
+            {
+                goto error;
+            }
+        }
+    }
+
+    if (update_datetime_range(ncid, product) != 0)
+    {
+        goto error;
+    }
+
+    free(string_length);
+    free(varid);
+    dimensions_done(&dimensions);
+    return 0;
+
+  error:
+    if (string_length != NULL)
+    {
+        free(string_length);
+    }
+    if (varid != NULL)
+    {
+        free(varid);
+    }
+    dimensions_done(&dimensions);
+    return -1;
+}
+
+/* Append the time samples of a product to an existing HARP netCDF file that has 'time' as record dimension. The
+ * product should have the same variables (with the same types and non-time dimensions) as the file. Only time
+ * dependent variables are written; time independent variables need to be equal to those in the file.
+ */
+int harp_export_append_netcdf(const char *filename, const harp_product *product)
+{
+    int result;
+    int ncid;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL");
+        return -1;
+    }
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL");
+        return -1;
+    }
+
+    result = nc_open(filename, NC_WRITE, &ncid);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        harp_add_error_message(" (%s)", filename);
+        return -1;
+    }
+
+    if (verify_product(ncid) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        nc_close(ncid);
+        return -1;
+    }
+
+    if (append_product(ncid, product) != 0)
+    {
+        harp_add_error_message(" (%s)", filename);
+        nc_close(ncid);
+        return -1;
+    }
+
+    result = nc_close(ncid);
+    if (result != NC_NOERR)
+    {
+        harp_set_error(HARP_ERROR_NETCDF, "%s", nc_strerror(result));
+        harp_add_error_message(" (%s)", filename);
+        return -1;
+    }
+
+    return 0;
+}
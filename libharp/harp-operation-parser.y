@@ -945,6 +945,14 @@ operation:
             harp_sized_array_delete($4);
             harp_sized_array_delete($8);
         }
+    | FUNC_BIN_SPATIAL '(' STRING_VALUE ')' {
+            if (harp_operation_bin_spatial_with_weights_new($3, &$$) != 0)
+            {
+                free($3);
+                YYERROR;
+            }
+            free($3);
+        }
     | FUNC_BIN_SPATIAL '(' int32_value ',' double_value ',' double_value ',' int32_value ',' double_value ','
       double_value ')' {
             harp_sized_array *lat_array;
@@ -647,6 +647,23 @@ static void bin_full_delete(harp_operation *operation)
     }
 }
 
+static void bin_spatial_with_weights_delete(harp_operation_bin_spatial_with_weights *operation)
+{
+    if (operation != NULL)
+    {
+        if (operation->weights_filename != NULL)
+        {
+            free(operation->weights_filename);
+        }
+        if (operation->weights != NULL)
+        {
+            harp_product_delete(operation->weights);
+        }
+
+        free(operation);
+    }
+}
+
 static void bin_spatial_delete(harp_operation_bin_spatial *operation)
 {
     if (operation != NULL)
@@ -1291,6 +1308,9 @@ void harp_operation_delete(harp_operation *operation)
         case operation_bin_spatial:
             bin_spatial_delete((harp_operation_bin_spatial *)operation);
             break;
+        case operation_bin_spatial_with_weights:
+            bin_spatial_with_weights_delete((harp_operation_bin_spatial_with_weights *)operation);
+            break;
         case operation_bin_with_variables:
             bin_with_variables_delete((harp_operation_bin_with_variables *)operation);
             break;
@@ -1753,6 +1773,36 @@ int harp_operation_bin_spatial_new(long num_latitude_edges, double *latitude_edg
     return 0;
 }
 
+int harp_operation_bin_spatial_with_weights_new(const char *weights_filename, harp_operation **new_operation)
+{
+    harp_operation_bin_spatial_with_weights *operation;
+
+    assert(weights_filename != NULL);
+
+    operation = (harp_operation_bin_spatial_with_weights *)malloc(sizeof(harp_operation_bin_spatial_with_weights));
+    if (operation == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_operation_bin_spatial_with_weights), __FILE__, __LINE__);
+        return -1;
+    }
+    operation->type = operation_bin_spatial_with_weights;
+    operation->weights_filename = NULL;
+    operation->weights = NULL;
+
+    operation->weights_filename = strdup(weights_filename);
+    if (operation->weights_filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
+                       __LINE__);
+        bin_spatial_with_weights_delete(operation);
+        return -1;
+    }
+
+    *new_operation = (harp_operation *)operation;
+    return 0;
+}
+
 int harp_operation_bin_with_variables_new(int num_variables, const char **variable_name, harp_operation **new_operation)
 {
     harp_operation_bin_with_variables *operation;
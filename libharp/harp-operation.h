@@ -46,6 +46,7 @@ typedef enum harp_operation_type_enum
     operation_bin_collocated,
     operation_bin_full,
     operation_bin_spatial,
+    operation_bin_spatial_with_weights,
     operation_bin_with_variables,
     operation_bit_mask_filter,
     operation_clamp,
@@ -127,6 +128,7 @@ typedef enum harp_membership_operator_type_enum
  *   |-  harp_operation_bin_collocated
  *   |-  harp_operation_bin_full
  *   |-  harp_operation_bin_spatial
+ *   |-  harp_operation_bin_spatial_with_weights
  *   |-  harp_operation_bin_with_variables
  *   |-  harp_operation_clamp
  *   |-  harp_operation_derive_variable
@@ -242,6 +244,15 @@ typedef struct harp_operation_bin_spatial_struct
     double *longitude_edges;
 } harp_operation_bin_spatial;
 
+typedef struct harp_operation_bin_spatial_with_weights_struct
+{
+    harp_operation_type type;
+    /* parameters */
+    char *weights_filename;
+    /* extra */
+    harp_product *weights;      /* weight table (read from file on first use) */
+} harp_operation_bin_spatial_with_weights;
+
 typedef struct harp_operation_bin_with_variables_struct
 {
     harp_operation_type type;
@@ -591,6 +602,7 @@ int harp_operation_bin_collocated_new(const char *collocation_result, const char
 int harp_operation_bin_full_new(harp_operation **new_operation);
 int harp_operation_bin_spatial_new(long num_latitude_edges, double *latitude_edges, long num_longitude_edges,
                                    double *longitude_edges, harp_operation **new_operation);
+int harp_operation_bin_spatial_with_weights_new(const char *weights_filename, harp_operation **new_operation);
 int harp_operation_bin_with_variables_new(int num_variables, const char **variable_name,
                                           harp_operation **new_operation);
 int harp_operation_bit_mask_filter_new(const char *variable_name, harp_bit_mask_operator_type operator_type,
@@ -1059,6 +1059,74 @@ static int add_missing_count_and_weight_variables(harp_product *product, harp_pr
  * @{
  */
 
+/** Reserve memory for appending time samples to a product.
+ * For each variable in the product that has 'time' as first dimension, memory is reserved such that the variable can
+ * hold \a time_capacity time samples (see harp_variable_reserve_time_capacity()). This allows a subsequent series of
+ * harp_product_append() calls to be performed without reallocating the variable data. The product itself is not
+ * changed by this function.
+ * \param product Product for which memory should be reserved.
+ * \param time_capacity Total number of time samples for which memory should be available.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_reserve_time_capacity(harp_product *product, long time_capacity)
+{
+    int i;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        harp_variable *variable = product->variable[i];
+
+        if (variable->num_dimensions > 0 && variable->dimension_type[0] == harp_dimension_time)
+        {
+            if (harp_variable_reserve_time_capacity(variable, time_capacity) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/** Release memory that was reserved for appending time samples to a product.
+ * For each variable in the product that has 'time' as first dimension, the memory that was reserved for appending
+ * further time samples (see harp_product_reserve_time_capacity() and harp_variable_trim_time_capacity()) is released.
+ * Use this after the last of a series of harp_product_append() calls. The product itself is not changed by this
+ * function.
+ * \param product Product for which reserved memory should be released.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_trim_time_capacity(harp_product *product)
+{
+    int i;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        if (harp_variable_trim_time_capacity(product->variable[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 /** Append one product to another.
  * The 'index' variable, if present, will be removed.
  * All variables in both products will have a 'time' dimension introduced as first dimension.
@@ -1067,6 +1135,10 @@ static int add_missing_count_and_weight_variables(harp_product *product, harp_pr
  *
  * If you pass NULL for 'other_product', then 'product' will be updated as if it was the result of a merge
  * (i.e. remove 'index', add 'time' dimension, and remove 'source_product' attribute).
+ *
+ * A single append only allocates the memory that is needed for the result. When the same product is appended to
+ * repeatedly, the variable data grows geometrically to keep the total cost of the appends linear; call
+ * harp_product_trim_time_capacity() after the last append to release the memory that was reserved in advance.
  * \param product Product to which data should be appended.
  * \param other_product (optional) Product that should be appended.
  * \return
@@ -1074,11 +1146,40 @@ static int add_missing_count_and_weight_variables(harp_product *product, harp_pr
  *   \arg \c -1, Error occurred (check #harp_errno).
  */
 LIBHARP_API int harp_product_append(harp_product *product, harp_product *other_product)
+{
+    return harp_product_append_many(product, other_product == NULL ? 0 : 1, &other_product);
+}
+
+/** Append several products to a product.
+ * The result is the same as calling harp_product_append() for each of the products in \a other_product in turn,
+ * but the data of each variable is only reallocated once (for the combined length of the time dimension).
+ * The 'index' variable, if present, will be removed from all products.
+ * All variables in all products will have a 'time' dimension introduced as first dimension.
+ * All products will have all non-time dimensions extended to the maximum over all products.
+ * Any 'source_product' attribute for the first product will be removed.
+ *
+ * If you pass 0 for 'num_products', then 'product' will be updated as if it was the result of a merge
+ * (i.e. remove 'index', add 'time' dimension, and remove 'source_product' attribute).
+ * \param product Product to which data should be appended.
+ * \param num_products Number of products in \a other_product.
+ * \param other_product Products that should be appended (in the given order).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_append_many(harp_product *product, int num_products, harp_product **other_product)
 {
     harp_variable *variable;
     harp_variable *other_variable;
     harp_dimension_type dimension_type;
-    int i;
+    long time_length;
+    int i, k;
+
+    if (num_products < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_products is negative (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
 
     if (harp_product_has_variable(product, "index"))
     {
@@ -1087,6 +1188,10 @@ LIBHARP_API int harp_product_append(harp_product *product, harp_product *other_p
             return -1;
         }
     }
+    if (harp_product_ensure_loaded(product) != 0)
+    {
+        return -1;
+    }
     if (harp_product_make_time_dependent(product) != 0)
     {
         return -1;
@@ -1097,53 +1202,63 @@ LIBHARP_API int harp_product_append(harp_product *product, harp_product *other_p
         product->source_product = NULL;
     }
 
-    if (other_product == NULL)
+    if (num_products == 0)
     {
         /* just update 'product' as if it was a result from a merge and return */
         return 0;
     }
 
-    if (harp_product_has_variable(other_product, "index"))
+    for (k = 0; k < num_products; k++)
     {
-        if (harp_product_remove_variable_by_name(other_product, "index") != 0)
+        if (harp_product_has_variable(other_product[k], "index"))
+        {
+            if (harp_product_remove_variable_by_name(other_product[k], "index") != 0)
+            {
+                return -1;
+            }
+        }
+        if (harp_product_ensure_loaded(other_product[k]) != 0)
         {
             return -1;
         }
-    }
 
-    /* add '*_count' and '*_weight' variables where needed */
-    if (add_missing_count_and_weight_variables(product, other_product) != 0)
-    {
-        return -1;
-    }
-    if (add_missing_count_and_weight_variables(other_product, product) != 0)
-    {
-        return -1;
-    }
-
-    /* now check if both products have the same variables */
-    for (i = 0; i < product->num_variables; i++)
-    {
-        variable = product->variable[i];
-        if (!harp_product_has_variable(other_product, variable->name))
+        /* add '*_count' and '*_weight' variables where needed */
+        if (add_missing_count_and_weight_variables(product, other_product[k]) != 0)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "products don't both have variable '%s'", variable->name);
             return -1;
         }
     }
-    for (i = 0; i < other_product->num_variables; i++)
+    for (k = 0; k < num_products; k++)
     {
-        variable = other_product->variable[i];
-        if (!harp_product_has_variable(product, variable->name))
+        if (add_missing_count_and_weight_variables(other_product[k], product) != 0)
         {
-            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "products don't both have variable '%s'", variable->name);
             return -1;
         }
-    }
 
-    if (harp_product_make_time_dependent(other_product) != 0)
-    {
-        return -1;
+        /* now check if both products have the same variables */
+        for (i = 0; i < product->num_variables; i++)
+        {
+            variable = product->variable[i];
+            if (!harp_product_has_variable(other_product[k], variable->name))
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "products don't both have variable '%s'", variable->name);
+                return -1;
+            }
+        }
+        for (i = 0; i < other_product[k]->num_variables; i++)
+        {
+            variable = other_product[k]->variable[i];
+            if (!harp_product_has_variable(product, variable->name))
+            {
+                harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "products don't both have variable '%s'", variable->name);
+                return -1;
+            }
+        }
+
+        if (harp_product_make_time_dependent(other_product[k]) != 0)
+        {
+            return -1;
+        }
     }
 
     /* align size of all non-time dimensions */
@@ -1151,40 +1266,67 @@ LIBHARP_API int harp_product_append(harp_product *product, harp_product *other_p
     {
         if (dimension_type != harp_dimension_time)
         {
-            if (product->dimension[dimension_type] > other_product->dimension[dimension_type])
+            long max_length = product->dimension[dimension_type];
+
+            for (k = 0; k < num_products; k++)
             {
-                if (harp_product_resize_dimension(other_product, dimension_type, product->dimension[dimension_type]) !=
-                    0)
+                if (other_product[k]->dimension[dimension_type] > max_length)
                 {
-                    return -1;
+                    max_length = other_product[k]->dimension[dimension_type];
                 }
             }
-            else if (product->dimension[dimension_type] < other_product->dimension[dimension_type])
+            if (product->dimension[dimension_type] < max_length)
             {
-                if (harp_product_resize_dimension(product, dimension_type, other_product->dimension[dimension_type]) !=
-                    0)
+                if (harp_product_resize_dimension(product, dimension_type, max_length) != 0)
                 {
                     return -1;
                 }
             }
+            for (k = 0; k < num_products; k++)
+            {
+                if (other_product[k]->dimension[dimension_type] < max_length)
+                {
+                    if (harp_product_resize_dimension(other_product[k], dimension_type, max_length) != 0)
+                    {
+                        return -1;
+                    }
+                }
+            }
         }
     }
 
-    /* append all variables */
+    /* make room for all time samples at once */
+    time_length = product->dimension[harp_dimension_time];
+    for (k = 0; k < num_products; k++)
+    {
+        time_length += other_product[k]->dimension[harp_dimension_time];
+    }
     for (i = 0; i < product->num_variables; i++)
     {
-        variable = product->variable[i];
-        if (harp_product_get_variable_by_name(other_product, variable->name, &other_variable) != 0)
+        if (harp_variable_grow_time_capacity(product->variable[i], time_length) != 0)
         {
-            assert(0);
-            exit(1);
+            return -1;
         }
-        if (harp_variable_append(variable, other_variable) != 0)
+    }
+
+    /* append all variables */
+    for (k = 0; k < num_products; k++)
+    {
+        for (i = 0; i < product->num_variables; i++)
         {
-            return -1;
+            variable = product->variable[i];
+            if (harp_product_get_variable_by_name(other_product[k], variable->name, &other_variable) != 0)
+            {
+                assert(0);
+                exit(1);
+            }
+            if (harp_variable_append(variable, other_variable) != 0)
+            {
+                return -1;
+            }
         }
+        product->dimension[harp_dimension_time] += other_product[k]->dimension[harp_dimension_time];
     }
-    product->dimension[harp_dimension_time] += other_product->dimension[harp_dimension_time];
 
     return 0;
 }
@@ -1815,6 +1957,35 @@ LIBHARP_API int harp_product_verify(const harp_product *product)
     return 0;
 }
 
+/** Make sure that the data of all variables of a product is available.
+ * For a product that was imported using harp_import_lazy() this reads the data of all variables that have not been
+ * loaded yet. For all other products this function does nothing.
+ * \param product Product whose variable data should be made available.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_product_ensure_loaded(harp_product *product)
+{
+    int i;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        if (harp_variable_ensure_loaded(product->variable[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 /** Print a harp_product struct using the specified print function.
  * \param product Product to print.
  * \param show_attributes Whether or not to print the attributes of variables.
@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2015-2020 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "harp-internal.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef WIN32
+#include "windows.h"
+#else
+#include <sys/time.h>
+#endif
+
+#define PROFILE_ENTRY_BLOCK_SIZE 32
+
+typedef struct profile_entry_struct
+{
+    char *category;
+    char *name;
+    long count;
+    double wall_time;
+    double cpu_time;
+    double num_bytes;
+    double num_elements;
+    double num_pool_bytes;
+} profile_entry;
+
+static long num_profile_entries = 0;
+static profile_entry *profile_entry_list = NULL;
+
+static double get_wall_time(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec * 1.0e-6;
+#endif
+}
+
+/* returns the CPU time of the calling thread (if available, otherwise of the process) */
+static double get_cpu_time(void)
+{
+#ifdef WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+    {
+        return 0;
+    }
+
+    /* FILETIME values are in units of 100 nanoseconds */
+    return ((((unsigned __int64)kernel_time.dwHighDateTime) << 32) + kernel_time.dwLowDateTime +
+            (((unsigned __int64)user_time.dwHighDateTime) << 32) + user_time.dwLowDateTime) * 1.0e-7;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    {
+        return 0;
+    }
+
+    return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static long get_variable_data_size(const harp_variable *variable)
+{
+    if (variable->data_type == harp_type_string)
+    {
+        long num_bytes = 0;
+        long i;
+
+        for (i = 0; i < variable->num_elements; i++)
+        {
+            if (variable->data.string_data[i] != NULL)
+            {
+                num_bytes += (long)strlen(variable->data.string_data[i]);
+            }
+        }
+        return num_bytes;
+    }
+
+    return variable->num_elements * harp_get_size_for_type(variable->data_type);
+}
+
+/* this function does not set the HARP error, since profiling should not interfere with the actual processing */
+static int add_entry(const char *category, const char *name, long *index)
+{
+    profile_entry *entry;
+
+    if (num_profile_entries % PROFILE_ENTRY_BLOCK_SIZE == 0)
+    {
+        profile_entry *new_entry_list;
+
+        new_entry_list = realloc(profile_entry_list,
+                                 (num_profile_entries + PROFILE_ENTRY_BLOCK_SIZE) * sizeof(profile_entry));
+        if (new_entry_list == NULL)
+        {
+            return -1;
+        }
+        profile_entry_list = new_entry_list;
+    }
+    entry = &profile_entry_list[num_profile_entries];
+
+    entry->category = strdup(category);
+    if (entry->category == NULL)
+    {
+        return -1;
+    }
+    entry->name = strdup(name);
+    if (entry->name == NULL)
+    {
+        free(entry->category);
+        return -1;
+    }
+    entry->count = 0;
+    entry->wall_time = 0;
+    entry->cpu_time = 0;
+    entry->num_bytes = 0;
+    entry->num_elements = 0;
+    entry->num_pool_bytes = 0;
+
+    *index = num_profile_entries;
+    num_profile_entries++;
+
+    return 0;
+}
+
+static void add_measurement(const harp_profile_timer *timer, const char *category, const char *name,
+                            double num_bytes, double num_elements, double num_pool_bytes)
+{
+    double wall_time;
+    double cpu_time;
+
+    wall_time = get_wall_time() - timer->wall_time;
+    cpu_time = get_cpu_time() - timer->cpu_time;
+
+    /* measurements can be added from multiple threads during a multi-threaded ingestion */
+#ifdef _OPENMP
+#pragma omp critical (harp_profiling)
+#endif
+    {
+        long index;
+
+        for (index = 0; index < num_profile_entries; index++)
+        {
+            if (strcmp(profile_entry_list[index].name, name) == 0 &&
+                strcmp(profile_entry_list[index].category, category) == 0)
+            {
+                break;
+            }
+        }
+        /* profiling is best effort, so on an allocation failure the measurement is just dropped */
+        if (index < num_profile_entries || add_entry(category, name, &index) == 0)
+        {
+            profile_entry *entry = &profile_entry_list[index];
+
+            entry->count++;
+            entry->wall_time += wall_time;
+            entry->cpu_time += cpu_time;
+            entry->num_bytes += num_bytes;
+            entry->num_elements += num_elements;
+            entry->num_pool_bytes += num_pool_bytes;
+        }
+    }
+}
+
+/* Start a measurement; this does nothing if profiling is disabled. */
+void harp_profile_timer_start(harp_profile_timer *timer)
+{
+    timer->active = harp_option_profiling;
+    if (timer->active)
+    {
+        timer->wall_time = get_wall_time();
+        timer->cpu_time = get_cpu_time();
+    }
+}
+
+/* Add the time since the start of the timer to the profiling results for 'category' and the name of the variable,
+ * together with the size and number of elements of the data of the variable and the number of bytes that were
+ * allocated from the ingestion memory pool while reading the variable. */
+void harp_profile_timer_stop_variable(const harp_profile_timer *timer, const char *category,
+                                      const harp_variable *variable, double num_pool_bytes)
+{
+    if (!timer->active)
+    {
+        return;
+    }
+    add_measurement(timer, category, variable->name, (double)get_variable_data_size(variable),
+                    (double)variable->num_elements, num_pool_bytes);
+}
+
+/* Add the time since the start of the timer to the profiling results for 'category'/'name', together with the total
+ * size and number of elements of the data of the variables in the product. */
+void harp_profile_timer_stop_product(const harp_profile_timer *timer, const char *category, const char *name,
+                                     const harp_product *product)
+{
+    double num_bytes = 0;
+    double num_elements = 0;
+    int i;
+
+    if (!timer->active)
+    {
+        return;
+    }
+    for (i = 0; i < product->num_variables; i++)
+    {
+        num_bytes += get_variable_data_size(product->variable[i]);
+        num_elements += product->variable[i]->num_elements;
+    }
+    add_measurement(timer, category, name, num_bytes, num_elements, 0);
+}
+
+/** \addtogroup harp_general
+ * @{
+ */
+
+/** Remove all profiling results that were gathered so far.
+ * \see harp_set_option_profiling()
+ */
+LIBHARP_API void harp_profiling_clear(void)
+{
+    long i;
+
+    for (i = 0; i < num_profile_entries; i++)
+    {
+        free(profile_entry_list[i].category);
+        free(profile_entry_list[i].name);
+    }
+    if (profile_entry_list != NULL)
+    {
+        free(profile_entry_list);
+        profile_entry_list = NULL;
+    }
+    num_profile_entries = 0;
+}
+
+/** Report a summary of the profiling results using the HARP warning handler.
+ * Each line of the summary contains the category (ingestion, operation, or export), the name of the variable,
+ * operation, or export format, the number of times it was measured, the total wall clock time and CPU time (in
+ * seconds), the total size (in MB) and number of elements of the resulting data, and the total size (in MB) of the
+ * read buffers that were allocated from the ingestion memory pool (only for the ingestion of variables).
+ * If no profiling results are available nothing will be reported.
+ * \see harp_set_option_profiling()
+ */
+LIBHARP_API void harp_profiling_report(void)
+{
+    long i;
+
+    if (num_profile_entries == 0)
+    {
+        return;
+    }
+
+    harp_report_warning("profiling results (category, name, count, wall time [s], cpu time [s], size [MB], "
+                        "elements, pool allocations [MB]):");
+    for (i = 0; i < num_profile_entries; i++)
+    {
+        profile_entry *entry = &profile_entry_list[i];
+
+        harp_report_warning("  %s, %s, %ld, %.6f, %.6f, %.3f, %.0f, %.3f", entry->category, entry->name, entry->count,
+                            entry->wall_time, entry->cpu_time, entry->num_bytes * 1.0e-6, entry->num_elements,
+                            entry->num_pool_bytes * 1.0e-6);
+    }
+}
+
+/** Retrieve the profiling results as a HARP product.
+ * The product contains a single (independent) dimension with one element per measured item and the variables
+ * 'category' (ingestion, operation, or export), 'name' (the variable, operation, or export format), 'count' (number of
+ * measurements), 'wall_time' and 'cpu_time' (totals in seconds), 'num_bytes' and 'num_elements' (totals of the
+ * data resulting from the measured actions), and 'num_pool_bytes' (total size of the read buffers that were allocated
+ * from the ingestion memory pool; this is 0 for operations and exports).
+ * \see harp_set_option_profiling()
+ * \param product Pointer to the C variable where the new product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_profiling_get_results(harp_product **product)
+{
+    harp_dimension_type dimension_type = harp_dimension_independent;
+    harp_product *new_product;
+    harp_variable *category;
+    harp_variable *name;
+    harp_variable *count;
+    harp_variable *wall_time;
+    harp_variable *cpu_time;
+    harp_variable *num_bytes;
+    harp_variable *num_elements;
+    harp_variable *num_pool_bytes;
+    long i;
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (harp_product_new(&new_product) != 0)
+    {
+        return -1;
+    }
+    if (harp_variable_new("category", harp_type_string, 1, &dimension_type, &num_profile_entries, &category) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, category) != 0)
+    {
+        harp_variable_delete(category);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("name", harp_type_string, 1, &dimension_type, &num_profile_entries, &name) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, name) != 0)
+    {
+        harp_variable_delete(name);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("count", harp_type_int32, 1, &dimension_type, &num_profile_entries, &count) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, count) != 0)
+    {
+        harp_variable_delete(count);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("wall_time", harp_type_double, 1, &dimension_type, &num_profile_entries, &wall_time) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, wall_time) != 0)
+    {
+        harp_variable_delete(wall_time);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("cpu_time", harp_type_double, 1, &dimension_type, &num_profile_entries, &cpu_time) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, cpu_time) != 0)
+    {
+        harp_variable_delete(cpu_time);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("num_bytes", harp_type_double, 1, &dimension_type, &num_profile_entries, &num_bytes) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, num_bytes) != 0)
+    {
+        harp_variable_delete(num_bytes);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("num_elements", harp_type_double, 1, &dimension_type, &num_profile_entries, &num_elements)
+        != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, num_elements) != 0)
+    {
+        harp_variable_delete(num_elements);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_new("num_pool_bytes", harp_type_double, 1, &dimension_type, &num_profile_entries,
+                          &num_pool_bytes) != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_product_add_variable(new_product, num_pool_bytes) != 0)
+    {
+        harp_variable_delete(num_pool_bytes);
+        harp_product_delete(new_product);
+        return -1;
+    }
+    if (harp_variable_set_unit(wall_time, "s") != 0 || harp_variable_set_unit(cpu_time, "s") != 0)
+    {
+        harp_product_delete(new_product);
+        return -1;
+    }
+
+    for (i = 0; i < num_profile_entries; i++)
+    {
+        profile_entry *entry = &profile_entry_list[i];
+
+        if (harp_variable_set_string_data_element(category, i, entry->category) != 0 ||
+            harp_variable_set_string_data_element(name, i, entry->name) != 0)
+        {
+            harp_product_delete(new_product);
+            return -1;
+        }
+        count->data.int32_data[i] = (int32_t)entry->count;
+        wall_time->data.double_data[i] = entry->wall_time;
+        cpu_time->data.double_data[i] = entry->cpu_time;
+        num_bytes->data.double_data[i] = entry->num_bytes;
+        num_elements->data.double_data[i] = entry->num_elements;
+        num_pool_bytes->data.double_data[i] = entry->num_pool_bytes;
+    }
+
+    *product = new_product;
+
+    return 0;
+}
+
+/** @} */
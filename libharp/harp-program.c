@@ -116,11 +116,42 @@ int harp_program_add_operation(harp_program *program, harp_operation *operation)
     return 0;
 }
 
+/* evaluate a string value filter for element 'index' of the variable
+ * for variables that store their strings in a string arena the filter only needs to be evaluated once for each
+ * distinct value (from the dictionary of the arena); 'value_result' caches these results (-1 means not evaluated yet)
+ */
+static int eval_string_value_filter(harp_operation_string_value_filter *operation, const harp_variable *variable,
+                                    long index, int8_t *value_result)
+{
+    long value_index = -1;
+    int result;
+
+    if (value_result != NULL)
+    {
+        value_index = harp_string_arena_get_value_index(HARP_VARIABLE_INTERNAL(variable)->string_arena,
+                                                        variable->data.string_data[index]);
+        if (value_index >= 0 && value_result[value_index] >= 0)
+        {
+            return value_result[value_index];
+        }
+    }
+    result = operation->eval(operation, variable->num_enum_values, variable->enum_name, variable->data_type,
+                             &variable->data.string_data[index]);
+    if (value_index >= 0 && result >= 0)
+    {
+        value_result[value_index] = (int8_t)result;
+    }
+
+    return result;
+}
+
 static int execute_value_filter(harp_product *product, harp_program *program)
 {
     harp_dimension_mask_set *dimension_mask_set = NULL;
     harp_variable *variable;
     const char *variable_name;
+    int8_t *value_result = NULL;
+    long num_values = 0;
     int num_operations = 1;
     int data_type_size;
     long i, j;
@@ -174,6 +205,23 @@ static int execute_value_filter(harp_product *product, harp_program *program)
         }
     }
 
+    if (variable->data_type == harp_type_string && HARP_VARIABLE_INTERNAL(variable)->string_arena != NULL &&
+        variable->num_dimensions > 0)
+    {
+        num_values = HARP_VARIABLE_INTERNAL(variable)->string_arena->num_values;
+        if (num_values > 0)
+        {
+            value_result = (int8_t *)malloc(num_operations * num_values * sizeof(int8_t));
+            if (value_result == NULL)
+            {
+                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                               num_operations * num_values * sizeof(int8_t), __FILE__, __LINE__);
+                return -1;
+            }
+            memset(value_result, -1, num_operations * num_values * sizeof(int8_t));
+        }
+    }
+
     if (variable->num_dimensions == 0)
     {
         for (k = 0; k < num_operations; k++)
@@ -197,7 +245,7 @@ static int execute_value_filter(harp_product *product, harp_program *program)
             }
             if (result < 0)
             {
-                return -1;
+                goto error;
             }
             if (result == 0)
             {
@@ -213,13 +261,12 @@ static int execute_value_filter(harp_product *product, harp_program *program)
 
         if (harp_dimension_mask_set_new(&dimension_mask_set) != 0)
         {
-            return -1;
+            goto error;
         }
 
         if (harp_dimension_mask_new(variable->num_dimensions, variable->dimension, &dimension_mask) != 0)
         {
-            harp_dimension_mask_set_delete(dimension_mask_set);
-            return -1;
+            goto error;
         }
         dimension_mask_set[variable->dimension_type[0]] = dimension_mask;
 
@@ -238,9 +285,8 @@ static int execute_value_filter(harp_product *product, harp_program *program)
                         harp_operation_string_value_filter *string_operation;
 
                         string_operation = (harp_operation_string_value_filter *)operation;
-                        result = string_operation->eval(string_operation, variable->num_enum_values,
-                                                        variable->enum_name, variable->data_type,
-                                                        &variable->data.int8_data[i * data_type_size]);
+                        result = eval_string_value_filter(string_operation, variable, i,
+                                                          value_result == NULL ? NULL : &value_result[k * num_values]);
                     }
                     else
                     {
@@ -252,8 +298,7 @@ static int execute_value_filter(harp_product *product, harp_program *program)
                     }
                     if (result < 0)
                     {
-                        harp_dimension_mask_set_delete(dimension_mask_set);
-                        return -1;
+                        goto error;
                     }
                     dimension_mask->mask[i] = result;
                 }
@@ -266,8 +311,7 @@ static int execute_value_filter(harp_product *product, harp_program *program)
 
         if (harp_product_filter(product, dimension_mask_set) != 0)
         {
-            harp_dimension_mask_set_delete(dimension_mask_set);
-            return -1;
+            goto error;
         }
 
         harp_dimension_mask_set_delete(dimension_mask_set);
@@ -285,19 +329,19 @@ static int execute_value_filter(harp_product *product, harp_program *program)
 
         if (harp_dimension_mask_set_new(&dimension_mask_set) != 0)
         {
-            return -1;
+            goto error;
         }
 
         if (harp_dimension_mask_new(1, variable->dimension, &dimension_mask_set[harp_dimension_time]) != 0)
         {
-            return -1;
+            goto error;
         }
         time_mask = dimension_mask_set[harp_dimension_time];
 
         if (harp_dimension_mask_new(variable->num_dimensions, variable->dimension, &dimension_mask_set[dimension_type])
             != 0)
         {
-            return -1;
+            goto error;
         }
         dimension_mask = dimension_mask_set[dimension_type];
 
@@ -321,9 +365,9 @@ static int execute_value_filter(harp_product *product, harp_program *program)
                             harp_operation_string_value_filter *string_operation;
 
                             string_operation = (harp_operation_string_value_filter *)operation;
-                            result = string_operation->eval(string_operation, variable->num_enum_values,
-                                                            variable->enum_name, variable->data_type,
-                                                            &variable->data.int8_data[index * data_type_size]);
+                            result = eval_string_value_filter(string_operation, variable, index,
+                                                              value_result == NULL ? NULL :
+                                                              &value_result[k * num_values]);
                         }
                         else
                         {
@@ -335,8 +379,7 @@ static int execute_value_filter(harp_product *product, harp_program *program)
                         }
                         if (result < 0)
                         {
-                            harp_dimension_mask_set_delete(dimension_mask_set);
-                            return -1;
+                            goto error;
                         }
                         dimension_mask->mask[index] = result;
                     }
@@ -360,8 +403,7 @@ static int execute_value_filter(harp_product *product, harp_program *program)
 
         if (harp_product_filter(product, dimension_mask_set) != 0)
         {
-            harp_dimension_mask_set_delete(dimension_mask_set);
-            return -1;
+            goto error;
         }
 
         harp_dimension_mask_set_delete(dimension_mask_set);
@@ -369,13 +411,27 @@ static int execute_value_filter(harp_product *product, harp_program *program)
     else
     {
         harp_set_error(HARP_ERROR_OPERATION, "variable '%s' has invalid dimensions for filtering", variable_name);
-        return -1;
+        goto error;
+    }
+
+    if (value_result != NULL)
+    {
+        free(value_result);
     }
 
     /* jump to the last operation in the list that we performed */
     program->current_index += num_operations - 1;
 
     return 0;
+
+  error:
+    harp_dimension_mask_set_delete(dimension_mask_set);
+    if (value_result != NULL)
+    {
+        free(value_result);
+    }
+
+    return -1;
 }
 
 static int execute_index_filter(harp_product *product, harp_program *program)
@@ -483,22 +539,38 @@ static int execute_point_filter(harp_product *product, harp_program *program)
 
     for (i = 0; i < num_points; i++)
     {
-        harp_spherical_point point;
+        mask[i] = 1;
+    }
 
-        point.lat = latitude->data.double_data[i];
-        point.lon = longitude->data.double_data[i];
-        harp_spherical_point_rad_from_deg(&point);
-        harp_spherical_point_check(&point);
+    for (k = 0; k < num_operations; k++)
+    {
+        harp_operation_point_filter *operation;
 
-        mask[i] = 1;
-        for (k = 0; k < num_operations; k++)
+        operation = (harp_operation_point_filter *)program->operation[program->current_index + k];
+        if (operation->type == operation_point_distance_filter)
+        {
+            harp_operation_point_distance_filter *distance_filter = (harp_operation_point_distance_filter *)operation;
+
+            /* evaluate the distance filter for all points at once */
+            harp_spherical_point_distance_filter(&distance_filter->point,
+                                                 distance_filter->distance / CONST_EARTH_RADIUS_WGS84_SPHERE,
+                                                 num_points, latitude->data.double_data,
+                                                 longitude->data.double_data, mask);
+            continue;
+        }
+
+        for (i = 0; i < num_points; i++)
         {
             if (mask[i])
             {
-                harp_operation_point_filter *operation;
+                harp_spherical_point point;
                 int result;
 
-                operation = (harp_operation_point_filter *)program->operation[program->current_index + k];
+                point.lat = latitude->data.double_data[i];
+                point.lon = longitude->data.double_data[i];
+                harp_spherical_point_rad_from_deg(&point);
+                harp_spherical_point_check(&point);
+
                 result = operation->eval(operation, &point);
                 if (result < 0)
                 {
@@ -710,6 +782,21 @@ static int execute_bin_spatial(harp_product *product, harp_operation_bin_spatial
                                          operation->num_longitude_edges, operation->longitude_edges);
 }
 
+static int execute_bin_spatial_with_weights(harp_product *product, harp_operation_bin_spatial_with_weights *operation)
+{
+    /* the weight table is read only once and kept with the operation, so it is reused when the program is executed
+     * for multiple products */
+    if (operation->weights == NULL)
+    {
+        if (harp_import(operation->weights_filename, NULL, NULL, &operation->weights) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return harp_product_bin_spatial_with_weights_full(product, operation->weights);
+}
+
 static int execute_bin_with_variables(harp_product *product, harp_operation_bin_with_variables *operation)
 {
     return harp_product_bin_with_variable(product, operation->num_variables, (const char **)operation->variable_name);
@@ -1247,12 +1334,142 @@ static int execute_wrap(harp_product *product, harp_operation_wrap *operation)
     return 0;
 }
 
+/* name of the operation as used in the profiling results */
+static const char *get_operation_name(const harp_operation *operation)
+{
+    switch (operation->type)
+    {
+        case operation_area_covers_area_filter:
+            return "area_covers_area";
+        case operation_area_covers_point_filter:
+            return "area_covers_point";
+        case operation_area_inside_area_filter:
+            return "area_inside_area";
+        case operation_area_intersects_area_filter:
+            return "area_intersects_area";
+        case operation_bin_collocated:
+        case operation_bin_full:
+        case operation_bin_with_variables:
+            return "bin";
+        case operation_bin_spatial:
+        case operation_bin_spatial_with_weights:
+            return "bin_spatial";
+        case operation_bit_mask_filter:
+            return "bit_mask_filter";
+        case operation_clamp:
+            return "clamp";
+        case operation_collocation_filter:
+            return "collocate";
+        case operation_comparison_filter:
+            return "comparison_filter";
+        case operation_derive_variable:
+            return "derive";
+        case operation_derive_smoothed_column_collocated_dataset:
+        case operation_derive_smoothed_column_collocated_product:
+            return "derive_smoothed_column";
+        case operation_exclude_variable:
+            return "exclude";
+        case operation_flatten:
+            return "flatten";
+        case operation_index_comparison_filter:
+            return "index_comparison_filter";
+        case operation_index_membership_filter:
+            return "index_membership_filter";
+        case operation_keep_variable:
+            return "keep";
+        case operation_longitude_range_filter:
+            return "longitude_range";
+        case operation_membership_filter:
+            return "membership_filter";
+        case operation_point_distance_filter:
+            return "point_distance";
+        case operation_point_in_area_filter:
+            return "point_in_area";
+        case operation_regrid:
+        case operation_regrid_collocated_dataset:
+        case operation_regrid_collocated_product:
+            return "regrid";
+        case operation_rename:
+            return "rename";
+        case operation_set:
+            return "set";
+        case operation_smooth_collocated_dataset:
+        case operation_smooth_collocated_product:
+            return "smooth";
+        case operation_sort:
+            return "sort";
+        case operation_squash:
+            return "squash";
+        case operation_string_comparison_filter:
+            return "string_comparison_filter";
+        case operation_string_membership_filter:
+            return "string_membership_filter";
+        case operation_valid_range_filter:
+            return "valid";
+        case operation_wrap:
+            return "wrap";
+    }
+
+    assert(0);
+    exit(1);
+}
+
+/* name used in the profiling results for the operations first_index..last_index that were executed together;
+ * the names of the operations are joined with '+' (e.g. "comparison_filter+valid") and truncated to 'buffer_size'
+ */
+static const char *get_operation_group_name(const harp_program *program, int first_index, int last_index,
+                                            char *buffer, size_t buffer_size)
+{
+    size_t length = 0;
+    int i;
+
+    if (first_index == last_index)
+    {
+        return get_operation_name(program->operation[first_index]);
+    }
+
+    buffer[0] = '\0';
+    for (i = first_index; i <= last_index; i++)
+    {
+        const char *name = get_operation_name(program->operation[i]);
+
+        if (length + strlen(name) + 1 >= buffer_size)
+        {
+            break;
+        }
+        if (i > first_index)
+        {
+            buffer[length] = '+';
+            length++;
+        }
+        strcpy(&buffer[length], name);
+        length += strlen(name);
+    }
+
+    return buffer;
+}
+
 /* this will start with the operation at program->current_index */
 int harp_product_execute_program(harp_product *product, harp_program *program)
 {
     while (program->current_index < program->num_operations)
     {
         harp_operation *operation = program->operation[program->current_index];
+        int first_index = program->current_index;
+        char group_name[128];
+        harp_profile_timer timer;
+
+        /* for lazily imported products, variables only need to be read once an operation uses the variable data */
+        if (operation->type != operation_exclude_variable && operation->type != operation_keep_variable &&
+            operation->type != operation_rename && operation->type != operation_set)
+        {
+            if (harp_product_ensure_loaded(product) != 0)
+            {
+                return -1;
+            }
+        }
+
+        harp_profile_timer_start(&timer);
 
         /* note that some consecutive filter operations can be executed together for optimization purposes */
         /* so the filter functions below may increase program->current_index itself */
@@ -1317,6 +1534,13 @@ int harp_product_execute_program(harp_product *product, harp_program *program)
                     return -1;
                 }
                 break;
+            case operation_bin_spatial_with_weights:
+                if (execute_bin_spatial_with_weights(product, (harp_operation_bin_spatial_with_weights *)operation)
+                    != 0)
+                {
+                    return -1;
+                }
+                break;
             case operation_bin_with_variables:
                 if (execute_bin_with_variables(product, (harp_operation_bin_with_variables *)operation) != 0)
                 {
@@ -1433,6 +1657,15 @@ int harp_product_execute_program(harp_product *product, harp_program *program)
                 break;
         }
 
+        if (timer.active)
+        {
+            /* filters that were executed together are measured as a single group */
+            const char *name = get_operation_group_name(program, first_index, program->current_index, group_name,
+                                                        sizeof(group_name));
+
+            harp_profile_timer_stop_product(&timer, "operation", name, product);
+        }
+
         if (harp_product_is_empty(product))
         {
             /* don't perform any of the remaining actions; just return the empty product */
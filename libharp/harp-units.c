@@ -289,7 +289,8 @@ static void unit_system_done(void)
 
 static int parse_unit(const char *str, ut_unit **new_unit)
 {
-    ut_unit *unit;
+    ut_unit *unit = NULL;
+    int result = 0;
 
     if (str == NULL)
     {
@@ -297,15 +298,28 @@ static int parse_unit(const char *str, ut_unit **new_unit)
         return -1;
     }
 
-    if (unit_system_init() != 0)
+    /* the udunits2 parser and status are global, so only one thread at a time may use them (variables of a product
+     * can be ingested by multiple threads, see harp_set_option_ingestion_num_threads()) */
+#ifdef _OPENMP
+#pragma omp critical (harp_udunits)
+#endif
     {
-        return -1;
+        if (unit_system_init() != 0)
+        {
+            result = -1;
+        }
+        else
+        {
+            unit = ut_parse(unit_system, str, UT_ASCII);
+            if (unit == NULL)
+            {
+                handle_udunits_error();
+                result = -1;
+            }
+        }
     }
-
-    unit = ut_parse(unit_system, str, UT_ASCII);
-    if (unit == NULL)
+    if (result != 0)
     {
-        handle_udunits_error();
         return -1;
     }
 
@@ -375,10 +389,18 @@ int harp_unit_converter_new(const char *from_unit, const char *to_unit, harp_uni
         return -1;
     }
 
-    unit_converter->converter = ut_get_converter(from_udunit, to_udunit);
+#ifdef _OPENMP
+#pragma omp critical (harp_udunits)
+#endif
+    {
+        unit_converter->converter = ut_get_converter(from_udunit, to_udunit);
+        if (unit_converter->converter == NULL)
+        {
+            handle_udunits_error();
+        }
+    }
     if (unit_converter->converter == NULL)
     {
-        handle_udunits_error();
         harp_unit_converter_delete(unit_converter);
         ut_free(to_udunit);
         ut_free(from_udunit);
@@ -30,6 +30,7 @@
  */
 
 #include "harp-internal.h"
+#include "hashtable.h"
 
 #include <assert.h>
 #include <math.h>
@@ -41,6 +42,251 @@
  * The HARP Variables module contains everything related to HARP variables.
  */
 
+static int string_arena_contains(const harp_string_arena *arena, const char *str)
+{
+    return arena != NULL && str != NULL && str >= arena->data && str < arena->data + arena->size;
+}
+
+static void string_arena_delete(harp_string_arena *arena)
+{
+    if (arena->data != NULL)
+    {
+        free(arena->data);
+    }
+    if (arena->value_offset != NULL)
+    {
+        free(arena->value_offset);
+    }
+    if (arena->dictionary != NULL)
+    {
+        hashtable_delete(arena->dictionary);
+    }
+    free(arena);
+}
+
+static int string_arena_new(harp_string_arena **new_arena)
+{
+    harp_string_arena *arena;
+
+    arena = (harp_string_arena *)malloc(sizeof(harp_string_arena));
+    if (arena == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(harp_string_arena), __FILE__, __LINE__);
+        return -1;
+    }
+    arena->data = NULL;
+    arena->size = 0;
+    arena->allocated_size = 0;
+    arena->num_values = 0;
+    arena->value_offset = NULL;
+    arena->dictionary = NULL;
+
+    arena->dictionary = hashtable_new(1);
+    if (arena->dictionary == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        string_arena_delete(arena);
+        return -1;
+    }
+
+    *new_arena = arena;
+    return 0;
+}
+
+/* move the arena data to a larger block of memory
+ * the first 'num_elements' entries of 'string_data' that point into the arena are moved along
+ */
+static int string_arena_grow(harp_string_arena *arena, size_t size, long num_elements, char **string_data)
+{
+    size_t allocated_size;
+    char *data;
+    long i;
+
+    /* grow geometrically, so the arena is only moved a logarithmic number of times */
+    allocated_size = 2 * arena->allocated_size;
+    if (allocated_size < size)
+    {
+        allocated_size = size;
+    }
+    data = (char *)malloc(allocated_size);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       allocated_size, __FILE__, __LINE__);
+        return -1;
+    }
+    if (arena->size > 0)
+    {
+        memcpy(data, arena->data, arena->size);
+        for (i = 0; i < num_elements; i++)
+        {
+            if (string_arena_contains(arena, string_data[i]))
+            {
+                string_data[i] = &data[string_data[i] - arena->data];
+            }
+        }
+    }
+    if (arena->data != NULL)
+    {
+        free(arena->data);
+    }
+    arena->data = data;
+    arena->allocated_size = allocated_size;
+
+    /* the dictionary refers to the strings in the arena, so it needs to be rebuilt */
+    hashtable_delete(arena->dictionary);
+    arena->dictionary = hashtable_new(1);
+    if (arena->dictionary == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not create hashtable) (%s:%u)", __FILE__,
+                       __LINE__);
+        return -1;
+    }
+    for (i = 0; i < arena->num_values; i++)
+    {
+        hashtable_add_name(arena->dictionary, &arena->data[arena->value_offset[i]]);
+    }
+
+    return 0;
+}
+
+/* find the string 'str' of 'length' bytes (which does not need to be zero terminated) in the dictionary of the arena
+ * and add it to the arena if it is not there yet
+ * if the arena needs to grow, the first 'num_elements' entries of 'string_data' that point into the arena are moved
+ * along
+ */
+static int string_arena_add(harp_string_arena *arena, long num_elements, char **string_data, const char *str,
+                            size_t length, char **arena_str)
+{
+    long index;
+
+    index = hashtable_get_index_from_name_n(arena->dictionary, str, (int)length);
+    if (index >= 0)
+    {
+        *arena_str = &arena->data[arena->value_offset[index]];
+        return 0;
+    }
+
+    if (arena->size + length + 1 > arena->allocated_size)
+    {
+        if (string_arena_grow(arena, arena->size + length + 1, num_elements, string_data) != 0)
+        {
+            return -1;
+        }
+    }
+    if (arena->num_values == 0 || (arena->num_values >= BLOCK_SIZE &&
+                                   (arena->num_values & (arena->num_values - 1)) == 0))
+    {
+        size_t *value_offset;
+        long num_allocated;
+
+        /* the capacity of value_offset is doubled each time num_values reaches a power of two */
+        num_allocated = arena->num_values == 0 ? BLOCK_SIZE : 2 * arena->num_values;
+        value_offset = (size_t *)realloc(arena->value_offset, num_allocated * sizeof(size_t));
+        if (value_offset == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           num_allocated * sizeof(size_t), __FILE__, __LINE__);
+            return -1;
+        }
+        arena->value_offset = value_offset;
+    }
+
+    *arena_str = &arena->data[arena->size];
+    memcpy(*arena_str, str, length);
+    (*arena_str)[length] = '\0';
+    arena->value_offset[arena->num_values] = arena->size;
+    hashtable_add_name(arena->dictionary, *arena_str);
+    arena->num_values++;
+    arena->size += length + 1;
+
+    return 0;
+}
+
+/* free a string of a string variable, unless it is stored in the string arena of the variable */
+void harp_string_arena_free_string(const harp_string_arena *arena, char *str)
+{
+    if (str != NULL && !string_arena_contains(arena, str))
+    {
+        free(str);
+    }
+}
+
+/* returns the index of 'str' in the dictionary of the arena, or -1 if 'str' is not stored in the arena */
+long harp_string_arena_get_value_index(const harp_string_arena *arena, const char *str)
+{
+    size_t offset;
+    long low;
+    long high;
+
+    if (!string_arena_contains(arena, str))
+    {
+        return -1;
+    }
+
+    /* values are stored in the arena in the order in which they were added, so we can use a binary search */
+    offset = str - arena->data;
+    low = 0;
+    high = arena->num_values - 1;
+    while (low <= high)
+    {
+        long middle = (low + high) / 2;
+
+        if (arena->value_offset[middle] == offset)
+        {
+            return middle;
+        }
+        if (arena->value_offset[middle] < offset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+/* store the strings from 'source' (which can contain NULL entries) in the string arena of the variable and let
+ * string_data[offset..offset + num_strings) refer to them
+ */
+static int variable_add_strings_to_arena(harp_variable *variable, long offset, long num_strings, char **source)
+{
+    harp_variable_internal *internal = HARP_VARIABLE_INTERNAL(variable);
+    char **target = &variable->data.string_data[offset];
+    long i;
+
+    if (internal->string_arena == NULL)
+    {
+        if (string_arena_new(&internal->string_arena) != 0)
+        {
+            return -1;
+        }
+    }
+    for (i = 0; i < num_strings; i++)
+    {
+        if (source[i] == NULL)
+        {
+            target[i] = NULL;
+        }
+        else if (i > 0 && source[i] == source[i - 1])
+        {
+            target[i] = target[i - 1];
+        }
+        else if (string_arena_add(internal->string_arena, offset + i, variable->data.string_data, source[i],
+                                  strlen(source[i]), &target[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 static void write_scalar(harp_scalar data, harp_data_type data_type, int (*print) (const char *, ...))
 {
     switch (data_type)
@@ -432,6 +678,7 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
         }
 
         variable->data.ptr = variable_data;
+        HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
     }
 
     /* Determine the positions where the old elements should end up.
@@ -519,10 +766,7 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
                     string_data = (char **)&to_ptr[j * filter_block_size];
                     for (k = 0; k < num_block_elements; k++)
                     {
-                        if (string_data[k] != NULL)
-                        {
-                            free(string_data[k]);
-                        }
+                        harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena, string_data[k]);
                     }
                 }
             }
@@ -602,11 +846,12 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
                     {
                         char **string_data;
 
-                        /* duplicate all strings in the block */
+                        /* duplicate all strings in the block (strings in the arena can be shared) */
                         string_data = (char **)&to_ptr[to_id * filter_block_size];
                         for (k = 0; k < num_block_elements; k++)
                         {
-                            if (string_data[k] != NULL)
+                            if (string_data[k] != NULL &&
+                                !string_arena_contains(HARP_VARIABLE_INTERNAL(variable)->string_arena, string_data[k]))
                             {
                                 string_data[k] = strdup(string_data[k]);
                                 if (string_data[k] == NULL)
@@ -652,6 +897,7 @@ int harp_variable_rearrange_dimension(harp_variable *variable, int dim_index, lo
             return -1;
         }
         variable->data.ptr = variable_data;
+        HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
     }
 
     /* update variable properties */
@@ -776,10 +1022,7 @@ int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const
 
                     for (k = 0; k < num_block_elements; k++)
                     {
-                        if (string_data[k] != NULL)
-                        {
-                            free(string_data[k]);
-                        }
+                        harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena, string_data[k]);
                     }
                 }
             }
@@ -794,6 +1037,7 @@ int harp_variable_filter_dimension(harp_variable *variable, int dim_index, const
         return -1;
     }
     variable->data.ptr = variable_data;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
 
     /* update variable properties */
     variable->num_elements = new_num_elements;
@@ -870,10 +1114,8 @@ int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long
                 /* remove trailing strings */
                 for (j = length * num_block_elements; j < variable->dimension[dim_index] * num_block_elements; j++)
                 {
-                    if (variable->data.string_data[from_offset + j] != NULL)
-                    {
-                        free(variable->data.string_data[from_offset + j]);
-                    }
+                    harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena,
+                                                  variable->data.string_data[from_offset + j]);
                 }
             }
 
@@ -895,6 +1137,7 @@ int harp_variable_resize_dimension(harp_variable *variable, int dim_index, long
         return -1;
     }
     variable->data.ptr = data;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
 
     if (length > variable->dimension[dim_index])
     {
@@ -1043,6 +1286,7 @@ int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dim
         return -1;
     }
     variable->data.ptr = data;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
 
     for (i = num_blocks - 1; i >= 0; i--)
     {
@@ -1062,10 +1306,11 @@ int harp_variable_add_dimension(harp_variable *variable, int dim_index, harp_dim
             {
                 char **string_data = (char **)to_ptr;
 
-                /* duplicate all strings in the block (except for the first block) */
+                /* duplicate all strings in the block (except for the first block and strings in the arena) */
                 for (k = 0; k < num_block_elements; k++)
                 {
-                    if (string_data[k] != NULL)
+                    if (string_data[k] != NULL &&
+                        !string_arena_contains(HARP_VARIABLE_INTERNAL(variable)->string_arena, string_data[k]))
                     {
                         string_data[k] = strdup(string_data[k]);
                         if (string_data[k] == NULL)
@@ -1207,24 +1452,18 @@ int harp_variable_squash_dimension(harp_variable *variable, int dim_index)
     return harp_variable_remove_dimension(variable, dim_index, 0);
 }
 
-/** \addtogroup harp_variable
- * @{
- */
+static void variable_loader_delete(struct harp_variable_loader_struct *loader)
+{
+    if (loader->done != NULL)
+    {
+        loader->done(loader->user_data);
+    }
+    free(loader);
+}
 
-/** Create new variable.
- * \param name Name of the variable.
- * \param data_type Storage type of the variable data.
- * \param num_dimensions Number of array dimensions (use '0' for scalar data).
- * \param dimension_type Array with the dimension type for each of the dimensions.
- * \param dimension Array with length for each of the dimensions.
- * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
- */
-LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, int num_dimensions,
-                                  const harp_dimension_type *dimension_type, const long *dimension,
-                                  harp_variable **new_variable)
+static int variable_new(const char *name, harp_data_type data_type, int num_dimensions,
+                        const harp_dimension_type *dimension_type, const long *dimension, int with_data,
+                        harp_variable **new_variable)
 {
     harp_variable *variable;
     int i;
@@ -1274,11 +1513,11 @@ LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, in
         }
     }
 
-    variable = (harp_variable *)malloc(sizeof(harp_variable));
+    variable = (harp_variable *)malloc(sizeof(harp_variable_internal));
     if (variable == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(harp_variable), __FILE__, __LINE__);
+                       sizeof(harp_variable_internal), __FILE__, __LINE__);
         return -1;
     }
     variable->name = NULL;
@@ -1289,6 +1528,9 @@ LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, in
     variable->unit = NULL;
     variable->num_enum_values = 0;
     variable->enum_name = NULL;
+    HARP_VARIABLE_INTERNAL(variable)->loader = NULL;
+    HARP_VARIABLE_INTERNAL(variable)->string_arena = NULL;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
 
     variable->num_elements = 1;
     for (i = 0; i < num_dimensions; i++)
@@ -1307,15 +1549,18 @@ LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, in
         return -1;
     }
 
-    variable->data.ptr = malloc((size_t)variable->num_elements * harp_get_size_for_type(data_type));
-    if (variable->data.ptr == NULL)
+    if (with_data)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       variable->num_elements * harp_get_size_for_type(data_type), __FILE__, __LINE__);
-        harp_variable_delete(variable);
-        return -1;
+        variable->data.ptr = malloc((size_t)variable->num_elements * harp_get_size_for_type(data_type));
+        if (variable->data.ptr == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           variable->num_elements * harp_get_size_for_type(data_type), __FILE__, __LINE__);
+            harp_variable_delete(variable);
+            return -1;
+        }
+        memset(variable->data.ptr, 0, (size_t)variable->num_elements * harp_get_size_for_type(data_type));
     }
-    memset(variable->data.ptr, 0, (size_t)variable->num_elements * harp_get_size_for_type(data_type));
 
     if (data_type != harp_type_string)
     {
@@ -1327,6 +1572,64 @@ LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, in
     return 0;
 }
 
+/* Create a new variable without data; the data will be read using 'load' the first time it is needed
+ * (see harp_variable_ensure_loaded()).
+ * On success the variable takes ownership of user_data and will call done(user_data) when the loader is no longer
+ * needed (i.e. once the data is loaded or when the variable is deleted).
+ */
+int harp_variable_new_with_loader(const char *name, harp_data_type data_type, int num_dimensions,
+                                  const harp_dimension_type *dimension_type, const long *dimension,
+                                  harp_variable_load_function load, harp_variable_loader_done_function done,
+                                  void *user_data, harp_variable **new_variable)
+{
+    struct harp_variable_loader_struct *loader;
+    harp_variable *variable;
+
+    loader = (struct harp_variable_loader_struct *)malloc(sizeof(struct harp_variable_loader_struct));
+    if (loader == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       sizeof(struct harp_variable_loader_struct), __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (variable_new(name, data_type, num_dimensions, dimension_type, dimension, 0, &variable) != 0)
+    {
+        free(loader);
+        return -1;
+    }
+
+    loader->load = load;
+    loader->done = done;
+    loader->user_data = user_data;
+    HARP_VARIABLE_INTERNAL(variable)->loader = loader;
+
+    *new_variable = variable;
+    return 0;
+}
+
+/** \addtogroup harp_variable
+ * @{
+ */
+
+/** Create new variable.
+ * \param name Name of the variable.
+ * \param data_type Storage type of the variable data.
+ * \param num_dimensions Number of array dimensions (use '0' for scalar data).
+ * \param dimension_type Array with the dimension type for each of the dimensions.
+ * \param dimension Array with length for each of the dimensions.
+ * \param new_variable Pointer to the C variable where the new HARP variable will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_new(const char *name, harp_data_type data_type, int num_dimensions,
+                                  const harp_dimension_type *dimension_type, const long *dimension,
+                                  harp_variable **new_variable)
+{
+    return variable_new(name, data_type, num_dimensions, dimension_type, dimension, 1, new_variable);
+}
+
 /** Delete variable.
  * Remove variable and all attached attributes.
  * \param variable HARP variable
@@ -1349,14 +1652,16 @@ LIBHARP_API void harp_variable_delete(harp_variable *variable)
 
             for (i = 0; i < variable->num_elements; i++)
             {
-                if (variable->data.string_data[i] != NULL)
-                {
-                    free(variable->data.string_data[i]);
-                }
+                harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena,
+                                              variable->data.string_data[i]);
             }
         }
         free(variable->data.ptr);
     }
+    if (HARP_VARIABLE_INTERNAL(variable)->string_arena != NULL)
+    {
+        string_arena_delete(HARP_VARIABLE_INTERNAL(variable)->string_arena);
+    }
     if (variable->description != NULL)
     {
         free(variable->description);
@@ -1378,6 +1683,10 @@ LIBHARP_API void harp_variable_delete(harp_variable *variable)
         }
         free(variable->enum_name);
     }
+    if (HARP_VARIABLE_INTERNAL(variable)->loader != NULL)
+    {
+        variable_loader_delete(HARP_VARIABLE_INTERNAL(variable)->loader);
+    }
 
     free(variable);
 }
@@ -1395,11 +1704,17 @@ LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_var
     harp_variable *variable;
     long i;
 
-    variable = (harp_variable *)malloc(sizeof(harp_variable));
+    /* loading the data does not change the content of the variable, so it is safe to cast away the const */
+    if (harp_variable_ensure_loaded((harp_variable *)other_variable) != 0)
+    {
+        return -1;
+    }
+
+    variable = (harp_variable *)malloc(sizeof(harp_variable_internal));
     if (variable == NULL)
     {
         harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       sizeof(harp_variable), __FILE__, __LINE__);
+                       sizeof(harp_variable_internal), __FILE__, __LINE__);
         return -1;
     }
     variable->name = NULL;
@@ -1418,6 +1733,9 @@ LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_var
     variable->valid_max = other_variable->valid_max;
     variable->num_enum_values = 0;
     variable->enum_name = NULL;
+    HARP_VARIABLE_INTERNAL(variable)->loader = NULL;
+    HARP_VARIABLE_INTERNAL(variable)->string_arena = NULL;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
 
     variable->name = strdup(other_variable->name);
     if (variable->name == NULL)
@@ -1486,17 +1804,12 @@ LIBHARP_API int harp_variable_copy(const harp_variable *other_variable, harp_var
     }
     if (variable->data_type == harp_type_string)
     {
+        /* store the (distinct) strings of the copy in a single block of memory */
         memset(variable->data.ptr, 0, (size_t)variable->num_elements * harp_get_size_for_type(harp_type_string));
-        for (i = 0; i < variable->num_elements; i++)
+        if (variable_add_strings_to_arena(variable, 0, variable->num_elements, other_variable->data.string_data) != 0)
         {
-            variable->data.string_data[i] = strdup(other_variable->data.string_data[i]);
-            if (variable->data.string_data[i] == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
-                harp_variable_delete(variable);
-                return -1;
-            }
+            harp_variable_delete(variable);
+            return -1;
         }
     }
     else
@@ -1538,9 +1851,163 @@ LIBHARP_API int harp_variable_copy_attributes(const harp_variable *variable, har
     return 0;
 }
 
+/* make sure the data block of the variable has room for at least 'num_elements' elements
+ * existing elements are preserved; the content of the additional elements is undefined
+ */
+static int variable_ensure_capacity(harp_variable *variable, long num_elements)
+{
+    long element_size;
+    void *data;
+
+    if (num_elements <= variable->num_elements ||
+        num_elements <= HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements)
+    {
+        return 0;
+    }
+
+    element_size = harp_get_size_for_type(variable->data_type);
+    data = realloc(variable->data.ptr, (size_t)num_elements * element_size);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (size_t)num_elements * element_size, __FILE__, __LINE__);
+        return -1;
+    }
+    variable->data.ptr = data;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = num_elements;
+
+    return 0;
+}
+
+static long get_num_sub_elements(const harp_variable *variable)
+{
+    long num_sub_elements = 1;
+    int i;
+
+    for (i = 1; i < variable->num_dimensions; i++)
+    {
+        num_sub_elements *= variable->dimension[i];
+    }
+
+    return num_sub_elements;
+}
+
+/* make sure that the (time dependent) variable has room for 'time_length' time samples for an append
+ * the first time a variable needs to grow, only the memory that is needed is allocated, such that a single append does
+ * not take more memory than needed; if a variable that already grew before (i.e. during a series of appends) needs more
+ * room, its capacity is at least doubled, such that a series of appends only copies each element a constant number of
+ * times on average
+ */
+int harp_variable_grow_time_capacity(harp_variable *variable, long time_length)
+{
+    long num_sub_elements = get_num_sub_elements(variable);
+    long num_elements = time_length * num_sub_elements;
+
+    if (num_elements <= variable->num_elements ||
+        num_elements <= HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements)
+    {
+        return 0;
+    }
+    if (HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements > 0 && num_elements < 2 * variable->num_elements)
+    {
+        num_elements = 2 * variable->num_elements;
+    }
+
+    return variable_ensure_capacity(variable, num_elements);
+}
+
+/** Reserve memory for appending time samples to a variable.
+ * The data block of the variable is enlarged such that it can hold \a time_capacity time samples. Subsequent calls to
+ * harp_variable_append() that do not exceed this number of time samples will then not need to reallocate the data.
+ * The variable itself (dimensions, data) is not changed by this function.
+ * The variable needs to have the 'time' dimension as first dimension.
+ * \param variable Variable for which memory should be reserved.
+ * \param time_capacity Total number of time samples for which memory should be available.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_reserve_time_capacity(harp_variable *variable, long time_capacity)
+{
+
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (time_capacity < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "time_capacity is negative (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (variable->num_dimensions == 0 || variable->dimension_type[0] != harp_dimension_time)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable needs to be time dependent (%s)", variable->name);
+        return -1;
+    }
+
+    if (harp_variable_ensure_loaded(variable) != 0)
+    {
+        return -1;
+    }
+
+    return variable_ensure_capacity(variable, time_capacity * get_num_sub_elements(variable));
+}
+
+/** Release memory that was reserved for appending time samples to a variable.
+ * The data block of the variable is reduced to the size that is needed for the current number of time samples.
+ * Use this after a series of harp_variable_append() calls (or after harp_variable_reserve_time_capacity()) to
+ * release any memory that was allocated in advance for further appends.
+ * The variable itself (dimensions, data) is not changed by this function.
+ * \param variable Variable for which reserved memory should be released.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_trim_time_capacity(harp_variable *variable)
+{
+    long element_size;
+    void *data;
+
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements <= variable->num_elements)
+    {
+        HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
+        return 0;
+    }
+    if (variable->num_elements == 0)
+    {
+        free(variable->data.ptr);
+        variable->data.ptr = NULL;
+        HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
+        return 0;
+    }
+
+    element_size = harp_get_size_for_type(variable->data_type);
+    data = realloc(variable->data.ptr, (size_t)variable->num_elements * element_size);
+    if (data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (size_t)variable->num_elements * element_size, __FILE__, __LINE__);
+        return -1;
+    }
+    variable->data.ptr = data;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
+
+    return 0;
+}
+
 /** Append one variable to another.
  * Both variables need to have the 'time' dimension as first dimension.
  * And all non-time dimensions need to be the same for both variables.
+ * When \a variable is appended to repeatedly, its data block grows geometrically, so each element is only copied a
+ * constant number of times on average (see also harp_variable_reserve_time_capacity() and
+ * harp_variable_trim_time_capacity()).
  * \param variable Variable to which data should be appended.
  * \param other_variable Variable that should be appended.
  * \return
@@ -1549,9 +2016,7 @@ LIBHARP_API int harp_variable_copy_attributes(const harp_variable *variable, har
  */
 LIBHARP_API int harp_variable_append(harp_variable *variable, const harp_variable *other_variable)
 {
-    void *data;
     long element_size;
-    long new_num_elements;
     long i;
 
     if (strcmp(variable->name, other_variable->name) != 0)
@@ -1599,30 +2064,32 @@ LIBHARP_API int harp_variable_append(harp_variable *variable, const harp_variabl
         }
     }
 
+    if (harp_variable_ensure_loaded(variable) != 0)
+    {
+        return -1;
+    }
+    /* loading the data does not change the content of the variable, so it is safe to cast away the const */
+    if (harp_variable_ensure_loaded((harp_variable *)other_variable) != 0)
+    {
+        return -1;
+    }
+
     element_size = harp_get_size_for_type(variable->data_type);
-    new_num_elements = variable->num_elements + other_variable->num_elements;
-    data = realloc(variable->data.ptr, (size_t)new_num_elements * element_size);
-    if (data == NULL)
+    if (harp_variable_grow_time_capacity(variable, variable->dimension[0] + other_variable->dimension[0]) != 0)
     {
-        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
-                       (size_t)new_num_elements * element_size, __FILE__, __LINE__);
         return -1;
     }
-    variable->data.ptr = data;
 
     if (variable->data_type == harp_type_string)
     {
+        /* the appended strings are stored in the string arena of the variable (only values that are not in its
+         * dictionary yet take up additional space) */
         memset(&variable->data.string_data[variable->num_elements], 0,
                (size_t)other_variable->num_elements * element_size);
-        for (i = 0; i < other_variable->num_elements; i++)
+        if (variable_add_strings_to_arena(variable, variable->num_elements, other_variable->num_elements,
+                                          other_variable->data.string_data) != 0)
         {
-            variable->data.string_data[variable->num_elements + i] = strdup(other_variable->data.string_data[i]);
-            if (variable->data.string_data[variable->num_elements + i] == NULL)
-            {
-                harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not duplicate string) (%s:%u)", __FILE__,
-                               __LINE__);
-                return -1;
-            }
+            return -1;
         }
     }
     else
@@ -1900,11 +2367,7 @@ LIBHARP_API int harp_variable_set_string_data_element(harp_variable *variable, l
         return -1;
     }
 
-    if (variable->data.string_data[index] != NULL)
-    {
-        free(variable->data.string_data[index]);
-    }
-
+    harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena, variable->data.string_data[index]);
     variable->data.string_data[index] = strdup(str);
 
     if (variable->data.string_data[index] == NULL)
@@ -1917,6 +2380,130 @@ LIBHARP_API int harp_variable_set_string_data_element(harp_variable *variable, l
     return 0;
 }
 
+/** Store all strings of a string variable in a single contiguous block of memory.
+ * After packing, each element of the \a string_data array of the variable points into this block (or is NULL), which
+ * avoids a separate memory allocation per string. Each distinct string value is only stored once (i.e. the strings are
+ * dictionary encoded), so elements with the same value will share the same pointer.
+ * Elements should then only be modified using harp_variable_set_string_data_element() (and should not be freed
+ * individually). String variables of imported products and copies of string variables are always stored this way.
+ * \param variable Variable whose string data should be packed.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_pack_string_data(harp_variable *variable)
+{
+    harp_string_arena *arena;
+    char **string_data;
+    long i;
+
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (variable->data_type != harp_type_string)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is of type '%s'; expected '%s' (%s:%u)",
+                       harp_get_data_type_name(variable->data_type), harp_get_data_type_name(harp_type_string),
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    if (harp_variable_ensure_loaded(variable) != 0)
+    {
+        return -1;
+    }
+
+    /* build the new arena using a separate array, so the variable is left untouched if an error occurs */
+    string_data = (char **)malloc((size_t)variable->num_elements * sizeof(char *));
+    if (string_data == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       (size_t)variable->num_elements * sizeof(char *), __FILE__, __LINE__);
+        return -1;
+    }
+    if (string_arena_new(&arena) != 0)
+    {
+        free(string_data);
+        return -1;
+    }
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        const char *str = variable->data.string_data[i];
+
+        if (str == NULL)
+        {
+            string_data[i] = NULL;
+        }
+        else if (string_arena_add(arena, i, string_data, str, strlen(str), &string_data[i]) != 0)
+        {
+            string_arena_delete(arena);
+            free(string_data);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena, variable->data.string_data[i]);
+    }
+    if (HARP_VARIABLE_INTERNAL(variable)->string_arena != NULL)
+    {
+        string_arena_delete(HARP_VARIABLE_INTERNAL(variable)->string_arena);
+    }
+    free(variable->data.ptr);
+    variable->data.string_data = string_data;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
+    HARP_VARIABLE_INTERNAL(variable)->string_arena = arena;
+
+    return 0;
+}
+
+/* Set all elements of a string variable from an array of fixed length strings (as used by the netCDF, HDF4, and HDF5
+ * file formats). The strings in 'buffer' are 'string_length' bytes long and only need to be zero terminated if they
+ * are shorter than that. The distinct string values are stored in a single string arena.
+ */
+int harp_variable_set_string_data_from_char_array(harp_variable *variable, long string_length, const char *buffer)
+{
+    harp_string_arena *arena;
+    long i;
+
+    assert(variable->data_type == harp_type_string);
+
+    if (string_arena_new(&arena) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < variable->num_elements; i++)
+    {
+        const char *str = &buffer[i * string_length];
+        const char *end = memchr(str, '\0', string_length);
+        char *arena_str;
+
+        if (string_arena_add(arena, i, variable->data.string_data, str, end == NULL ? string_length : end - str,
+                             &arena_str) != 0)
+        {
+            /* make sure the variable does not refer to the arena anymore */
+            while (i > 0)
+            {
+                i--;
+                variable->data.string_data[i] = NULL;
+            }
+            string_arena_delete(arena);
+            return -1;
+        }
+        harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena, variable->data.string_data[i]);
+        variable->data.string_data[i] = arena_str;
+    }
+    if (HARP_VARIABLE_INTERNAL(variable)->string_arena != NULL)
+    {
+        string_arena_delete(HARP_VARIABLE_INTERNAL(variable)->string_arena);
+    }
+    HARP_VARIABLE_INTERNAL(variable)->string_arena = arena;
+
+    return 0;
+}
+
 /** Convert the data for the variable such that it matches the given data type.
  * The memory for the block holding the data for the attribute will be resized to match the new data type if needed.
  * You cannot convert string data to numeric data or vice-versa. Conversion from floating point to integer data (or
@@ -2351,6 +2938,7 @@ LIBHARP_API int harp_variable_convert_data_type(harp_variable *variable, harp_da
 
     free(variable->data.ptr);
     variable->data.ptr = data.ptr;
+    HARP_VARIABLE_INTERNAL(variable)->num_allocated_elements = 0;
     variable->data_type = target_data_type;
 
     return 0;
@@ -2422,6 +3010,73 @@ LIBHARP_API int harp_variable_has_unit(const harp_variable *variable, const char
     return (harp_unit_compare(variable->unit, unit) == 0);
 }
 
+/** Make sure that the data of a variable is available.
+ * Variables of products that were imported using harp_import_lazy() only get their data read from file the first time
+ * it is needed. This function reads the data of such a variable if this did not happen yet. For all other variables
+ * this function does nothing.
+ * Call this function before accessing the \a data field of a variable from a lazily imported product.
+ * \param variable Variable whose data should be made available.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_variable_ensure_loaded(harp_variable *variable)
+{
+    struct harp_variable_loader_struct *loader;
+    size_t size;
+
+    if (variable == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "variable is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (HARP_VARIABLE_INTERNAL(variable)->loader == NULL)
+    {
+        return 0;
+    }
+    loader = HARP_VARIABLE_INTERNAL(variable)->loader;
+    assert(variable->data.ptr == NULL);
+
+    size = (size_t)variable->num_elements * harp_get_size_for_type(variable->data_type);
+    variable->data.ptr = malloc(size);
+    if (variable->data.ptr == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)", size,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    memset(variable->data.ptr, 0, size);
+
+    if (loader->load(variable, loader->user_data) != 0)
+    {
+        /* keep the loader, but remove any partially read data */
+        if (variable->data_type == harp_type_string)
+        {
+            long i;
+
+            for (i = 0; i < variable->num_elements; i++)
+            {
+                harp_string_arena_free_string(HARP_VARIABLE_INTERNAL(variable)->string_arena,
+                                              variable->data.string_data[i]);
+            }
+            if (HARP_VARIABLE_INTERNAL(variable)->string_arena != NULL)
+            {
+                string_arena_delete(HARP_VARIABLE_INTERNAL(variable)->string_arena);
+                HARP_VARIABLE_INTERNAL(variable)->string_arena = NULL;
+            }
+        }
+        free(variable->data.ptr);
+        variable->data.ptr = NULL;
+        harp_add_error_message(" (variable '%s')", variable->name);
+        return -1;
+    }
+
+    HARP_VARIABLE_INTERNAL(variable)->loader = NULL;
+    variable_loader_delete(loader);
+
+    return 0;
+}
+
 /** Verify that a variable is internally consistent and complies with conventions.
  * \param variable Variable to verify.
  * \return
@@ -2539,7 +3194,8 @@ LIBHARP_API int harp_variable_verify(const harp_variable *variable)
 
     }
 
-    if (variable->num_elements > 0 && variable->data.ptr == NULL)
+    if (variable->num_elements > 0 && variable->data.ptr == NULL &&
+        HARP_VARIABLE_INTERNAL(variable)->loader == NULL)
     {
         harp_set_error(HARP_ERROR_INVALID_VARIABLE, "number of elements is > 0, but variable contains no data");
         return -1;
@@ -2725,6 +3381,11 @@ LIBHARP_API void harp_variable_print_data(harp_variable *variable, int (*print)
 {
     print("%s", variable->name);
     print(" = ");
+    if (harp_variable_ensure_loaded(variable) != 0)
+    {
+        print("<%s>\n\n", harp_errno_to_string(harp_errno));
+        return;
+    }
     if (variable->num_dimensions <= 1)
     {
         write_array(variable->data, variable->data_type, variable->num_elements, 1, print);
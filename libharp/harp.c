@@ -30,6 +30,7 @@
  */
 
 #include "harp-internal.h"
+#include "harp-area-mask.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -54,7 +55,15 @@ static int harp_init_counter = 0;
 int harp_option_enable_aux_afgl86 = 0;
 int harp_option_enable_aux_usstd76 = 0;
 int harp_option_hdf5_compression = 0;
+int harp_option_hdf5_compression_filter = 0;
+int harp_option_hdf5_shuffle = 0;
+long harp_option_hdf5_chunk_size = 1048576;
+int harp_option_netcdf_unlimited_time = 0;
 int harp_option_regrid_out_of_bounds = 0;
+long harp_option_ingestion_max_range_gap = 8;
+int harp_option_ingestion_num_threads = 1;
+long harp_option_ingestion_cache_size = 1024;
+int harp_option_profiling = 0;
 
 typedef enum file_format_enum
 {
@@ -81,6 +90,21 @@ static file_format format_from_string(const char *format)
     return format_unknown;
 }
 
+static const char *format_to_string(file_format format)
+{
+    switch (format)
+    {
+        case format_hdf4:
+            return "hdf4";
+        case format_hdf5:
+            return "hdf5";
+        case format_netcdf:
+            return "netcdf";
+        default:
+            return "unknown";
+    }
+}
+
 static int determine_file_format(const char *filename, file_format *format)
 {
     unsigned char buffer[DETECTION_BLOCK_SIZE];
@@ -148,8 +172,9 @@ static int determine_file_format(const char *filename, file_format *format)
         return 0;
     }
 
-    /* netCDF */
-    if (statbuf.st_size >= 4 && memcmp(buffer, "CDF", 3) == 0 && (buffer[3] == '\001' || buffer[3] == '\002'))
+    /* netCDF (classic, 64-bit offset, and 64-bit data (CDF-5)) */
+    if (statbuf.st_size >= 4 && memcmp(buffer, "CDF", 3) == 0 &&
+        (buffer[3] == '\001' || buffer[3] == '\002' || buffer[3] == '\005'))
     {
         *format = format_netcdf;
         return 0;
@@ -412,6 +437,149 @@ LIBHARP_API int harp_get_option_hdf5_compression(void)
     return harp_option_hdf5_compression;
 }
 
+/** Set the compression filter to use for storing variables in HDF5 files.
+ * This option is only used when compression is enabled (see harp_set_option_hdf5_compression()).
+ * The szip filter is only applied to numerical variables (string variables will still use deflate) and requires an
+ * HDF5 library with szip encoding support. For szip the compression level is ignored.
+ * \param filter
+ *   \arg 0: Use deflate (zlib) compression (default).
+ *   \arg 1: Use szip compression.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_hdf5_compression_filter(int filter)
+{
+    if (filter != 0 && filter != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filter argument (%d) is not valid (%s:%u)", filter, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_hdf5_compression_filter = filter;
+
+    return 0;
+}
+
+/** Retrieve the compression filter that is used for storing variables in HDF5 files.
+ * \see harp_set_option_hdf5_compression_filter()
+ * \return 0=deflate, 1=szip
+ */
+LIBHARP_API int harp_get_option_hdf5_compression_filter(void)
+{
+    return harp_option_hdf5_compression_filter;
+}
+
+/** Enable/Disable the use of the shuffle filter for storing variables in HDF5 files.
+ * The shuffle filter reorders the bytes of the data elements before compression, which generally improves the
+ * compression ratio of numerical data. This option is only used when compression is enabled (see
+ * harp_set_option_hdf5_compression()).
+ * \param enable
+ *   \arg 0: Disable the shuffle filter (default).
+ *   \arg 1: Enable the shuffle filter.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_hdf5_shuffle(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_hdf5_shuffle = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for the use of the shuffle filter for storing variables in HDF5 files.
+ * \see harp_set_option_hdf5_shuffle()
+ * \return
+ *   \arg \c 0, Shuffle filter is disabled.
+ *   \arg \c 1, Shuffle filter is enabled.
+ */
+LIBHARP_API int harp_get_option_hdf5_shuffle(void)
+{
+    return harp_option_hdf5_shuffle;
+}
+
+/** Set the target chunk size to use for compressed variables in HDF5 files.
+ * Compression in HDF5 requires the data of a variable to be stored in chunks. HARP splits a variable along its
+ * outer-most dimension(s) (which is the time dimension for time dependent variables) such that each chunk contains
+ * at most \a size bytes (but at least one element). Reading part of a compressed variable (such as a time range) then
+ * only requires the chunks that overlap with that part to be decompressed.
+ * A size of 0 stores each variable as a single chunk (as far as the HDF5 chunk limits allow).
+ * The default chunk size is 1MiB (which matches the default HDF5 chunk cache size).
+ * \param size The target chunk size in bytes, or 0 to use a single chunk per variable.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_hdf5_chunk_size(long size)
+{
+    if (size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "size argument (%ld) is not valid (%s:%u)", size, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_hdf5_chunk_size = size;
+
+    return 0;
+}
+
+/** Retrieve the target chunk size that is used for compressed variables in HDF5 files.
+ * \see harp_set_option_hdf5_chunk_size()
+ * \return The target chunk size in bytes (0 means a single chunk per variable).
+ */
+LIBHARP_API long harp_get_option_hdf5_chunk_size(void)
+{
+    return harp_option_hdf5_chunk_size;
+}
+
+/** Enable/Disable storing the time dimension as unlimited (record) dimension in netCDF files.
+ * With an unlimited time dimension, new time samples can be appended to an exported netCDF file without rewriting it
+ * (see harp_export_append()). Such files are always stored using the netCDF-3 64-bit offset format (or the CDF-5
+ * format if a single time sample of a variable is larger than 4GB).
+ * Note that netCDF-3 stores the data of all time dependent variables interleaved per time sample, which makes reading
+ * a single time dependent variable from the file slower than for a file with a fixed time dimension.
+ * \param enable
+ *   \arg 0: Store the time dimension as a fixed dimension (default).
+ *   \arg 1: Store the time dimension as the unlimited (record) dimension.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_netcdf_unlimited_time(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_netcdf_unlimited_time = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for storing the time dimension as unlimited dimension in netCDF files.
+ * \see harp_set_option_netcdf_unlimited_time()
+ * \return
+ *   \arg \c 0, The time dimension is stored as a fixed dimension.
+ *   \arg \c 1, The time dimension is stored as the unlimited (record) dimension.
+ */
+LIBHARP_API int harp_get_option_netcdf_unlimited_time(void)
+{
+    return harp_option_netcdf_unlimited_time;
+}
+
 /** Set how to treat out of bound values during regridding operations.
  * This is only applicable for point interpolation regridding. Any point that falls outside the target grid
  * can be either set to NaN (the default), set to the nearest edge value, or set based on extrapolation (of two nearest
@@ -450,6 +618,159 @@ LIBHARP_API int harp_get_option_regrid_out_of_bounds(void)
     return harp_option_regrid_out_of_bounds;
 }
 
+/** Set the maximum gap for combining reads of subsetted samples during ingestion.
+ * When an ingestion only keeps part of the samples along the time dimension (e.g. because of a filter operation),
+ * variables that an ingestion module can read in ranges are read using a single read per run of consecutive
+ * samples that are kept. Runs that are separated by at most \a gap samples that are not kept are combined into a
+ * single read (the data for the samples in between is read and discarded). A larger gap reduces the number of reads
+ * at the cost of reading more data. A gap of 0 only reads the data of the samples that are kept.
+ * The default gap is 8 samples.
+ * \param gap The maximum number of samples that are not kept between two runs of samples that are combined.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_ingestion_max_range_gap(long gap)
+{
+    if (gap < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "gap argument (%ld) is not valid (%s:%u)", gap, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_ingestion_max_range_gap = gap;
+
+    return 0;
+}
+
+/** Retrieve the maximum gap for combining reads of subsetted samples during ingestion.
+ * \see harp_set_option_ingestion_max_range_gap()
+ * \return The maximum number of samples that are not kept between two runs of samples that are combined.
+ */
+LIBHARP_API long harp_get_option_ingestion_max_range_gap(void)
+{
+    return harp_option_ingestion_max_range_gap;
+}
+
+/** Set the number of threads to use for reading the variables of a product during ingestion.
+ * With more than one thread, the variables of a product are read concurrently, where each thread opens the product
+ * file itself and reads whole variables. This mainly helps when reading from storage with a high latency (such as
+ * network or parallel file systems). The ECMWF GRIB ingestion also uses the threads to decode the GRIB messages of the
+ * vertical levels of a variable in parallel, if the variables themselves are not read in parallel (or if nested
+ * parallelism is enabled in OpenMP).
+ * The resulting product is identical to that of a single threaded ingestion.
+ * Multi-threaded ingestion is only available if HARP was built with OpenMP support and with a thread-safe CODA library
+ * (the HARP_WITH_THREADSAFE_CODA CMake option or --enable-threadsafe-coda configure option). HDF5 based products are
+ * only read in parallel if the HDF5 library is thread-safe and HDF4 based products are never read in parallel. In all
+ * other cases the product is read using a single thread.
+ * By default a single thread is used.
+ * \param num_threads The number of threads to use (1 or more).
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_ingestion_num_threads(int num_threads)
+{
+    if (num_threads < 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_threads argument (%d) is not valid (%s:%u)", num_threads,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+
+    harp_option_ingestion_num_threads = num_threads;
+
+    return 0;
+}
+
+/** Retrieve the number of threads to use for reading the variables of a product during ingestion.
+ * \see harp_set_option_ingestion_num_threads()
+ * \return The number of threads.
+ */
+LIBHARP_API int harp_get_option_ingestion_num_threads(void)
+{
+    return harp_option_ingestion_num_threads;
+}
+
+/** Set the maximum size of the ingestion cache.
+ * When storing a new product in the ingestion cache (see harp_set_ingestion_cache_path()) makes the total size of the
+ * cache directory exceed this size, the least recently used cache entries are removed.
+ * A size of 0 means that the size of the cache is not limited.
+ * The default maximum size is 1024 MB.
+ * \param size The maximum size of the ingestion cache in MB.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_ingestion_cache_size(long size)
+{
+    if (size < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "size argument (%ld) is not valid (%s:%u)", size, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_ingestion_cache_size = size;
+
+    return 0;
+}
+
+/** Retrieve the maximum size of the ingestion cache.
+ * \see harp_set_option_ingestion_cache_size()
+ * \return The maximum size of the ingestion cache in MB (0 means no limit).
+ */
+LIBHARP_API long harp_get_option_ingestion_cache_size(void)
+{
+    return harp_option_ingestion_cache_size;
+}
+
+/** Enable/disable the gathering of profiling results.
+ * When enabled, HARP measures the wall clock time and CPU time of the ingestion of each variable, of each operation
+ * that is performed on a product, and of each export, together with the size and number of elements of the resulting
+ * data. For the ingestion of a variable the size of the read buffers that were allocated from the ingestion memory
+ * pool is measured as well. Measurements are accumulated per variable/operation/export format.
+ * Consecutive filter operations that HARP executes together are measured as a single operation that is named after
+ * all operations in the group (e.g. "comparison_filter+valid").
+ * The results can be retrieved with harp_profiling_get_results() or reported with harp_profiling_report() and are
+ * removed with harp_profiling_clear(). Any remaining results are reported using the HARP warning handler when the
+ * final harp_done() is called.
+ * If the HARP_PROFILING environment variable is set (to a value other than 0) when harp_init() is called, profiling
+ * is enabled automatically.
+ * By default profiling is disabled.
+ * \param enable
+ *   \arg 0: Disable profiling.
+ *   \arg 1: Enable profiling.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_set_option_profiling(int enable)
+{
+    if (enable != 0 && enable != 1)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "enable argument (%d) is not valid (%s:%u)", enable, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    harp_option_profiling = enable;
+
+    return 0;
+}
+
+/** Retrieve the current setting for gathering profiling results.
+ * \see harp_set_option_profiling()
+ * \return
+ *   \arg 0: Profiling is disabled.
+ *   \arg 1: Profiling is enabled.
+ */
+LIBHARP_API int harp_get_option_profiling(void)
+{
+    return harp_option_profiling;
+}
+
 /** Initializes the HARP C library.
  * This function should be called before any other HARP C library function is called (except for
  * harp_set_coda_definition_path(), harp_set_coda_definition_path_conditional(), and harp_set_warning_handler()).
@@ -483,6 +804,14 @@ LIBHARP_API int harp_init(void)
         {
             return -1;
         }
+        if (harp_ingestion_cache_init() != 0)
+        {
+            return -1;
+        }
+        if (getenv("HARP_PROFILING") != NULL && strcmp(getenv("HARP_PROFILING"), "0") != 0)
+        {
+            harp_option_profiling = 1;
+        }
     }
 
     harp_init_counter++;
@@ -511,42 +840,71 @@ LIBHARP_API void harp_done(void)
             harp_unit_done();
             harp_derived_variable_list_done();
             harp_ingestion_done();
+            harp_area_mask_done();
             /* explicitly clear search paths in case unit and/or ingestion init() routines were never called */
             harp_set_coda_definition_path(NULL);
             harp_set_udunits2_xml_path(NULL);
+            harp_set_ingestion_cache_path(NULL);
+            harp_profiling_report();
+            harp_profiling_clear();
         }
     }
 }
 
 /** @} */
 
-/** Import a product from a file.
- * \ingroup harp_product
- * This will first try to import the file as an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
- * If the file is not stored using the HARP format then it will try to import it using one of the available ingestion
- * modules.
- * The \a options parameter is optional (can be NULL) and describes the ingestion options. The parameter is only
- * applicable if the file is not already using the HARP format and needs to be converted using one of the ingestion
- * modules.
- * The \a operations parameter is optional (can be NULL) and provides the list of operations that will be performed as
- * part of the import. Some operations, such as filters, can already be performed as part of an import and this may thus
- * be faster than using a harp_product_execute_operations() after a full import of the product.
- * \param[in] filename Path to the file that is to be imported.
- * \param[in] operations string (optional) containing actions to apply as part of the import; should be specified as a
- * semi-colon separated string of operations.
- * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
- * string of key=value pair; only used if the file is not in HARP format.
- * \param[out] product Pointer to a location where a pointer to the ingested product will be stored.
- * \return
- *   \arg \c 0, Success.
- *   \arg \c -1, Error occurred (check #harp_errno).
+static int filter_time_indices(harp_product *product, long num_indices, const long *index)
+{
+    uint8_t *mask;
+    long i;
+
+    if (index[num_indices - 1] >= product->dimension[harp_dimension_time])
+    {
+        harp_set_error(HARP_ERROR_INVALID_INDEX, "time index (%ld) exceeds time dimension length (%ld)",
+                       index[num_indices - 1], product->dimension[harp_dimension_time]);
+        return -1;
+    }
+
+    mask = calloc(product->dimension[harp_dimension_time], sizeof(uint8_t));
+    if (mask == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       product->dimension[harp_dimension_time] * sizeof(uint8_t), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < num_indices; i++)
+    {
+        mask[index[i]] = 1;
+    }
+
+    if (harp_product_filter_dimension(product, harp_dimension_time, mask) != 0)
+    {
+        free(mask);
+        return -1;
+    }
+
+    free(mask);
+
+    return 0;
+}
+
+/* import a product; if 'time_index' is not NULL, only the samples at the given (strictly increasing) indices of the
+ * time dimension are kept (a time selection can not be combined with operations)
  */
-LIBHARP_API int harp_import(const char *filename, const char *operations, const char *options, harp_product **product)
+static int import_product(const char *filename, const char *operations, const char *options, int lazy,
+                          long num_time_indices, const long *time_index, harp_product **product)
 {
     harp_product *imported_product;
     file_format format;
+    int import_lazy;
+    int is_subset = 0;
     int result;
 
+    assert(time_index == NULL || operations == NULL);
+
+    /* when operations are given, we only want to read the variables that remain after any keep()/exclude() */
+    import_lazy = lazy || operations != NULL;
+
     if (determine_file_format(filename, &format) != 0)
     {
         return -1;
@@ -564,14 +922,22 @@ LIBHARP_API int harp_import(const char *filename, const char *operations, const
             break;
         case format_hdf5:
 #ifdef HAVE_HDF5
-            result = harp_import_hdf5(filename, &imported_product);
+            if (time_index != NULL)
+            {
+                result = harp_import_hdf5_time_subset(filename, num_time_indices, time_index, &imported_product);
+                is_subset = (result == 0);
+            }
+            else
+            {
+                result = harp_import_hdf5(filename, import_lazy, &imported_product);
+            }
 #else
             harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
             result = -1;
 #endif
             break;
         case format_netcdf:
-            result = harp_import_netcdf(filename, &imported_product);
+            result = harp_import_netcdf(filename, import_lazy, &imported_product);
             break;
         default:
             harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
@@ -586,7 +952,7 @@ LIBHARP_API int harp_import(const char *filename, const char *operations, const
         }
 
         /* try ingest */
-        if (harp_ingest(filename, operations, options, &imported_product) != 0)
+        if (harp_ingest_cached(filename, operations, options, lazy, &imported_product) != 0)
         {
             return -1;
         }
@@ -608,7 +974,31 @@ LIBHARP_API int harp_import(const char *filename, const char *operations, const
                 return -1;
             }
         }
+    }
+
+    if (time_index != NULL)
+    {
+        if (imported_product->dimension[harp_dimension_time] == 0)
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product '%s' has no time dimension", filename);
+            harp_product_delete(imported_product);
+            return -1;
+        }
 
+        /* the HDF5 backend already applied the selection while reading */
+        if (!is_subset)
+        {
+            if (filter_time_indices(imported_product, num_time_indices, time_index) != 0)
+            {
+                harp_product_delete(imported_product);
+                return -1;
+            }
+        }
+    }
+
+    if (result == 0)
+    {
+        /* operations (and loading of the data) for ingested products are already handled by the ingestion */
         if (operations != NULL)
         {
             if (harp_product_execute_operations(imported_product, operations) != 0)
@@ -617,6 +1007,15 @@ LIBHARP_API int harp_import(const char *filename, const char *operations, const
                 return -1;
             }
         }
+
+        if (!lazy)
+        {
+            if (harp_product_ensure_loaded(imported_product) != 0)
+            {
+                harp_product_delete(imported_product);
+                return -1;
+            }
+        }
     }
 
     *product = imported_product;
@@ -624,6 +1023,162 @@ LIBHARP_API int harp_import(const char *filename, const char *operations, const
     return 0;
 }
 
+/** Import a product from a file.
+ * \ingroup harp_product
+ * This will first try to import the file as an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
+ * If the file is not stored using the HARP format then it will try to import it using one of the available ingestion
+ * modules.
+ * The \a options parameter is optional (can be NULL) and describes the ingestion options. The parameter is only
+ * applicable if the file is not already using the HARP format and needs to be converted using one of the ingestion
+ * modules.
+ * The \a operations parameter is optional (can be NULL) and provides the list of operations that will be performed as
+ * part of the import. Some operations, such as filters, can already be performed as part of an import and this may thus
+ * be faster than using a harp_product_execute_operations() after a full import of the product.
+ * \param[in] filename Path to the file that is to be imported.
+ * \param[in] operations string (optional) containing actions to apply as part of the import; should be specified as a
+ * semi-colon separated string of operations.
+ * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format.
+ * \param[out] product Pointer to a location where a pointer to the ingested product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import(const char *filename, const char *operations, const char *options, harp_product **product)
+{
+    return import_product(filename, operations, options, 0, 0, NULL, product);
+}
+
+/** Import a product from a file, deferring the reading of variable data until it is needed.
+ * \ingroup harp_product
+ * This function behaves as harp_import(), except that for netCDF and HDF5 files that are in HARP format (and for
+ * entries of the ingestion cache) only the variable metadata (name, type, dimensions and attributes) is read. The data
+ * of a variable is read from file the first time it is needed. This makes importing cheap if only a few variables of a
+ * product are used.
+ * HARP functions such as harp_product_execute_operations(), harp_product_copy(), harp_product_append(),
+ * harp_product_print() and harp_export() will automatically load the data of variables as needed. Before accessing the
+ * \a data field of a variable directly, or passing the product to other HARP functions, you should call
+ * harp_variable_ensure_loaded() (or harp_product_ensure_loaded() for the whole product).
+ * The imported file is kept open until the data of all variables is loaded or the product is deleted.
+ * Products that are ingested using an ingestion module are always read completely.
+ * \param[in] filename Path to the file that is to be imported.
+ * \param[in] operations string (optional) containing actions to apply as part of the import; should be specified as a
+ * semi-colon separated string of operations.
+ * \param[in] options Ingestion module specific options (optional); should be specified as a semi-colon separated
+ * string of key=value pair; only used if the file is not in HARP format.
+ * \param[out] product Pointer to a location where a pointer to the imported product will be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_lazy(const char *filename, const char *operations, const char *options,
+                                 harp_product **product)
+{
+    return import_product(filename, operations, options, 1, 0, NULL, product);
+}
+
+/** Import the given samples of the time dimension of a product.
+ * \ingroup harp_product
+ * This function behaves as harp_import() without operations and options, but only the elements at the given indices
+ * of the time dimension are included in the resulting product. Variables that do not depend on the time dimension
+ * are imported in full.
+ * For HARP products in HDF5 format only the selected parts of each variable are read from file (and, for compressed
+ * files, only the chunks that contain the selected elements are decompressed). For other files, the full product is
+ * imported and then filtered.
+ * \param filename Filename of the product to import.
+ * \param num_indices Number of time indices in \a index.
+ * \param index Strictly increasing list of (zero-based) indices into the time dimension.
+ * \param product Pointer to the location where the imported product should be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_time_indices(const char *filename, long num_indices, const long *index,
+                                         harp_product **product)
+{
+    long i;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (num_indices <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "num_indices argument (%ld) is not valid (%s:%u)", num_indices,
+                       __FILE__, __LINE__);
+        return -1;
+    }
+    if (index == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "index is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+    if (index[0] < 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_INDEX, "time index (%ld) is negative", index[0]);
+        return -1;
+    }
+    for (i = 1; i < num_indices; i++)
+    {
+        if (index[i] <= index[i - 1])
+        {
+            harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "time indices are not strictly increasing (%s:%u)",
+                           __FILE__, __LINE__);
+            return -1;
+        }
+    }
+
+    return import_product(filename, NULL, NULL, 0, num_indices, index, product);
+}
+
+/** Import a contiguous range of the time dimension of a product.
+ * \ingroup harp_product
+ * This is a convenience wrapper around harp_import_time_indices() for the indices
+ * \a offset, \a offset + 1, ..., \a offset + \a length - 1.
+ * \param filename Filename of the product to import.
+ * \param offset Index of the first element of the time dimension to import.
+ * \param length Number of consecutive elements of the time dimension to import.
+ * \param product Pointer to the location where the imported product should be stored.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_import_time_range(const char *filename, long offset, long length, harp_product **product)
+{
+    long *index;
+    long i;
+
+    if (length <= 0)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "length argument (%ld) is not valid (%s:%u)", length, __FILE__,
+                       __LINE__);
+        return -1;
+    }
+
+    index = malloc(length * sizeof(long));
+    if (index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       length * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    for (i = 0; i < length; i++)
+    {
+        index[i] = offset + i;
+    }
+
+    if (harp_import_time_indices(filename, length, index, product) != 0)
+    {
+        free(index);
+        return -1;
+    }
+
+    free(index);
+
+    return 0;
+}
+
 /** Test import of a product.
  * \ingroup harp_product
  * If the product is a HARP product then verify that the product is a HARP compliant netCDF/HDF4/HDF5 product.
@@ -664,14 +1219,14 @@ LIBHARP_API int harp_import_test(const char *filename, int (*print) (const char
             break;
         case format_hdf5:
 #ifdef HAVE_HDF5
-            result = harp_import_hdf5(filename, &product);
+            result = harp_import_hdf5(filename, 0, &product);
 #else
             harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
             result = -1;
 #endif
             break;
         case format_netcdf:
-            result = harp_import_netcdf(filename, &product);
+            result = harp_import_netcdf(filename, 0, &product);
             break;
         default:
             harp_set_error(HARP_ERROR_UNSUPPORTED_PRODUCT, NULL);
@@ -796,6 +1351,34 @@ LIBHARP_API int harp_import_product_metadata(const char *filename, const char *o
     return 0;
 }
 
+static int export_product(const char *filename, file_format format, const harp_product *product)
+{
+    switch (format)
+    {
+        case format_hdf4:
+#ifdef HAVE_HDF4
+            return harp_export_hdf4(filename, product);
+#else
+            harp_set_error(HARP_ERROR_NO_HDF4_SUPPORT, NULL);
+            return -1;
+#endif
+        case format_hdf5:
+#ifdef HAVE_HDF5
+            return harp_export_hdf5(filename, product);
+#else
+            harp_set_error(HARP_ERROR_NO_HDF5_SUPPORT, NULL);
+            return -1;
+#endif
+        case format_netcdf:
+            return harp_export_netcdf(filename, harp_option_netcdf_unlimited_time, product);
+        default:
+            assert(0);
+            exit(1);
+    }
+
+    return 0;
+}
+
 /** Export HARP product to a file.
  * \ingroup harp_product
  * Export product to an HDF4, HDF5, or netCDF file that complies to the HARP Data Format.
@@ -808,6 +1391,7 @@ LIBHARP_API int harp_import_product_metadata(const char *filename, const char *o
  */
 LIBHARP_API int harp_export(const char *filename, const char *export_format, const harp_product *product)
 {
+    harp_profile_timer timer;
     file_format format;
 
     format = format_from_string(export_format);
@@ -817,28 +1401,90 @@ LIBHARP_API int harp_export(const char *filename, const char *export_format, con
         return -1;
     }
 
-    switch (format)
+    /* loading the data does not change the content of the product, so it is safe to cast away the const */
+    if (harp_product_ensure_loaded((harp_product *)product) != 0)
     {
-        case format_hdf4:
-#ifdef HAVE_HDF4
-            return harp_export_hdf4(filename, product);
-#else
-            harp_set_error(HARP_ERROR_NO_HDF4_SUPPORT, NULL);
+        return -1;
+    }
+
+    harp_profile_timer_start(&timer);
+    if (export_product(filename, format, product) != 0)
+    {
+        return -1;
+    }
+    harp_profile_timer_stop_product(&timer, "export", format_to_string(format), product);
+
+    return 0;
+}
+
+/** Append the time samples of a HARP product to a HARP netCDF file.
+ * \ingroup harp_product
+ * The file should have been exported with the time dimension as unlimited (record) dimension (see
+ * harp_set_option_netcdf_unlimited_time()). The product should contain the same variables, with the same data types
+ * and dimensions (except for the length of the time dimension), as the file. Time independent variables should be
+ * equal to the ones in the file and strings can not be longer than the string length used in the file.
+ * The data of the time dependent variables is written after the existing time samples and the datetime_start and
+ * datetime_stop attributes of the file are extended to include the datetime range of the product. The history
+ * attribute of the file is left unchanged.
+ * If the file does not exist yet, the product will be exported as a new netCDF file with an unlimited time dimension.
+ * \param filename Path to the file to which the product is to be appended.
+ * \param product Product that should be appended to the file.
+ * \return
+ *   \arg \c 0, Success.
+ *   \arg \c -1, Error occurred (check #harp_errno).
+ */
+LIBHARP_API int harp_export_append(const char *filename, const harp_product *product)
+{
+    harp_profile_timer timer;
+    file_format format;
+
+    if (filename == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "filename is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    if (product == NULL)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "product is NULL (%s:%u)", __FILE__, __LINE__);
+        return -1;
+    }
+
+    /* loading the data does not change the content of the product, so it is safe to cast away the const */
+    if (harp_product_ensure_loaded((harp_product *)product) != 0)
+    {
+        return -1;
+    }
+
+    if (determine_file_format(filename, &format) != 0)
+    {
+        if (harp_errno != HARP_ERROR_FILE_NOT_FOUND)
+        {
             return -1;
-#endif
-        case format_hdf5:
-#ifdef HAVE_HDF5
-            return harp_export_hdf5(filename, product);
-#else
-            harp_set_error(HARP_ERROR_NO_HDF5_SUPPORT, NULL);
+        }
+
+        /* create a new file that can be appended to */
+        harp_profile_timer_start(&timer);
+        if (harp_export_netcdf(filename, 1, product) != 0)
+        {
             return -1;
-#endif
-        case format_netcdf:
-            return harp_export_netcdf(filename, product);
-        default:
-            assert(0);
-            exit(1);
+        }
+        harp_profile_timer_stop_product(&timer, "export", "netcdf", product);
+        return 0;
+    }
+
+    if (format != format_netcdf)
+    {
+        harp_set_error(HARP_ERROR_INVALID_ARGUMENT, "appending is only supported for netCDF files (%s)", filename);
+        return -1;
+    }
+
+    harp_profile_timer_start(&timer);
+    if (harp_export_append_netcdf(filename, product) != 0)
+    {
+        return -1;
     }
+    harp_profile_timer_stop_product(&timer, "export", "netcdf_append", product);
 
     return 0;
 }
@@ -51,6 +51,10 @@ static void harp_matlab_add_harp_product_variable(mxArray *mx_struct, harp_produ
     {
         harp_matlab_harp_error();
     }
+    if (harp_variable_ensure_loaded(variable) != 0)
+    {
+        harp_matlab_harp_error();
+    }
     if (harp_product_get_variable_index_by_name(*product, variable->name, &index) != 0)
     {
         harp_matlab_harp_error();
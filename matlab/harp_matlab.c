@@ -315,9 +315,10 @@ static void harp_matlab_import(int nlhs, mxArray *plhs[], int nrhs, const mxArra
         }
     }
 
+    /* variable data is read on demand while converting the product */
     for (i = 0; i < num_files; i++)
     {
-        if (harp_import(filenames[i], operations, option, &product) != 0)
+        if (harp_import_lazy(filenames[i], operations, option, &product) != 0)
         {
             harp_matlab_harp_error();
         }
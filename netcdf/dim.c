@@ -336,7 +336,11 @@ nc_def_dim(int ncid, const char *name, size_t size, int *dimidp)
 	if(status != NC_NOERR)
 		return status;
 
-	if ((ncp->flags & NC_64BIT_OFFSET) && sizeof(off_t) > 4) {
+	if ((ncp->flags & NC_64BIT_DATA) && sizeof(off_t) > 4) {
+	    /* CDF5 format and LFS */
+	    if(size > (size_t)-1 - 3) /* "- 3" handles rounded-up size */
+		return NC_EDIMSIZE;
+	} else if ((ncp->flags & NC_64BIT_OFFSET) && sizeof(off_t) > 4) {
 	    /* CDF2 format and LFS */
 	    if(size > X_UINT_MAX - 3) /* "- 3" handles rounded-up size */
 		return NC_EDIMSIZE;
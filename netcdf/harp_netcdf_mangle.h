@@ -273,6 +273,7 @@
 #define ncx_get_short_short harp_ncx_get_short_short
 #define ncx_get_short_uchar harp_ncx_get_short_uchar
 #define ncx_get_size_t harp_ncx_get_size_t
+#define ncx_get_uint64 harp_ncx_get_uint64
 #define ncx_getn_double_double harp_ncx_getn_double_double
 #define ncx_getn_double_float harp_ncx_getn_double_float
 #define ncx_getn_double_int harp_ncx_getn_double_int
@@ -375,6 +376,7 @@
 #define ncx_put_short_short harp_ncx_put_short_short
 #define ncx_put_short_uchar harp_ncx_put_short_uchar
 #define ncx_put_size_t harp_ncx_put_size_t
+#define ncx_put_uint64 harp_ncx_put_uint64
 #define ncx_putn_double_double harp_ncx_putn_double_double
 #define ncx_putn_double_float harp_ncx_putn_double_float
 #define ncx_putn_double_int harp_ncx_putn_double_int
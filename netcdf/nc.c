@@ -226,7 +226,7 @@ NC_begins(NC *ncp,
 	if(r_align == NC_ALIGN_CHUNK)
 		r_align = ncp->chunk;
 
-	if (fIsSet(ncp->flags, NC_64BIT_OFFSET)) {
+	if (fIsSet(ncp->flags, NC_64BIT_OFFSET) || fIsSet(ncp->flags, NC_64BIT_DATA)) {
 	  sizeof_off_t = 8;
 	} else {
 	  sizeof_off_t = 4;
@@ -343,14 +343,23 @@ read_numrecs(NC *ncp)
 	assert(!NC_indef(ncp));
 
 #define NC_NUMRECS_OFFSET 4
-#define NC_NUMRECS_EXTENT 4
+#define NC_NUMRECS_EXTENT(ncp) (fIsSet((ncp)->flags, NC_64BIT_DATA) ? 8 : 4)
 	status = ncp->nciop->get(ncp->nciop,
-		 NC_NUMRECS_OFFSET, NC_NUMRECS_EXTENT, 0, (void **)&xp);
+		 NC_NUMRECS_OFFSET, NC_NUMRECS_EXTENT(ncp), 0, (void **)&xp);
 					/* cast away const */
 	if(status != NC_NOERR)
 		return status;
 
-	status = ncx_get_size_t(&xp, &nrecs);
+	if(fIsSet(ncp->flags, NC_64BIT_DATA))
+	{
+		unsigned long long ull = 0;
+		status = ncx_get_uint64(&xp, &ull);
+		if(status == NC_NOERR && (size_t)ull != ull)
+			status = NC_ERANGE;
+		nrecs = (size_t)ull;
+	}
+	else
+		status = ncx_get_size_t(&xp, &nrecs);
 
 	(void) ncp->nciop->rel(ncp->nciop, NC_NUMRECS_OFFSET, 0);
 
@@ -378,13 +387,16 @@ write_numrecs(NC *ncp)
 	assert(!NC_indef(ncp));
 
 	status = ncp->nciop->get(ncp->nciop,
-		 NC_NUMRECS_OFFSET, NC_NUMRECS_EXTENT, RGN_WRITE, &xp);
+		 NC_NUMRECS_OFFSET, NC_NUMRECS_EXTENT(ncp), RGN_WRITE, &xp);
 	if(status != NC_NOERR)
 		return status;
 
 	{
 		const size_t nrecs = NC_get_numrecs(ncp);
-		status = ncx_put_size_t(&xp, &nrecs);
+		if(fIsSet(ncp->flags, NC_64BIT_DATA))
+			status = ncx_put_uint64(&xp, (unsigned long long)nrecs);
+		else
+			status = ncx_put_size_t(&xp, &nrecs);
 	}
 
 	(void) ncp->nciop->rel(ncp->nciop, NC_NUMRECS_OFFSET, RGN_MODIFIED);
@@ -693,7 +705,10 @@ NC_check_vlens(NC *ncp)
     if(ncp->vars.nelems == 0) 
 	return NC_NOERR;
 
-    if ((ncp->flags & NC_64BIT_OFFSET) && sizeof(off_t) > 4) {
+    if ((ncp->flags & NC_64BIT_DATA) && sizeof(off_t) > 4) {
+	/* CDF5 format and LFS */
+	vlen_max = (size_t)-1 - 3; /* "- 3" handles rounded-up size */
+    } else if ((ncp->flags & NC_64BIT_OFFSET) && sizeof(off_t) > 4) {
 	/* CDF2 format and LFS */
 	vlen_max = X_UINT_MAX - 3; /* "- 3" handles rounded-up size */
     } else {
@@ -953,15 +968,21 @@ nc__create_mp(const char * path, int ioflags, size_t initialsz, int basepe,
 	/* Apply default create format. */
 	if (default_create_format == NC_FORMAT_64BIT)
 	  ioflags |= NC_64BIT_OFFSET;
+	else if (default_create_format == NC_FORMAT_CDF5)
+	  ioflags |= NC_64BIT_DATA;
 
-	if (fIsSet(ioflags, NC_64BIT_OFFSET)) {
+	if (fIsSet(ioflags, NC_64BIT_DATA)) {
+	  fSet(ncp->flags, NC_64BIT_DATA);
+	  sizeof_off_t = 8;
+	} else if (fIsSet(ioflags, NC_64BIT_OFFSET)) {
 	  fSet(ncp->flags, NC_64BIT_OFFSET);
 	  sizeof_off_t = 8;
 	} else {
 	  sizeof_off_t = 4;
 	}
 
-	assert(ncp->xsz == ncx_len_NC(ncp,sizeof_off_t));
+	/* the empty header of a CDF-5 file is larger than MIN_NC_XSZ */
+	ncp->xsz = ncx_len_NC(ncp,sizeof_off_t);
 	
 	status = ncio_create(path, ioflags,
 		initialsz,
@@ -1023,11 +1044,11 @@ nc_set_default_format(int format, int *old_formatp)
 
     /* Make sure only valid format is set. */
 #ifdef USE_NETCDF4
-    if (format != NC_FORMAT_CLASSIC && format != NC_FORMAT_64BIT &&
+    if (format != NC_FORMAT_CLASSIC && format != NC_FORMAT_64BIT && format != NC_FORMAT_CDF5 &&
 	format != NC_FORMAT_NETCDF4 && format != NC_FORMAT_NETCDF4_CLASSIC)
       return NC_EINVAL;
 #else
-    if (format != NC_FORMAT_CLASSIC && format != NC_FORMAT_64BIT)
+    if (format != NC_FORMAT_CLASSIC && format != NC_FORMAT_64BIT && format != NC_FORMAT_CDF5)
       return NC_EINVAL;
 #endif
     default_create_format = format;
@@ -1623,7 +1644,10 @@ nc_inq_format(int ncid, int *formatp)
 
 	/* only need to check for netCDF-3 variants, since this is never called for netCDF-4 
 	   files */
-	*formatp = fIsSet(ncp->flags, NC_64BIT_OFFSET) ? NC_FORMAT_64BIT 
-	    : NC_FORMAT_CLASSIC; 
+	if (fIsSet(ncp->flags, NC_64BIT_DATA))
+	    *formatp = NC_FORMAT_CDF5;
+	else
+	    *formatp = fIsSet(ncp->flags, NC_64BIT_OFFSET) ? NC_FORMAT_64BIT 
+		: NC_FORMAT_CLASSIC; 
 	return NC_NOERR;
 }
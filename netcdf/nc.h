@@ -36,6 +36,7 @@
  * The extern size of an empty
  * netcdf version 1 file.
  * The initial value of ncp->xsz.
+ * (an empty CDF-5 header is 48 bytes)
  */
 #define MIN_NC_XSZ 32
 
@@ -256,7 +257,7 @@ struct NC {
 #define NC_CREAT 2	/* in create phase, cleared by ncendef */
 #define NC_INDEF 8	/* in define mode, cleared by ncendef */
 #define NC_NSYNC 0x10	/* synchronise numrecs on change */
-#define NC_HSYNC 0x20	/* synchronise whole header on change */
+#define NC_HSYNC 0x04	/* synchronise whole header on change (0x20 is NC_64BIT_DATA) */
 #define NC_NDIRTY 0x40	/* numrecs has changed */
 #define NC_HDIRTY 0x80  /* header info has changed */
 /*	NC_NOFILL in netcdf.h, historical interface */
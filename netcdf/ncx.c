@@ -90,6 +90,66 @@ static const char nada[X_ALIGN] = {0, 0, 0, 0};
 		(((a) >>  8) & 0x0000ff00) | \
 		(((a) >> 24) & 0x000000ff) )
 
+/*
+ * On x86 the bulk of each array is swapped with SSSE3 byte shuffles,
+ * 16 bytes at a time (or with AVX2, 32 bytes at a time, if the compiler
+ * targets AVX2). The unrolled loops below then only handle the remaining
+ * elements.
+ * If the compiler targets SSSE3 (e.g. -mssse3 or -march=native) the
+ * shuffles are always used. Otherwise, for GCC and clang, swapn_shuffle()
+ * is compiled for SSSE3 on its own and is only used if the CPU supports
+ * SSSE3 at runtime.
+ */
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#define NCX_SHUFFLE
+#define NCX_SHUFFLE_TARGET
+#define NCX_CPU_HAS_SHUFFLE() 1
+#elif (defined(__x86_64__) || defined(__i386__)) && (__GNUC__ >= 5 || defined(__clang__))
+#include <immintrin.h>
+#define NCX_SHUFFLE
+#define NCX_SHUFFLE_TARGET __attribute__((target("ssse3")))
+#define NCX_CPU_HAS_SHUFFLE() __builtin_cpu_supports("ssse3")
+#endif
+
+#ifdef NCX_SHUFFLE
+static const char shuffle2b[16] = {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14};
+static const char shuffle4b[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+static const char shuffle8b[16] = {7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8};
+
+/*
+ * Apply 'shuffle' to each 16 byte block of src and store the result in dst.
+ * Returns the number of bytes that were swapped (a multiple of 16).
+ * Only call this if NCX_CPU_HAS_SHUFFLE() is true.
+ */
+static NCX_SHUFFLE_TARGET size_t
+swapn_shuffle(void *dst, const void *src, size_t nbytes, const char *shuffle)
+{
+	char *op = dst;
+	const char *ip = src;
+	size_t nswapped = 0;
+	const __m128i mask = _mm_loadu_si128((const __m128i *)shuffle);
+#if defined(__AVX2__)
+	/* _mm256_shuffle_epi8 shuffles within each 128-bit lane */
+	const __m256i mask256 = _mm256_broadcastsi128_si256(mask);
+
+	while(nswapped + 32 <= nbytes)
+	{
+		_mm256_storeu_si256((__m256i *)(op + nswapped),
+			_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(ip + nswapped)), mask256));
+		nswapped += 32;
+	}
+#endif
+	while(nswapped + 16 <= nbytes)
+	{
+		_mm_storeu_si128((__m128i *)(op + nswapped),
+			_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(ip + nswapped)), mask));
+		nswapped += 16;
+	}
+	return nswapped;
+}
+#endif /* NCX_SHUFFLE */
+
 
 static void
 swapn2b(void *dst, const void *src, size_t nn)
@@ -105,6 +165,16 @@ swapn2b(void *dst, const void *src, size_t nn)
  *		*op++ = *(ip++ -1);
  *	}                                       
  */
+#ifdef NCX_SHUFFLE
+	{
+		const size_t nswapped =
+			NCX_CPU_HAS_SHUFFLE() ? swapn_shuffle(dst, src, nn * 2, shuffle2b) : 0;
+
+		op += nswapped;
+		ip += nswapped;
+		nn -= nswapped / 2;
+	}
+#endif
 	while(nn > 3)
 	{
 		*op++ = *(++ip);
@@ -154,6 +224,16 @@ swapn4b(void *dst, const void *src, size_t nn)
  *		ip += 4;
  *	}
  */
+#ifdef NCX_SHUFFLE
+	{
+		const size_t nswapped =
+			NCX_CPU_HAS_SHUFFLE() ? swapn_shuffle(dst, src, nn * 4, shuffle4b) : 0;
+
+		op += nswapped;
+		ip += nswapped;
+		nn -= nswapped / 4;
+	}
+#endif
 	while(nn > 3)
 	{
 		op[0] = ip[3];
@@ -238,6 +318,16 @@ swapn8b(void *dst, const void *src, size_t nn)
  *	}
  */
 #  ifndef FLOAT_WORDS_BIGENDIAN
+#   ifdef NCX_SHUFFLE
+	{
+		const size_t nswapped =
+			NCX_CPU_HAS_SHUFFLE() ? swapn_shuffle(dst, src, nn * 8, shuffle8b) : 0;
+
+		op += nswapped;
+		ip += nswapped;
+		nn -= nswapped / 8;
+	}
+#   endif
 	while(nn > 1)
 	{
 		op[0] = ip[7];
@@ -1964,6 +2054,44 @@ ncx_get_off_t(const void **xpp, off_t *lp, size_t sizeof_off_t)
 	return ENOERR;
 }
 
+/* x_uint64 */
+
+int
+ncx_put_uint64(void **xpp, const unsigned long long ip)
+{
+	uchar *cp = (uchar *) *xpp;
+
+	*cp++ = (uchar)(ip >> 56);
+	*cp++ = (uchar)((ip & 0x00ff000000000000ULL) >> 48);
+	*cp++ = (uchar)((ip & 0x0000ff0000000000ULL) >> 40);
+	*cp++ = (uchar)((ip & 0x000000ff00000000ULL) >> 32);
+	*cp++ = (uchar)((ip & 0x00000000ff000000ULL) >> 24);
+	*cp++ = (uchar)((ip & 0x0000000000ff0000ULL) >> 16);
+	*cp++ = (uchar)((ip & 0x000000000000ff00ULL) >>  8);
+	*cp   = (uchar)(ip & 0x00000000000000ffULL);
+
+	*xpp = (void *)((char *)(*xpp) + X_SIZEOF_INT64);
+	return ENOERR;
+}
+
+int
+ncx_get_uint64(const void **xpp, unsigned long long *ullp)
+{
+	const uchar *cp = (const uchar *) *xpp;
+
+	*ullp =  ((unsigned long long)(*cp++) << 56);
+	*ullp |= ((unsigned long long)(*cp++) << 48);
+	*ullp |= ((unsigned long long)(*cp++) << 40);
+	*ullp |= ((unsigned long long)(*cp++) << 32);
+	*ullp |= ((unsigned long long)(*cp++) << 24);
+	*ullp |= ((unsigned long long)(*cp++) << 16);
+	*ullp |= ((unsigned long long)(*cp++) <<  8);
+	*ullp |=  (unsigned long long)(*cp);
+
+	*xpp = (const void *)((const char *)(*xpp) + X_SIZEOF_INT64);
+	return ENOERR;
+}
+
 
 /*
  * Aggregate numeric conversion functions.
@@ -84,6 +84,7 @@ typedef unsigned char uchar;
  */
 #define X_SIZEOF_OFF_T		(sizeof(off_t))
 #define X_SIZEOF_SIZE_T		X_SIZEOF_INT
+#define X_SIZEOF_INT64		8	/* sizes and counts in CDF-5 files */
 
 /*
  * limits of the external representation
@@ -100,6 +101,7 @@ typedef unsigned char uchar;
 #define X_INT_MIN	(-2147483647-1)
 #define X_INT_MAX	2147483647
 #define X_UINT_MAX	4294967295U
+#define X_INT64_MAX	9223372036854775807LL
 #define X_FLOAT_MAX	3.402823466e+38f
 #define X_FLOAT_MIN	(-X_FLOAT_MAX)
 #define X_FLT_MAX	X_FLOAT_MAX	/* alias compatible with limits.h */
@@ -144,6 +146,9 @@ typedef unsigned char uchar;
 #define ncx_len_double(nelems) \
 	((nelems) * X_SIZEOF_DOUBLE)
 
+#define ncx_len_int64(nelems) \
+	((nelems) * X_SIZEOF_INT64)
+
 /* End ncx_len */
 
 #if __CHAR_UNSIGNED__
@@ -381,6 +386,12 @@ ncx_put_size_t(void **xpp, const size_t *ulp);
 extern int
 ncx_put_off_t(void **xpp, const off_t *lp, size_t sizeof_off_t);
 
+/* 64-bit unsigned integers (sizes and counts in CDF-5 headers) */
+extern int
+ncx_get_uint64(const void **xpp, unsigned long long *ullp);
+extern int
+ncx_put_uint64(void **xpp, const unsigned long long ip);
+
 
 /*
  * Aggregate numeric conversion functions.
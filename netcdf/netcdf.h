@@ -95,6 +95,7 @@ typedef enum {
 #define NC_CLOBBER	0
 #define NC_NOCLOBBER	0x4	/* Don't destroy existing file on create */
 #define NC_64BIT_OFFSET 0x0200  /* Use large (64-bit) file offsets */
+#define NC_64BIT_DATA   0x0020  /* Use 64-bit sizes and counts (CDF-5 format) */
 
 /*
  * 'mode' flags for nccreate and ncopen
@@ -116,6 +117,8 @@ typedef enum {
 #define NC_FORMAT_64BIT   (2)
 #define NC_FORMAT_NETCDF4 (3)
 #define NC_FORMAT_NETCDF4_CLASSIC  (4) /* create netcdf-4 files, with NC_STRICT_NC3. */
+#define NC_FORMAT_CDF5    (5)
+#define NC_FORMAT_64BIT_DATA NC_FORMAT_CDF5
 
 /*
  * Let nc__create() or nc__open() figure out
@@ -27,6 +27,10 @@
 #define SEEK_END 2
 #endif
 
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif
+
 #include "ncio.h"
 #include "fbits.h"
 #include "rnd.h"
@@ -1341,6 +1345,198 @@ ncio_spx_init(ncio *const nciop)
 }
 
 
+/* Begin mm */
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#define NCIO_MMAP 1
+#endif
+
+#ifdef NCIO_MMAP
+
+/* This is the struct that gets hung of ncio->pvt when a file is
+   opened read-only (no NC_WRITE and no NC_SHARE) and the whole file
+   could be memory mapped.
+
+   map_base - start of the read-only mapping of the file.
+   map_size - size of the file (and the mapping) at open time.
+   pad_base - buffer for regions that extend beyond the end of the
+   file. These are zero filled, just as px_pgin does for short reads.
+   pad_extent - allocated size of pad_base.
+*/
+typedef struct ncio_mm {
+	void	*map_base;
+	size_t	map_size;
+	void	*pad_base;
+	size_t	pad_extent;
+} ncio_mm;
+
+
+/*ARGSUSED*/
+/* This function releases the region specified by offset. Regions
+   point directly into the mapping (or into the pad buffer), so there
+   is nothing to write back or free.
+*/
+static int
+ncio_mm_rel(ncio *const nciop, off_t offset, int rflags)
+{
+	(void)nciop;
+	(void)offset;
+
+	if(fIsSet(rflags, RGN_MODIFIED))
+		return EPERM; /* attempt to write readonly file */
+
+	return ENOERR;
+}
+
+
+/* Request that the region (offset, extent) be made available
+   through *vpp. For regions within the file this is a pointer into
+   the mapping, so no data is copied. Regions that extend beyond the
+   end of the file are copied into a zero padded buffer.
+
+   nciop - pointer to ncio struct for this file.
+   offset - offset of the region.
+   extent - size of the region.
+   rflags - One of the RGN_* flags defined in ncio.h. RGN_WRITE is
+   not allowed, since the mapping is read-only.
+   vpp - handle to point at data when it's been read.
+*/
+static int
+ncio_mm_get(ncio *const nciop,
+		off_t offset, size_t extent,
+		int rflags,
+		void **const vpp)
+{
+	ncio_mm *const mmp = (ncio_mm *)nciop->pvt;
+	size_t navail = 0;
+
+	if(fIsSet(rflags, RGN_WRITE))
+		return EPERM; /* attempt to write readonly file */
+
+	if(offset < 0)
+		return EINVAL;
+
+	if((size_t)offset <= mmp->map_size)
+	{
+		navail = mmp->map_size - (size_t)offset;
+		if(extent <= navail)
+		{
+			*vpp = (char *)mmp->map_base + offset;
+			return ENOERR;
+		}
+	}
+
+	/* region extends beyond the end of the file */
+	if(extent > mmp->pad_extent)
+	{
+		void *base = realloc(mmp->pad_base, extent);
+		if(base == NULL)
+			return ENOMEM;
+		mmp->pad_base = base;
+		mmp->pad_extent = extent;
+	}
+	if(navail > 0)
+		(void) memcpy(mmp->pad_base, (char *)mmp->map_base + offset, navail);
+	(void) memset((char *)mmp->pad_base + navail, 0, extent - navail);
+
+	*vpp = mmp->pad_base;
+	return ENOERR;
+}
+
+
+/*ARGSUSED*/
+/* Moving data requires write access, which a mapped file never has.
+*/
+static int
+ncio_mm_move(ncio *const nciop, off_t to, off_t from,
+			size_t nbytes, int rflags)
+{
+	(void)nciop;
+	(void)to;
+	(void)from;
+	(void)nbytes;
+	(void)rflags;
+	return EPERM; /* attempt to write readonly file */
+}
+
+
+/*ARGSUSED*/
+/* Flush any buffers to disk. A no-op for a read-only mapping.
+*/
+static int
+ncio_mm_sync(ncio *const nciop)
+{
+	(void)nciop;
+	/* NOOP */
+	return ENOERR;
+}
+
+static void
+ncio_mm_free(void *const pvt)
+{
+	ncio_mm *const mmp = (ncio_mm *)pvt;
+	if(mmp == NULL)
+		return;
+
+	if(mmp->map_base != NULL)
+	{
+		(void) munmap(mmp->map_base, mmp->map_size);
+		mmp->map_base = NULL;
+		mmp->map_size = 0;
+	}
+	if(mmp->pad_base != NULL)
+	{
+		free(mmp->pad_base);
+		mmp->pad_base = NULL;
+		mmp->pad_extent = 0;
+	}
+}
+
+
+/* Replace the (not yet initialized) ncio_px backend of a file that
+   was opened read-only by a memory mapping of the whole file. The
+   rel, get, move, sync, and free function pointers are set to the
+   ncio_mm_* functions.
+
+   If the file can not be mapped (e.g. it is empty or mmap() is not
+   supported for it) an error is returned and the ncio_px backend is
+   left untouched, so the caller can fall back to ncio_px_init2.
+*/
+static int
+ncio_mm_init2(ncio *const nciop)
+{
+	ncio_mm *const mmp = (ncio_mm *)nciop->pvt;
+	struct stat sb;
+	void *base;
+
+	assert(nciop->fd >= 0);
+
+	if(fstat(nciop->fd, &sb) < 0)
+		return errno;
+	if(sb.st_size <= 0 || (off_t)(size_t)sb.st_size != sb.st_size)
+		return EINVAL;
+
+	base = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, nciop->fd, 0);
+	if(base == MAP_FAILED)
+		return errno;
+
+	*((ncio_relfunc **)&nciop->rel) = ncio_mm_rel; /* cast away const */
+	*((ncio_getfunc **)&nciop->get) = ncio_mm_get; /* cast away const */
+	*((ncio_movefunc **)&nciop->move) = ncio_mm_move; /* cast away const */
+	*((ncio_syncfunc **)&nciop->sync) = ncio_mm_sync; /* cast away const */
+	*((ncio_freefunc **)&nciop->free) = ncio_mm_free; /* cast away const */
+
+	mmp->map_base = base;
+	mmp->map_size = (size_t)sb.st_size;
+	mmp->pad_base = NULL;
+	mmp->pad_extent = 0;
+
+	return ENOERR;
+}
+
+#endif /* NCIO_MMAP */
+
+
 /* */
 
 /* This will call whatever free function is attached to the free
@@ -1381,6 +1577,11 @@ ncio_new(const char *path, int ioflags)
 		sz_ncio_pvt = sizeof(ncio_spx);
 	else
 		sz_ncio_pvt = sizeof(ncio_px);
+#ifdef NCIO_MMAP
+	/* read-only files may switch to ncio_mm in ncio_open */
+	if(sz_ncio_pvt < sizeof(ncio_mm))
+		sz_ncio_pvt = sizeof(ncio_mm);
+#endif
 
 	nciop = (ncio *) malloc(sz_ncio + sz_path + sz_ncio_pvt);
 	if(nciop == NULL)
@@ -1616,7 +1817,17 @@ ncio_open(const char *path,
 	if(fIsSet(nciop->ioflags, NC_SHARE))
 		status = ncio_spx_init2(nciop, sizehintp);
 	else
+	{
+#ifdef NCIO_MMAP
+		/* read-only files are accessed through a memory mapping,
+		   falling back to buffered reads if the file can't be mapped */
+		if(!fIsSet(nciop->ioflags, NC_WRITE) &&
+				ncio_mm_init2(nciop) == ENOERR)
+			status = ENOERR;
+		else
+#endif
 		status = ncio_px_init2(nciop, sizehintp, 0);
+	}
 
 	if(status != ENOERR)
 		goto unwind_open;
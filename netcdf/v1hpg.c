@@ -17,7 +17,8 @@
  * of the "header" of a netcdf version one file and
  * the version two variant that uses 64-bit file 
  * offsets instead of the 32-bit file offsets in version 
- * one files.
+ * one files, and the version five (CDF-5) variant that
+ * also uses 64-bit values for all sizes and counts.
  * For each of the components of the NC structure,
  * There are (static) ncx_len_XXX(), v1h_put_XXX()
  * and v1h_get_XXX() functions. These define the
@@ -33,6 +34,7 @@
  */
 static const schar ncmagic[] = {'C', 'D', 'F', 0x02};
 static const schar ncmagic1[] = {'C', 'D', 'F', 0x01};
+static const schar ncmagic5[] = {'C', 'D', 'F', 0x05};
 
 
 /*
@@ -49,7 +51,7 @@ typedef struct v1hs {
 	off_t offset;	/* argument to nciop->get() */
 	size_t extent;	/* argument to nciop->get() */
 	int flags;	/* set to RGN_WRITE for write */
-        int version;    /* format variant: NC_FORMAT_CLASSIC or NC_FORMAT_64BIT */
+        int version;    /* format variant: 1 (classic), 2 (64-bit offset) or 5 (CDF-5) */
 	void *base;	/* beginning of current buffer */
 	void *pos;	/* current position in buffer */
 	void *end;	/* end of current buffer = base + extent */
@@ -128,13 +130,22 @@ fprintf(stderr, "nextread %lu, remaining %lu\n",
 
 /* End v1hs */
 
+/*
+ * External size of the sizes and counts in the header
+ * (NON_NEG in the format specification).
+ */
+#define X_SIZEOF_NON_NEG(version) \
+	((version) == 5 ? X_SIZEOF_INT64 : X_SIZEOF_SIZE_T)
+
 /* Write a size_t to the header */
 static int
 v1h_put_size_t(v1hs *psp, const size_t *sp)
 {
-	int status = check_v1hs(psp, X_SIZEOF_SIZE_T);
+	int status = check_v1hs(psp, X_SIZEOF_NON_NEG(psp->version));
 	if(status != ENOERR)
 		return status;
+	if(psp->version == 5)
+		return ncx_put_uint64(&psp->pos, (unsigned long long)*sp);
 	return ncx_put_size_t(&psp->pos, sp);
 }
 
@@ -143,9 +154,20 @@ v1h_put_size_t(v1hs *psp, const size_t *sp)
 static int
 v1h_get_size_t(v1hs *gsp, size_t *sp)
 {
-	int status = check_v1hs(gsp, X_SIZEOF_SIZE_T);
+	int status = check_v1hs(gsp, X_SIZEOF_NON_NEG(gsp->version));
 	if(status != ENOERR)
 		return status;
+	if(gsp->version == 5)
+	{
+		unsigned long long ull = 0;
+		status = ncx_get_uint64((const void **)(&gsp->pos), &ull);
+		if(status != ENOERR)
+			return status;
+		if(ull > (unsigned long long)X_INT64_MAX || (size_t)ull != ull)
+			return NC_ERANGE;
+		*sp = (size_t)ull;
+		return ENOERR;
+	}
 	return ncx_get_size_t((const void **)(&gsp->pos), sp);
 }
 
@@ -181,12 +203,14 @@ v1h_get_nc_type(v1hs *gsp, nc_type *typep)
 	if(status != ENOERR)
 		return status;
 
-	assert(type == NC_BYTE
-		|| type == NC_CHAR
-		|| type == NC_SHORT
-		|| type == NC_INT
-		|| type == NC_FLOAT
-		|| type == NC_DOUBLE);
+	/* the extended CDF-5 types (unsigned and 64-bit integers) are not supported */
+	if(type != NC_BYTE
+		&& type != NC_CHAR
+		&& type != NC_SHORT
+		&& type != NC_INT
+		&& type != NC_FLOAT
+		&& type != NC_DOUBLE)
+		return NC_EBADTYPE;
 
 	/* else */
 	*typep = (nc_type) type;
@@ -238,9 +262,9 @@ v1h_get_NCtype(v1hs *gsp, NCtype *typep)
 NC_xlen_string(cdfstr)
  */
 static size_t
-ncx_len_NC_string(const NC_string *ncstrp)
+ncx_len_NC_string(const NC_string *ncstrp, int version)
 {
-	size_t sz = X_SIZEOF_SIZE_T; /* nchars */
+	size_t sz = X_SIZEOF_NON_NEG(version); /* nchars */
 
 	assert(ncstrp != NULL);
 
@@ -335,14 +359,14 @@ unwind_alloc:
 NC_xlen_dim(dpp)
  */
 static size_t
-ncx_len_NC_dim(const NC_dim *dimp)
+ncx_len_NC_dim(const NC_dim *dimp, int version)
 {
 	size_t sz;
 
 	assert(dimp != NULL);
 
-	sz = ncx_len_NC_string(dimp->name);
-	sz += X_SIZEOF_SIZE_T;
+	sz = ncx_len_NC_string(dimp->name, version);
+	sz += X_SIZEOF_NON_NEG(version);
 
 	return(sz);
 }
@@ -403,10 +427,10 @@ unwind_name:
 
 /* How much space in the header is required for this NC_dimarray? */
 static size_t
-ncx_len_NC_dimarray(const NC_dimarray *ncap)
+ncx_len_NC_dimarray(const NC_dimarray *ncap, int version)
 {
 	size_t xlen = X_SIZEOF_NCTYPE;	/* type */
-	xlen += X_SIZEOF_SIZE_T;	/* count */
+	xlen += X_SIZEOF_NON_NEG(version);	/* count */
 	if(ncap == NULL)
 		return xlen;
 	/* else */
@@ -415,7 +439,7 @@ ncx_len_NC_dimarray(const NC_dimarray *ncap)
 		const NC_dim *const *const end = &dpp[ncap->nelems];
 		for(  /*NADA*/; dpp < end; dpp++)
 		{
-			xlen += ncx_len_NC_dim(*dpp);
+			xlen += ncx_len_NC_dim(*dpp, version);
 		}
 	}
 	return xlen;
@@ -536,15 +560,15 @@ v1h_get_NC_dimarray(v1hs *gsp, NC_dimarray *ncap)
 NC_xlen_attr(app)
  */
 static size_t
-ncx_len_NC_attr(const NC_attr *attrp)
+ncx_len_NC_attr(const NC_attr *attrp, int version)
 {
 	size_t sz;
 
 	assert(attrp != NULL);
 
-	sz = ncx_len_NC_string(attrp->name);
+	sz = ncx_len_NC_string(attrp->name, version);
 	sz += X_SIZEOF_NC_TYPE; /* type */
-	sz += X_SIZEOF_SIZE_T; /* nelems */
+	sz += X_SIZEOF_NON_NEG(version); /* nelems */
 	sz += attrp->xsz;
 
 	return(sz);
@@ -695,10 +719,10 @@ unwind_name:
 
 /* How much space in the header is required for this NC_attrarray? */
 static size_t
-ncx_len_NC_attrarray(const NC_attrarray *ncap)
+ncx_len_NC_attrarray(const NC_attrarray *ncap, int version)
 {
 	size_t xlen = X_SIZEOF_NCTYPE;	/* type */
-	xlen += X_SIZEOF_SIZE_T;	/* count */
+	xlen += X_SIZEOF_NON_NEG(version);	/* count */
 	if(ncap == NULL)
 		return xlen;
 	/* else */
@@ -707,7 +731,7 @@ ncx_len_NC_attrarray(const NC_attrarray *ncap)
 		const NC_attr *const *const end = &app[ncap->nelems];
 		for( /*NADA*/; app < end; app++)
 		{
-			xlen += ncx_len_NC_attr(*app);
+			xlen += ncx_len_NC_attr(*app, version);
 		}
 	}
 	return xlen;
@@ -825,19 +849,22 @@ v1h_get_NC_attrarray(v1hs *gsp, NC_attrarray *ncap)
 NC_xlen_var(vpp)
  */
 static size_t
-ncx_len_NC_var(const NC_var *varp, size_t sizeof_off_t)
+ncx_len_NC_var(const NC_var *varp, size_t sizeof_off_t, int version)
 {
 	size_t sz;
 
 	assert(varp != NULL);
 	assert(sizeof_off_t != 0);
 
-	sz = ncx_len_NC_string(varp->name);
-	sz += X_SIZEOF_SIZE_T; /* ndims */
-	sz += ncx_len_int(varp->ndims); /* dimids */
-	sz += ncx_len_NC_attrarray(&varp->attrs);
+	sz = ncx_len_NC_string(varp->name, version);
+	sz += X_SIZEOF_NON_NEG(version); /* ndims */
+	if(version == 5)
+		sz += ncx_len_int64(varp->ndims); /* dimids */
+	else
+		sz += ncx_len_int(varp->ndims); /* dimids */
+	sz += ncx_len_NC_attrarray(&varp->attrs, version);
 	sz += X_SIZEOF_NC_TYPE; /* type */
-	sz += X_SIZEOF_SIZE_T; /* len */
+	sz += X_SIZEOF_NON_NEG(version); /* len */
 	sz += sizeof_off_t; /* begin */
 
 	return(sz);
@@ -858,13 +885,27 @@ v1h_put_NC_var(v1hs *psp, const NC_var *varp)
 	if(status != ENOERR)
 		return status;
 
-	status = check_v1hs(psp, ncx_len_int(varp->ndims));
-	if(status != ENOERR)
-		return status;
-	status = ncx_putn_int_int(&psp->pos,
-			varp->ndims, varp->dimids);
-	if(status != ENOERR)
-		return status;
+	if(psp->version == 5)
+	{
+		size_t ii;
+		for(ii = 0; ii < varp->ndims; ii++)
+		{
+			const size_t dimid = (size_t)varp->dimids[ii];
+			status = v1h_put_size_t(psp, &dimid);
+			if(status != ENOERR)
+				return status;
+		}
+	}
+	else
+	{
+		status = check_v1hs(psp, ncx_len_int(varp->ndims));
+		if(status != ENOERR)
+			return status;
+		status = ncx_putn_int_int(&psp->pos,
+				varp->ndims, varp->dimids);
+		if(status != ENOERR)
+			return status;
+	}
 
 	status = v1h_put_NC_attrarray(psp, &varp->attrs);
 	if(status != ENOERR)
@@ -874,9 +915,20 @@ v1h_put_NC_var(v1hs *psp, const NC_var *varp)
 	if(status != ENOERR)
 		return status;
 
-	status = v1h_put_size_t(psp, &varp->len);
+	{
+	/*
+	 * A variable that is too large for the 32-bit vsize of
+	 * version 1 and 2 files (only allowed for the last variable)
+	 * is written with the special value 2^32 - 1.
+	 * Readers recompute the size from the shape.
+	 */
+	size_t vsize = varp->len;
+	if(psp->version != 5 && vsize > X_UINT_MAX)
+		vsize = X_UINT_MAX;
+	status = v1h_put_size_t(psp, &vsize);
 	if(status != ENOERR)
 		return status;
+	}
 
 	status = check_v1hs(psp, psp->version == 1 ? 4 : 8);
 	if(status != ENOERR)
@@ -913,13 +965,33 @@ v1h_get_NC_var(v1hs *gsp, NC_var **varpp)
 		goto unwind_name;
 	}
 
-	status = check_v1hs(gsp, ncx_len_int(ndims));
-	if(status != ENOERR)
-		goto unwind_alloc;
-	status = ncx_getn_int_int((const void **)(&gsp->pos),
-			ndims, varp->dimids);
-	if(status != ENOERR)
-		goto unwind_alloc;
+	if(gsp->version == 5)
+	{
+		size_t ii;
+		for(ii = 0; ii < ndims; ii++)
+		{
+			size_t dimid = 0;
+			status = v1h_get_size_t(gsp, &dimid);
+			if(status != ENOERR)
+				goto unwind_alloc;
+			if(dimid > X_INT_MAX)
+			{
+				status = NC_EBADDIM;
+				goto unwind_alloc;
+			}
+			varp->dimids[ii] = (int)dimid;
+		}
+	}
+	else
+	{
+		status = check_v1hs(gsp, ncx_len_int(ndims));
+		if(status != ENOERR)
+			goto unwind_alloc;
+		status = ncx_getn_int_int((const void **)(&gsp->pos),
+				ndims, varp->dimids);
+		if(status != ENOERR)
+			goto unwind_alloc;
+	}
 
 	status = v1h_get_NC_attrarray(gsp, &varp->attrs);
 	if(status != ENOERR)
@@ -956,10 +1028,10 @@ unwind_name:
 
 /* How much space in the header is required for this NC_vararray? */
 static size_t
-ncx_len_NC_vararray(const NC_vararray *ncap, size_t sizeof_off_t)
+ncx_len_NC_vararray(const NC_vararray *ncap, size_t sizeof_off_t, int version)
 {
 	size_t xlen = X_SIZEOF_NCTYPE;	/* type */
-	xlen += X_SIZEOF_SIZE_T;	/* count */
+	xlen += X_SIZEOF_NON_NEG(version);	/* count */
 	if(ncap == NULL)
 		return xlen;
 	/* else */
@@ -968,7 +1040,7 @@ ncx_len_NC_vararray(const NC_vararray *ncap, size_t sizeof_off_t)
 		const NC_var *const *const end = &vpp[ncap->nelems];
 		for( /*NADA*/; vpp < end; vpp++)
 		{
-			xlen += ncx_len_NC_var(*vpp, sizeof_off_t);
+			xlen += ncx_len_NC_var(*vpp, sizeof_off_t, version);
 		}
 	}
 	return xlen;
@@ -1165,13 +1237,17 @@ size_t
 ncx_len_NC(const NC *ncp, size_t sizeof_off_t)
 {
 	size_t xlen = sizeof(ncmagic);
+	int version = 1;
 
 	assert(ncp != NULL);
+
+	if (fIsSet(ncp->flags, NC_64BIT_DATA))
+	  version = 5;
 	
-	xlen += X_SIZEOF_SIZE_T; /* numrecs */
-	xlen += ncx_len_NC_dimarray(&ncp->dims);
-	xlen += ncx_len_NC_attrarray(&ncp->attrs);
-	xlen += ncx_len_NC_vararray(&ncp->vars, sizeof_off_t);
+	xlen += X_SIZEOF_NON_NEG(version); /* numrecs */
+	xlen += ncx_len_NC_dimarray(&ncp->dims, version);
+	xlen += ncx_len_NC_attrarray(&ncp->attrs, version);
+	xlen += ncx_len_NC_vararray(&ncp->vars, sizeof_off_t, version);
 
 	return xlen;
 }
@@ -1191,7 +1267,9 @@ ncx_put_NC(const NC *ncp, void **xpp, off_t offset, size_t extent)
 	ps.nciop = ncp->nciop;
 	ps.flags = RGN_WRITE;
 
-	if (ncp->flags & NC_64BIT_OFFSET)
+	if (ncp->flags & NC_64BIT_DATA)
+	  ps.version = 5;
+	else if (ncp->flags & NC_64BIT_OFFSET)
 	  ps.version = 2;
 	else 
 	  ps.version = 1;
@@ -1234,7 +1312,9 @@ ncx_put_NC(const NC *ncp, void **xpp, off_t offset, size_t extent)
 		ps.end = (char *)ps.base + ps.extent;
 	}
 
-	if (ps.version == 2)
+	if (ps.version == 5)
+	  status = ncx_putn_schar_schar(&ps.pos, sizeof(ncmagic5), ncmagic5);
+	else if (ps.version == 2)
 	  status = ncx_putn_schar_schar(&ps.pos, sizeof(ncmagic), ncmagic);
 	else
 	  status = ncx_putn_schar_schar(&ps.pos, sizeof(ncmagic1), ncmagic1);
@@ -1243,7 +1323,7 @@ ncx_put_NC(const NC *ncp, void **xpp, off_t offset, size_t extent)
 
 	{
 	const size_t nrecs = NC_get_numrecs(ncp);
-	status = ncx_put_size_t(&ps.pos, &nrecs);
+	status = v1h_put_size_t(&ps, &nrecs);
 	if(status != ENOERR)
 		goto release;
 	}
@@ -1362,6 +1442,9 @@ nc_get_NC(NC *ncp)
 		    fprintf(stderr, "NETCDF WARNING: Version 2 file on 32-bit system.\n");
 		  }
 #endif
+		} else if (magic[sizeof(ncmagic)-1] == 0x5) {
+		  gs.version = 5;
+		  fSet(ncp->flags, NC_64BIT_DATA);
 		} else {
 			status = NC_ENOTNC;
 			goto unwind_get;
@@ -1370,7 +1453,7 @@ nc_get_NC(NC *ncp)
 	
 	{
 	size_t nrecs = 0;
-	status = ncx_get_size_t((const void **)(&gs.pos), &nrecs);
+	status = v1h_get_size_t(&gs, &nrecs);
 	if(status != ENOERR)
 		goto unwind_get;
 	NC_set_numrecs(ncp, nrecs);
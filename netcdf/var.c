@@ -410,12 +410,14 @@ NC_var_shape(NC_var *varp, const NC_dimarray *dims)
 	{
 		if(!(shp == varp->shape && IS_RECVAR(varp)))
 		{
-			if( *shp <= X_UINT_MAX / product ) 
+			/* sizes are only limited by size_t here; the
+			 * per-format limits are checked by NC_check_vlens() */
+			if( *shp <= ((size_t)-1) / product ) 
 			{
 				product *= *shp;
 			} else 
 			{
-				product = X_UINT_MAX ;
+				product = (size_t)-1 ;
 			}
 		}
 		*dsp = product;
@@ -423,7 +425,7 @@ NC_var_shape(NC_var *varp, const NC_dimarray *dims)
 
 
 out :
-    if( varp->xsz <= (X_UINT_MAX - 1) / product ) /* if integer multiply will not overflow */
+    if( varp->xsz <= ((size_t)-1 - 3) / product ) /* if integer multiply will not overflow */
 	{
 	        varp->len = product * varp->xsz;
 		switch(varp->type) {
@@ -442,7 +444,7 @@ out :
 		}
         } else
 	{	/* OK for last var to be "too big", indicated by this special len */
-	        varp->len = X_UINT_MAX;
+	        varp->len = (size_t)-1;
         }
 #if 0
 	arrayp("\tshape", varp->ndims, varp->shape);
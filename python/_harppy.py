@@ -809,6 +809,9 @@ def _import_product(c_product):
     # Import variables.
     for i in range(c_product.num_variables):
         c_variable_ptr = c_product.variable[i]
+        # Variable data may not have been read yet if the product was imported lazily.
+        if _lib.harp_variable_ensure_loaded(c_variable_ptr) != 0:
+            raise CLibraryError()
         variable = _import_variable(c_variable_ptr[0])
         setattr(product, _decode_string(_ffi.string(c_variable_ptr[0].name)), variable)
 
@@ -1211,9 +1214,10 @@ def import_product(filename, operations="", options="", reduce_operations="", po
 
     c_product_ptr = _ffi.new("harp_product **")
 
-    # Import the product as a C product.
-    if _lib.harp_import(_encode_path(filename), _encode_string(operations), _encode_string(options),
-                        c_product_ptr) != 0:
+    # Import the product as a C product. Variable data is read on demand while converting the product, so only
+    # a single variable needs to be held in memory in both its C and its Python representation at any time.
+    if _lib.harp_import_lazy(_encode_path(filename), _encode_string(operations), _encode_string(options),
+                             c_product_ptr) != 0:
         raise CLibraryError()
 
     try:
@@ -1332,12 +1336,12 @@ def _get_time_length(product):
     return time_length
 
 
-def _extend_variable_for_dim(variable, dim_index, new_length):
-    shape = list(variable.data.shape)
+def _extend_data_for_dim(data, dim_index, new_length):
+    shape = list(data.shape)
     shape[dim_index] = new_length - shape[dim_index]
-    filler = numpy.empty(shape, dtype=variable.data.dtype)
+    filler = numpy.empty(shape, dtype=data.dtype)
     filler[:] = numpy.NAN
-    variable.data = numpy.concatenate([variable.data, filler], axis=dim_index)
+    return numpy.concatenate([data, filler], axis=dim_index)
 
 
 def make_time_dependent(product):
@@ -1374,34 +1378,40 @@ def concatenate(products):
         make_time_dependent(product)
     target_product = Product()
     for name in variable_names:
-        for product in products:
+        source_variable = products[0][name]
+        target_variable = Variable(source_variable.data, source_variable.dimension)
+        if hasattr(source_variable, 'unit'):
+            target_variable.unit = source_variable.unit
+        if hasattr(source_variable, 'valid_min'):
+            target_variable.valid_min = source_variable.valid_min
+        if hasattr(source_variable, 'valid_max'):
+            target_variable.valid_max = source_variable.valid_max
+        if hasattr(source_variable, 'description'):
+            target_variable.description = source_variable.description
+        if hasattr(source_variable, 'enum'):
+            target_variable.enum = source_variable.enum
+
+        # determine the shape of the result first, so the data can be concatenated in a single step
+        shape = list(source_variable.data.shape)
+        for product in products[1:]:
             source_variable = product[name]
-            if name not in target_product:
-                target_variable = Variable(source_variable.data, source_variable.dimension)
-                if hasattr(source_variable, 'unit'):
-                    target_variable.unit = source_variable.unit
-                if hasattr(source_variable, 'valid_min'):
-                    target_variable.valid_min = source_variable.valid_min
-                if hasattr(source_variable, 'valid_max'):
-                    target_variable.valid_max = source_variable.valid_max
-                if hasattr(source_variable, 'description'):
-                    target_variable.description = source_variable.description
-                if hasattr(source_variable, 'enum'):
-                    target_variable.enum = source_variable.enum
-                target_product[name] = target_variable
-            else:
-                target_variable = target_product[name]
-                if hasattr(target_variable, 'unit'):
-                    if not hasattr(source_variable, 'unit') or target_variable.unit != source_variable.unit:
-                        raise Error("inconsistent units in appending variable '%s'" % (name,))
-                if len(target_variable.data.shape) != len(source_variable.data.shape):
-                    raise Error("inconsistent number of dimensions for appending variable '%s'" % (name,))
-                for i in range(len(target_variable.data.shape))[1:]:
-                    if target_variable.data.shape[i] < source_variable.data.shape[i]:
-                        _extend_variable_for_dim(target_variable, i, source_variable.data.shape[i])
-                    if source_variable.data.shape[i] < target_variable.data.shape[i]:
-                        _extend_variable_for_dim(source_variable, i, target_variable.data.shape[i])
-                target_variable.data = numpy.append(target_variable.data, source_variable.data, axis=0)
+            if hasattr(target_variable, 'unit'):
+                if not hasattr(source_variable, 'unit') or target_variable.unit != source_variable.unit:
+                    raise Error("inconsistent units in appending variable '%s'" % (name,))
+            if len(shape) != len(source_variable.data.shape):
+                raise Error("inconsistent number of dimensions for appending variable '%s'" % (name,))
+            for i in range(len(shape))[1:]:
+                shape[i] = max(shape[i], source_variable.data.shape[i])
+
+        data = []
+        for product in products:
+            source_data = product[name].data
+            for i in range(len(shape))[1:]:
+                if source_data.shape[i] < shape[i]:
+                    source_data = _extend_data_for_dim(source_data, i, shape[i])
+            data.append(source_data)
+        target_variable.data = numpy.concatenate(data, axis=0)
+        target_product[name] = target_variable
     return target_product
 
 
@@ -0,0 +1,752 @@
+/*
+ * Copyright (C) 2015-2020 S[&]T, The Netherlands.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "harp.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include "windows.h"
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define DEFAULT_NUM_REPEATS 3
+
+typedef struct benchmark_info_struct
+{
+    int num_operations;
+    const char **operations;    /* [num_operations] */
+    int num_options;
+    const char **options;       /* [num_options] */
+    int num_repeats;
+    int variable_times;
+    FILE *output;
+} benchmark_info;
+
+static int print_warning(const char *message, va_list ap)
+{
+    int result;
+
+    fprintf(stderr, "WARNING: ");
+    result = vfprintf(stderr, message, ap);
+    fprintf(stderr, "\n");
+
+    return result;
+}
+
+static void print_version()
+{
+    printf("harpbench version %s\n", libharp_version);
+    printf("Copyright (C) 2015-2020 S[&]T, The Netherlands.\n\n");
+}
+
+static void print_help()
+{
+    printf("Usage:\n");
+    printf("    harpbench [options] <input product file> [input product file...]\n");
+    printf("        Measure the performance of importing products with HARP and write\n");
+    printf("        the results in JSON format.\n");
+    printf("        Each product is imported for each combination of the given\n");
+    printf("        operation lists and ingestion option lists. For each import the\n");
+    printf("        wall clock time and CPU time, the throughput in MB/s (10^6 bytes\n");
+    printf("        of the input file per second) and samples/s (elements of the time\n");
+    printf("        dimension per second) are reported. Products are grouped by their\n");
+    printf("        format (the HARP product type of the ingestion module, or the file\n");
+    printf("        format for HARP products).\n");
+    printf("        The peak resident memory size during the imports is reported for each\n");
+    printf("        case as well. On Linux the peak of the harpbench process is reset\n");
+    printf("        before each case. On other systems the import is performed once more\n");
+    printf("        in a child process to measure its peak. The value is null if it can\n");
+    printf("        not be determined.\n");
+    printf("        The ingestion cache (HARP_INGESTION_CACHE) is not used.\n");
+    printf("\n");
+    printf("        Options:\n");
+    printf("            -a, --operations <operation list>\n");
+    printf("                List of operations to apply to the product.\n");
+    printf("                An operation list needs to be provided as a single expression.\n");
+    printf("                This option can be given multiple times to benchmark multiple\n");
+    printf("                operation lists.\n");
+    printf("\n");
+    printf("            -o, --options <option list>\n");
+    printf("                List of options to pass to the ingestion module.\n");
+    printf("                Only applicable if the input product is not in HARP format.\n");
+    printf("                Options are separated by semi-colons. Each option consists\n");
+    printf("                of an <option name>=<value> pair. An option list needs to be\n");
+    printf("                provided as a single expression.\n");
+    printf("                This option can be given multiple times to benchmark multiple\n");
+    printf("                option lists.\n");
+    printf("\n");
+    printf("            -n, --repeat <count>\n");
+    printf("                Number of times each import is performed (default %d).\n", DEFAULT_NUM_REPEATS);
+    printf("                The minimum and mean times are reported.\n");
+    printf("\n");
+    printf("            --no-variable-times\n");
+    printf("                Do not measure the read time per variable. By default, each\n");
+    printf("                variable of the ingested product is also imported on its own\n");
+    printf("                (using a keep() operation) for each option list.\n");
+    printf("\n");
+    printf("            --output <file>\n");
+    printf("                Write the JSON results to the given file instead of to the\n");
+    printf("                standard output.\n");
+    printf("\n");
+    printf("    harpbench -h, --help\n");
+    printf("        Show help (this text).\n");
+    printf("\n");
+    printf("    harpbench -v, --version\n");
+    printf("        Print the version number of HARP and exit.\n");
+    printf("\n");
+}
+
+static double get_wall_time(void)
+{
+#ifdef WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec * 1.0e-6;
+#endif
+}
+
+static double get_cpu_time(void)
+{
+#ifdef WIN32
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+    {
+        return 0;
+    }
+
+    /* FILETIME values are in units of 100 nanoseconds */
+    return ((((unsigned __int64)kernel_time.dwHighDateTime) << 32) + kernel_time.dwLowDateTime +
+            (((unsigned __int64)user_time.dwHighDateTime) << 32) + user_time.dwLowDateTime) * 1.0e-7;
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1.0e-6 + usage.ru_stime.tv_sec +
+        usage.ru_stime.tv_usec * 1.0e-6;
+#endif
+}
+
+/* reset the peak resident set size of the process to its current resident set size
+ * returns 0 on success, or -1 if this is not supported
+ */
+static int reset_peak_rss(void)
+{
+#ifdef __linux__
+    FILE *f;
+
+    f = fopen("/proc/self/clear_refs", "w");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    if (fputs("5", f) == EOF)
+    {
+        fclose(f);
+        return -1;
+    }
+    if (fclose(f) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* returns the peak resident set size of the process since the last reset_peak_rss() in bytes, or -1 if not available */
+static long get_peak_rss(void)
+{
+#ifdef __linux__
+    char line[256];
+    long peak_rss = -1;
+    FILE *f;
+
+    f = fopen("/proc/self/status", "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (strncmp(line, "VmHWM:", 6) == 0)
+        {
+            /* the value is in kilobytes */
+            if (sscanf(&line[6], "%ld", &peak_rss) == 1)
+            {
+                peak_rss *= 1024;
+            }
+            else
+            {
+                peak_rss = -1;
+            }
+            break;
+        }
+    }
+    fclose(f);
+
+    return peak_rss;
+#else
+    return -1;
+#endif
+}
+
+/* import a product in a child process and return the peak resident set size of that process in bytes,
+ * or -1 if not available */
+static long get_child_peak_rss(const char *filename, const char *operations, const char *options)
+{
+#ifdef WIN32
+    (void)filename;
+    (void)operations;
+    (void)options;
+
+    return -1;
+#else
+    struct rusage usage;
+    harp_product *product;
+    pid_t pid;
+    int status;
+
+    /* make sure that pending output is not written twice */
+    fflush(NULL);
+    pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        _exit(harp_import(filename, operations, options, &product) == 0 ? 0 : 1);
+    }
+    if (wait4(pid, &status, 0, &usage) != pid)
+    {
+        return -1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+#ifdef __APPLE__
+    /* ru_maxrss is in bytes on macOS */
+    return (long)usage.ru_maxrss;
+#else
+    /* ru_maxrss is in kilobytes on Linux and BSD */
+    return (long)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static void write_json_string(FILE *output, const char *str)
+{
+    fputc('"', output);
+    if (str != NULL)
+    {
+        while (*str != '\0')
+        {
+            unsigned char c = (unsigned char)*str;
+
+            if (c == '"' || c == '\\')
+            {
+                fprintf(output, "\\%c", c);
+            }
+            else if (c == '\n')
+            {
+                fprintf(output, "\\n");
+            }
+            else if (c == '\t')
+            {
+                fprintf(output, "\\t");
+            }
+            else if (c < 0x20)
+            {
+                fprintf(output, "\\u%04x", c);
+            }
+            else
+            {
+                fputc(c, output);
+            }
+            str++;
+        }
+    }
+    fputc('"', output);
+}
+
+static void write_json_error(FILE *output, const char *indent)
+{
+    fprintf(output, "%s\"error\": ", indent);
+    write_json_string(output, harp_errno_to_string(harp_errno));
+}
+
+/* import a product 'num_repeats' times and return the minimum and mean wall clock time and the mean CPU time;
+ * the product of the last import is returned in 'product' (if not NULL) */
+static int time_import(const char *filename, const char *operations, const char *options, int num_repeats,
+                       double *wall_time_min, double *wall_time_mean, double *cpu_time_mean, harp_product **product)
+{
+    double wall_time_sum = 0;
+    double cpu_time_sum = 0;
+    int i;
+
+    *wall_time_min = 0;
+    for (i = 0; i < num_repeats; i++)
+    {
+        harp_product *imported_product;
+        double wall_time;
+        double cpu_time;
+
+        wall_time = get_wall_time();
+        cpu_time = get_cpu_time();
+        if (harp_import(filename, operations, options, &imported_product) != 0)
+        {
+            return -1;
+        }
+        wall_time = get_wall_time() - wall_time;
+        cpu_time = get_cpu_time() - cpu_time;
+
+        if (i == 0 || wall_time < *wall_time_min)
+        {
+            *wall_time_min = wall_time;
+        }
+        wall_time_sum += wall_time;
+        cpu_time_sum += cpu_time;
+
+        if (product != NULL && i == num_repeats - 1)
+        {
+            *product = imported_product;
+        }
+        else
+        {
+            harp_product_delete(imported_product);
+        }
+    }
+    *wall_time_mean = wall_time_sum / num_repeats;
+    *cpu_time_mean = cpu_time_sum / num_repeats;
+
+    return 0;
+}
+
+static int benchmark_case(benchmark_info *info, const char *filename, long file_size, const char *operations,
+                          const char *options)
+{
+    harp_product *product;
+    double wall_time_min;
+    double wall_time_mean;
+    double cpu_time_mean;
+    long peak_rss;
+    int peak_rss_reset;
+
+    fprintf(info->output, "        {\n");
+    fprintf(info->output, "          \"operations\": ");
+    write_json_string(info->output, operations == NULL ? "" : operations);
+    fprintf(info->output, ",\n          \"options\": ");
+    write_json_string(info->output, options == NULL ? "" : options);
+    fprintf(info->output, ",\n");
+
+    peak_rss_reset = (reset_peak_rss() == 0);
+    if (time_import(filename, operations, options, info->num_repeats, &wall_time_min, &wall_time_mean,
+                    &cpu_time_mean, &product) != 0)
+    {
+        write_json_error(info->output, "          ");
+        fprintf(info->output, "\n        }");
+        return -1;
+    }
+    peak_rss = peak_rss_reset ? get_peak_rss() : get_child_peak_rss(filename, operations, options);
+
+    fprintf(info->output, "          \"num_samples\": %ld,\n", product->dimension[harp_dimension_time]);
+    fprintf(info->output, "          \"num_variables\": %d,\n", product->num_variables);
+    fprintf(info->output, "          \"wall_time_min\": %.6f,\n", wall_time_min);
+    fprintf(info->output, "          \"wall_time_mean\": %.6f,\n", wall_time_mean);
+    fprintf(info->output, "          \"cpu_time_mean\": %.6f,\n", cpu_time_mean);
+    if (peak_rss >= 0)
+    {
+        fprintf(info->output, "          \"peak_rss\": %ld,\n", peak_rss);
+    }
+    else
+    {
+        fprintf(info->output, "          \"peak_rss\": null,\n");
+    }
+    if (wall_time_min > 0)
+    {
+        fprintf(info->output, "          \"megabytes_per_second\": %.3f,\n", file_size * 1.0e-6 / wall_time_min);
+        fprintf(info->output, "          \"samples_per_second\": %.3f\n",
+                product->dimension[harp_dimension_time] / wall_time_min);
+    }
+    else
+    {
+        fprintf(info->output, "          \"megabytes_per_second\": null,\n");
+        fprintf(info->output, "          \"samples_per_second\": null\n");
+    }
+    fprintf(info->output, "        }");
+
+    harp_product_delete(product);
+
+    return 0;
+}
+
+/* measure the time it takes to import each variable of the product on its own */
+static int benchmark_variables(benchmark_info *info, const char *filename, const char *options, int *first_entry)
+{
+    harp_product *product;
+    int result = 0;
+    int i;
+
+    if (harp_import(filename, NULL, options, &product) != 0)
+    {
+        fprintf(info->output, "%s        {\n          \"options\": ", *first_entry ? "" : ",\n");
+        write_json_string(info->output, options == NULL ? "" : options);
+        fprintf(info->output, ",\n");
+        write_json_error(info->output, "          ");
+        fprintf(info->output, "\n        }");
+        *first_entry = 0;
+        return -1;
+    }
+
+    for (i = 0; i < product->num_variables; i++)
+    {
+        const char *name = product->variable[i]->name;
+        double wall_time_min;
+        double wall_time_mean;
+        double cpu_time_mean;
+        char *operations;
+
+        operations = malloc(strlen(name) + 7);
+        if (operations == NULL)
+        {
+            harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                           strlen(name) + 7, __FILE__, __LINE__);
+            harp_product_delete(product);
+            return -1;
+        }
+        sprintf(operations, "keep(%s)", name);
+
+        fprintf(info->output, "%s        {\n          \"options\": ", *first_entry ? "" : ",\n");
+        write_json_string(info->output, options == NULL ? "" : options);
+        fprintf(info->output, ",\n          \"name\": ");
+        write_json_string(info->output, name);
+        fprintf(info->output, ",\n");
+        *first_entry = 0;
+
+        if (time_import(filename, operations, options, info->num_repeats, &wall_time_min, &wall_time_mean,
+                        &cpu_time_mean, NULL) != 0)
+        {
+            write_json_error(info->output, "          ");
+            fprintf(info->output, "\n");
+            result = -1;
+        }
+        else
+        {
+            fprintf(info->output, "          \"read_time_min\": %.6f,\n", wall_time_min);
+            fprintf(info->output, "          \"read_time_mean\": %.6f\n", wall_time_mean);
+        }
+        fprintf(info->output, "        }");
+
+        free(operations);
+    }
+
+    harp_product_delete(product);
+
+    return result;
+}
+
+static int benchmark_product(benchmark_info *info, const char *filename)
+{
+    harp_product_metadata *metadata;
+    struct stat statbuf;
+    int first_entry = 1;
+    int result = 0;
+    int i, j;
+
+    fprintf(info->output, "    {\n      \"filename\": ");
+    write_json_string(info->output, filename);
+    fprintf(info->output, ",\n");
+
+    if (stat(filename, &statbuf) != 0)
+    {
+        if (errno == ENOENT)
+        {
+            harp_set_error(HARP_ERROR_FILE_NOT_FOUND, "could not find %s", filename);
+        }
+        else
+        {
+            harp_set_error(HARP_ERROR_FILE_OPEN, "could not open %s (%s)", filename, strerror(errno));
+        }
+        write_json_error(info->output, "      ");
+        fprintf(info->output, "\n    }");
+        return -1;
+    }
+    if (harp_import_product_metadata(filename, info->num_options > 0 ? info->options[0] : NULL, &metadata) != 0)
+    {
+        write_json_error(info->output, "      ");
+        fprintf(info->output, "\n    }");
+        return -1;
+    }
+    fprintf(info->output, "      \"format\": ");
+    write_json_string(info->output, metadata->format);
+    fprintf(info->output, ",\n      \"file_size\": %ld,\n", (long)statbuf.st_size);
+    harp_product_metadata_delete(metadata);
+
+    fprintf(info->output, "      \"cases\": [\n");
+    for (i = 0; i < (info->num_options > 0 ? info->num_options : 1); i++)
+    {
+        const char *options = info->num_options > 0 ? info->options[i] : NULL;
+
+        for (j = 0; j < (info->num_operations > 0 ? info->num_operations : 1); j++)
+        {
+            const char *operations = info->num_operations > 0 ? info->operations[j] : NULL;
+
+            if (i > 0 || j > 0)
+            {
+                fprintf(info->output, ",\n");
+            }
+            if (benchmark_case(info, filename, (long)statbuf.st_size, operations, options) != 0)
+            {
+                result = -1;
+            }
+        }
+    }
+    fprintf(info->output, "\n      ]");
+
+    if (info->variable_times)
+    {
+        fprintf(info->output, ",\n      \"variables\": [\n");
+        for (i = 0; i < (info->num_options > 0 ? info->num_options : 1); i++)
+        {
+            if (benchmark_variables(info, filename, info->num_options > 0 ? info->options[i] : NULL, &first_entry)
+                != 0)
+            {
+                result = -1;
+            }
+        }
+        fprintf(info->output, "\n      ]");
+    }
+    fprintf(info->output, "\n    }");
+
+    return result;
+}
+
+static int benchmark(int argc, char *argv[])
+{
+    benchmark_info info;
+    const char *output_filename = NULL;
+    int result = 0;
+    int i;
+
+    info.num_operations = 0;
+    info.operations = malloc(argc * sizeof(const char *));
+    info.num_options = 0;
+    info.options = malloc(argc * sizeof(const char *));
+    info.num_repeats = DEFAULT_NUM_REPEATS;
+    info.variable_times = 1;
+    info.output = stdout;
+    if (info.operations == NULL || info.options == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory\n");
+        return -1;
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--operations") == 0) && i + 1 < argc &&
+            argv[i + 1][0] != '-')
+        {
+            info.operations[info.num_operations] = argv[i + 1];
+            info.num_operations++;
+            i++;
+        }
+        else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--options") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            info.options[info.num_options] = argv[i + 1];
+            info.num_options++;
+            i++;
+        }
+        else if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--repeat") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            info.num_repeats = atoi(argv[i + 1]);
+            if (info.num_repeats < 1)
+            {
+                fprintf(stderr, "ERROR: invalid repeat argument: '%s'\n", argv[i + 1]);
+                free(info.operations);
+                free(info.options);
+                return 1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--no-variable-times") == 0)
+        {
+            info.variable_times = 0;
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            output_filename = argv[i + 1];
+            i++;
+        }
+        else if (argv[i][0] != '-')
+        {
+            /* assume all arguments from here on are files */
+            break;
+        }
+        else
+        {
+            free(info.operations);
+            free(info.options);
+            return 1;
+        }
+    }
+    if (i == argc)
+    {
+        free(info.operations);
+        free(info.options);
+        return 1;
+    }
+
+    if (output_filename != NULL)
+    {
+        info.output = fopen(output_filename, "w");
+        if (info.output == NULL)
+        {
+            fprintf(stderr, "ERROR: could not open '%s' for writing\n", output_filename);
+            free(info.operations);
+            free(info.options);
+            return -1;
+        }
+    }
+
+    fprintf(info.output, "{\n  \"harp_version\": ");
+    write_json_string(info.output, libharp_version);
+    fprintf(info.output, ",\n  \"num_repeats\": %d,\n  \"products\": [\n", info.num_repeats);
+    for (; i < argc; i++)
+    {
+        if (benchmark_product(&info, argv[i]) != 0)
+        {
+            fprintf(stderr, "ERROR: %s: %s\n", argv[i], harp_errno_to_string(harp_errno));
+            result = -1;
+        }
+        fputs(i < argc - 1 ? ",\n" : "\n", info.output);
+    }
+    fprintf(info.output, "  ]\n}\n");
+
+    if (output_filename != NULL)
+    {
+        fclose(info.output);
+    }
+    free(info.operations);
+    free(info.options);
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    int result;
+
+    if (argc == 1 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+    {
+        print_help();
+        exit(0);
+    }
+
+    if (strcmp(argv[1], "-v") == 0 || strcmp(argv[1], "--version") == 0)
+    {
+        print_version();
+        exit(0);
+    }
+
+    if (harp_set_coda_definition_path_conditional(argv[0], NULL, "../share/coda/definitions") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+    if (harp_set_udunits2_xml_path_conditional(argv[0], NULL, "../share/harp/udunits2.xml") != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    harp_set_warning_handler(print_warning);
+
+    if (harp_init() != 0)
+    {
+        fprintf(stderr, "ERROR: %s\n", harp_errno_to_string(harp_errno));
+        exit(1);
+    }
+
+    /* always measure the actual ingestion */
+    harp_set_ingestion_cache_path(NULL);
+
+    result = benchmark(argc, argv);
+
+    harp_done();
+
+    if (result == 1)
+    {
+        fprintf(stderr, "ERROR: invalid arguments\n");
+        print_help();
+        exit(1);
+    }
+    if (result != 0)
+    {
+        exit(1);
+    }
+
+    return 0;
+}
@@ -79,6 +79,7 @@ typedef struct collocation_info_struct
     const char *ingest_options_b;
     const char *operations_a;
     const char *operations_b;
+    int num_prefetch;   /* number of upcoming product files of dataset A to read ahead */
 
     int perform_nearest_neighbour_x_first;
     char *nearest_neighbour_x_variable_name;
@@ -92,6 +93,7 @@ typedef struct collocation_info_struct
     /* state */
     long *sorted_index_a;       /* indices of products sorted by datetime_start/datetime_stop */
     long *sorted_index_b;
+    harp_dataset_import_iter *import_iter_a;    /* imports the products of dataset A in sorted_index_a order */
     long product_a_index;
     harp_product *product_a;    /* we only have one product of dataset A loaded at any moment */
     harp_product **product_b;   /* for dataset B we may have multiple products loaded */
@@ -264,6 +266,10 @@ static void collocation_info_delete(collocation_info *info)
         {
             free(info->sorted_index_b);
         }
+        if (info->import_iter_a != NULL)
+        {
+            harp_dataset_import_iter_delete(info->import_iter_a);
+        }
         if (info->product_a != NULL)
         {
             harp_product_delete(info->product_a);
@@ -361,6 +367,7 @@ static int collocation_info_new(collocation_info **new_info)
     info->ingest_options_b = NULL;
     info->operations_a = NULL;
     info->operations_b = NULL;
+    info->num_prefetch = 0;
     info->perform_nearest_neighbour_x_first = 0;
     info->nearest_neighbour_x_variable_name = NULL;
     info->nearest_neighbour_x_criterium_index = -1;
@@ -369,6 +376,7 @@ static int collocation_info_new(collocation_info **new_info)
     info->collocation_result = NULL;
     info->sorted_index_a = NULL;
     info->sorted_index_b = NULL;
+    info->import_iter_a = NULL;
     info->product_a_index = -1;
     info->product_a = NULL;
     info->product_b = NULL;
@@ -807,7 +815,41 @@ static void reindex_collocation_indices(harp_collocation_result *collocation_res
     }
 }
 
-static int perform_matchup_on_measurements(collocation_info *info, long index_a, long product_b_index, long index_b)
+/* determine the difference for criterium i and return whether the pair matches on this criterium
+ * the point distance (in [m]) needs to be provided by the caller */
+static int criterium_matches(collocation_info *info, int i, long index_a, long index_b, double point_distance)
+{
+    if (i == info->point_distance_index)
+    {
+        info->difference[i] = point_distance * info->point_distance_conversion_factor;
+    }
+    else
+    {
+        info->difference[i] = fabs(info->variables_a.criterium[i]->data.double_data[index_a] -
+                                   info->variables_b.criterium[i]->data.double_data[index_b]);
+        if (i == info->datetime_index)
+        {
+            info->difference[i] *= info->datetime_conversion_factor;
+        }
+    }
+    if (info->criterium[i]->use_modulo)
+    {
+        while (info->difference[i] > info->criterium[i]->modulo_value)
+        {
+            info->difference[i] -= info->criterium[i]->modulo_value;
+        }
+        if (info->difference[i] > info->criterium[i]->modulo_value / 2)
+        {
+            info->difference[i] = info->criterium[i]->modulo_value - info->difference[i];
+        }
+    }
+
+    /* a NaN value for the difference will also result in a mismatch */
+    return info->difference[i] <= info->criterium[i]->value;
+}
+
+static int perform_matchup_on_measurements(collocation_info *info, long index_a, long product_b_index, long index_b,
+                                           double point_distance)
 {
     double *longitude_bounds_a;
     double *latitude_bounds_a;
@@ -824,42 +866,7 @@ static int perform_matchup_on_measurements(collocation_info *info, long index_a,
 
     for (i = 0; i < info->num_criteria; i++)
     {
-        if (i == info->point_distance_index)
-        {
-            latitude_a = info->variables_a.latitude->data.double_data[index_a];
-            longitude_a = info->variables_a.longitude->data.double_data[index_a];
-            latitude_b = info->variables_b.latitude->data.double_data[index_b];
-            longitude_b = info->variables_b.longitude->data.double_data[index_b];
-
-            if (harp_geometry_get_point_distance(latitude_a, longitude_a, latitude_b, longitude_b, &info->difference[i])
-                != 0)
-            {
-                return -1;
-            }
-            info->difference[i] *= info->point_distance_conversion_factor;
-        }
-        else
-        {
-            info->difference[i] = fabs(info->variables_a.criterium[i]->data.double_data[index_a] -
-                                       info->variables_b.criterium[i]->data.double_data[index_b]);
-            if (i == info->datetime_index)
-            {
-                info->difference[i] *= info->datetime_conversion_factor;
-            }
-        }
-        if (info->criterium[i]->use_modulo)
-        {
-            while (info->difference[i] > info->criterium[i]->modulo_value)
-            {
-                info->difference[i] -= info->criterium[i]->modulo_value;
-            }
-            if (info->difference[i] > info->criterium[i]->modulo_value / 2)
-            {
-                info->difference[i] = info->criterium[i]->modulo_value - info->difference[i];
-            }
-        }
-        /* we use !(x<=y) instead of x>y so a NaN value for the difference will also result in a mismatch */
-        if (!(info->difference[i] <= info->criterium[i]->value))
+        if (!criterium_matches(info, i, index_a, index_b, point_distance))
         {
             return 0;
         }
@@ -1036,24 +1043,116 @@ static int perform_matchup_on_measurements(collocation_info *info, long index_a,
 
 static int perform_matchup_on_products(collocation_info *info, long product_b_index)
 {
-    long i, j;
+    double *candidate_latitude;
+    double *candidate_longitude;
+    double *candidate_distance;
+    long *candidate_index;
+    long num_samples_b;
+    long i, j, k;
+
+    if (info->point_distance_index < 0)
+    {
+        for (i = 0; i < info->product_a->dimension[harp_dimension_time]; i++)
+        {
+            for (j = 0; j < info->product_b[product_b_index]->dimension[harp_dimension_time]; j++)
+            {
+                if (perform_matchup_on_measurements(info, i, product_b_index, j, 0) != 0)
+                {
+                    harp_add_error_message(" (comparing %s [index=%ld] against %s [index=%ld])",
+                                           info->dataset_a->metadata[info->product_a_index]->filename,
+                                           info->variables_a.index->data.int32_data[i],
+                                           info->dataset_b->metadata[product_b_index]->filename,
+                                           info->variables_b.index->data.int32_data[j]);
+                    return -1;
+                }
+            }
+        }
+
+        return 0;
+    }
+
+    /* for each sample of A we first select the samples of B that match on all criteria other than the point distance
+     * and then calculate the point distances for all these candidates in one go */
+    num_samples_b = info->product_b[product_b_index]->dimension[harp_dimension_time];
+    if (num_samples_b == 0)
+    {
+        return 0;
+    }
+    candidate_index = malloc(num_samples_b * sizeof(long));
+    if (candidate_index == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       num_samples_b * sizeof(long), __FILE__, __LINE__);
+        return -1;
+    }
+    candidate_latitude = malloc(3 * num_samples_b * sizeof(double));
+    if (candidate_latitude == NULL)
+    {
+        harp_set_error(HARP_ERROR_OUT_OF_MEMORY, "out of memory (could not allocate %lu bytes) (%s:%u)",
+                       3 * num_samples_b * sizeof(double), __FILE__, __LINE__);
+        free(candidate_index);
+        return -1;
+    }
+    candidate_longitude = &candidate_latitude[num_samples_b];
+    candidate_distance = &candidate_latitude[2 * num_samples_b];
 
     for (i = 0; i < info->product_a->dimension[harp_dimension_time]; i++)
     {
-        for (j = 0; j < info->product_b[product_b_index]->dimension[harp_dimension_time]; j++)
+        long num_candidates = 0;
+
+        for (j = 0; j < num_samples_b; j++)
         {
-            if (perform_matchup_on_measurements(info, i, product_b_index, j) != 0)
+            int match = 1;
+
+            for (k = 0; k < info->num_criteria && match; k++)
+            {
+                if (k != info->point_distance_index)
+                {
+                    match = criterium_matches(info, (int)k, i, j, 0);
+                }
+            }
+            if (match)
+            {
+                candidate_index[num_candidates] = j;
+                candidate_latitude[num_candidates] = info->variables_b.latitude->data.double_data[j];
+                candidate_longitude[num_candidates] = info->variables_b.longitude->data.double_data[j];
+                num_candidates++;
+            }
+        }
+        if (num_candidates == 0)
+        {
+            continue;
+        }
+
+        if (harp_geometry_get_point_distances(info->variables_a.latitude->data.double_data[i],
+                                              info->variables_a.longitude->data.double_data[i], num_candidates,
+                                              candidate_latitude, candidate_longitude, candidate_distance) != 0)
+        {
+            free(candidate_latitude);
+            free(candidate_index);
+            return -1;
+        }
+
+        for (k = 0; k < num_candidates; k++)
+        {
+            j = candidate_index[k];
+            if (perform_matchup_on_measurements(info, i, product_b_index, j, candidate_distance[k]) != 0)
             {
                 harp_add_error_message(" (comparing %s [index=%ld] against %s [index=%ld])",
                                        info->dataset_a->metadata[info->product_a_index]->filename,
                                        info->variables_a.index->data.int32_data[i],
                                        info->dataset_b->metadata[product_b_index]->filename,
                                        info->variables_b.index->data.int32_data[j]);
+                free(candidate_latitude);
+                free(candidate_index);
                 return -1;
             }
         }
     }
 
+    free(candidate_latitude);
+    free(candidate_index);
+
     return 0;
 }
 
@@ -1363,6 +1462,12 @@ static int perform_matchup(collocation_info *info)
         delta_time = harp_plusinf();
     }
 
+    if (harp_dataset_import_iter_new(info->dataset_a, info->sorted_index_a, info->operations_a,
+                                     info->ingest_options_a, info->num_prefetch, &info->import_iter_a) != 0)
+    {
+        return -1;
+    }
+
     /* loop over products in dataset A */
     for (i = 0; i < info->dataset_a->num_products; i++)
     {
@@ -1372,8 +1477,7 @@ static int perform_matchup(collocation_info *info)
 
         /* import product of dataset A */
         info->product_a_index = index_a;
-        if (harp_import(info->dataset_a->metadata[index_a]->filename, info->operations_a, info->ingest_options_a,
-                        &info->product_a) != 0)
+        if (harp_dataset_import_iter_next(info->import_iter_a, NULL, &info->product_a) != 0)
         {
             return -1;
         }
@@ -1543,6 +1647,16 @@ int matchup(int argc, char *argv[])
             info->operations_b = argv[i + 1];
             i++;
         }
+        else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            info->num_prefetch = atoi(argv[i + 1]);
+            if (info->num_prefetch < 0)
+            {
+                collocation_info_delete(info);
+                return 1;
+            }
+            i++;
+        }
         else
         {
             if (argv[i][0] == '-' || i != argc - 3)
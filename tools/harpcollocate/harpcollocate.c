@@ -122,6 +122,10 @@ static void print_help(void)
     printf("            -ab, --operations-b <operation list>\n");
     printf("                List of operations to apply to each product of the second\n");
     printf("                dataset before collocating (see above).\n");
+    printf("            --prefetch <N>\n");
+    printf("                Ask the operating system to read the files of the next N\n");
+    printf("                products of the first dataset into its file cache while the\n");
+    printf("                current product is being collocated (default 0).\n");
     printf("        The order in which -nx and -ny are provided determines the order in\n");
     printf("        which the nearest filters are executed.\n");
     printf("        When '[unit]' is not specified, the unit of the variable of the\n");
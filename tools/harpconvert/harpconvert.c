@@ -89,6 +89,31 @@ static void print_help()
     printf("                Set data compression level for storing in HDF5 format.\n");
     printf("                0=disabled, 1=low, ..., 9=high.\n");
     printf("\n");
+    printf("            --hdf5-chunk-size <bytes>\n");
+    printf("                Set the target chunk size for compressed variables in HDF5\n");
+    printf("                format. Variables are split along the time dimension into\n");
+    printf("                chunks of at most this size (default 1048576). 0 stores\n");
+    printf("                each variable as a single chunk.\n");
+    printf("\n");
+    printf("            --hdf5-filter <filter>\n");
+    printf("                Compression filter for storing in HDF5 format:\n");
+    printf("                    deflate (default)\n");
+    printf("                    szip\n");
+    printf("\n");
+    printf("            --hdf5-shuffle\n");
+    printf("                Apply the shuffle filter before compression in HDF5 format.\n");
+    printf("\n");
+    printf("            --netcdf-unlimited-time\n");
+    printf("                Store the time dimension as unlimited (record) dimension in\n");
+    printf("                netCDF format, such that time samples can be appended later.\n");
+    printf("\n");
+    printf("            --append\n");
+    printf("                Append the time samples of the product to an existing netCDF\n");
+    printf("                output file that has an unlimited time dimension. The product\n");
+    printf("                should contain the same variables as the file. If the output\n");
+    printf("                file does not exist, it is created with an unlimited time\n");
+    printf("                dimension. Only the netcdf output format is supported.\n");
+    printf("\n");
     printf("            --no-history\n");
     printf("                Do not update the global history attribute.\n");
     printf("\n");
@@ -145,6 +170,7 @@ static int convert(int argc, char *argv[])
     const char *output_format = "netcdf";
     const char *input_filename = NULL;
     int update_history = 1;
+    int append = 0;
     int i;
 
     for (i = 1; i < argc; i++)
@@ -177,6 +203,46 @@ static int convert(int argc, char *argv[])
             }
             i++;
         }
+        else if (strcmp(argv[i], "--hdf5-chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_chunk_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 chunk size argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-filter") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (strcmp(argv[i + 1], "deflate") == 0)
+            {
+                harp_set_option_hdf5_compression_filter(0);
+            }
+            else if (strcmp(argv[i + 1], "szip") == 0)
+            {
+                harp_set_option_hdf5_compression_filter(1);
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 filter argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-shuffle") == 0)
+        {
+            harp_set_option_hdf5_shuffle(1);
+        }
+        else if (strcmp(argv[i], "--netcdf-unlimited-time") == 0)
+        {
+            harp_set_option_netcdf_unlimited_time(1);
+        }
+        else if (strcmp(argv[i], "--append") == 0)
+        {
+            append = 1;
+        }
         else if (strcmp(argv[i], "--no-history") == 0)
         {
             update_history = 0;
@@ -204,6 +270,13 @@ static int convert(int argc, char *argv[])
     input_filename = argv[argc - 2];
     output_filename = argv[argc - 1];
 
+    if (append && strcmp(output_format, "netcdf") != 0)
+    {
+        fprintf(stderr, "ERROR: --append is only supported for the netcdf output format\n");
+        print_help();
+        return -1;
+    }
+
     if (harp_import(input_filename, operations, options, &product) != 0)
     {
         return -1;
@@ -226,7 +299,15 @@ static int convert(int argc, char *argv[])
     }
 
     /* Export the product */
-    if (harp_export(output_filename, output_format, product) != 0)
+    if (append)
+    {
+        if (harp_export_append(output_filename, product) != 0)
+        {
+            harp_product_delete(product);
+            return -1;
+        }
+    }
+    else if (harp_export(output_filename, output_format, product) != 0)
     {
         harp_product_delete(product);
         return -1;
@@ -301,7 +301,15 @@ static int dump(int argc, char *argv[])
         return -1;
     }
 
-    if (harp_import(argv[argc - 1], operations, options, &product) != 0)
+    if (!data || list)
+    {
+        /* variable data is never accessed, so there is no need to read it */
+        if (harp_import_lazy(argv[argc - 1], operations, options, &product) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (harp_import(argv[argc - 1], operations, options, &product) != 0)
     {
         return -1;
     }
@@ -82,6 +82,15 @@ static void print_help()
     printf("                of time reduction operations (such as bin()) that would\n");
     printf("                normally be provided as part of the post operations.\n");
     printf("\n");
+    printf("            -ab, --bin <variable>[,<variable>...]\n");
+    printf("                Bin the merged product such that all samples that have the\n");
+    printf("                same combination of values for the given variables are\n");
+    printf("                averaged together (as with the bin() operation).\n");
+    printf("                Products are binned as they are read and samples are kept\n");
+    printf("                in temporary files instead of in memory. The result is the\n");
+    printf("                same as providing bin((<variable>, ...)) as the first post\n");
+    printf("                operation. This option can not be combined with -ar.\n");
+    printf("\n");
     printf("            -ap, --post-operations <operation list>\n");
     printf("                List of operations to apply to the merged product.\n");
     printf("                An operation list needs to be provided as a single expression.\n");
@@ -98,6 +107,12 @@ static void print_help()
     printf("            -l, --list\n");
     printf("                Print to stdout each filename that is currently being merged.\n");
     printf("\n");
+    printf("            --prefetch <N>\n");
+    printf("                Ask the operating system to read the files of the next N\n");
+    printf("                products into its file cache while the current product is\n");
+    printf("                being imported and merged (default 0). The products\n");
+    printf("                themselves are still imported one at a time, in sorted order.\n");
+    printf("\n");
     printf("            -f, --format <format>\n");
     printf("                Output format:\n");
     printf("                    netcdf (default)\n");
@@ -108,6 +123,31 @@ static void print_help()
     printf("                Set data compression level for storing in HDF5 format.\n");
     printf("                0=disabled, 1=low, ..., 9=high.\n");
     printf("\n");
+    printf("            --hdf5-chunk-size <bytes>\n");
+    printf("                Set the target chunk size for compressed variables in HDF5\n");
+    printf("                format. Variables are split along the time dimension into\n");
+    printf("                chunks of at most this size (default 1048576). 0 stores\n");
+    printf("                each variable as a single chunk.\n");
+    printf("\n");
+    printf("            --hdf5-filter <filter>\n");
+    printf("                Compression filter for storing in HDF5 format:\n");
+    printf("                    deflate (default)\n");
+    printf("                    szip\n");
+    printf("\n");
+    printf("            --hdf5-shuffle\n");
+    printf("                Apply the shuffle filter before compression in HDF5 format.\n");
+    printf("\n");
+    printf("            --netcdf-unlimited-time\n");
+    printf("                Store the time dimension as unlimited (record) dimension in\n");
+    printf("                netCDF format, such that time samples can be appended later.\n");
+    printf("\n");
+    printf("            --append\n");
+    printf("                Append the time samples of the product to an existing netCDF\n");
+    printf("                output file that has an unlimited time dimension. The product\n");
+    printf("                should contain the same variables as the file. If the output\n");
+    printf("                file does not exist, it is created with an unlimited time\n");
+    printf("                dimension. Only the netcdf output format is supported.\n");
+    printf("\n");
     printf("            --no-history\n");
     printf("                Do not update the global history attribute.\n");
     printf("\n");
@@ -122,28 +162,66 @@ static void print_help()
     printf("\n");
 }
 
-int merge_dataset(harp_product **merged_product, harp_dataset *dataset, const char *operations, const char *options,
-                  const char *reduce_operations, int verbose)
+int merge_dataset(harp_product **merged_product, harp_bin_stream *bin_stream, long *num_binned_products,
+                  harp_dataset *dataset, const char *operations, const char *options, const char *reduce_operations,
+                  int num_prefetch, int verbose)
 {
+    harp_dataset_import_iter *iter;
+    harp_product *product;
+    long time_capacity = 0;
     int i;
 
-    for (i = 0; i < dataset->num_products; i++)
+    if (bin_stream == NULL && operations == NULL && reduce_operations == NULL)
     {
-        harp_product *product;
-        int index;
-
-        /* add products in sorted order (sorted by source_product value) */
-        index = dataset->sorted_index[i];
+        /* without operations the merged time dimension is known up front from the product metadata */
+        if (*merged_product != NULL)
+        {
+            time_capacity = (*merged_product)->dimension[harp_dimension_time];
+        }
+        for (i = 0; i < dataset->num_products; i++)
+        {
+            if (dataset->metadata[i] == NULL)
+            {
+                time_capacity = 0;
+                break;
+            }
+            time_capacity += dataset->metadata[i]->dimension[harp_dimension_time] > 0 ?
+                dataset->metadata[i]->dimension[harp_dimension_time] : 1;
+        }
+    }
 
+    /* add products in sorted order (sorted by source_product value) */
+    if (harp_dataset_import_iter_new(dataset, NULL, operations, options, num_prefetch, &iter) != 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < dataset->num_products; i++)
+    {
         if (verbose)
         {
-            printf("%s\n", dataset->metadata[index]->filename);
+            printf("%s\n", dataset->metadata[dataset->sorted_index[i]]->filename);
         }
-        if (harp_import(dataset->metadata[index]->filename, operations, options, &product) != 0)
+        if (harp_dataset_import_iter_next(iter, NULL, &product) != 0)
         {
+            harp_dataset_import_iter_delete(iter);
             return -1;
         }
-        if (!harp_product_is_empty(product))
+        if (bin_stream != NULL)
+        {
+            if (!harp_product_is_empty(product))
+            {
+                if (harp_bin_stream_add_product(bin_stream, product, product->dimension[harp_dimension_time], NULL) !=
+                    0)
+                {
+                    harp_product_delete(product);
+                    harp_dataset_import_iter_delete(iter);
+                    return -1;
+                }
+                (*num_binned_products)++;
+            }
+            harp_product_delete(product);
+        }
+        else if (!harp_product_is_empty(product))
         {
             if (*merged_product == NULL)
             {
@@ -151,14 +229,27 @@ int merge_dataset(harp_product **merged_product, harp_dataset *dataset, const ch
                 /* if this remains the only product then make sure it still looks like it was the result of a merge */
                 if (harp_product_append(*merged_product, NULL) != 0)
                 {
+                    harp_dataset_import_iter_delete(iter);
                     return -1;
                 }
             }
             else
             {
+                if (time_capacity > 0)
+                {
+                    /* allocate the merged variables only once for the full dataset */
+                    if (harp_product_reserve_time_capacity(*merged_product, time_capacity) != 0)
+                    {
+                        harp_product_delete(product);
+                        harp_dataset_import_iter_delete(iter);
+                        return -1;
+                    }
+                    time_capacity = 0;
+                }
                 if (harp_product_append(*merged_product, product) != 0)
                 {
                     harp_product_delete(product);
+                    harp_dataset_import_iter_delete(iter);
                     return -1;
                 }
                 harp_product_delete(product);
@@ -168,25 +259,99 @@ int merge_dataset(harp_product **merged_product, harp_dataset *dataset, const ch
                 /* perform reduction operations on the partially merged product after each append */
                 if (harp_product_execute_operations(*merged_product, reduce_operations) != 0)
                 {
+                    harp_dataset_import_iter_delete(iter);
                     return -1;
                 }
             }
         }
+        else
+        {
+            harp_product_delete(product);
+        }
+    }
+    harp_dataset_import_iter_delete(iter);
+
+    if (*merged_product != NULL)
+    {
+        /* release the memory that was reserved for further appends */
+        if (harp_product_trim_time_capacity(*merged_product) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* create a binning stream for a comma separated list of variable names */
+static int create_bin_stream(const char *bin_variables, harp_bin_stream **bin_stream)
+{
+    const char **variable_name;
+    char *variable_list;
+    char *cursor;
+    int num_variables = 1;
+    int i;
+
+    variable_list = strdup(bin_variables);
+    if (variable_list == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory\n");
+        return -1;
+    }
+    for (cursor = variable_list; *cursor != '\0'; cursor++)
+    {
+        if (*cursor == ',')
+        {
+            num_variables++;
+        }
+    }
+    variable_name = malloc(num_variables * sizeof(char *));
+    if (variable_name == NULL)
+    {
+        fprintf(stderr, "ERROR: out of memory\n");
+        free(variable_list);
+        return -1;
+    }
+    variable_name[0] = variable_list;
+    i = 1;
+    for (cursor = variable_list; *cursor != '\0'; cursor++)
+    {
+        if (*cursor == ',')
+        {
+            *cursor = '\0';
+            variable_name[i] = cursor + 1;
+            i++;
+        }
+    }
+
+    if (harp_bin_stream_new_with_variable(num_variables, variable_name, bin_stream) != 0)
+    {
+        free(variable_name);
+        free(variable_list);
+        return -1;
     }
 
+    free(variable_name);
+    free(variable_list);
+
     return 0;
 }
 
 static int merge(int argc, char *argv[])
 {
     harp_product *merged_product = NULL;
+    harp_bin_stream *bin_stream = NULL;
+    long num_binned_products = 0;
     const char *operations = NULL;
     const char *reduce_operations = NULL;
+    const char *bin_variables = NULL;
     const char *post_operations = NULL;
     const char *options = NULL;
     const char *output_filename = NULL;
     const char *output_format = "netcdf";
     int update_history = 1;
+    int append = 0;
+    int num_prefetch = 0;
     int verbose = 0;
     int i;
 
@@ -205,6 +370,12 @@ static int merge(int argc, char *argv[])
             reduce_operations = argv[i + 1];
             i++;
         }
+        else if ((strcmp(argv[i], "-ab") == 0 || strcmp(argv[i], "--bin") == 0) && i + 1 < argc &&
+                 argv[i + 1][0] != '-')
+        {
+            bin_variables = argv[i + 1];
+            i++;
+        }
         else if ((strcmp(argv[i], "-ap") == 0 || strcmp(argv[i], "--post-operations") == 0) && i + 1 < argc &&
                  argv[i + 1][0] != '-')
         {
@@ -227,6 +398,17 @@ static int merge(int argc, char *argv[])
         {
             verbose = 1;
         }
+        else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            num_prefetch = atoi(argv[i + 1]);
+            if (num_prefetch < 0)
+            {
+                fprintf(stderr, "ERROR: invalid prefetch argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
         else if (strcmp(argv[i], "--hdf5-compression") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
         {
             if (harp_set_option_hdf5_compression(atoi(argv[i + 1])) != 0)
@@ -237,6 +419,46 @@ static int merge(int argc, char *argv[])
             }
             i++;
         }
+        else if (strcmp(argv[i], "--hdf5-chunk-size") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (harp_set_option_hdf5_chunk_size(atol(argv[i + 1])) != 0)
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 chunk size argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-filter") == 0 && i + 1 < argc && argv[i + 1][0] != '-')
+        {
+            if (strcmp(argv[i + 1], "deflate") == 0)
+            {
+                harp_set_option_hdf5_compression_filter(0);
+            }
+            else if (strcmp(argv[i + 1], "szip") == 0)
+            {
+                harp_set_option_hdf5_compression_filter(1);
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: invalid hdf5 filter argument: '%s'\n", argv[i + 1]);
+                print_help();
+                return -1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i], "--hdf5-shuffle") == 0)
+        {
+            harp_set_option_hdf5_shuffle(1);
+        }
+        else if (strcmp(argv[i], "--netcdf-unlimited-time") == 0)
+        {
+            harp_set_option_netcdf_unlimited_time(1);
+        }
+        else if (strcmp(argv[i], "--append") == 0)
+        {
+            append = 1;
+        }
         else if (strcmp(argv[i], "--no-history") == 0)
         {
             update_history = 0;
@@ -262,29 +484,67 @@ static int merge(int argc, char *argv[])
     }
     output_filename = argv[argc - 1];
 
+    if (append && strcmp(output_format, "netcdf") != 0)
+    {
+        fprintf(stderr, "ERROR: --append is only supported for the netcdf output format\n");
+        print_help();
+        return -1;
+    }
+
+    if (bin_variables != NULL)
+    {
+        if (reduce_operations != NULL)
+        {
+            fprintf(stderr, "ERROR: options -ab and -ar can not be combined\n");
+            print_help();
+            return -1;
+        }
+        if (create_bin_stream(bin_variables, &bin_stream) != 0)
+        {
+            return -1;
+        }
+    }
+
     while (i < argc - 1)
     {
         harp_dataset *dataset;
 
         if (harp_dataset_new(&dataset) != 0)
         {
+            harp_bin_stream_delete(bin_stream);
             return -1;
         }
         if (harp_dataset_import(dataset, argv[i], options) != 0)
         {
             harp_dataset_delete(dataset);
+            harp_bin_stream_delete(bin_stream);
             return -1;
         }
-        if (merge_dataset(&merged_product, dataset, operations, options, reduce_operations, verbose) != 0)
+        if (merge_dataset(&merged_product, bin_stream, &num_binned_products, dataset, operations, options,
+                          reduce_operations, num_prefetch, verbose) != 0)
         {
             harp_product_delete(merged_product);
             harp_dataset_delete(dataset);
+            harp_bin_stream_delete(bin_stream);
             return -1;
         }
         harp_dataset_delete(dataset);
         i++;
     }
 
+    if (bin_stream != NULL)
+    {
+        if (num_binned_products > 0)
+        {
+            if (harp_bin_stream_finish(bin_stream, &merged_product) != 0)
+            {
+                harp_bin_stream_delete(bin_stream);
+                return -1;
+            }
+        }
+        harp_bin_stream_delete(bin_stream);
+    }
+
     if (merged_product == NULL)
     {
         return -2;
@@ -319,7 +579,15 @@ static int merge(int argc, char *argv[])
     }
 
     /* export the product */
-    if (harp_export(output_filename, output_format, merged_product) != 0)
+    if (append)
+    {
+        if (harp_export_append(output_filename, merged_product) != 0)
+        {
+            harp_product_delete(merged_product);
+            return -1;
+        }
+    }
+    else if (harp_export(output_filename, output_format, merged_product) != 0)
     {
         harp_product_delete(merged_product);
         return -1;